@@ -213,4 +213,20 @@
   sv_setnv($result, (double) vrna_md_defaults_sfact_get());
 }
 
+%typemap(varin) int wavefront {
+  vrna_md_defaults_wavefront(SvIV($input));
+}
+
+%typemap(varout) int wavefront {
+  sv_setiv($result, (IV) vrna_md_defaults_wavefront_get());
+}
+
+%typemap(varin) int pf_float {
+  vrna_md_defaults_pf_float(SvIV($input));
+}
+
+%typemap(varout) int pf_float {
+  sv_setiv($result, (IV) vrna_md_defaults_pf_float_get());
+}
+
 #endif
@@ -214,5 +214,21 @@
   $result = PyFloat_FromDouble(vrna_md_defaults_sfact_get());
 }
 
+%typemap(varin) int wavefront {
+  vrna_md_defaults_wavefront(PyInt_AsLong($input));
+}
+
+%typemap(varout) int wavefront {
+  $result = PyInt_FromLong(vrna_md_defaults_wavefront_get());
+}
+
+%typemap(varin) int pf_float {
+  vrna_md_defaults_pf_float(PyInt_AsLong($input));
+}
+
+%typemap(varout) int pf_float {
+  $result = PyInt_FromLong(vrna_md_defaults_pf_float_get());
+}
+
 #endif
 
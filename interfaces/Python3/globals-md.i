@@ -214,5 +214,21 @@
   $result = PyFloat_FromDouble(vrna_md_defaults_sfact_get());
 }
 
+%typemap(varin) int wavefront {
+  vrna_md_defaults_wavefront((int)PyLong_AsLong($input));
+}
+
+%typemap(varout) int wavefront {
+  $result = PyLong_FromLong((long)vrna_md_defaults_wavefront_get());
+}
+
+%typemap(varin) int pf_float {
+  vrna_md_defaults_pf_float((int)PyLong_AsLong($input));
+}
+
+%typemap(varout) int pf_float {
+  $result = PyLong_FromLong((long)vrna_md_defaults_pf_float_get());
+}
+
 #endif
 
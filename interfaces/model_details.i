@@ -33,6 +33,8 @@ typedef struct {
   double  cv_fact;
   double  nc_fact;
   double  sfact;
+  int     wavefront;
+  int     pf_float;
   int     rtype[8];
   short   alias[MAXALPHA+1];
 } vrna_md_t;
@@ -112,6 +114,8 @@ extern int    ribo;
 extern double cv_fact;
 extern double nc_fact;
 extern double sfact;
+extern int    wavefront;
+extern int    pf_float;
 
 %include <ViennaRNA/model.h>
 
@@ -50,6 +50,7 @@ RNA_ENABLE_SVM
 RNA_ENABLE_JSON
 RNA_ENABLE_GSL
 RNA_ENABLE_OPENMP
+RNA_ENABLE_SIMD
 RNA_ENABLE_BOUSTROPHEDON
 RNA_ENABLE_FLOATPF
 RNA_ENABLE_DEPRECATION_WARNINGS
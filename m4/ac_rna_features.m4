@@ -26,6 +26,10 @@ AC_DEFUN([RNA_GET_FEATURE],[
     AC_RNA_APPEND_VAR_COMMA($1, [LTO])
     _features_active=1
   ])
+  AS_IF([test "x$enable_simd" = "xyes"], [
+    AC_RNA_APPEND_VAR_COMMA($1, [SIMD($simd_extensions)])
+    _features_active=1
+  ])
   AS_IF([test "x$enable_floatpf" = "xyes"], [
     AC_RNA_APPEND_VAR_COMMA($1, [Float Precision(PF)])
     _features_active=1
@@ -188,6 +192,67 @@ AC_DEFUN([RNA_ENABLE_OPENMP],[
 ])
 
 
+#
+# SIMD optimized kernels
+#
+
+AC_DEFUN([RNA_ENABLE_SIMD],[
+
+  AX_REQUIRE_DEFINED([AX_CHECK_COMPILE_FLAG])
+
+  RNA_ADD_FEATURE([simd],
+                  [SIMD optimized (SSE4.1/AVX2/AVX-512) kernels with runtime CPU dispatch],
+                  [yes])
+
+  ac_sse41_supported=no
+  ac_avx2_supported=no
+  ac_avx512_supported=no
+  simd_extensions=""
+
+  RNA_FEATURE_IF_ENABLED([simd],[
+    ## SIMD kernels are only implemented for x86 architectures
+    case "$host_cpu" in
+      x86_64|i?86)
+        AC_LANG_PUSH([C])
+        AX_CHECK_COMPILE_FLAG([-msse4.1], [
+          ac_sse41_supported=yes
+          SSE41_CFLAGS="-msse4.1"
+          AC_DEFINE([VRNA_WITH_SSE41_IMPLEMENTATION], [1], [Compile SSE4.1 optimized kernels])
+          AC_RNA_APPEND_VAR_COMMA(simd_extensions, [SSE4.1])
+        ],[],[],[])
+        AX_CHECK_COMPILE_FLAG([-mavx2], [
+          ac_avx2_supported=yes
+          AVX2_CFLAGS="-mavx2"
+          AC_DEFINE([VRNA_WITH_AVX2_IMPLEMENTATION], [1], [Compile AVX2 optimized kernels])
+          AC_RNA_APPEND_VAR_COMMA(simd_extensions, [AVX2])
+        ],[],[],[])
+        AX_CHECK_COMPILE_FLAG([-mavx512f], [
+          ac_avx512_supported=yes
+          AVX512_CFLAGS="-mavx512f"
+          AC_DEFINE([VRNA_WITH_AVX512_IMPLEMENTATION], [1], [Compile AVX-512 optimized kernels])
+          AC_RNA_APPEND_VAR_COMMA(simd_extensions, [AVX-512])
+        ],[],[],[])
+        AC_LANG_POP([C])
+        ;;
+      *)
+        ;;
+    esac
+
+    AS_IF([ test "x$simd_extensions" = "x" ],[
+      AC_MSG_WARN([No SIMD instruction set extensions available, using scalar implementations only])
+      enable_simd="no"
+    ])
+  ])
+
+  AC_SUBST(SSE41_CFLAGS)
+  AC_SUBST(AVX2_CFLAGS)
+  AC_SUBST(AVX512_CFLAGS)
+  AM_CONDITIONAL(VRNA_AM_SWITCH_SSE41, test "x$ac_sse41_supported" = "xyes")
+  AM_CONDITIONAL(VRNA_AM_SWITCH_AVX2, test "x$ac_avx2_supported" = "xyes")
+  AM_CONDITIONAL(VRNA_AM_SWITCH_AVX512, test "x$ac_avx512_supported" = "xyes")
+])
+
+
 #
 # C11 feature support
 #
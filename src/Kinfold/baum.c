@@ -45,51 +45,76 @@ typedef struct _baum {
   struct _baum *down;
 } baum;
 
+/* ringlist-tree of a trajectory */
+typedef struct _RingList {
+  short *pairList;
+  short *typeList;
+  short *aliasList;
+  baum *rl;                /* ringlist */
+  baum *wurzl;             /* virtualroot of ringlist-tree */
+  char **ptype;
+  int loopE;               /* sum of all loop energies of the current structure */
+  int treeE;               /* energy of the current structure */
+  int crossPairs;          /* number of base pairs between the two strands */
+  int duplexInit;          /* dimer initiation penalty */
+  unsigned long treeKey;   /* hash key of the current structure */
+  baum **renew;            /* loops whose neighbours are renewed by update_tree() */
+  char *is_renewed;        /* flags the loops in renew by owner() */
+} RingList;
+
 static char UNUSED rcsid[]="$Id: baum.c,v 1.9 2008/05/21 10:15:45 ivo Exp $";
-static short *pairList = NULL;
-static short *typeList = NULL;
-static short *aliasList = NULL;
-static baum *rl = NULL;         /* ringlist */
-static baum *wurzl = NULL;      /* virtualroot of ringlist-tree */
-static char **ptype = NULL;
 
 static int comp_struc(const void *A, const void *B);
 /* PUBLIC FUNCTIONES */
-void ini_or_reset_rl (void);
-void move_it (void);
-void update_tree (int i, int j);
-void clean_up_rl (void);
+void ini_start_stop (void);
+void ini_or_reset_rl(TrajVars *T);
+void move_it(TrajVars *T);
+void update_tree(TrajVars *T, int i, int j);
+void clean_up_rl(TrajVars *T);
+unsigned long current_key(TrajVars *T);
+unsigned long structure_key (const char *struc);
 
 /* PRIVATE FUNCTIONES */
-static void ini_ringlist(void);
-static void reset_ringlist(void);
-static void struc2tree (char *struc);
-static void close_bp_en (baum *i, baum *j);
-static void close_bp (baum *i, baum *j);
-static void open_bp (baum *i);
-static void open_bp_en (baum *i);
-static void inb (baum *root);
-static void inb_nolp (baum *root);
-static void dnb (baum *rli);
-static void dnb_nolp (baum *rli);
-static void fnb (baum *rli);
-static void make_ptypes(const short *S);
+static void ini_ringlist(TrajVars *T);
+static void reset_ringlist(TrajVars *T);
+static void struc2tree(TrajVars *T, char *struc);
+static void close_bp_en(TrajVars *T, baum *i, baum *j);
+static void close_bp(TrajVars *T, baum *i, baum *j);
+static void open_bp(TrajVars *T, baum *i);
+static void open_bp_en(TrajVars *T, baum *i);
+static void inb(TrajVars *T, baum *root);
+static void inb_nolp(TrajVars *T, baum *root);
+static void dnb(TrajVars *T, baum *rli);
+static void dnb_nolp(TrajVars *T, baum *rli);
+static void fnb(TrajVars *T, baum *rli);
+static void lnb(TrajVars *T, baum *root);
+static void all_nb(TrajVars *T);
+static void renew_nb(TrajVars *T, baum **touched, int n);
+static void mark_renew(TrajVars *T, baum *root, int *n);
+static int owner(TrajVars *T, baum *root);
+static void tree_energy(TrajVars *T);
+static void make_ptypes(TrajVars *T, const short *S);
+static int eval_loop(TrajVars *T, baum *root);
+static baum *enclosing_pair(baum *i);
+static int energy_of_tree(TrajVars *T, int E_loops);
+static unsigned long pair_key(int i, int j);
 /* debugging tool(s) */
 #if 0
-static void rl_status(void);
+static void rl_status(TrajVars *T);
 #endif
 
 /* convert structure in bracked-dot-notation to a ringlist-tree */
-static void struc2tree(char *struc) {
+static void struc2tree(TrajVars *T, char *struc) {
+  RingList *R = T->ring;
   char* struc_copy;
   int ipos, jpos, balance = 0;
   baum *rli, *rlj;
 
-  struc_copy = (char *)calloc(GSV.len+1, sizeof(char));
+  struc_copy = (char *)calloc(T->len+1, sizeof(char));
   assert(struc_copy);
   strcpy(struc_copy,struc);
 
-  for (ipos = 0; ipos < GSV.len; ipos++) {
+  for (ipos = 0; ipos < T->len; ipos++) {
     if (struc_copy[ipos] == ')') {
       jpos = ipos;
       struc_copy[ipos] = '.';
@@ -97,274 +122,338 @@ static void struc2tree(char *struc) {
       while (struc_copy[--ipos] != '(');
       struc_copy[ipos] = '.';
       balance--;
-      rli = &rl[ipos];
-      rlj = &rl[jpos];
-      close_bp(rli, rlj);
+      rli = &R->rl[ipos];
+      rlj = &R->rl[jpos];
+      close_bp(T, rli, rlj);
     }
   }
 
   if (balance) {
     fprintf(stderr,
 	    "struc2tree(): start structure is not balanced !\n%s\n%s\n",
-	    GAV.farbe, struc);
+	    T->farbe, struc);
     exit(1);
   }
 
 #if HAVE_LIBRNA_API3
-  GSV.currE = GSV.startE = (float)vrna_eval_structure_pt(GAV.vc, pairList) / 100.0;
+  T->currE = (float)vrna_eval_structure_pt(T->vc, R->pairList) / 100.0;
 #else
-  GSV.currE = GSV.startE =
-    (float )energy_of_struct_pt_par(GAV.farbe, pairList, typeList,
-				    aliasList, GAV.params, 0) / 100.0;
+  T->currE =
+    (float )energy_of_struct_pt_par(T->farbe, R->pairList, R->typeList,
+				    R->aliasList, GAV.params, 0) / 100.0;
 #endif
   {
     int i;
-    for(i = 0; i < GSV.len; i++) {
-      if (pairList[i+1]>i+1)
-#if HAVE_LIBRNA_API3
-        rl[i].loop_energy = vrna_eval_loop_pt(GAV.vc, i+1, pairList);
-#else
-	rl[i].loop_energy = loop_energy(pairList, typeList, aliasList,i+1);
-#endif
+    for(i = 0; i < T->len; i++) {
+      if (R->pairList[i+1]>i+1)
+        R->rl[i].loop_energy = eval_loop(T, &R->rl[i]);
     }
-#if HAVE_LIBRNA_API3
-    wurzl->loop_energy = vrna_eval_loop_pt(GAV.vc, 0, pairList);
-#else
-    wurzl->loop_energy = loop_energy(pairList, typeList, aliasList,0);
-#endif
+    R->wurzl->loop_energy = eval_loop(T, R->wurzl);
+
+    /* energy of the structure is the sum of its loop energies */
+    R->loopE = R->wurzl->loop_energy;
+    for(i = 0; i < T->len; i++)
+      if (R->pairList[i+1]>i+1) R->loopE += R->rl[i].loop_energy;
   }
 
   free(struc_copy);
 }
 
 /**/
-static void ini_ringlist(void) {
+static void ini_ringlist(TrajVars *T) {
   int i;
+  RingList *R;
+
+  R = T->ring = (RingList *)calloc(1, sizeof(RingList));
+  assert(R != NULL);
 
   /* needed by function energy_of_struct_pt() from Vienna-RNA-1.4 */
-  pairList = (short *)calloc(GSV.len + 2, sizeof(short));
-  assert(pairList != NULL);
-  typeList = (short *)calloc(GSV.len + 2, sizeof(short));
-  assert(typeList != NULL);
-  aliasList = (short *)calloc(GSV.len + 2, sizeof(short));
-  assert(aliasList != NULL);
-  pairList[0] = typeList[0] = aliasList[0] = GSV.len;
-  ptype =  (char **)calloc(GSV.len + 2, sizeof(char *));
-  assert(ptype != NULL);
-  for (i=0; i<=GSV.len; i++) {
-    ptype[i] =   (char*)calloc(GSV.len + 2, sizeof(char));
-    assert(ptype[i] != NULL);
+  R->pairList = (short *)calloc(T->len + 2, sizeof(short));
+  assert(R->pairList != NULL);
+  R->typeList = (short *)calloc(T->len + 2, sizeof(short));
+  assert(R->typeList != NULL);
+  R->aliasList = (short *)calloc(T->len + 2, sizeof(short));
+  assert(R->aliasList != NULL);
+  R->pairList[0] = R->typeList[0] = R->aliasList[0] = T->len;
+  R->ptype =  (char **)calloc(T->len + 2, sizeof(char *));
+  assert(R->ptype != NULL);
+  for (i=0; i<=T->len; i++) {
+    R->ptype[i] =   (char*)calloc(T->len + 2, sizeof(char));
+    assert(R->ptype[i] != NULL);
   }
 
   /* allocate virtual root */
-  wurzl = (baum *)calloc(1, sizeof(baum));
-  assert(wurzl != NULL);
+  R->wurzl = (baum *)calloc(1, sizeof(baum));
+  assert(R->wurzl != NULL);
   /* allocate ringList */
-  rl = (baum *)calloc(GSV.len+1, sizeof(baum));
-  assert(rl != NULL);
+  R->rl = (baum *)calloc(T->len+1, sizeof(baum));
+  assert(R->rl != NULL);
+  /* one for each pair and the virtualroot */
+  R->renew = (baum **)calloc(T->len+1, sizeof(baum *));
+  assert(R->renew != NULL);
+  R->is_renewed = (char *)calloc(T->len+1, sizeof(char));
+  assert(R->is_renewed != NULL);
   /* allocate PostOrderList */
 
   /* initialize virtualroot */
-  wurzl->typ = 'r';
-  wurzl->nummer = -1;
+  R->wurzl->typ = 'r';
+  R->wurzl->nummer = -1;
   /* connect virtualroot to ringlist-tree in down direction */
-  wurzl->down = &rl[GSV.len];
+  R->wurzl->down = &R->rl[T->len];
   /* initialize post-order list */
 
   make_pair_matrix();
 
   /* initialize rest of ringlist-tree */
-  for(i = 0; i < GSV.len; i++) {
+  for(i = 0; i < T->len; i++) {
     int c;
-    GAV.currform[i] = '.';
-    GAV.prevform[i] = 'x';
-    pairList[i+1] = 0;
-    rl[i].typ = 'u';
+    T->currform[i] = '.';
+    T->prevform[i] = 'x';
+    R->pairList[i+1] = 0;
+    R->rl[i].typ = 'u';
     /* decode base to numeric value */
-    c = encode_char(GAV.farbe[i]);
-    rl[i].base = typeList[i+1] = c;
-    aliasList[i+1] = alias[typeList[i+1]];
+    c = encode_char(T->farbe[i]);
+    R->rl[i].base = R->typeList[i+1] = c;
+    R->aliasList[i+1] = alias[R->typeList[i+1]];
     /* astablish links for node of the ringlist-tree */
-    rl[i].nummer = i;
-    rl[i].next = &rl[i+1];
-    rl[i].prev = ((i == 0) ? &rl[GSV.len] : &rl[i-1]);
-    rl[i].up = rl[i].down = NULL;
+    R->rl[i].nummer = i;
+    R->rl[i].next = &R->rl[i+1];
+    R->rl[i].prev = ((i == 0) ? &R->rl[T->len] : &R->rl[i-1]);
+    R->rl[i].up = R->rl[i].down = NULL;
   }
-  GAV.currform[GSV.len] =   GAV.prevform[GSV.len] = '\0';
-  make_ptypes(aliasList);
+  T->currform[T->len] =   T->prevform[T->len] = '\0';
+  make_ptypes(T, R->aliasList);
 
-  rl[i].nummer = i;
-  rl[i].base = 0;
+  R->rl[i].nummer = i;
+  R->rl[i].base = 0;
   /* make ringlist circular in next, prev direction */
-  rl[i].next = &rl[0];
-  rl[i].prev = &rl[i-1];
+  R->rl[i].next = &R->rl[0];
+  R->rl[i].prev = &R->rl[i-1];
   /* make virtual basepair for virtualroot */
-  rl[i].up = wurzl;
-  rl[i].typ = 'x';
+  R->rl[i].up = R->wurzl;
+  R->rl[i].typ = 'x';
 
+  R->crossPairs = 0;
+  R->treeKey = 0;
+#if HAVE_LIBRNA_API3
+  R->duplexInit = T->vc->params->DuplexInit;
+#else
+  R->duplexInit = GAV.params->DuplexInit;
+#endif
 }
 
-/**/
-void ini_or_reset_rl(void) {
+/* energies of start and stop structure(s), shared by all trajectories */
+void ini_start_stop(void) {
 
-  /* if there is no ringList-tree make a new one */
-  if (wurzl == NULL) {
-    ini_ringlist();
+  make_pair_matrix();
 
-    /* start structure */
-    struc2tree(GAV.startform);
 #if HAVE_LIBRNA_API3
-    GSV.currE = GSV.startE = vrna_eval_structure(GAV.vc, GAV.startform);
+  GSV.startE = vrna_eval_structure(GAV.vc, GAV.startform);
 #else
-    GSV.currE = GSV.startE = energy_of_structure(GAV.farbe, GAV.startform, 0);
+  GSV.startE = energy_of_structure(GAV.farbe, GAV.startform, 0);
 #endif
 
-    /* stop structure(s) */
-    if ( GTV.stop )  {
-      int i;
+  /* stop structure(s) */
+  if ( GTV.stop )  {
+    int i;
 
-      qsort(GAV.stopform, GSV.maxS, sizeof(char *), comp_struc);
+    qsort(GAV.stopform, GSV.maxS, sizeof(char *), comp_struc);
 #if HAVE_LIBRNA_API3
-      /*
-        note that we need to hack the full length into GAV.vc again,
-        in case it was shortened due to chain growth simulation
-      */
-      unsigned int n, tmp_n;
-      n     = strlen(GAV.farbe_full);
-      tmp_n = GAV.vc->length;
-      GAV.vc->length = n;
-      for (i = 0; i< GSV.maxS; i++)
-        GAV.sE[i] = vrna_eval_structure(GAV.vc, GAV.stopform[i]);
-      GAV.vc->length = tmp_n;
+    /*
+      note that we need to hack the full length into GAV.vc again,
+      in case it was shortened due to chain growth simulation
+    */
+    unsigned int n, tmp_n;
+    n     = strlen(GAV.farbe_full);
+    tmp_n = GAV.vc->length;
+    GAV.vc->length = n;
+    for (i = 0; i< GSV.maxS; i++)
+      GAV.sE[i] = vrna_eval_structure(GAV.vc, GAV.stopform[i]);
+    GAV.vc->length = tmp_n;
 #else
-      for (i = 0; i< GSV.maxS; i++)
-	GAV.sE[i] = energy_of_structure(GAV.farbe_full, GAV.stopform[i], 0);
+    for (i = 0; i< GSV.maxS; i++)
+      GAV.sE[i] = energy_of_structure(GAV.farbe_full, GAV.stopform[i], 0);
 #endif
-    }
-    else {
+  }
+  else {
 #if HAVE_LIBRNA_API3
-      /* fold sequence to get Minimum free energy structure (Mfe) */
-      /*
-        note that we need to hack the full length into GAV.vc again,
-        in case it was shortened due to chain growth simulation
-      */
-      unsigned int n, tmp_n;
-      n     = strlen(GAV.farbe_full);
-      tmp_n = GAV.vc->length;
-      GAV.vc->length = n;
-      GAV.sE[0] = vrna_mfe_dimer(GAV.vc, GAV.stopform[0]);
-      vrna_mx_mfe_free(GAV.vc);
-      /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
-      GAV.sE[0] = vrna_eval_structure(GAV.vc, GAV.stopform[0]);
-      GAV.vc->length = tmp_n;
+    /* fold sequence to get Minimum free energy structure (Mfe) */
+    /*
+      note that we need to hack the full length into GAV.vc again,
+      in case it was shortened due to chain growth simulation
+    */
+    unsigned int n, tmp_n;
+    n     = strlen(GAV.farbe_full);
+    tmp_n = GAV.vc->length;
+    GAV.vc->length = n;
+    GAV.sE[0] = vrna_mfe_dimer(GAV.vc, GAV.stopform[0]);
+    vrna_mx_mfe_free(GAV.vc);
+    /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
+    GAV.sE[0] = vrna_eval_structure(GAV.vc, GAV.stopform[0]);
+    GAV.vc->length = tmp_n;
 #else
-      if(GTV.noLP)
-	noLonelyPairs=1;
-      initialize_cofold(GSV.len);
-      /* fold sequence to get Minimum free energy structure (Mfe) */
-      GAV.sE[0] = cofold(GAV.farbe_full, GAV.stopform[0]);
-      free_arrays();
-      /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
-      GAV.sE[0] = energy_of_structure(GAV.farbe_full, GAV.stopform[0], 0);
+    if(GTV.noLP)
+      noLonelyPairs=1;
+    initialize_cofold(GSV.len);
+    /* fold sequence to get Minimum free energy structure (Mfe) */
+    GAV.sE[0] = cofold(GAV.farbe_full, GAV.stopform[0]);
+    free_arrays();
+    /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
+    GAV.sE[0] = energy_of_structure(GAV.farbe_full, GAV.stopform[0], 0);
 #endif
-    }
-    GSV.stopE = GAV.sE[0];
-    ini_nbList(strlen(GAV.farbe_full)*strlen(GAV.farbe_full));
+  }
+  GSV.stopE = GAV.sE[0];
+}
+
+/**/
+void ini_or_reset_rl(TrajVars *T) {
+  RingList *R;
+
+  /* if there is no ringList-tree make a new one */
+  if (T->ring == NULL) {
+    ini_ringlist(T);
+
+    /* start structure */
+    struc2tree(T, T->startform);
+#if HAVE_LIBRNA_API3
+    T->currE = vrna_eval_structure(T->vc, T->startform);
+#else
+    T->currE = energy_of_structure(T->farbe, T->startform, 0);
+#endif
+
+    ini_nbList(T, strlen(GAV.farbe_full)*strlen(GAV.farbe_full));
   }
   else {
     /* reset ringlist-tree to start conditions */
-    reset_ringlist();
-    if(GTV.start) struc2tree(GAV.startform);
+    R = T->ring;
+    reset_ringlist(T);
+    if(GTV.start) struc2tree(T, T->startform);
     else {
-      GSV.currE = GSV.startE;
+      T->currE = GSV.startE;
+      R->loopE = R->wurzl->loop_energy = eval_loop(T, R->wurzl);
     }
   }
 }
 
 /**/
-static void reset_ringlist(void) {
+static void reset_ringlist(TrajVars *T) {
+  RingList *R = T->ring;
   int i;
 
-  for(i = 0; i < GSV.len; i++) {
-    GAV.currform[i] = '.';
-    GAV.prevform[i] = 'x';
-    pairList[i+1] = 0;
-    rl[i].typ = 'u';
-    rl[i].next = &rl[i + 1];
-    rl[i].prev = ((i == 0) ? &rl[GSV.len] : &rl[i - 1]);
-    rl[i].up = rl[i].down = NULL;
+  for(i = 0; i < T->len; i++) {
+    T->currform[i] = '.';
+    T->prevform[i] = 'x';
+    R->pairList[i+1] = 0;
+    R->rl[i].typ = 'u';
+    R->rl[i].next = &R->rl[i + 1];
+    R->rl[i].prev = ((i == 0) ? &R->rl[T->len] : &R->rl[i - 1]);
+    R->rl[i].up = R->rl[i].down = NULL;
   }
-  rl[i].next = &rl[0];
-  rl[i].prev = &rl[i-1];
-  rl[i].up = wurzl;
+  R->rl[i].next = &R->rl[0];
+  R->rl[i].prev = &R->rl[i-1];
+  R->rl[i].up = R->wurzl;
+  R->crossPairs = 0;
+  R->treeKey = 0;
 }
 
-/* update ringlist-tree */
-void update_tree(int i, int j) {
-
+/* update ringlist-tree and the neighbours of the loops changed by the move */
+void update_tree(TrajVars *T, int i, int j) {
+  RingList *R = T->ring;
   baum *rli, *rlj, *tempb;
+  baum *touched[4]; /* bases that change their partner */
+  int n = 0, cross = R->crossPairs;
 
-  if ( abs(i) < GSV.len) { /* >> single basepair move */
+  if ( abs(i) < T->len) { /* >> single basepair move */
     if ((i > 0) && (j > 0)) { /* insert */
-      rli = &rl[i-1];
-      rlj = &rl[j-1];
-      close_bp_en(rli, rlj);
+      rli = &R->rl[i-1];
+      rlj = &R->rl[j-1];
+      touched[n++] = rli;
+      touched[n++] = rlj;
+      close_bp_en(T, rli, rlj);
     }
     else if ((i < 0)&&(j < 0)) { /* delete */
       i = -i;
-      rli = &rl[i-1];
-      open_bp_en(rli);
+      rli = &R->rl[i-1];
+      touched[n++] = rli;
+      touched[n++] = rli->down;
+      open_bp_en(T, rli);
     }
     else { /* shift */
       if (i > 0) { /* i remains the same, j shifts */
 	j=-j;
-	rli=&rl[i-1];
-	rlj=&rl[j-1];
-	open_bp_en(rli);
+	rli=&R->rl[i-1];
+	rlj=&R->rl[j-1];
+	touched[n++] = rli;
+	touched[n++] = rli->down;
+	touched[n++] = rlj;
+	open_bp_en(T, rli);
 	ORDER(rli, rlj);
-	close_bp_en(rli, rlj);
+	close_bp_en(T, rli, rlj);
       }
       else { /* j remains the same, i shifts */
 	baum *old_rli;
 	i = -i;
-	rli = &rl[i-1];
-	rlj = &rl[j-1];
+	rli = &R->rl[i-1];
+	rlj = &R->rl[j-1];
 	old_rli = rlj->up;
-	open_bp_en(old_rli);
+	touched[n++] = old_rli;
+	touched[n++] = rli;
+	touched[n++] = rlj;
+	open_bp_en(T, old_rli);
 	ORDER(rli, rlj);
-	close_bp_en(rli, rlj);
+	close_bp_en(T, rli, rlj);
       }
     }
   } /* << single basepair move */
   else { /* >> double basepair move */
     if ((i > 0) && (j > 0)) { /* insert */
-      rli = &rl[i-GSV.len-2];
-      rlj = &rl[j-GSV.len-2];
-      close_bp_en(rli->next, rlj->prev);
-      close_bp_en(rli, rlj);
+      rli = &R->rl[i-T->len-2];
+      rlj = &R->rl[j-T->len-2];
+      touched[n++] = rli;
+      touched[n++] = rlj;
+      touched[n++] = rli->next;
+      touched[n++] = rlj->prev;
+      close_bp_en(T, rli->next, rlj->prev);
+      close_bp_en(T, rli, rlj);
     }
     else if ((i < 0)&&(j < 0)) { /* delete */
       i = -i;
-      rli = &rl[i-GSV.len-2];
-      open_bp_en(rli);
-      open_bp_en(rli->next);
+      rli = &R->rl[i-T->len-2];
+      touched[n++] = rli;
+      touched[n++] = rli->down;
+      touched[n++] = rli->down->next;
+      touched[n++] = rli->down->next->down;
+      open_bp_en(T, rli);
+      open_bp_en(T, rli->next);
     }
   } /* << double basepair move */
 
+  tree_energy(T);
+
+  /*
+    the dimer initiation penalty enters the energy change of moves
+    that make or break the last intermolecular pair
+  */
+  if ((R->crossPairs != cross) && ((cross < 2) || (R->crossPairs < 2)))
+    all_nb(T);
+  else
+    renew_nb(T, touched, n);
 }
 
 /* open a particular base pair */
-void open_bp(baum *i) {
-
+void open_bp(TrajVars *T, baum *i) {
+  RingList *R = T->ring;
   baum *in; /* points to i->next */
 
   /* change string representation */
-  GAV.currform[i->nummer] = '.';
-  GAV.currform[i->down->nummer] = '.';
+  T->currform[i->nummer] = '.';
+  T->currform[i->down->nummer] = '.';
 
   /* change pairtable representation */
-  pairList[1 + i->nummer] = 0;
-  pairList[1 + i->down->nummer] = 0;
+  R->pairList[1 + i->nummer] = 0;
+  R->pairList[1 + i->down->nummer] = 0;
+  if (!SAME_STRAND(1 + i->nummer, 1 + i->down->nummer)) R->crossPairs--;
+  R->treeKey ^= pair_key(i->nummer, i->down->nummer);
 
   /* change tree representation */
   in = i->next;
@@ -378,17 +467,19 @@ void open_bp(baum *i) {
 }
 
 /* close a particular base pair */
-void close_bp (baum *i, baum *j) {
-
+void close_bp(TrajVars *T, baum *i, baum *j) {
+  RingList *R = T->ring;
   baum *jn; /* points to j->next */
 
   /* change string representation */
-  GAV.currform[i->nummer] = '(';
-  GAV.currform[j->nummer] = ')';
+  T->currform[i->nummer] = '(';
+  T->currform[j->nummer] = ')';
 
   /* change pairtable representation */
-  pairList[1 + i->nummer] = 1+ j->nummer;
-  pairList[1 + j->nummer] = 1 + i->nummer;
+  R->pairList[1 + i->nummer] = 1+ j->nummer;
+  R->pairList[1 + j->nummer] = 1 + i->nummer;
+  if (!SAME_STRAND(1 + i->nummer, 1 + j->nummer)) R->crossPairs++;
+  R->treeKey ^= pair_key(i->nummer, j->nummer);
 
   /* change tree representation */
   jn = j->next;
@@ -430,8 +521,8 @@ static void make_poList (baum *root) {
 
 /* for a given ringlist, generate all structures
    with one additional basepair */
-static void inb(baum *root) {
-
+static void inb(TrajVars *T, baum *root) {
+  RingList *R = T->ring;
   int EoT;
   int E_old, E_new_in, E_new_out;
   baum *stop,*rli,*rlj;
@@ -449,24 +540,18 @@ static void inb(baum *root) {
       /* potential j-position is already paired */
       if(rlj->typ=='p') continue;
       /* if i-j can form a base pair ... */
-      if(ptype[rli->nummer][rlj->nummer]){
+      if(R->ptype[rli->nummer][rlj->nummer]){
 	/* close the base bair and ... */
-	close_bp(rli,rlj);
-#if HAVE_LIBRNA_API3
-        E_new_in  = vrna_eval_loop_pt(GAV.vc, rli->nummer+1, pairList);
-        E_new_out = vrna_eval_loop_pt(GAV.vc, root->nummer+1, pairList);
-#else
-	E_new_in  = loop_energy(pairList, typeList, aliasList,rli->nummer+1);
-	E_new_out = loop_energy(pairList, typeList, aliasList,root->nummer+1);
-#endif
+	close_bp(T, rli,rlj);
+	E_new_in  = eval_loop(T, rli);
+	E_new_out = eval_loop(T, root);
 	/* ... evaluate energy of the structure */
-	EoT = (int) (GSV.currE*100 + ((GSV.currE<0)?-0.4:0.4)) +  E_new_in + E_new_out - E_old ;
-	/* assert(EoT ==  energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params)); */
+	EoT = energy_of_tree(T, R->loopE + E_new_in + E_new_out - E_old);
 	/* open the base pair again... */
-	open_bp(rli);
+	open_bp(T, rli);
 	/* ... and put the move and the enegy
 	   of the structure into the neighbour list */
-	update_nbList(1 + rli->nummer, 1 + rlj->nummer, EoT);
+	update_nbList(T, 1 + rli->nummer, 1 + rlj->nummer, EoT - R->treeE);
       }
     }
   }
@@ -474,11 +559,13 @@ static void inb(baum *root) {
 
 /* for a given ringlist, generate all structures (canonical)
    with one additional base pair (BUT WITHOUT ISOLATED BASE PAIRS) */
-static void inb_nolp(baum *root) {
-
+static void inb_nolp(TrajVars *T, baum *root) {
+  RingList *R = T->ring;
   int EoT = 0;
+  int E_old, E_new_out;
   baum *stop, *rli, *rlj;
 
+  E_old = root->loop_energy;
   stop = root->down;
     /* loop ringlist over all possible i positions */
   for (rli=stop->next;rli!=stop;rli=rli->next) {
@@ -491,44 +578,40 @@ static void inb_nolp(baum *root) {
       /* potential j-position is already paired */
       if (rlj->typ=='p') continue;
       /* if i-j can form a base pair ... */
-      if (ptype[rli->nummer][rlj->nummer]) {
+      if (R->ptype[rli->nummer][rlj->nummer]) {
 	/* ... and extends a helix ... */
 	if (((rli->prev==stop && rlj->next==stop) && stop->typ != 'x') ||
 	    (rli->next == rlj->prev)) {
 	  /* ... close the base bair and ... */
-	  close_bp(rli,rlj);
+	  close_bp(T, rli,rlj);
 	  /* ... evaluate energy of the structure */
-#if HAVE_LIBRNA_API3
-	  EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-	  EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+	  E_new_out = eval_loop(T, root);
+	  EoT = energy_of_tree(T, R->loopE + eval_loop(T, rli) + E_new_out - E_old);
 	  /* open the base pair again... */
-	  open_bp(rli);
+	  open_bp(T, rli);
 	  /* ... and put the move and the enegy
 	     of the structure into the neighbour list */
-	  update_nbList(1 + rli->nummer, 1 + rlj->nummer, EoT);
+	  update_nbList(T, 1 + rli->nummer, 1 + rlj->nummer, EoT - R->treeE);
 	}
 	/* if double insertion is possible ... */
 	else if ((rlj->nummer - rli->nummer >= MYTURN+2)&&
 		 (rli->next->typ != 'p' && rlj->prev->typ != 'p') &&
 		 (rli->next->next != rlj->prev->prev) &&
-		 (ptype[rli->next->nummer][rlj->prev->nummer])) {
+		 (R->ptype[rli->next->nummer][rlj->prev->nummer])) {
+	  baum *rlin = rli->next;
 	  /* close the two base bair and ... */
-	  close_bp(rli->next, rlj->prev);
-	  close_bp(rli, rlj);
+	  close_bp(T, rlin, rlj->prev);
+	  close_bp(T, rli, rlj);
 	  /* ... evaluate energy of the structure */
-#if HAVE_LIBRNA_API3
-	  EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-	  EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+	  E_new_out = eval_loop(T, root);
+	  EoT = energy_of_tree(T, R->loopE + eval_loop(T, rli) + eval_loop(T, rlin)
+			       + E_new_out - E_old);
 	  /* open the two base pair again ... */
-	  open_bp(rli);
-	  open_bp(rli->next);
+	  open_bp(T, rli);
+	  open_bp(T, rli->next);
 	  /* ... and put the move and the enegy
 	     of the structure into the neighbour list */
-	  update_nbList(1+rli->nummer+GSV.len+1, 1+rlj->nummer+GSV.len+1, EoT);
+	  update_nbList(T, 1+rli->nummer+T->len+1, 1+rlj->nummer+T->len+1, EoT - R->treeE);
 	}
       }
     }
@@ -537,38 +620,32 @@ static void inb_nolp(baum *root) {
 
 /* for a given ringlist, generate all structures
  with one less base pair */
-static void dnb(baum *rli){
-
+static void dnb(TrajVars *T, baum *rli){
+  RingList *R = T->ring;
   int EoT, E_old_in, E_old_out, E_new;
 
   baum *rlj, *r;
 
   rlj=rli->down;
-  open_bp(rli);
+  open_bp(T, rli);
   /* ... evaluate energy of the structure */
 
-  for (r=rli->next; r->up==NULL; r=r->next);
+  r = enclosing_pair(rli);
   E_old_in = rli->loop_energy;
-  E_old_out = r->up->loop_energy;
-#if HAVE_LIBRNA_API3
-  E_new = vrna_eval_loop_pt(GAV.vc, r->up->nummer+1, pairList);
-#else
-  E_new = loop_energy(pairList,typeList,aliasList,r->up->nummer+1);
-#endif
-  EoT = (int) (GSV.currE*100 + ((GSV.currE<0)?-0.4:0.4)) -
-    E_old_in - E_old_out + E_new;
+  E_old_out = r->loop_energy;
+  E_new = eval_loop(T, r);
+  EoT = energy_of_tree(T, R->loopE - E_old_in - E_old_out + E_new);
 
-  /* assert(EoT== energy_of_struct_pt(GAV.farbe, pairList, typeList, aliasList));*/
-  close_bp(rli,rlj);
-  update_nbList(-(1 + rli->nummer), -(1 + rlj->nummer), EoT);
+  close_bp(T, rli,rlj);
+  update_nbList(T, -(1 + rli->nummer), -(1 + rlj->nummer), EoT - R->treeE);
 }
 
 /* for a given ringlist, generate all structures (canonical)
  with one less base pair (BUT WITHOUT ISOLATED BASE PAIRS) */
-static void dnb_nolp(baum *rli) {
-
+static void dnb_nolp(TrajVars *T, baum *rli) {
+  RingList *R = T->ring;
   int EoT = 0;
-  baum *rlj;
+  baum *rlj, *r;
   baum *rlin = NULL; /* pointers to following pair in helix, if any */
   baum *rljn = NULL;
   baum *rlip = NULL; /* pointers to preceding pair in helix, if any */
@@ -591,50 +668,53 @@ static void dnb_nolp(baum *rli) {
   /* double delete ? */
   if (rlip==NULL && rlin && rljn->next != rljn->prev ) {
     /* open the two base pairs ... */
-    open_bp(rli);
-    open_bp(rlin);
+    open_bp(T, rli);
+    open_bp(T, rlin);
     /* ... evaluate energy of the structure ... */
-#if HAVE_LIBRNA_API3
-    EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-    EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+    r = enclosing_pair(rli);
+    EoT = energy_of_tree(T, R->loopE - rli->loop_energy - rlin->loop_energy
+			 - r->loop_energy + eval_loop(T, r));
     /* ... and put the move and the enegy
        of the structure into the neighbour list ... */
-    update_nbList(-(1+rli->nummer+GSV.len+1),-(1+rlj->nummer+GSV.len+1), EoT);
+    update_nbList(T, -(1+rli->nummer+T->len+1),-(1+rlj->nummer+T->len+1), EoT - R->treeE);
     /* ... and close the two base pairs again */
-    close_bp(rlin, rljn);
-    close_bp(rli, rlj);
+    close_bp(T, rlin, rljn);
+    close_bp(T, rli, rlj);
   } else { /* single delete */
     /* the following will work only if boolean expr are shortcicuited */
     if (rlip==NULL || (rlip->prev == rlip->next && rlip->prev->typ != 'x'))
       if (rlin ==NULL || (rljn->next == rljn->prev)) {
 	/* open the base pair ... */
-	open_bp(rli);
+	open_bp(T, rli);
 	/* ... evaluate energy of the structure ... */
-#if HAVE_LIBRNA_API3
-	EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-	EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+	r = enclosing_pair(rli);
+	EoT = energy_of_tree(T, R->loopE - rli->loop_energy - r->loop_energy
+			     + eval_loop(T, r));
 	/* ... and put the move and the enegy
 	   of the structure into the neighbour list ... */
-	update_nbList(-(1 + rli->nummer),-(1 + rlj->nummer), EoT);
+	update_nbList(T, -(1 + rli->nummer),-(1 + rlj->nummer), EoT - R->treeE);
 	/* and close the base pair again */
-	close_bp(rli, rlj);
+	close_bp(T, rli, rlj);
       }
   }
 }
 
 /* for a given ringlist, generate all structures
  with one shifted base pair */
-static void fnb(baum *rli) {
-
-  int EoT = 0, x;
-  baum *rlj, *stop, *help_rli, *help_rlj;
+static void fnb(TrajVars *T, baum *rli) {
+  RingList *R = T->ring;
+  int EoT = 0, x, E_old;
+  baum *rlj, *stop, *help_rli, *help_rlj, *r;
 
   stop = rli->down;
 
+  /*
+    a shift only changes the loop closed by the shifted pair
+    and the loop enclosing it
+  */
+  r = enclosing_pair(rli);
+  E_old = rli->loop_energy + r->loop_energy;
+
   /* examin interior loop of bp(ij); (.......)
      i of j move                      ->   <- */
   for (rlj = stop->next; rlj != stop; rlj = rlj->next) {
@@ -642,43 +722,35 @@ static void fnb(baum *rli) {
     if ((rlj->typ=='p')||(rlj->typ=='q')) continue;
     /* j-position of base pair shifts to k position (ij)->(ik) i<k<j */
     if ( (rlj->nummer-rli->nummer >= MYTURN)
-	 && (ptype[rli->nummer][rlj->nummer]) ) {
+	 && (R->ptype[rli->nummer][rlj->nummer]) ) {
       /* open original basepair */
-      open_bp(rli);
+      open_bp(T, rli);
       /* close shifted version of original basepair */
-      close_bp(rli, rlj);
+      close_bp(T, rli, rlj);
       /* evaluate energy of the structure */
-#if HAVE_LIBRNA_API3
-      EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-      EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+      EoT = energy_of_tree(T, R->loopE - E_old + eval_loop(T, rli) + eval_loop(T, r));
       /* put the move and the enegy of the structure into the neighbour list */
-      update_nbList(1+rli->nummer, -(1+rlj->nummer), EoT);
+      update_nbList(T, 1+rli->nummer, -(1+rlj->nummer), EoT - R->treeE);
       /* open shifted basepair */
-      open_bp(rli);
+      open_bp(T, rli);
       /* restore original basepair */
-      close_bp(rli, stop);
+      close_bp(T, rli, stop);
     }
     /* i-position of base pair shifts to position k (ij)->(kj) i<k<j */
     if ( (stop->nummer-rlj->nummer >= MYTURN)
-	 && (ptype[stop->nummer][rlj->nummer]) ) {
+	 && (R->ptype[stop->nummer][rlj->nummer]) ) {
       /* open original basepair */
-      open_bp(rli);
+      open_bp(T, rli);
       /* close shifted version of original basepair */
-      close_bp(rlj, stop);
+      close_bp(T, rlj, stop);
       /* evaluate energy of the structure */
-#if HAVE_LIBRNA_API3
-      EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-      EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+      EoT = energy_of_tree(T, R->loopE - E_old + eval_loop(T, rlj) + eval_loop(T, r));
       /* put the move and the enegy of the structure into the neighbour list */
-      update_nbList(-(1 + rlj->nummer), 1 + stop->nummer, EoT);
+      update_nbList(T, -(1 + rlj->nummer), 1 + stop->nummer, EoT - R->treeE);
       /* open shifted basepair */
-      open_bp(rlj);
+      open_bp(T, rlj);
       /* restore original basepair */
-      close_bp(rli, stop);
+      close_bp(T, rli, stop);
     }
   }
   /* examin exterior loop of bp(ij);   (.......)
@@ -688,7 +760,7 @@ static void fnb(baum *rli) {
     x=rlj->nummer-rli->nummer;
     if (x<0) x=-x;
     /* j-position of base pair shifts to position k */
-    if ((x >= MYTURN) && (ptype[rli->nummer][rlj->nummer])) {
+    if ((x >= MYTURN) && (R->ptype[rli->nummer][rlj->nummer])) {
       if (rli->nummer<rlj->nummer) {
 	help_rli=rli;
 	help_rlj=rlj;
@@ -698,26 +770,22 @@ static void fnb(baum *rli) {
 	help_rlj=rli;
       }
       /* open original basepair */
-      open_bp(rli);
+      open_bp(T, rli);
       /* close shifted version of original basepair */
-      close_bp(help_rli,help_rlj);
+      close_bp(T, help_rli,help_rlj);
       /* evaluate energy of the structure */
-#if HAVE_LIBRNA_API3
-      EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-      EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+      EoT = energy_of_tree(T, R->loopE - E_old + eval_loop(T, help_rli) + eval_loop(T, r));
       /* put the move and the enegy of the structure into the neighbour list */
-      update_nbList(1 + rli->nummer, -(1 + rlj->nummer), EoT);
+      update_nbList(T, 1 + rli->nummer, -(1 + rlj->nummer), EoT - R->treeE);
       /* open shifted base pair */
-      open_bp(help_rli);
+      open_bp(T, help_rli);
       /* restore original basepair */
-      close_bp(rli,stop);
+      close_bp(T, rli,stop);
     }
     x = rlj->nummer-stop->nummer;
     if (x < 0) x = -x;
     /* i-position of base pair shifts to position k */
-    if ((x >= MYTURN) && (ptype[stop->nummer][rlj->nummer])) {
+    if ((x >= MYTURN) && (R->ptype[stop->nummer][rlj->nummer])) {
       if (stop->nummer < rlj->nummer) {
 	help_rli = stop;
 	help_rlj = rlj;
@@ -727,73 +795,157 @@ static void fnb(baum *rli) {
 	help_rlj = stop;
       }
       /* open original basepair */
-      open_bp(rli);
+      open_bp(T, rli);
        /* close shifted version of original basepair */
-      close_bp(help_rli, help_rlj);
+      close_bp(T, help_rli, help_rlj);
       /* evaluate energy of the structure */
-#if HAVE_LIBRNA_API3
-      EoT = vrna_eval_structure_pt(GAV.vc, pairList);
-#else
-      EoT = energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0);
-#endif
+      EoT = energy_of_tree(T, R->loopE - E_old + eval_loop(T, help_rli) + eval_loop(T, r));
       /* put the move and the enegy of the structure into the neighbour list */
-      update_nbList(-(1 + rlj->nummer), 1 + stop->nummer, EoT);
+      update_nbList(T, -(1 + rlj->nummer), 1 + stop->nummer, EoT - R->treeE);
       /* open shifted basepair */
-      open_bp(help_rli);
+      open_bp(T, help_rli);
       /* restore original basepair */
-      close_bp(rli,stop);
+      close_bp(T, rli,stop);
     }
   }
 }
 
 /* for a given tree (structure),
    generate all neighbours according to moveset */
-void move_it (void) {
-  int i;
-  
+void move_it(TrajVars *T) {
+  tree_energy(T);
+  all_nb(T);
+}
+
+/* energy of the current tree, loop energies are kept up to date by update_tree() */
+static void tree_energy(TrajVars *T) {
+  RingList *R = T->ring;
+
+  R->treeE = energy_of_tree(T, R->loopE);
+  T->currE = (float)R->treeE/100.;
+
+#if _DEBUG_KINFOLD_
+  /* the running sum must agree with a full evaluation after every move */
 #if HAVE_LIBRNA_API3
-  GSV.currE = (float)vrna_eval_structure_pt(GAV.vc, pairList)/100.;
+  assert(R->treeE == vrna_eval_structure_pt(T->vc, R->pairList));
 #else
-  GSV.currE =
-    energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0)/100.;
+  assert(R->treeE ==
+	 energy_of_struct_pt_par(T->farbe, R->pairList, R->typeList,
+				 R->aliasList, GAV.params, 0));
 #endif
-  
+#endif
+}
+
+/* index of the neighbours generated by the loop closed by root */
+static int owner(TrajVars *T, baum *root) {
+  return (root == T->ring->wurzl) ? 0 : root->nummer + 1;
+}
+
+/* generate the neighbours of the loop closed by root */
+static void lnb(TrajVars *T, baum *root) {
+  RingList *R = T->ring;
+
+  begin_nbBlock(T, owner(T, root));
   if ( GTV.noLP ) { /* canonical neighbours only */
-    inb_nolp(wurzl);
-    for (i = 0; i < GSV.len; i++) {
-      
-      if (pairList[i+1]>i+1) {
-	inb_nolp(rl+i);      /* insert pair neighbours */
-	dnb_nolp(rl+i);  /* delete pair neighbour */
-      }
-    }
+    inb_nolp(T, root);      /* insert pair neighbours */
+    if (root != R->wurzl)
+      dnb_nolp(T, root);    /* delete pair neighbour */
   }
   else { /* all neighbours */
-    inb(wurzl);
-    for (i = 0; i < GSV.len; i++) {
-      
-      if (pairList[i+1]>i+1) {
-	inb(rl+i); 	 /* insert pair neighbours */
-	dnb(rl+i);  /* delete pair neighbour */
-	if ( GTV.noShift == 0 ) fnb(rl+i);
-      }
+    inb(T, root); 	 /* insert pair neighbours */
+    if (root != R->wurzl) {
+      dnb(T, root);      /* delete pair neighbour */
+      if ( GTV.noShift == 0 ) fnb(T, root);
+    }
+  }
+  end_nbBlock(T);
+}
+
+/* generate the neighbours of all loops */
+static void all_nb(TrajVars *T) {
+  RingList *R = T->ring;
+  int i;
+
+  lnb(T, R->wurzl);
+  for (i = 0; i < T->len; i++) {
+    if (R->pairList[i+1]>i+1) lnb(T, R->rl+i);
+    else { /* unpaired bases and 3' bases own no neighbours */
+      begin_nbBlock(T, i+1);
+      end_nbBlock(T);
     }
   }
 }
 
+/* put the loop closed by root on the list of loops to renew, once */
+static void mark_renew(TrajVars *T, baum *root, int *n) {
+  RingList *R = T->ring;
+  int k = owner(T, root);
+
+  if (R->is_renewed[k]) return;
+  R->is_renewed[k] = 1;
+  R->renew[(*n)++] = root;
+}
+
+/* renew the neighbours that depend on a loop changed by a move */
+static void renew_nb(TrajVars *T, baum **touched, int n) {
+  RingList *R = T->ring;
+  baum *stop, *c, *cc;
+  int k, m = 0, changed;
+
+  /* loops closed by or containing a base that changed its partner */
+  for (k = 0; k < n; k++) {
+    if (touched[k]->typ == 'p') mark_renew(T, touched[k], &m);
+    else { /* a base that lost its pair owns no neighbours any more */
+      begin_nbBlock(T, owner(T, touched[k]));
+      end_nbBlock(T);
+    }
+    mark_renew(T, enclosing_pair(touched[k]), &m);
+  }
+
+  /*
+    deletion and shifts of a pair also depend on the loop enclosing
+    it, with --noLP on the loops of the stacked pairs next to it, too
+  */
+  changed = m;
+  for (k = 0; k < changed; k++) {
+    stop = R->renew[k]->down;
+    for (c = stop->next; c != stop; c = c->next) {
+      if (c->typ != 'p') continue;
+      mark_renew(T, c, &m);
+      if ( GTV.noLP )
+	for (cc = c->down->next; cc != c->down; cc = cc->next)
+	  if (cc->typ == 'p') mark_renew(T, cc, &m);
+    }
+    if (GTV.noLP && (R->renew[k] != R->wurzl))
+      mark_renew(T, enclosing_pair(R->renew[k]), &m);
+  }
+
+  for (k = 0; k < m; k++) {
+    lnb(T, R->renew[k]);
+    R->is_renewed[owner(T, R->renew[k])] = 0;
+  }
+}
+
 
 /**/
-void clean_up_rl(void) {
+void clean_up_rl(TrajVars *T) {
+  RingList *R = T->ring;
   int i;
-  free(pairList); pairList=NULL;
-  free(typeList); typeList = NULL;
-  free(aliasList); aliasList = NULL;
-  free(rl); rl=NULL;
-  free(wurzl);  wurzl=NULL;
-  for (i=0; i<=GSV.len; i++)
-    free(ptype[i]);
-  free(ptype);
-  ptype=NULL;
+
+  if (R == NULL) return;  /* no trajectory was simulated */
+  free(R->typeList);
+  free(R->aliasList);
+  free(R->rl);
+  free(R->wurzl);
+  free(R->renew);
+  free(R->is_renewed);
+  /* chain growth may have changed T->len since the tree was made */
+  for (i=0; i<=R->pairList[0]; i++)
+    free(R->ptype[i]);
+  free(R->pairList);
+  free(R->ptype);
+  free(R);
+  T->ring = NULL;
 }
 
 /**/
@@ -806,27 +958,28 @@ static int comp_struc(const void *A, const void *B) {
 
 #if 0
 /**/
-static void rl_status(void) {
-
+static void rl_status(TrajVars *T) {
+  RingList *R = T->ring;
   int i;
 
-  printf("\n%s\n%s\n", GAV.farbe, GAV.currform);
-  for (i=0; i <= GSV.len; i++) {
+  printf("\n%s\n%s\n", T->farbe, T->currform);
+  for (i=0; i <= T->len; i++) {
     printf("%2d %c %c %2d %2d %2d %2d\n",
-	   rl[i].nummer,
-	   i == GSV.len ? 'X': GAV.farbe[i],
-	   rl[i].typ,
-	   rl[i].up==NULL?0:(rl[i].up)->nummer,
-	   rl[i].down==NULL?0:(rl[i].down)->nummer,
-	   (rl[i].prev)->nummer,
-	   (rl[i].next)->nummer);
+	   R->rl[i].nummer,
+	   i == T->len ? 'X': T->farbe[i],
+	   R->rl[i].typ,
+	   R->rl[i].up==NULL?0:(R->rl[i].up)->nummer,
+	   R->rl[i].down==NULL?0:(R->rl[i].down)->nummer,
+	   (R->rl[i].prev)->nummer,
+	   (R->rl[i].next)->nummer);
   }
   printf("---\n");
 }
 #endif
 
 #define TURN 3
-static void make_ptypes(const short *S) {
+static void make_ptypes(TrajVars *T, const short *S) {
+  RingList *R = T->ring;
   int n,i,j,k,l;
   n=S[0];
   for (k=1; k<n; k++)
@@ -840,7 +993,7 @@ static void make_ptypes(const short *S) {
 	if ((i>1)&&(j<n)) ntype = pair[S[i-1]][S[j+1]];
 	if (noLonelyPairs && (!otype) && (!ntype))
 	  type = 0; /* i.j can only form isolated pairs */
-	ptype[i-1][j-1] = ptype[j-1][i-1] = (char) type;
+	R->ptype[i-1][j-1] = R->ptype[j-1][i-1] = (char) type;
 	otype =  type;
 	type  = ntype;
 	i--; j++;
@@ -848,35 +1001,83 @@ static void make_ptypes(const short *S) {
     }
 }
 
-static void close_bp_en (baum *i, baum *j) {
+static void close_bp_en(TrajVars *T, baum *i, baum *j) {
   /* close bp and update energy */
+  RingList *R = T->ring;
   baum *r;
-  close_bp(i,j);
+  close_bp(T, i,j);
 
-#if HAVE_LIBRNA_API3
-  i->loop_energy = vrna_eval_loop_pt(GAV.vc, i->nummer+1, pairList);
-#else
-  i->loop_energy = loop_energy(pairList,typeList,aliasList,i->nummer+1);
-#endif
+  r = enclosing_pair(i);
+  R->loopE -= r->loop_energy;
+  i->loop_energy = eval_loop(T, i);
+  r->loop_energy = eval_loop(T, r);
+  R->loopE += i->loop_energy + r->loop_energy;
+}
 
-  for (r=i->next; r->up==NULL; r=r->next);
+static void open_bp_en(TrajVars *T, baum *i) {
+  /* open bp and update energy */
+  RingList *R = T->ring;
+  baum *r;
+  R->loopE -= i->loop_energy;
+  i->loop_energy=0;
+  open_bp(T, i);
+
+  r = enclosing_pair(i);
+  R->loopE -= r->loop_energy;
+  r->loop_energy = eval_loop(T, r);
+  R->loopE += r->loop_energy;
+}
 
+/* energy of the loop closed by root (the exterior loop for the virtualroot) */
+static int eval_loop(TrajVars *T, baum *root) {
+  RingList *R = T->ring;
 #if HAVE_LIBRNA_API3
-  r->up->loop_energy = vrna_eval_loop_pt(GAV.vc, r->up->nummer+1, pairList);
+  return vrna_eval_loop_pt(T->vc, root->nummer+1, R->pairList);
 #else
-  r->up->loop_energy = loop_energy(pairList,typeList,aliasList,r->up->nummer+1);
+  return loop_energy(R->pairList, R->typeList, R->aliasList, root->nummer+1);
 #endif
-};
+}
 
-static void open_bp_en (baum *i) {
-  /* open bp and update energy */
+/* 5' base of the pair closing the loop that contains i */
+static baum *enclosing_pair(baum *i) {
   baum *r;
-  i->loop_energy=0;
-  open_bp(i);
+  /* only the 3' base of the closing pair has an up-link within the ring */
   for (r=i->next; r->up==NULL; r=r->next);
-#if HAVE_LIBRNA_API3
-  r->up->loop_energy = vrna_eval_loop_pt(GAV.vc, r->up->nummer+1, pairList);
-#else
-  r->up->loop_energy = loop_energy(pairList,typeList,aliasList,r->up->nummer+1);
-#endif
-};
+  return r->up;
+}
+
+/* energy of the current tree from the sum of its loop energies */
+static int energy_of_tree(TrajVars *T, int E_loops) {
+  RingList *R = T->ring;
+  return (R->crossPairs > 0) ? E_loops + R->duplexInit : E_loops;
+}
+
+/* random looking key of base pair (i,j), combined by xor into structure keys */
+static unsigned long pair_key(int i, int j) {
+  unsigned long long z;
+
+  z = ((unsigned long long)i << 32) + (unsigned long long)j + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return (unsigned long)(z ^ (z >> 31));
+}
+
+/* key of the current structure, kept up to date by open_bp() and close_bp() */
+unsigned long current_key(TrajVars *T) {
+  return T->ring->treeKey;
+}
+
+/* key of a structure in bracket-dot-notation */
+unsigned long structure_key(const char *struc) {
+  int i, sp = 0, *stack;
+  unsigned long key = 0;
+
+  stack = (int *)calloc(strlen(struc)+1, sizeof(int));
+  assert(stack != NULL);
+  for (i = 0; struc[i]; i++) {
+    if (struc[i] == '(') stack[sp++] = i;
+    else if ((struc[i] == ')') && (sp > 0)) key ^= pair_key(stack[--sp], i);
+  }
+  free(stack);
+  return key;
+}
@@ -9,12 +9,17 @@
 #ifndef BAUM_H
 #define BAUM_H
 
+#include "globals.h"
+
 /* used in main.c */
-extern void ini_or_reset_rl(void);
-extern void move_it(void);
-extern void clean_up_rl(void);
+extern void ini_start_stop(void);
+extern void ini_or_reset_rl(TrajVars *T);
+extern void move_it(TrajVars *T);
+extern void clean_up_rl(TrajVars *T);
 
 /* used in nachbar.c */
-extern void update_tree(int i,int j);
+extern void update_tree(TrajVars *T, int i,int j);
+extern unsigned long current_key(TrajVars *T);
+extern unsigned long structure_key(const char *struc);
 
 #endif
@@ -18,6 +18,10 @@
 #include <utils.h>
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "cache_util.h"
 
 #ifdef __GNUC__
@@ -27,119 +31,223 @@
 #endif
 
 /*
-  modify cache_f(), cache_comp() and the typedef of cache_entry
-  in cache_utils.h to suit your application
+  open addressing hash table of neighborhoods: a structure hashes to a
+  bucket of WAYS consecutive slots, and a full bucket evicts one of its
+  entries by the CLOCK rule (the hand skips, and clears, every slot
+  that was used since the hand passed it last).
+  structures are stored as packed pair tables ('.' '(' ')' in 2 bits).
 */
 
 /* PUBLIC FUNCTIONES */
-cache_entry *lookup_cache (char *x);
-int write_cache (cache_entry *x);
-/*  void delete_cache (cache_entry *x); */
+void initialize_cache (int size);
+int lookup_cache (const char *x, cache_entry *c);
+int write_cache (const char *x, const cache_entry *c);
 void kill_cache();
-void initialize_cache();
 
 /* PRIVATE FUNCTIONES */
-/*  static int cache_comp(cache_entry *x, cache_entry *y); */
-INLINE static unsigned cache_f (char *x);
-
-/* #define CACHESIZE 67108864 -1 */ /* 2^26 -1   must be power of 2 -1 */
-/* #define CACHESIZE 33554432 -1 */ /* 2^25 -1   must be power of 2 -1 */
-/* #define CACHESIZE 16777216 -1 */ /* 2^24 -1   must be power of 2 -1 */ 
-/* #define CACHESIZE  4194304 -1 */ /* 2^22 -1   must be power of 2 -1 */
-#define CACHESIZE  1048576 -1  /* 2^20 -1   must be power of 2 -1 */
-/* #define CACHESIZE   262144 -1 */ /* 2^18 -1   must be power of 2 -1 */
-/* next is default */
-/* #define CACHESIZE    65536 -1 */ /* 2^16 -1   must be power of 2 -1 */
-/* #define CACHESIZE    16384 -1 */ /* 2^14 -1   must be power of 2 -1 */
-/* #define CACHESIZE     4096 -1 */ /* 2^12 -1   must be power of 2 -1 */
-
-static cache_entry *cachetab[CACHESIZE+1];
+INLINE static unsigned int pack_word (const char *x, int len, int w);
+INLINE static unsigned int cache_f (const char *x, int len);
+INLINE static int cache_comp (const cache_entry *c, const char *x, int len);
+
+#define WAYS  8      /* slots per bucket */
+#define LOCKS 1024   /* buckets share LOCKS locks, must be power of 2 */
+
+typedef struct {
+  unsigned int  hash;   /* of the structure in entry */
+  unsigned char ref;    /* used since the CLOCK hand passed */
+  cache_entry  *entry;  /* NULL for an empty slot */
+} cache_slot;
+
+static cache_slot    *cachetab = NULL;
+static unsigned char *hand = NULL;    /* CLOCK hand of every bucket */
+static unsigned int   buckets = 0;    /* number of buckets - 1 */
+
+#ifdef _OPENMP
+static omp_lock_t locks[LOCKS];
+# define LOCK(b)   omp_set_lock(&locks[(b) & (LOCKS-1)])
+# define UNLOCK(b) omp_unset_lock(&locks[(b) & (LOCKS-1)])
+#else
+# define LOCK(b)
+# define UNLOCK(b)
+#endif
+
 static char UNUSED rcsid[] ="$Id: cache.c,v 1.3 2006/10/04 12:45:12 xtof Exp $";
-unsigned long collisions=0;
-
-/* stolen from perl source */
-char coeff[] = {
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1};
-
-/* key must not be longer than 128 */
-INLINE static unsigned cache_f(char *x) { 
-  register char *s;
-  register int i;
-  register unsigned cache;
-
-  s = x;
-
-  for (i=0,    cache = 0;
-       /* while */ *s;
-       s++,           i++ , cache *= 5 ) {
-    cache += *s * coeff[i];
-  }
 
-   /* divide through CACHESIZE for normalization */
-  return ((cache) & (CACHESIZE));
+/* 16 positions of the structure x, 2 bits each */
+INLINE static unsigned int pack_word(const char *x, int len, int w) {
+  int i, end;
+  unsigned int word = 0;
+
+  end = (16*(w+1) < len) ? 16*(w+1) : len;
+  for (i = 16*w; i < end; i++) {
+    word <<= 2;
+    if (x[i] == '(') word |= 1;
+    else if (x[i] == ')') word |= 2;
+  }
+  return word;
 }
 
+/**/
+INLINE static unsigned int cache_f(const char *x, int len) { 
+  int w;
+  unsigned int cache = 2166136261U ^ (unsigned int)len;
+
+  for (w = 0; 16*w < len; w++) {
+    cache ^= pack_word(x, len, w);
+    cache *= 0x9e3779b1U;
+    cache ^= cache >> 15;
+  }
+  cache ^= cache >> 13;
+  cache *= 0x85ebca6bU;
+  cache ^= cache >> 16;
+  return cache;
+}
 
-/* returns NULL unless x is in the cache */
-cache_entry *lookup_cache (char *x) {
-  int cacheval;
-  cache_entry *c;
+/* returns 1 if c holds the structure x */
+INLINE static int cache_comp(const cache_entry *c, const char *x, int len) {
+  int w;
 
-  cacheval=cache_f(x);
-  if ((c=cachetab[cacheval]))
-    if (strcmp(c->structure,x)==0) return c;
-  
-  return NULL;
+  if (c->length != len) return 0;
+  for (w = 0; 16*w < len; w++)
+    if (c->packed[w] != pack_word(x, len, w)) return 0;
+  return 1;
 }
 
-/* returns 1 if x already was in the cache */
-int write_cache (cache_entry *x) {
-  int cacheval;
-  cache_entry *c;
-  
-  cacheval=cache_f(x->structure);
-  if ((c=cachetab[cacheval])) {
-    free(c->structure);
-    free(c->neighbors);
-    free(c->rates);
-    free(c->energies);
-    free(c);
+/* set up a cache holding (at least) size structures; 0 turns it off */
+void initialize_cache(int size) {
+
+  kill_cache();
+  if (size <= 0) return;
+
+  for (buckets = 1; buckets*WAYS < (unsigned int)size; buckets <<= 1);
+  cachetab = (cache_slot *)calloc(buckets*WAYS, sizeof(cache_slot));
+  hand = (unsigned char *)calloc(buckets, sizeof(unsigned char));
+  if ((cachetab == NULL) || (hand == NULL)) {
+    fprintf(stderr, "out of memory\n"); exit(255);
   }
-  cachetab[cacheval]=x;
-  return 0;
+  buckets--;
+#ifdef _OPENMP
+  {
+    int i;
+    for (i = 0; i < LOCKS; i++) omp_init_lock(&locks[i]);
+  }
+#endif
 }
 
-/**/
-void initialize_cache () { }
+/* returns 0 unless x is in the cache; then its neighborhood is copied into c */
+int lookup_cache (const char *x, cache_entry *c) {
+  int len, found = 0;
+  unsigned int h, b, i;
+  cache_slot *s;
+
+  if (cachetab == NULL) return 0;
+
+  len = strlen(x);
+  h = cache_f(x, len);
+  b = h & buckets;
+  s = cachetab + b*WAYS;
+
+  LOCK(b);
+  for (i = 0; i < WAYS; i++) {
+    cache_entry *e = s[i].entry;
+    if (e && (s[i].hash == h) && cache_comp(e, x, len)) {
+      s[i].ref = 1;
+      c->top    = e->top;
+      c->energy = e->energy;
+      memcpy(c->neighbors, e->neighbors, 2*e->top*sizeof(short));
+      memcpy(c->deltas, e->deltas, e->top*sizeof(int));
+      memcpy(c->rates, e->rates, e->top*sizeof(double));
+      memcpy(c->owners, e->owners, e->top*sizeof(int));
+      found = 1;
+      break;
+    }
+  }
+  UNLOCK(b);
 
-/**/
-void kill_cache () {
-  int i;
-  
-  for (i=0;i<CACHESIZE+1;i++) {
-    if ( cachetab[i] ) {
-      free (cachetab[i]->structure);
-      free (cachetab[i]->neighbors);
-      free (cachetab[i]->rates);
-      free (cachetab[i]->energies);
-      free (cachetab[i]);
+  return found;
+}
+
+/* returns 1 if x already was in the cache */
+int write_cache (const char *x, const cache_entry *c) {
+  int w, words, len, found = 0;
+  unsigned int h, b, i;
+  cache_slot *s, *slot = NULL;
+  cache_entry *e, *victim = NULL;
+
+  if (cachetab == NULL) return 0;
+
+  len = strlen(x);
+  words = (len + 15)/16;
+
+  /* one block for the entry: rates, deltas, owners, structure, neighbors */
+  e = (cache_entry *)malloc(sizeof(cache_entry)
+			    + c->top*(sizeof(double) + 2*sizeof(int) + 2*sizeof(short))
+			    + words*sizeof(unsigned int));
+  if (e == NULL) {
+    fprintf(stderr, "out of memory\n"); exit(255);
+  }
+  *e = *c;
+  e->rates     = (double *)(e + 1);
+  e->deltas    = (int *)(e->rates + c->top);
+  e->owners    = e->deltas + c->top;
+  e->packed    = (unsigned int *)(e->owners + c->top);
+  e->neighbors = (short *)(e->packed + words);
+  e->length    = len;
+  memcpy(e->rates, c->rates, c->top*sizeof(double));
+  memcpy(e->deltas, c->deltas, c->top*sizeof(int));
+  memcpy(e->owners, c->owners, c->top*sizeof(int));
+  memcpy(e->neighbors, c->neighbors, 2*c->top*sizeof(short));
+  for (w = 0; w < words; w++) e->packed[w] = pack_word(x, len, w);
+
+  h = cache_f(x, len);
+  b = h & buckets;
+  s = cachetab + b*WAYS;
+
+  LOCK(b);
+  for (i = 0; i < WAYS; i++) {
+    if (s[i].entry == NULL) {
+      if (slot == NULL) slot = s + i;
+    }
+    else if ((s[i].hash == h) && cache_comp(s[i].entry, x, len)) {
+      slot = s + i;
+      found = 1;
+      break;
+    }
+  }
+  if (slot == NULL) {
+    /* bucket is full, advance the CLOCK hand to an entry not used recently */
+    while (s[hand[b]].ref) {
+      s[hand[b]].ref = 0;
+      hand[b] = (hand[b] + 1) % WAYS;
     }
-    cachetab[i]=NULL;
+    slot = s + hand[b];
+    hand[b] = (hand[b] + 1) % WAYS;
   }
+  victim = slot->entry;
+  slot->entry = e;
+  slot->hash = h;
+  slot->ref = 1;
+  UNLOCK(b);
+
+  free(victim);
+  return found;
 }
 
-#if 0
 /**/
-static int cache_comp(cache_entry *x, cache_entry *y) {
-  return strcmp(((cache_entry *)x)->structure, ((cache_entry *)y)->structure);
-}
+void kill_cache () {
+  unsigned int i;
+
+  if (cachetab == NULL) return;
+
+  for (i = 0; i < (buckets+1)*WAYS; i++)
+    free(cachetab[i].entry);
+  free(cachetab);
+  free(hand);
+  cachetab = NULL;
+  hand = NULL;
+#ifdef _OPENMP
+  for (i = 0; i < LOCKS; i++) omp_destroy_lock(&locks[i]);
 #endif
+}
 
 /* End of file */
@@ -16,18 +16,24 @@
 #endif
 
 typedef struct {
-  char *structure;
+  unsigned int *packed; /* structure, 2 bits per position */
+  int length;        /* length of the structure */
   int top;           /* number of neighbors */
-  int lmin;          /* is a local minimum ? */
-  double flux;       /* sum of rates */
   double energy;     /* energy of this structure */
   short *neighbors;  
-  float *rates;
-  double *energies;
+  int *deltas;       /* energy change of every move */
+  double *rates;
+  int *owners;       /* loop that generated every move, see nachbar.c */
 } cache_entry;
 
-extern cache_entry *lookup_cache (char *x);
-extern int write_cache (cache_entry *x);
+/*
+  the cache is shared by all trajectories, so entries are never handed
+  out: write_cache() stores a copy of the neighborhood in x, and
+  lookup_cache() copies a cached neighborhood into the arrays of x
+*/
+extern void initialize_cache (int size);
+extern int lookup_cache (const char *structure, cache_entry *x);
+extern int write_cache (const char *structure, const cache_entry *x);
 void kill_cache(void);
 
 #endif
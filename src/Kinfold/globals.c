@@ -12,6 +12,7 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <math.h>
 #include <getopt.h>
 
 #if HAVE_LIBRNA_API3
@@ -22,6 +23,10 @@
 #include <fold_vars.h>
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "globals.h"
 #include "cmdline.h"
 
@@ -40,6 +45,10 @@ static void process_options_gg (int argc, char *argv[]);
 static const char *costring(const char *str);
 
 static char UNUSED rcsid[] ="$Id: globals.c,v 1.8 2008/10/07 09:03:14 ivo Exp $";
+
+GlobVars GSV;
+GlobArrays GAV;
+GlobToggles GTV;
 #define MAXMSG 8
 static char msg[MAXMSG][60] =
 {{"off"},
@@ -94,8 +103,6 @@ void clean_up_globals(void) {
   free(GAV.farbe);
   free(GAV.farbe_full);
   free(GAV.startform);
-  free(GAV.currform);
-  free(GAV.prevform);
   for (i = 0; i < GSV.maxS; i++) free(GAV.stopform[i]);
   free(GAV.stopform);
   free(GAV.sE);
@@ -196,11 +203,60 @@ void log_start_stop(FILE *FP) {
   for (i = 0; i < GSV.maxS; i++) {
     fprintf(FP, "#%s (%6.2f) X%02d\n", costring(GAV.stopform[i]), GAV.sE[i], i+1);
   }
-  fprintf(FP, "(%-5hu %5hu %5hu)", GAV.subi[0], GAV.subi[1], GAV.subi[2]);
+  /* parallel runs log the seed of each trajectory along with its result */
+  if (GSV.jobs <= 1)
+    fprintf(FP, "(%-5hu %5hu %5hu)", GAV.subi[0], GAV.subi[1], GAV.subi[2]);
   costring(NULL);
   fflush(FP);
 }
 
+/**/
+void log_fpt_summary(FILE *FP, int n, const int *reached, const double *fpt) {
+  int i, k, hits, bin, min_bin, max_bin, *hist;
+  double sum;
+
+  for (i = 0, hits = 0; i < n; i++)
+    if (reached[i]) hits++;
+  fprintf(FP, "#Summary: %d trajectories, %d reached a stop structure\n", n, hits);
+  if (hits == 0) {
+    fflush(FP);
+    return;
+  }
+
+  /* first passage times per stop structure */
+  for (k = 1; k <= GSV.maxS; k++) {
+    for (i = 0, hits = 0, sum = 0.; i < n; i++)
+      if (reached[i] == k) {
+	hits++;
+	sum += fpt[i];
+      }
+    if (hits)
+      fprintf(FP, "#X%02d: %d hits, mean first passage time %12.3f\n", k, hits, sum/hits);
+  }
+
+  /* histogram of first passage times, 4 bins per decade */
+  min_bin = max_bin = 0;
+  for (i = 0, hits = 0; i < n; i++)
+    if (reached[i]) {
+      bin = (int)floor(4. * log10(fpt[i] > 1e-10 ? fpt[i] : 1e-10));
+      if ((hits++ == 0) || (bin < min_bin)) min_bin = bin;
+      if ((hits == 1) || (bin > max_bin)) max_bin = bin;
+    }
+  hist = (int *)calloc(max_bin - min_bin + 1, sizeof(int));
+  assert(hist != NULL);
+  for (i = 0; i < n; i++)
+    if (reached[i])
+      hist[(int)floor(4. * log10(fpt[i] > 1e-10 ? fpt[i] : 1e-10)) - min_bin]++;
+
+  fprintf(FP, "#First passage time histogram\n");
+  for (bin = min_bin; bin <= max_bin; bin++)
+    fprintf(FP, "#%12.3f %12.3f %6d\n",
+	    pow(10., bin/4.), pow(10., (bin+1)/4.), hist[bin - min_bin]);
+
+  free(hist);
+  fflush(FP);
+}
+
 /**/
 static void display_settings(void) {
   fprintf(stderr,
@@ -368,6 +424,14 @@ static void process_options_gg (int argc, char *argv[]) {
   GSV.cut = args_info.cut_arg;
   GSV.grow = args_info.grow_arg;
   GSV.glen = args_info.glen_arg;
+  GSV.cache = args_info.cache_arg;
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    GSV.jobs = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_max_threads();
+#else
+    fprintf(stderr, "WARNING: Kinfold was compiled without OpenMP support, ignoring --jobs\n");
+#endif
+  }
   GTV.lmin = args_info.lmin_flag;
   GTV.fpt  = args_info.fpt_flag;
   cmdline_parser_free(&args_info);
@@ -545,11 +609,11 @@ static void ini_gvars(void) {
   GSV.Temp = 37.0;
   GSV.startE = 0.0;
   GSV.stopE = 0.0;
-  GSV.currE = 0.0;
   GSV.time = 500.0;
   GSV.phi = 1.0;
-  GSV.simTime = 0.0;
   GSV.glen = 15;
+  GSV.jobs = 1;
+  GSV.cache = 1048576;
 }
 
 /**/
@@ -566,8 +630,6 @@ static void ini_garrays(void) {
   assert(GAV.stopform != NULL);
   GAV.farbe = NULL;
   GAV.startform = NULL;
-  GAV.currform = NULL;
-  GAV.prevform = NULL;
   GAV.phi_bounds[0] = 0.1;
   GAV.phi_bounds[1] = 0.1;
   GAV.phi_bounds[2] = 2.0;
@@ -29,17 +29,16 @@ typedef struct _GlobVars {
   int len;
   int num;
   int maxS;
-  int steps;
   float cut;
   float Temp;
   float startE;
   float stopE;
-  float currE;
   double grow;
   int    glen;
   double time;
   double phi;
-  double simTime;
+  int jobs;         /* number of trajectories simulated in parallel */
+  int cache;        /* number of neighborhoods kept in the cache */
 } GlobVars;
 
 typedef struct _GlobArrays {
@@ -50,8 +49,6 @@ typedef struct _GlobArrays {
   char *farbe_full;    /* full sequence (for chain growth simulation) */
   char *startform;     /* start structure */
   char **stopform;     /* stop structure(s) */
-  char *currform;      /* current structure */
-  char *prevform;      /* current structure of previous time step */
   float *sE;           /* energy(s) of stop structure(s) */
   double phi_bounds[3];   /* phi_min, phi_inc, phi_max */
   unsigned short subi[3]; /* seeds for random-number-generator */
@@ -83,14 +80,40 @@ typedef struct _GlobToogles {
   int verbose;
 } GlobToggles;
 
+/*
+  state of a simulation, handed to every function of a trajectory.
+  GSV, GAV and GTV only hold the setup and are not changed by
+  trajectories, so each thread can simulate with its own TrajVars
+*/
+typedef struct _TrajVars {
+  int len;                /* current length of the chain */
+  int steps;              /* number of the current step */
+  float currE;            /* energy of the current structure */
+  double simTime;         /* duration of the last trajectory */
+  int reached;            /* stop structure reached by the last trajectory (0 if none) */
+  char *farbe;            /* sequence (shorter during chain growth) */
+  char *startform;        /* start structure */
+  char *currform;         /* current structure */
+  char *prevform;         /* current structure of previous time step */
+  unsigned short subi[3]; /* state of the random-number-generator */
+#if HAVE_LIBRNA_API3
+  vrna_fold_compound_t *vc;
+#endif
+  struct _RingList *ring; /* ringlist-tree of the current structure, see baum.c */
+  struct _NbList *nbl;    /* neighbours of the current structure, see nachbar.c */
+  FILE *out;              /* stdout of the trajectory */
+  FILE *log;              /* log-file of the trajectory */
+} TrajVars;
+
 void decode_switches(int argc, char *argv[]);
 void clean_up_globals(void);
 void log_prog_params(FILE *FP);
 void log_start_stop(FILE *FP);
+void log_fpt_summary(FILE *FP, int n, const int *reached, const double *fpt);
 
-GlobVars GSV;
-GlobArrays GAV;
-GlobToggles GTV;
+extern GlobVars GSV;
+extern GlobArrays GAV;
+extern GlobToggles GTV;
 
 #endif
 
@@ -25,6 +25,10 @@
 #include <utils.h>
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "baum.h"
 #include "nachbar.h"
 #include "cache_util.h"
@@ -32,22 +36,34 @@
 
 static char UNUSED rcsid[] ="$Id: main.c,v 1.5 2008/08/28 09:40:55 ivo Exp $";
 extern void  read_parameter_file(const char fname[]);
-extern void get_from_cache(cache_entry *c);
 
 /* PRIVAT FUNCTIONS */
 static void ini_energy_model(void);
 static void read_data(void);
 static void clean_up(void);
+static TrajVars *ini_traj(void);
+static void clean_up_traj(TrajVars *T);
+static void run_trajectory(TrajVars *T, const char *start, FILE *out, FILE *log);
+#if defined(_OPENMP) && HAVE_LIBRNA_API3
+static void run_parallel(const char *start, int *reached, double *fpt);
+#endif
+
+static FILE *logFP = NULL;
 
 /**/
 int main(int argc, char *argv[]) {
-  int i;
-  char * start, *tmp;
+  int i, *reached;
+  char * start, *tmp, logFN[256];
+  double *fpt;
   
   /*
     process command-line optiones
   */
   decode_switches(argc, argv);
+#if !defined(_OPENMP) || !HAVE_LIBRNA_API3
+  GSV.jobs = 1;
+#endif
+  if (GSV.num < 2) GSV.jobs = 1;
 
   /*
     initialize energy parameters
@@ -70,65 +86,211 @@ int main(int argc, char *argv[]) {
   free(tmp);
 #endif
 
+  /*
+    energies of start and stop structure(s)
+  */
+  ini_start_stop();
+  initialize_cache(GSV.cache);
+
+  /* open log-file and log initial condition */
+  logFP = fopen(strcat(strcpy(logFN, GAV.BaseName), ".log"), "a+");
+  assert(logFP != NULL);
+  log_prog_params(logFP);
+  log_start_stop(logFP);
+
   /*
     perform GSV.num simulations
   */
-    
   start = strdup(GAV.startform); /* remember startform for next run */
-  for (i = 0; i < GSV.num; i++) {
+  if ((GSV.grow > 0) && (strlen(start) > GSV.glen)) start[GSV.glen] = '\0';
 
-    /*
-      initialize or reset ringlist to start conditions
-    */
-    ini_or_reset_rl();
-    if (GSV.grow>0) {
-      if (strlen(GAV.farbe)>GSV.glen) {
-	start[GSV.glen] = '\0';
-	GAV.farbe[GSV.glen] = '\0';
-	strcpy(GAV.startform,start);
-	strcpy(GAV.currform,start);
-	GSV.len=GSV.glen;
+  reached = (int *)calloc(GSV.num, sizeof(int));
+  assert(reached != NULL);
+  fpt = (double *)calloc(GSV.num, sizeof(double));
+  assert(fpt != NULL);
 
-#if HAVE_LIBRNA_API3
-        GAV.vc->length = GSV.len;
+#if defined(_OPENMP) && HAVE_LIBRNA_API3
+  if (GSV.jobs > 1)
+    run_parallel(start, reached, fpt);
+  else
 #endif
-      }
-      clean_up_rl();
-      ini_or_reset_rl();
-    }
-
-    /*
-      perform simulation
-    */
-    for (GSV.steps = 1;; GSV.steps++) {
-      cache_entry *c;
-
-      /*
-	take neighbourhood of current structure from cache if there
-	else generate it from scratch
-      */
-      if ( (c = lookup_cache(GAV.currform)) ) get_from_cache(c);
-      else move_it();
-	
-      /*
-	select a structure from neighbourhood of current structure
-	and make it to the new current structure.
-	stop simulation if stop condition is met.
-      */
-      if ( sel_nb() > 0 ) break;
-
-      /* if (GSV.grow>0) grow_chain(); */
+  {
+    TrajVars *T = ini_traj();
+    for (i = 0; i < GSV.num; i++) {
+      run_trajectory(T, start, stdout, logFP);
+      reached[i] = T->reached;
+      fpt[i] = T->simTime;
     }
+    clean_up_traj(T);
   }
-  
+
+  fprintf(logFP, "\n");
+  log_fpt_summary(logFP, GSV.num, reached, fpt);
+  fclose(logFP);
+
   /*
     clean up memory
   */
   free(start);
+  free(reached);
+  free(fpt);
   clean_up();
   return(0);
 }
 
+/*
+  state of a new trajectory, with its own vrna_fold_compound_t since
+  chain growth changes its length
+*/
+static TrajVars *ini_traj(void) {
+  TrajVars *T;
+  int n = strlen(GAV.farbe_full);
+#if HAVE_LIBRNA_API3
+  char *tmp;
+#endif
+
+  T = (TrajVars *)calloc(1, sizeof(TrajVars));
+  assert(T != NULL);
+  T->len = GSV.len;
+  T->farbe = strdup(GAV.farbe_full);
+  T->startform = (char *)calloc(n+1, sizeof(char));
+  T->currform = (char *)calloc(n+1, sizeof(char));
+  T->prevform = (char *)calloc(n+1, sizeof(char));
+  assert(T->farbe && T->startform && T->currform && T->prevform);
+  strcpy(T->startform, GAV.startform);
+  T->subi[0] = GAV.subi[0];
+  T->subi[1] = GAV.subi[1];
+  T->subi[2] = GAV.subi[2];
+#if HAVE_LIBRNA_API3
+  tmp   = vrna_cut_point_insert(GAV.farbe_full, cut_point);
+  T->vc = vrna_fold_compound(tmp, &(GAV.md), VRNA_OPTION_EVAL_ONLY);
+  free(tmp);
+#endif
+  return T;
+}
+
+/**/
+static void clean_up_traj(TrajVars *T) {
+  clean_up_rl(T);
+  clean_up_nbList(T);
+#if HAVE_LIBRNA_API3
+  vrna_fold_compound_free(T->vc);
+#endif
+  free(T->farbe);
+  free(T->startform);
+  free(T->currform);
+  free(T->prevform);
+  free(T);
+}
+
+/* simulate a single trajectory from the start structure */
+static void run_trajectory(TrajVars *T, const char *start, FILE *out, FILE *log) {
+
+  T->out = out;
+  T->log = log;
+
+  /*
+    initialize or reset ringlist to start conditions
+  */
+  ini_or_reset_rl(T);
+  if (GSV.grow>0) {
+    if (strlen(T->farbe)>GSV.glen) {
+      T->farbe[GSV.glen] = '\0';
+      strcpy(T->startform,start);
+      strcpy(T->currform,start);
+      T->len=GSV.glen;
+
+#if HAVE_LIBRNA_API3
+      T->vc->length = T->len;
+#endif
+    }
+    clean_up_rl(T);
+    ini_or_reset_rl(T);
+  }
+
+  /*
+    perform simulation
+  */
+  for (T->steps = 1;; T->steps++) {
+    /*
+      update_tree() keeps the neighbourhood of the current structure
+      up to date, a new tree takes it from cache if there else
+      generates it from scratch
+    */
+    if ( !valid_nbList(T) && !get_from_cache(T) ) move_it(T);
+
+    /*
+      select a structure from neighbourhood of current structure
+      and make it to the new current structure.
+      stop simulation if stop condition is met.
+    */
+    if ( sel_nb(T) > 0 ) break;
+  }
+}
+
+#if defined(_OPENMP) && HAVE_LIBRNA_API3
+/*
+  simulate the trajectories on GSV.jobs threads. Each thread keeps its
+  own TrajVars, all share the cache of
+  neighbourhoods, and each trajectory draws
+  from its own random number stream derived from the seed, so results do
+  not depend on the number of threads. Output of a trajectory is buffered
+  and written in one piece as soon as it is finished
+*/
+static void run_parallel(const char *start, int *reached, double *fpt) {
+  omp_set_num_threads(GSV.jobs);
+
+#pragma omp parallel
+  {
+    int i;
+    TrajVars *T = ini_traj();
+
+#pragma omp for schedule(dynamic, 1)
+    for (i = 0; i < GSV.num; i++) {
+      char *out_buf = NULL, *log_buf = NULL;
+      size_t out_size = 0, log_size = 0;
+      unsigned long long z;
+      FILE *out, *log;
+
+      /* independent random number stream of trajectory i */
+      z = ((unsigned long long)GAV.subi[0] << 32) + ((unsigned long long)GAV.subi[1] << 16)
+          + GAV.subi[2] + (unsigned long long)(i + 1) * 0x9e3779b97f4a7c15ULL;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      z ^= z >> 31;
+      T->subi[0] = (unsigned short)z;
+      T->subi[1] = (unsigned short)(z >> 16);
+      T->subi[2] = (unsigned short)(z >> 32);
+
+      out = open_memstream(&out_buf, &out_size);
+      log = open_memstream(&log_buf, &log_size);
+      assert(out != NULL && log != NULL);
+      fprintf(log, "(%5hu %5hu %5hu)", T->subi[0], T->subi[1], T->subi[2]);
+
+      run_trajectory(T, start, out, log);
+      fclose(out);
+      fclose(log);
+
+      reached[i] = T->reached;
+      fpt[i] = T->simTime;
+
+#pragma omp critical (kinfold_output)
+      {
+        fwrite(out_buf, sizeof(char), out_size, stdout);
+        fflush(stdout);
+        fwrite(log_buf, sizeof(char), log_size, logFP);
+        fflush(logFP);
+      }
+
+      free(out_buf);
+      free(log_buf);
+    }
+
+    clean_up_traj(T);
+  }
+}
+#endif
+
 /**/
 static void ini_energy_model(void) {
 
@@ -183,10 +345,6 @@ static void read_data(void) {
   for (i = 0; i < len; i++) GAV.farbe[i] = toupper(GAV.farbe[i]);
   free (ctmp);
   /* allocate some global arrays */
-  GAV.currform = (char *)calloc(GSV.len +1, sizeof(char));
-  assert(GAV.currform != NULL);
-  GAV.prevform = (char *)calloc(GSV.len +1, sizeof(char));
-  assert(GAV.prevform != NULL);
   GAV.startform = (char *)calloc(GSV.len +1, sizeof(char));
   assert(GAV.startform != NULL);
 
@@ -256,7 +414,5 @@ static void read_data(void) {
 /**/
 void clean_up(void) {
   clean_up_globals();
-  clean_up_rl();
-  clean_up_nbList();
   kill_cache();
 }
@@ -29,302 +29,453 @@
 
 static char UNUSED rcsid[]="$Id: nachbar.c,v 1.8 2008/06/03 21:55:11 ivo Exp $";
 
-/* arrays */
-static short *neighbor_list=NULL;
-static float *bmf=NULL; /* boltzmann weight of structure */
-static const char *costring(const char *str);
-
-/* globals for laplace stuff */
-static double L = 0.0;
-static double D = 0.0;
-static double sumT = 0.0;
-static double sumK = 0.0;
-static double sumKK = 0.0;
-static double sumD = 0.0;
-static double *energies=NULL; /* energies of neighbors */
-
-/* variables */
-/*  static double highestE = -1000.0; */
-/*  static double OhighestE = -1000.0; */
-/*  static char *highestS, *OhighestS; */
-static int lmin = 1;
-static int top = 0;
-static int is_from_cache = 0;
-/*  static double meanE = 0.0; */
-static double totalflux = 0.0;
-static double Zeit = 0.0;
-static double zeitInc = 0.0;
-static double _RT = 0.6;
+/*
+  neighbours generated by one loop of the ringlist-tree, i.e. the
+  insertions into the loop and, for a loop closed by a base pair,
+  the deletion and the shifts of that pair
+*/
+typedef struct _NbBlock {
+  int top;           /* number of neighbours */
+  int size;          /* room for size neighbours */
+  short *moves;      /* move coding, 2 per neighbour */
+  int *dE;           /* energy change of every move in dcal/mol */
+  double *rates;     /* boltzmann weight of every move */
+  double *tree;      /* Fenwick tree of rates, 1-based */
+  int down;          /* number of moves lowering the energy */
+  int flat;          /* number of moves keeping the energy */
+  double sumdE;      /* sum of dE */
+} NbBlock;
+
+/* neighbour list and clock of a trajectory */
+typedef struct _NbList {
+  /*
+    neighbours by loop, in the order move_it() generates them:
+    block 0 is the exterior loop, block i+1 the loop closed by the
+    pair with 5' base i. update_tree() renews the blocks of the loops
+    changed by a move, all other blocks stay valid.
+  */
+  NbBlock *block;
+  int blocks;
+  int cur;           /* block filled by update_nbList() */
+  double *flux;      /* sum tree of the fluxes of all blocks */
+  int leaves;        /* first leaf of flux[], power of 2 */
+
+  /* move coding, energy change, rate and block of each neighbour in the cache */
+  short *neighbor_list;
+  int *deltas;
+  double *bmf;
+  int *owners;
+
+  /* laplace stuff */
+  double L;
+  double D;
+  double sumT;
+  double sumK;
+  double sumKK;
+  double sumD;
+
+  /* hash set of stop structure(s) */
+  unsigned long *stop_keys;
+  char **stop_struc;
+  int stop_mask;
+
+  /* variables */
+  /*  double highestE; */
+  /*  double OhighestE; */
+  /*  char *highestS, *OhighestS; */
+  int lmin;
+  int top;
+  int down;
+  int flat;
+  double sumdE;
+  int is_valid;      /* blocks hold the neighbours of the current structure */
+  int is_new;        /* ... generated from scratch, not yet in the cache */
+  /*  double meanE; */
+  double Zeit;
+  double zeitInc;
+  double _RT;
+
+  /* buffer of costring() */
+  char *buffer;
+  int size;
+} NbList;
 
 /* public functiones */
-void ini_nbList(int chords);
-void update_nbList(int i, int j, int iE);
-int sel_nb(void);
-void clean_up_nbList(void);
-extern void update_tree(int i, int j);
+void ini_nbList(TrajVars *T, int chords);
+void begin_nbBlock(TrajVars *T, int k);
+void update_nbList(TrajVars *T, int i, int j, int dE);
+void end_nbBlock(TrajVars *T);
+int valid_nbList(TrajVars *T);
+int sel_nb(TrajVars *T);
+void clean_up_nbList(TrajVars *T);
 
 /* privat functiones */
-static void reset_nbList(void);
-static void grow_chain(void);
-static FILE *logFP=NULL;
+static void reset_nbList(TrajVars *T);
+static void append_nb(TrajVars *T, int i, int j, int dE, double p);
+static short *select_nb(TrajVars *T, double x);
+static void grow_chain(TrajVars *T);
+static void ini_stop_set(TrajVars *T);
+static int find_stop(TrajVars *T);
+static const char *costring(TrajVars *T, const char *str);
 
 /**/
-void ini_nbList(int chords) {
-  char logFN[256];
+void ini_nbList(TrajVars *T, int chords) {
+  NbList *nb;
+
+  if (T->nbl != NULL) return;
+  nb = T->nbl = (NbList *)calloc(1, sizeof(NbList));
+  assert(nb != NULL);
+  nb->lmin = 1;
+  nb->_RT = (((temperature + K0) * GASCONST) / 1000.0);
+
+  /* one block per base and one for the exterior loop */
+  nb->blocks = strlen(GAV.farbe_full) + 1;
+  nb->block = (NbBlock *)calloc(nb->blocks, sizeof(NbBlock));
+  assert(nb->block != NULL);
+  for (nb->leaves = 1; nb->leaves < nb->blocks; nb->leaves *= 2);
+  nb->flux = (double *)calloc(2*nb->leaves, sizeof(double));
+  assert(nb->flux != NULL);
 
-  _RT = (((temperature + K0) * GASCONST) / 1000.0);
-  if (neighbor_list!=NULL) return;
   /*
-    list for move coding
+    the cache takes whole neighbourhoods,
     make room for 2*chords neighbors (safe bet)
   */
-  if (chords == 0) chords = 1;
-  neighbor_list = (short *)calloc(4*chords, sizeof(short));
-  assert(neighbor_list != NULL);
-  /*
-    list for Boltzmann-factors
-  */
-  bmf = (float *)calloc(2*chords, sizeof(double));
-  assert(bmf != NULL);
+  if (GSV.cache > 0) {
+    if (chords == 0) chords = 1;
+    nb->neighbor_list = (short *)calloc(4*chords, sizeof(short));
+    assert(nb->neighbor_list != NULL);
+    nb->deltas = (int *)calloc(2*chords, sizeof(int));
+    assert(nb->deltas != NULL);
+    nb->bmf = (double *)calloc(2*chords, sizeof(double));
+    assert(nb->bmf != NULL);
+    nb->owners = (int *)calloc(2*chords, sizeof(int));
+    assert(nb->owners != NULL);
+  }
 
-  /* list of neighbor energies */
-  energies = (double*)calloc(2*chords, sizeof(double));
-  assert(energies != NULL);
-  
-  /* open log-file */
-  logFP = fopen(strcat(strcpy(logFN, GAV.BaseName), ".log"), "a+");
-  assert(logFP != NULL);
+  ini_stop_set(T);
+}
 
-  /* log initial condition */
-  log_prog_params(logFP);
-  log_start_stop(logFP);
+/* returns 0 unless the blocks hold the neighbours of the current structure */
+int valid_nbList(TrajVars *T) {
+  return T->nbl->is_valid;
 }
 
-/**/
-void update_nbList(int i, int j, int iE) {
-  double E, dE, p;
+/* empty block k, update_nbList() adds the new neighbours of the loop */
+void begin_nbBlock(TrajVars *T, int k) {
+  NbList *nb = T->nbl;
+  NbBlock *b = &nb->block[k];
 
-  E = (double)iE/100.;
-  neighbor_list[2*top] = (short )i;
-  neighbor_list[2*top+1] = (short )j;
-  
-  /* compute rates and some statistics */
-  /*    meanE += E; */
-  dE = E-GSV.currE;
+  if (!nb->is_valid) {
+    /* first block of a neighbourhood generated from scratch */
+    nb->is_valid = 1;
+    nb->is_new = 1;
+  }
+  nb->top   -= b->top;
+  nb->down  -= b->down;
+  nb->flat  -= b->flat;
+  nb->sumdE -= b->sumdE;
+  b->top = b->down = b->flat = 0;
+  b->sumdE = 0.;
+  nb->cur = k;
+}
 
-  /* laplace stuff */
-  energies[top] = E;
-  L += GSV.currE-E;
-  D++;
-  /* fprintf(stderr, ">>%g %g<<\n", L, D); */
-  
+/**/
+void update_nbList(TrajVars *T, int i, int j, int dE) {
+  NbList *nb = T->nbl;
+  double p;
+
+  /* compute rates */
   if( GTV.mc ) {
     /* metropolis rule */
     if (dE < 0) p = 1;
-    else p = exp(-(dE / _RT*GSV.phi));
+    else p = exp(-((dE/100.) / nb->_RT*GSV.phi));
   }
   else  /* kawasaki rule */
-    p = exp(-0.5 * (dE / _RT*GSV.phi));
+    p = exp(-0.5 * ((dE/100.) / nb->_RT*GSV.phi));
 
-  totalflux += p;
-  bmf[top++] = (float )p;
-  if (dE < 0) lmin = 0;
-  if ((dE == 0) && (lmin==1)) lmin = 2;
+  append_nb(T, i, j, dE, p);
 }
 
-/**/
-void get_from_cache(cache_entry *c) {
-  top = c->top;
-  totalflux = c->flux;
-  GSV.currE = c->energy;
-  lmin = c->lmin;
-  memcpy(neighbor_list, c->neighbors, 2*top*sizeof(short));
-  memcpy(bmf, c->rates, top*sizeof(float));
-  memcpy(energies, c->energies, top*sizeof(double));
-  is_from_cache = 1;
+/* put move (i,j) into the current block */
+static void append_nb(TrajVars *T, int i, int j, int dE, double p) {
+  NbBlock *b = &T->nbl->block[T->nbl->cur];
+
+  if (b->top == b->size) {
+    b->size = (b->size > 0) ? 2*b->size : 16;
+    b->moves = (short *)realloc(b->moves, 2*b->size*sizeof(short));
+    b->dE    = (int *)realloc(b->dE, b->size*sizeof(int));
+    b->rates = (double *)realloc(b->rates, b->size*sizeof(double));
+    b->tree  = (double *)realloc(b->tree, (b->size+1)*sizeof(double));
+    assert((b->moves != NULL) && (b->dE != NULL) && (b->rates != NULL) && (b->tree != NULL));
+  }
+  b->moves[2*b->top] = (short )i;
+  b->moves[2*b->top+1] = (short )j;
+  b->dE[b->top] = dE;
+  b->rates[b->top++] = p;
+  b->sumdE += dE;
+  if (dE < 0) b->down++;
+  if (dE == 0) b->flat++;
+}
+
+/* sum up the rates of the current block and update the sum tree */
+void end_nbBlock(TrajVars *T) {
+  NbList *nb = T->nbl;
+  NbBlock *b = &nb->block[nb->cur];
+  int i, k;
+  double flux = 0.;
+
+  for (i = 1; i <= b->top; i++) {
+    flux += b->rates[i-1];
+    b->tree[i] = b->rates[i-1];
+  }
+  for (i = 1; i <= b->top; i++) {
+    k = i + (i & -i);
+    if (k <= b->top) b->tree[k] += b->tree[i];
+  }
+
+  nb->top   += b->top;
+  nb->down  += b->down;
+  nb->flat  += b->flat;
+  nb->sumdE += b->sumdE;
+
+  k = nb->leaves + nb->cur;
+  nb->flux[k] = flux;
+  for (k /= 2; k > 0; k /= 2)
+    nb->flux[k] = nb->flux[2*k] + nb->flux[2*k+1];
+}
+
+/* returns 0 unless the neighborhood of the current structure is cached */
+int get_from_cache(TrajVars *T) {
+  NbList *nb = T->nbl;
+  cache_entry c;
+  int m;
+
+  if (nb->neighbor_list == NULL) return 0;
+  c.neighbors = nb->neighbor_list;
+  c.deltas = nb->deltas;
+  c.rates = nb->bmf;
+  c.owners = nb->owners;
+  if (!lookup_cache(T->currform, &c)) return 0;
+
+  /* all blocks are empty, refill the ones of the cached neighbourhood */
+  nb->is_valid = 1;
+  begin_nbBlock(T, 0);
+  for (m = 0; m < c.top; m++) {
+    if (c.owners[m] != nb->cur) {
+      end_nbBlock(T);
+      begin_nbBlock(T, c.owners[m]);
+    }
+    append_nb(T, c.neighbors[2*m], c.neighbors[2*m+1], c.deltas[m], c.rates[m]);
+  }
+  end_nbBlock(T);
+  T->currE = c.energy;
+  return 1;
 }
 
 /**/
-void put_in_cache(void) {
-  cache_entry *c;
+static void put_in_cache(TrajVars *T) {
+  NbList *nb = T->nbl;
+  NbBlock *b;
+  cache_entry c;
+  int k, m;
+
+  if (nb->neighbor_list == NULL) return;
+  for (c.top = k = 0; k < nb->blocks; k++)
+    for (b = &nb->block[k], m = 0; m < b->top; m++, c.top++) {
+      nb->neighbor_list[2*c.top] = b->moves[2*m];
+      nb->neighbor_list[2*c.top+1] = b->moves[2*m+1];
+      nb->deltas[c.top] = b->dE[m];
+      nb->bmf[c.top] = b->rates[m];
+      nb->owners[c.top] = k;
+    }
+  c.neighbors = nb->neighbor_list;
+  c.deltas = nb->deltas;
+  c.rates = nb->bmf;
+  c.owners = nb->owners;
+  c.energy = T->currE;
+  write_cache(T->currform, &c);
+}
+
+/* returns the move whose cumulative rate first exceeds x */
+static short *select_nb(TrajVars *T, double x) {
+  NbList *nb = T->nbl;
+  NbBlock *b;
+  int k = 1, pos = 0, step;
 
-  if ((c = (cache_entry *) malloc(sizeof(cache_entry)))==NULL) {
-    fprintf(stderr, "out of memory\n"); exit(255);
+  /* find the block in the sum tree ... */
+  while (k < nb->leaves) {
+    if ((nb->flux[2*k] > x) || (nb->flux[2*k+1] <= 0.)) k = 2*k;
+    else {
+      x -= nb->flux[2*k];
+      k = 2*k+1;
+    }
   }
-/*    c->structure = strdup(GAV.currform); */
-  c->structure = (char *) calloc(GSV.len+1, sizeof(char));
-  strcpy(c->structure, GAV.currform);
-  c->neighbors = (short *) malloc(top*2*sizeof(short));
-  memcpy(c->neighbors,neighbor_list,top*2*sizeof(short));
-  c->rates = (float *) malloc(top*sizeof(float));
-  memcpy(c->rates, bmf, top*sizeof(float));
-  c->energies = (double*)malloc(top*sizeof(double));
-  memcpy(c->energies, energies, top*sizeof(double));
-  c->top = top;
-  c->lmin = lmin;
-  c->flux = totalflux;
-  c->energy = GSV.currE;
-  write_cache(c);
+  b = &nb->block[k - nb->leaves];
+  if (b->top == 0) return NULL;
+
+  /* ... and the move in the Fenwick tree of the block */
+  for (step = 1; 2*step <= b->top; step *= 2);
+  for (; step > 0; step /= 2) {
+    if ((pos+step <= b->top) && (b->tree[pos+step] <= x)) {
+      pos += step;
+      x -= b->tree[pos];
+    }
+  }
+  /* in case of rounding errors */
+  if (pos == b->top) pos = b->top-1;
+
+  return &b->moves[2*pos];
 }
 
 /*============*/
 
-int sel_nb(void) {
-
-  char trans, **s;
-  int next, i;
-  double pegel = 0.0, schwelle = 0.0, zufall = 0.0;
+int sel_nb(TrajVars *T) {
+  NbList *nb = T->nbl;
+  char trans;
+  short *next = NULL;
+  double schwelle = 0.0, zufall = 0.0;
   int found_stop=0;
 
-  /* before we select a move, store current conformation in cache */
-  /* ... unless it just came from there */
-  if ( !is_from_cache ) put_in_cache();
-  else
-    /* laplace stuff */
-    for (i=0; i<top; i++) {
-      L += (GSV.currE - energies[i]);
-      D++;
-    }
-  is_from_cache = 0;
+  /* before we select a move, store a new neighbourhood in cache */
+  if ( nb->is_new ) put_in_cache(T);
+  nb->is_new = 0;
+
+  /* local minimum unless a move goes down (0) or stays level (2) */
+  nb->lmin = (nb->down > 0) ? 0 : ((nb->flat > 0) ? 2 : 1);
+
+  /* laplace stuff */
+  nb->L -= nb->sumdE/100.;
+  nb->D += nb->top;
 
   /* draw 2 different a random number */
-  schwelle = urn();
-  while ( zufall==0 ) zufall = urn();
+  schwelle = erand48(T->subi);
+  while ( zufall==0 ) zufall = erand48(T->subi);
 
   /* advance internal clock */
-  if (totalflux>0)
-    zeitInc = (log(1. / zufall) / totalflux);
+  if (nb->flux[1]>0)
+    nb->zeitInc = (log(1. / zufall) / nb->flux[1]);
   else {
-    if (GSV.grow>0) zeitInc=GSV.grow;
-    else zeitInc = GSV.time;
+    if (GSV.grow>0) nb->zeitInc=GSV.grow;
+    else nb->zeitInc = GSV.time;
   }
 
-  Zeit += zeitInc;
+  nb->Zeit += nb->zeitInc;
 
   /* laplace stuff */
-  sumK  += L*zeitInc;
-  sumKK += L*L*zeitInc;
-  sumD  += D*zeitInc;
+  nb->sumK  += nb->L*nb->zeitInc;
+  nb->sumKK += nb->L*nb->L*nb->zeitInc;
+  nb->sumD  += nb->D*nb->zeitInc;
   
-  if (GSV.grow>0 && GSV.len < strlen(GAV.farbe_full)) grow_chain();
+  if (GSV.grow>0 && T->len < strlen(GAV.farbe_full)) grow_chain(T);
 
   /* meanE /= (double)top; */
 
   /* normalize boltzmann weights */
-  schwelle *=totalflux;
+  schwelle *=nb->flux[1];
 
   /* and choose a neighbour structure next */
-  for (next = 0; next < top; next++) {
-    pegel += bmf[next];
-    if (pegel > schwelle) break;
-  }
-
-  /* in case of rounding errors */
-  if (next==top) next=top-1;
+  if (nb->top > 0) next = select_nb(T, schwelle);
 
   /*
     process termination contitiones
   */
   /* is current structure identical to a stop structure ?*/
-  for (found_stop = 0, s = GAV.stopform; *s; s++) {
-    if (strcmp(*s, GAV.currform) == 0) {
-      found_stop = (s - GAV.stopform) + 1;
-      break;
-    }
-  }
+  found_stop = find_stop(T);
 
-  if ( ((found_stop > 0) && (GTV.fpt == 1)) || (Zeit > GSV.time) ) {
+  if ( ((found_stop > 0) && (GTV.fpt == 1)) || (nb->Zeit > GSV.time) ) {
     /* met condition to stop simulation */
 
     /* laplace stuff */
     double K, KK, N, sigma;
-    K = sumK/Zeit;
-    KK = sumKK/Zeit;
-    N = sumD/Zeit;
+    K = nb->sumK/nb->Zeit;
+    KK = nb->sumKK/nb->Zeit;
+    N = nb->sumD/nb->Zeit;
     /* graph Laplacian is - Laplace-Beltrami operator */
     sigma = -1.0*sqrt((KK-K*K)/N)/(K/N);
     
     /* this goes to stdout */
     if ( !GTV.silent ) {
-      printf("%s %6.2f %10.3f", costring(GAV.currform), GSV.currE, Zeit);
+      fprintf(T->out, "%s %6.2f %10.3f", costring(T, T->currform), T->currE, nb->Zeit);
 
       /* laplace stuff*/
-      if (GTV.phi) printf(" %8.3f %8.3f %3g", zeitInc, L, D); 
+      if (GTV.phi) fprintf(T->out, " %8.3f %8.3f %3g", nb->zeitInc, nb->L, nb->D); 
 
-      if (GTV.verbose) printf(" %4d _ %d", top, lmin);
-      if (found_stop) printf(" X%d\n", found_stop);/* found a stop structure */
-      else printf(" O\n"); /* time for simulation is exceeded */
+      if (GTV.verbose) fprintf(T->out, " %4d _ %d", nb->top, nb->lmin);
+      if (found_stop) fprintf(T->out, " X%d\n", found_stop);/* found a stop structure */
+      else fprintf(T->out, " O\n"); /* time for simulation is exceeded */
 
       /* laplace stuff */
-      if (GTV.phi) printf("Curvature fluctuation sigma = %7.5f\n", sigma);
+      if (GTV.phi) fprintf(T->out, "Curvature fluctuation sigma = %7.5f\n", sigma);
 
-      fflush(stdout);
+      fflush(T->out);
     }
 
     /* this goes to log */
     /* comment log steps of simulation as well !!! %6.2f  round */
     if ( found_stop ) {
-      fprintf(logFP," X%02d %12.3f", found_stop, Zeit);
+      fprintf(T->log," X%02d %12.3f", found_stop, nb->Zeit);
 
       /* laplace stuff */
-      if (GTV.phi) fprintf(logFP, " %3g %7.5f", GSV.phi, sigma);
+      if (GTV.phi) fprintf(T->log, " %3g %7.5f", GSV.phi, sigma);
 
-      fprintf(logFP,"\n");
+      fprintf(T->log,"\n");
     }
     else {
-      fprintf(logFP," O   %12.3f", Zeit);
+      fprintf(T->log," O   %12.3f", nb->Zeit);
 
       /* laplace stuff */
-      if (GTV.phi) fprintf(logFP, " %3g %7.5f", GSV.phi, sigma);      
+      if (GTV.phi) fprintf(T->log, " %3g %7.5f", GSV.phi, sigma);      
 
-      fprintf(logFP," %d %s\n", lmin, costring(GAV.currform));
+      fprintf(T->log," %d %s\n", nb->lmin, costring(T, T->currform));
     }
-    GAV.subi[0] = xsubi[0];
-    GAV.subi[1] = xsubi[1];
-    GAV.subi[2] = xsubi[2];
-    fprintf(logFP, "(%5hu %5hu %5hu)", GAV.subi[0], GAV.subi[1], GAV.subi[2]);
-    fflush(logFP);
-    
-    Zeit = 0.0;
+    if (GSV.jobs <= 1)
+      fprintf(T->log, "(%5hu %5hu %5hu)", T->subi[0], T->subi[1], T->subi[2]);
+    fflush(T->log);
+
+    /* first passage time statistics */
+    T->reached = found_stop;
+    T->simTime = nb->Zeit;
+
+    nb->Zeit = 0.0;
 
     /* reset laplace stuff for next trajectory */
-    sumT = 0.0;
-    sumK = 0.0;
-    sumKK = 0.0;
-    sumD = 0.0;
-    L = 0.0;
-    D = 0.0;
+    nb->sumT = 0.0;
+    nb->sumK = 0.0;
+    nb->sumKK = 0.0;
+    nb->sumD = 0.0;
+    nb->L = 0.0;
+    nb->D = 0.0;
     
     /*  highestE = OhighestE = -1000.0; */
-    reset_nbList();
-    costring(NULL);
+    reset_nbList(T);
+    costring(T, NULL);
     return(1);
   }
   else {
     /* continue simulation */
     int flag = 0;
-    if( (!GTV.silent) && (GSV.currE <= GSV.stopE+GSV.cut) ) {
+    if( (!GTV.silent) && (T->currE <= GSV.stopE+GSV.cut) ) {
 
-      if (!GTV.lmin || (lmin==1 && strcmp(GAV.prevform, GAV.currform) != 0)) {
+      if (!GTV.lmin || (nb->lmin==1 && strcmp(T->prevform, T->currform) != 0)) {
 	char format[64];
 	flag = 1;
 	sprintf(format, "%%-%ds %%6.2f %%10.3f", strlen(GAV.farbe_full)+1);
-	printf(format, costring(GAV.currform), GSV.currE, Zeit);
+	fprintf(T->out, format, costring(T, T->currform), T->currE, nb->Zeit);
       }
 
       /* laplace stuff */
       if (GTV.phi) {
-	printf(" %8.3f %8.3f %3g", zeitInc, L, D);
-	L = D = 0.0; /* reset L and D for next structure */
+	fprintf(T->out, " %8.3f %8.3f %3g", nb->zeitInc, nb->L, nb->D);
+	nb->L = nb->D = 0.0; /* reset L and D for next structure */
       }
 
       if ( flag && GTV.verbose ) {
 	int ii, jj;
-	if (next<0) trans='g'; /* growth */
+	if (next==NULL) trans='g'; /* growth */
 	else {
-	  ii = neighbor_list[2*next];
-	  jj = neighbor_list[2*next+1];
-	  if (abs(ii) < GSV.len) {
+	  ii = next[0];
+	  jj = next[1];
+	  if (abs(ii) < T->len) {
 	    if ((ii > 0) && (jj > 0)) trans = 'i';
 	    else if ((ii < 0) && (jj < 0)) trans = 'd';
 	    else if ((ii > 0) && (jj < 0)) trans = 's';
@@ -334,113 +485,176 @@ int sel_nb(void) {
 	    else trans = 'D';
 	  }
 	}
-	printf(" %4d %c %d", top, trans, lmin);
+	fprintf(T->out, " %4d %c %d", nb->top, trans, nb->lmin);
       }
-      if (flag) printf("\n");
+      if (flag) fprintf(T->out, "\n");
     }
   }
 
 
   /* store last lmin seen, so we can avoid printing the same lmin twice */
-  if (lmin==1)
-    strcpy(GAV.prevform, GAV.currform);
+  if (nb->lmin==1)
+    strcpy(T->prevform, T->currform);
 
 #if 0
-  if (lmin==1) {
+  if (nb->lmin==1) {
     /* went back to previous lmin */
-    if (strcmp(GAV.prevform, GAV.currform) == 0) {
+    if (strcmp(T->prevform, T->currform) == 0) {
       if (OhighestE < highestE) {
 	highestE = OhighestE;  /* delete loop */
 	strcpy(highestS, OhighestS);
       }
     } else {
-      strcpy(GAV.prevform, GAV.currform);
+      strcpy(T->prevform, T->currform);
       OhighestE = 10000.;
     }
   }
 
-  if ( strcmp(GAV.currform, GAV.startform)==0 ) {
+  if ( strcmp(T->currform, T->startform)==0 ) {
     OhighestE = highestE = -1000.;
     highestS[0] = 0;
   }
 
   /* log highes energy */
-  if (GSV.currE > highestE) {
+  if (T->currE > highestE) {
     OhighestE = highestE;
-    highestE = GSV.currE;
+    highestE = T->currE;
     strcpy(OhighestS, highestS);
-    strcpy(highestS, GAV.currform);
+    strcpy(highestS, T->currform);
   }
 #endif
 
-  if (next>=0) update_tree(neighbor_list[2*next], neighbor_list[2*next+1]);
+  /* update_tree() renews the neighbours changed by the move */
+  if (next!=NULL) update_tree(T, next[0], next[1]);
   else {
-    clean_up_rl(); ini_or_reset_rl();
+    clean_up_rl(T); ini_or_reset_rl(T);
+    reset_nbList(T);
   }
 
-  reset_nbList();
   return(0);
 }
 
 /*==========================*/
-static void reset_nbList(void) {
-
-  top = 0;
-  totalflux = 0.0;
+static void reset_nbList(TrajVars *T) {
+  NbList *nb = T->nbl;
+  int k;
+
+  /* empty all blocks */
+  for (k = 0; k < nb->blocks; k++) {
+    nb->block[k].top = nb->block[k].down = nb->block[k].flat = 0;
+    nb->block[k].sumdE = 0.;
+  }
+  memset(nb->flux, 0, 2*nb->leaves*sizeof(double));
+  nb->top = nb->down = nb->flat = 0;
+  nb->sumdE = 0.;
+  nb->is_valid = nb->is_new = 0;
   /*    meanE = 0.0; */
-  lmin = 1;
 }
 
 /*======================*/
-void clean_up_nbList(void){
+void clean_up_nbList(TrajVars *T){
+  NbList *nb = T->nbl;
+  int k;
+
+  if (nb == NULL) return;
+  for (k = 0; k < nb->blocks; k++) {
+    free(nb->block[k].moves);
+    free(nb->block[k].dE);
+    free(nb->block[k].rates);
+    free(nb->block[k].tree);
+  }
+  free(nb->block);
+  free(nb->flux);
+  free(nb->neighbor_list);
+  free(nb->deltas);
+  free(nb->bmf);
+  free(nb->owners);
+  free(nb->stop_keys);
+  free(nb->stop_struc);
+  free(nb->buffer);
+  free(nb);
+  T->nbl = NULL;
+}
+
+/*======================*/
+static void ini_stop_set(TrajVars *T) {
+  NbList *nb = T->nbl;
+  int i, h, size;
+
+  for (size = 2; size < 2*GSV.maxS; size *= 2);
+  nb->stop_mask = size-1;
+  nb->stop_keys = (unsigned long *)calloc(size, sizeof(unsigned long));
+  assert(nb->stop_keys != NULL);
+  nb->stop_struc = (char **)calloc(size, sizeof(char *));
+  assert(nb->stop_struc != NULL);
+
+  for (i = 0; i < GSV.maxS; i++) {
+    unsigned long key = structure_key(GAV.stopform[i]);
+    for (h = key & nb->stop_mask; nb->stop_struc[h]; h = (h+1) & nb->stop_mask);
+    nb->stop_keys[h] = key;
+    nb->stop_struc[h] = GAV.stopform[i];
+  }
+}
 
-  free(neighbor_list);
-  free(bmf);
-  free(energies);
-  fprintf(logFP,"\n");
-  fclose(logFP);
+/*======================*/
+static int find_stop(TrajVars *T) {
+  /* 1-based index of the stop structure equal to the current one, 0 if none */
+  NbList *nb = T->nbl;
+  int h;
+  char **s;
+  unsigned long key = current_key(T);
+
+  for (h = key & nb->stop_mask; nb->stop_struc[h]; h = (h+1) & nb->stop_mask)
+    if ((nb->stop_keys[h] == key) && (strcmp(nb->stop_struc[h], T->currform) == 0)) {
+      /* stop structures may have been reordered, report the first match */
+      for (s = GAV.stopform; strcmp(*s, T->currform) != 0; s++);
+      return (s - GAV.stopform) + 1;
+    }
+  return 0;
 }
 
 /*======================*/
-static void grow_chain(void){
+static void grow_chain(TrajVars *T){
+  NbList *nb = T->nbl;
   int newl;
   /* note Zeit=0 corresponds to chain length GSV.glen */
-  if (Zeit<(GSV.len+1-GSV.glen) * GSV.grow) return;
-  newl = GSV.len+1;
-  Zeit = (newl-GSV.glen) * GSV.grow;
-  top=0; /* prevent structure move in sel_nb */
-
-  if (GSV.len<newl) {
-    strncpy(GAV.farbe, GAV.farbe_full, newl);
-    GAV.farbe[newl] = '\0';
-    strcpy(GAV.startform, GAV.currform);
-    strcat(GAV.startform, ".");
-
-    GSV.len = newl;
+  if (nb->Zeit<(T->len+1-GSV.glen) * GSV.grow) return;
+  newl = T->len+1;
+  nb->Zeit = (newl-GSV.glen) * GSV.grow;
+  reset_nbList(T); /* prevent structure move in sel_nb */
+
+  if (T->len<newl) {
+    strncpy(T->farbe, GAV.farbe_full, newl);
+    T->farbe[newl] = '\0';
+    strcpy(T->startform, T->currform);
+    strcat(T->startform, ".");
+
+    T->len = newl;
 #if HAVE_LIBRNA_API3
-    /* fake actual length of sequence in GAV.vc */
-    GAV.vc->length = newl;
+    /* fake actual length of sequence in T->vc */
+    T->vc->length = newl;
 #endif
   }
 }
 
-static const char *costring(const char *str) {
-  static char* buffer=NULL;
-  static int size=0;
+static const char *costring(TrajVars *T, const char *str) {
+  NbList *nb = T->nbl;
+  char *buffer;
   int n;
   if (str==NULL) {
-    if (buffer) {
+    if (nb->buffer) {
       /* make it possible to free buffer */
-      free(buffer);
-      size = 0; buffer = NULL;
+      free(nb->buffer);
+      nb->size = 0; nb->buffer = NULL;
     }
     return NULL;
   }
   n=strlen(str);
-  if (n>=size) {
-    size = n+2;
-    buffer = realloc(buffer, size);
+  if (n>=nb->size) {
+    nb->size = n+2;
+    nb->buffer = realloc(nb->buffer, nb->size);
   }
+  buffer = nb->buffer;
   if ((cut_point>0)&&(cut_point<=n)) {
     strncpy(buffer, str, cut_point-1);
     buffer[cut_point-1] = '&';
@@ -4110,7 +4110,7 @@ update_TwoDfold_params(TwoDfold_vars *vars)
 
   set_model_details(&md);
 
-  free(vars->compatibility->params);
+  vrna_params_release(vars->compatibility->params);
   vars->compatibility->params = vrna_params(&md);
 
   crosslink(vars);
@@ -21,7 +21,6 @@
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/energy_par.h"
 #include "ViennaRNA/fold_vars.h"
-#include "ViennaRNA/pair_mat.h"
 #include "ViennaRNA/PS_dot.h"
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/params.h"
@@ -40,32 +39,61 @@
  #################################
  */
 
+/*
+ *  Sequence chunks processed by vrna_probs_window_parallel() consist of
+ *  a core region of CHUNK_FACTOR times the overlap, flanked by the overlap
+ *  on either side
+ */
+#define CHUNK_FACTOR  8
+
+/* data of the backward compatibility wrapper pfl_fold_par() */
+typedef struct {
+  float   cutoff;
+  int     num_p;
+  int     max_p;
+  plist   *pl;
+  FILE    *spup;
+  int     num_dpp;
+  plist   *dpp;
+  int     ulength;
+  double  **pU;
+  FILE    *pUfp;
+} backward_compat_data;
+
+/* a single callback invocation recorded for a sequence chunk */
+typedef struct {
+  unsigned int  type;
+  int           i;
+  int           pr_size;
+  int           max;
+  size_t        offset;   /* position of the first value within the value buffer */
+} chunk_entry;
+
+/* results of a sequence chunk, in global coordinates */
+typedef struct {
+  int           shift;    /* offset of the chunk within the entire sequence */
+  int           first;    /* first position of the chunk core */
+  int           last;     /* last position of the chunk core */
+  chunk_entry   *entries;
+  size_t        num_entries;
+  size_t        max_entries;
+  FLT_OR_DBL    *values;
+  size_t        num_values;
+  size_t        max_values;
+} chunk_buffer;
+
 /*
  #################################
  # PRIVATE VARIABLES             #
  #################################
  */
 
-PRIVATE float             cutoff;
-PRIVATE int               num_p = 0;                                                                                                  /* for counting basepairs in pairlist pl, can actually be moved into pfl_fold */
-PRIVATE FLT_OR_DBL        *expMLbase = NULL;
-PRIVATE FLT_OR_DBL        **q = NULL, **qb = NULL, **qm = NULL, **pR = NULL, **qm2 = NULL, **QI5 = NULL, **q2l = NULL, **qmb = NULL;  /* ,**QI3, */
-PRIVATE FLT_OR_DBL        *q1k = NULL, *qln = NULL;
-PRIVATE FLT_OR_DBL        *scale = NULL;
-PRIVATE char              **ptype = NULL; /* precomputed array of pair types */
-PRIVATE int               *jindx = NULL;
-PRIVATE int               *my_iindx = NULL;
-PRIVATE vrna_exp_param_t  *pf_params = NULL;
-PRIVATE short             *S = NULL, *S1 = NULL;
-PRIVATE int               ulength;
-PRIVATE int               pUoutput;
+/* energy parameters of the last call to pfl_fold_par(), used by putoutpU_prob() */
+PRIVATE vrna_exp_param_t  *backward_compat_pf_params = NULL;
 
 #ifdef _OPENMP
 
-/* NOTE: all variables are assumed to be uninitialized if they are declared as threadprivate
- */
-#pragma omp threadprivate(cutoff, num_p, scale, ptype, jindx, my_iindx, pf_params, \
-  expMLbase, q, qb, qm, pR, qm2, QI5, q2l, qmb, q1k, qln, S, S1, ulength, pUoutput)
+#pragma omp threadprivate(backward_compat_pf_params)
 
 #endif
 
@@ -75,191 +103,216 @@ PRIVATE int               pUoutput;
  #################################
  */
 
-PRIVATE void  init_partfunc_L(int               length,
-                              vrna_exp_param_t  *parameters);
+PRIVATE void  store_chunk_data(FLT_OR_DBL   *pr,
+                               int          pr_size,
+                               int          i,
+                               int          max,
+                               unsigned int type,
+                               void         *data);
 
 
-PRIVATE void  get_arrays_L(unsigned int length);
+PRIVATE void  replay_chunk_data(chunk_buffer                *buf,
+                                vrna_probs_window_callback  *cb,
+                                void                        *data);
 
 
-PRIVATE void  free_pf_arrays_L(void);
+PRIVATE void  backward_compat_callback(FLT_OR_DBL   *pr,
+                                       int          pr_size,
+                                       int          i,
+                                       int          max,
+                                       unsigned int type,
+                                       void         *data);
 
 
-PRIVATE void  scale_pf_params(unsigned int      length,
-                              vrna_exp_param_t  *parameters);
+/*
+ *  the sliding window kernel, once with DP matrices of type FLT_OR_DBL
+ *  and once in single precision (see vrna_md_t.pf_float)
+ */
+#define PF_REAL           FLT_OR_DBL
+#define PF_REAL_MAX       ((sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX)
+#define PF_NATIVE         1
+#define PF_WINDOW(name)   name ## _native
 
+#include "LPfold_window.inc"
 
-PRIVATE void  GetPtype(int          j,
-                       int          pairsize,
-                       const short  *S,
-                       int          n);
+#undef PF_REAL
+#undef PF_REAL_MAX
+#undef PF_NATIVE
+#undef PF_WINDOW
 
+#ifndef USE_FLOAT_PF
 
-PRIVATE void  FreeOldArrays(int i);
+#define PF_REAL           float
+#define PF_REAL_MAX       FLT_MAX
+#define PF_NATIVE         0
+#define PF_WINDOW(name)   name ## _float
 
+#include "LPfold_window.inc"
 
-PRIVATE void  GetNewArrays(int  j,
-                           int  winSize);
+#undef PF_REAL
+#undef PF_REAL_MAX
+#undef PF_NATIVE
+#undef PF_WINDOW
 
+#endif
 
-PRIVATE void  printpbar(FLT_OR_DBL  **prb,
-                        int         winSize,
-                        int         i,
-                        int         n);
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC int
+vrna_probs_window(vrna_fold_compound_t        *vc,
+                  int                         ulength,
+                  unsigned int                options,
+                  vrna_probs_window_callback  *cb,
+                  void                        *data)
+{
+  int i, u, n;
 
+  if ((!vc) || (!cb))
+    return 0;
 
-PRIVATE plist *get_deppp(plist  *pl,
-                         int    start,
-                         int    pairsize,
-                         int    length);
+  if ((vc->type != VRNA_FC_TYPE_SINGLE) || (vc->window_size <= 0)) {
+    vrna_message_warning("vrna_probs_window@LPfold.c: "
+                         "Fold compound must be created with option VRNA_OPTION_WINDOW");
+    return 0;
+  }
 
+  if (!(options & VRNA_PROBS_WINDOW_UP))
+    ulength = 0;
 
-PRIVATE plist *get_plistW(plist       *pl,
-                          int         length,
-                          int         start,
-                          FLT_OR_DBL  **Tpr,
-                          int         winSize);
+  n       = (int)vc->length;
+  ulength = MIN2(ulength, vc->window_size);
 
+  if (n < TURN + 2) {
+    /* no base pairs possible, everything is unpaired */
+    if (ulength > 0) {
+      FLT_OR_DBL *pr = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (ulength + 1));
+      for (u = 0; u <= ulength; u++)
+        pr[u] = 1.;
 
-PRIVATE void  print_plist(int         length,
-                          int         start,
-                          FLT_OR_DBL  **Tpr,
-                          int         winSize,
-                          FILE        *fp);
+      for (i = 1; i <= n; i++)
+        cb(pr, MIN2(ulength, i), i, ulength, VRNA_PROBS_WINDOW_UP, data);
 
+      free(pr);
+    }
 
-PRIVATE void  compute_pU(int    k,
-                         int    ulength,
-                         double **pU,
-                         int    winSize,
-                         int    n,
-                         char   *sequence);
+    return 1;
+  }
 
+  if (!vrna_mx_prepare(vc, VRNA_OPTION_PF | VRNA_OPTION_WINDOW)) {
+    vrna_message_warning("vrna_probs_window@LPfold.c: Failed to prepare DP matrices");
+    return 0;
+  }
 
-PRIVATE void  putoutpU(double **pU,
-                       int    k,
-                       int    ulength,
-                       FILE   *fp);
+#ifndef USE_FLOAT_PF
+  if (vc->exp_params->model_details.pf_float)
+    probs_window_float(vc, ulength, options, cb, data);
+  else
+#endif
+  probs_window_native(vc, ulength, options, cb, data);
 
+  return 1;
+}
 
-/* PRIVATE void make_ptypes(const short *S, const char *structure); */
 
-PRIVATE void putoutpU_splitup(double  **pUx,
-                              int     k,
-                              int     ulength,
-                              FILE    *fp,
-                              char    ident);
+PUBLIC int
+vrna_probs_window_parallel(vrna_fold_compound_t       *vc,
+                           int                        ulength,
+                           unsigned int               options,
+                           vrna_probs_window_callback *cb,
+                           void                       *data)
+{
+  int       n, c, overlap, chunk_size, num_chunks, ret;
+  vrna_md_t md;
 
+  if ((!vc) || (!cb))
+    return 0;
 
-PRIVATE void compute_pU_splitup(int     k,
-                                int     ulength,
-                                double  **pU,
-                                double  **pUO,
-                                double  **pUH,
-                                double  **pUI,
-                                double  **pUM,
-                                int     winSize,
-                                int     n,
-                                char    *sequence);
+  if ((vc->type != VRNA_FC_TYPE_SINGLE) || (vc->window_size <= 0) || (!vc->exp_params)) {
+    vrna_message_warning("vrna_probs_window_parallel@LPfold.c: "
+                         "Fold compound must be created with options VRNA_OPTION_PF and VRNA_OPTION_WINDOW");
+    return 0;
+  }
 
+  if (!(options & VRNA_PROBS_WINDOW_UP))
+    ulength = 0;
 
-/*
- #################################
- # BEGIN OF FUNCTION DEFINITIONS #
- #################################
- */
-PRIVATE void
-init_partfunc_L(int               length,
-                vrna_exp_param_t  *parameters)
-{
-  if (length < 1)
-    vrna_message_error("init_partfunc_L: length must be greater 0");
+  n       = (int)vc->length;
+  ulength = MIN2(ulength, vc->window_size);
+
+  /*
+   *  The results for any position only depend on the windows that contain
+   *  its pairs and loops, i.e. on the sequence at most two window sizes
+   *  (plus the unpaired stretch) away. Thus, each chunk that is extended by
+   *  that overlap yields exactly the same values for its core region.
+   */
+  overlap     = 2 * vc->window_size + MAXLOOP + ulength + 4;
+  chunk_size  = CHUNK_FACTOR * overlap;
+  num_chunks  = (n + chunk_size - 1) / chunk_size;
+
+  if (num_chunks < 2)
+    return vrna_probs_window(vc, ulength, options, cb, data);
+
+  /* the chunks are fresh fold compounds that know nothing about the constraints of vc */
+  if ((vc->hc) || (vc->sc) || (vc->domains_up)) {
+    vrna_message_warning("vrna_probs_window_parallel@LPfold.c: "
+                         "Constraints and unstructured domains are not transferred to sequence chunks, "
+                         "falling back to vrna_probs_window()");
+    return vrna_probs_window(vc, ulength, options, cb, data);
+  }
+
+  md  = vc->exp_params->model_details;
+  ret = 1;
 
 #ifdef _OPENMP
-  /* Explicitly turn off dynamic threads */
-  omp_set_dynamic(0);
-  free_pf_arrays_L(); /* free previous allocation */
-#else
-  free_pf_arrays_L(); /* free previous allocation */
+#pragma omp parallel for ordered schedule(dynamic, 1)
 #endif
+  for (c = 0; c < num_chunks; c++) {
+    int                   from, to, r;
+    char                  *sequence;
+    chunk_buffer          buf;
+    vrna_fold_compound_t  *fc;
 
-#ifdef SUN4
-  nonstandard_arithmetic();
-#else
-#ifdef HP9
-  fpsetfastmode(1);
-#endif
-#endif
-  make_pair_matrix();
-  get_arrays_L((unsigned)length);
-  scale_pf_params((unsigned)length, parameters);
-}
+    buf.first       = c * chunk_size + 1;
+    buf.last        = MIN2(n, buf.first + chunk_size - 1);
+    buf.entries     = NULL;
+    buf.values      = NULL;
+    buf.num_entries = buf.max_entries = 0;
+    buf.num_values  = buf.max_values = 0;
 
+    from      = MAX2(1, buf.first - overlap);
+    to        = MIN2(n, buf.last + overlap);
+    buf.shift = from - 1;
 
-PRIVATE void
-get_arrays_L(unsigned int length)
-{
-  /*arrays in 2 dimensions*/
-
-  q         = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (length + 1));
-  qb        = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (length + 1));
-  qm        = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (length + 1));
-  pR        = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (length + 1));
-  q1k       = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (length + 1));
-  qln       = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (length + 2));
-  expMLbase = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (length + 1));
-  scale     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (length + 1));
-  ptype     = (char **)vrna_alloc(sizeof(char *) * (length + 2));
-
-  if (ulength > 0) {
-    /* QI3 = (FLT_OR_DBL **) vrna_alloc((length+1)*sizeof(FLT_OR_DBL *)); */
-    QI5 = (FLT_OR_DBL **)vrna_alloc((length + 1) * sizeof(FLT_OR_DBL *));
-    qmb = (FLT_OR_DBL **)vrna_alloc((length + 1) * sizeof(FLT_OR_DBL *));
-    qm2 = (FLT_OR_DBL **)vrna_alloc((length + 1) * sizeof(FLT_OR_DBL *));
-    q2l = (FLT_OR_DBL **)vrna_alloc((length + 1) * sizeof(FLT_OR_DBL *));
-  }
+    sequence = (char *)vrna_alloc(sizeof(char) * (to - from + 2));
+    memcpy(sequence, vc->sequence + from - 1, sizeof(char) * (to - from + 1));
 
-  my_iindx  = vrna_idx_row_wise(length);
-  iindx     = vrna_idx_row_wise(length); /* for backward compatibility and Perl wrapper */
-  jindx     = vrna_idx_col_wise(length);
-}
+    fc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+    vrna_exp_params_subst(fc, vc->exp_params);
 
+    r = vrna_probs_window(fc, ulength, options, &store_chunk_data, (void *)&buf);
 
-PRIVATE void
-free_pf_arrays_L(void)
-{
-  free(q);
-  free(qb);
-  free(qm);
-  free(pR);
-  free(qm2);
-  free(q1k);
-  free(qln);
-  free(expMLbase);
-  free(scale);
-  free(my_iindx);
-  free(iindx);             /* for backward compatibility and Perl wrapper */
-  free(jindx);
-  free(ptype);
-  free(QI5);
-  free(qmb);
-  free(q2l);
-  free(pf_params);
-
-  q         = qb = qm = pR = QI5 = qmb = qm2 = q2l = NULL;
-  q1k       = qln = expMLbase = NULL;
-  my_iindx  = jindx = iindx = NULL;
-  pf_params = NULL;
-  ptype     = NULL;
-  scale     = NULL;
-
-#ifdef SUN4
-  standard_arithmetic();
-#else
-#ifdef HP9
-  fpsetfastmode(0);
-#endif
+    vrna_fold_compound_free(fc);
+    free(sequence);
+
+    /* hand over the results in the order of the sequence */
+#ifdef _OPENMP
+#pragma omp ordered
 #endif
+    {
+      if (r)
+        replay_chunk_data(&buf, cb, data);
+      else
+        ret = 0;
+    }
+
+    free(buf.entries);
+    free(buf.values);
+  }
+
+  return ret;
 }
 
 
@@ -274,7 +327,15 @@ PUBLIC void
 update_pf_paramsLP_par(int              length,
                        vrna_exp_param_t *parameters)
 {
-  init_partfunc_L(length, parameters);
+  free(backward_compat_pf_params);
+
+  if (parameters) {
+    backward_compat_pf_params = vrna_exp_params_copy(parameters);
+  } else {
+    vrna_md_t md;
+    set_model_details(&md);
+    backward_compat_pf_params = vrna_exp_params(&md);
+  }
 }
 
 
@@ -303,943 +364,255 @@ pfl_fold_par(char             *sequence,
              FILE             *spup,
              vrna_exp_param_t *parameters)
 {
-  int         n, m, i, j, k, l, u, u1, type, type_2, tt, ov, do_dpp, simply_putout, noGUclosure;
-  double      max_real;
-  FLT_OR_DBL  temp, Qmax, prm_MLb, prmt, prmt1, qbt1, *tmp, expMLclosing;
-  FLT_OR_DBL  *qqm = NULL, *qqm1 = NULL, *qq = NULL, *qq1 = NULL;
-  FLT_OR_DBL  *prml = NULL, *prm_l = NULL, *prm_l1 = NULL;
-
-  plist       *dpp, *pl;
-  int         split = 0;
-
-  ov            = 0;
-  Qmax          = 0;
-  do_dpp        = 0;
-  simply_putout = 0;
-  dpp           = NULL;
-  pl            = NULL;
-  pUoutput      = 0;
-  ulength       = 0;
-  cutoff        = cutoffb;
-
-  if (pU != NULL)
-    ulength = (int)pU[0][0] + 0.49;
-
-  if (spup != NULL)
-    simply_putout = 1;               /* can't have one without the other */
-
-  if (pUfp != NULL) {
-    pUoutput = 1;
-  } else if ((pUoutput) && (ulength != 0)) {
-    vrna_message_warning("There was a problem with non existing File Pointer for unpaireds, terminating process\n");
-    return pl;
-  }
+  int                   i, j, n, ulength;
+  unsigned int          options;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc;
+  backward_compat_data  data;
 
-  dpp = *dpp2;
-  if (dpp != NULL)
-    do_dpp = 1;
+  n       = (int)strlen(sequence);
+  ulength = (pU != NULL) ? (int)(pU[0][0] + 0.49) : 0;
 
   /*
    * here, I allocate memory for pU, if has to be saved, I allocate all in one go,
-   * if pU is put out and freed, I only allocate what I really need
+   * if pU is put out, I don't need any memory at all
    */
-
-  n = (int)strlen(sequence);
-
-  qq      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-  qq1     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-  qqm     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-  qqm1    = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-  prm_l   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-  prm_l1  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-  prml    = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
-
-  /* allocate memory and initialize unpaired probabilities */
-  if (ulength > 0) {
-    if (pUoutput)
-      for (i = 1; i <= ulength; i++)
-        pU[i] = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
-    else
-      for (i = 1; i <= n; i++)
-        pU[i] = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
-  }
+  if ((ulength > 0) && (pUfp == NULL))
+    for (i = 1; i <= n; i++)
+      pU[i] = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
 
   if (n < TURN + 2) {
-    if (ulength > 0) {
-      if (pUoutput) {
-        for (i = 1; i <= ulength; i++)
-          for (j = 0; j < MAX2(MAXLOOP, ulength) + 1; j++)
-            pU[i][j] = 1.;
-      } else {
-        for (i = 1; i <= n; i++)
-          for (j = 0; j < MAX2(MAXLOOP, ulength) + 1; j++)
-            pU[i][j] = 1.;
-      }
-    }
+    if ((ulength > 0) && (pUfp == NULL))
+      for (i = 1; i <= n; i++)
+        for (j = 0; j < MAX2(MAXLOOP, ulength) + 1; j++)
+          pU[i][j] = 1.;
 
-    return pl;
+    return NULL;
   }
 
-  /* always init everything since all global static variables are uninitialized when entering a thread */
-  init_partfunc_L(n, parameters);
-
-  expMLclosing  = pf_params->expMLclosing;
-  noGUclosure   = pf_params->model_details.noGUclosure;
-
-
-  max_real = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
-
-  S   = encode_sequence(sequence, 0);
-  S1  = encode_sequence(sequence, 1);
-
-  /*  make_ptypes(S, structure); das machmadochlieber lokal, ey! */
+  if (parameters)
+    md = parameters->model_details;
+  else
+    set_model_details(&md);
 
-  /*
-   * array initialization ; qb,qm,q
-   * qb,qm,q (i,j) are stored as ((n+1-i)*(n-i) div 2 + n+1-j
-   */
-  num_p = 0;
-  pl    = (plist *)vrna_alloc(1000 * sizeof(plist));
+  md.window_size  = winSize;
+  md.max_bp_span  = pairSize;
 
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
 
-  /* ALWAYS q[i][j] => i>j!! */
-  for (j = 1; j < MIN2(TURN + 2, n); j++) {
-    /* allocate start */
-    GetNewArrays(j, winSize);
-    GetPtype(j, pairSize, S, n);
-    for (i = 1; i <= j; i++)
-      q[i][j] = scale[(j - i + 1)];
+  if (parameters) {
+    vrna_exp_params_subst(vc, parameters);
+    vc->exp_params->model_details.window_size = vc->window_size;
+    vc->exp_params->model_details.max_bp_span = MIN2(pairSize, vc->window_size);
   }
-  for (j = TURN + 2; j <= n + winSize; j++) {
-    if (j <= n) {
-      GetNewArrays(j, winSize);
-      GetPtype(j, pairSize, S, n);
-      for (i = MAX2(1, j - winSize); i <= j /* -TURN */; i++)
-        q[i][j] = scale[(j - i + 1)];
-      for (i = j - TURN - 1; i >= MAX2(1, (j - winSize + 1)); i--) {
-        /* construction of partition function of segment i,j */
-        /* firstly that given i bound to j : qb(i,j) */
-        u     = j - i - 1;
-        type  = ptype[i][j];
-        if (type != 0) {
-          /* hairpin contribution */
-          if (((type == 3) || (type == 4)) && noGUclosure)
-            qbt1 = 0;
-          else
-            qbt1 = exp_E_Hairpin(u, type, S1[i + 1], S1[j - 1], sequence + i - 1, pf_params) * scale[u + 2];
-
-          /* interior loops with interior pair k,l */
-          for (k = i + 1; k <= MIN2(i + MAXLOOP + 1, j - TURN - 2); k++) {
-            u1 = k - i - 1;
-            for (l = MAX2(k + TURN + 1, j - 1 - MAXLOOP + u1); l < j; l++) {
-              type_2 = ptype[k][l];
-              if (type_2) {
-                type_2  = rtype[type_2];
-                qbt1    += qb[k][l] *
-                           exp_E_IntLoop(u1, j - l - 1, type, type_2,
-                                         S1[i + 1], S1[j - 1], S1[k - 1], S1[l + 1], pf_params) * scale[k - i + j - l];
-              }
-            }
-          }
-          /* multiple stem loop contribution */
-          temp = 0.0;
-          for (k = i + 2; k <= j - 1; k++)
-            temp += qm[i + 1][k - 1] * qqm1[k];
-          tt    = rtype[type];
-          qbt1  += temp * expMLclosing * exp_E_MLstem(tt, S1[j - 1], S1[i + 1], pf_params) * scale[2];
-
-          qb[i][j] = qbt1;
-        } /* end if (type!=0) */
-        else {
-          qb[i][j] = 0.0;
-        }
-
-        /*
-         * construction of qqm matrix containing final stem
-         * contributions to multiple loop partition function
-         * from segment i,j
-         */
-        qqm[i] = qqm1[i] * expMLbase[1];
-        if (type) {
-          qbt1    = qb[i][j] * exp_E_MLstem(type, (i > 1) ? S1[i - 1] : -1, (j < n) ? S1[j + 1] : -1, pf_params);
-          qqm[i]  += qbt1;
-        }
-
-        /*
-         * construction of qm matrix containing multiple loop
-         * partition function contributions from segment i,j
-         */
-        temp = 0.0;
-        /* ii = my_iindx[i];   ii-k=[i,k-1] */
-        /* new qm2 computation done here */
-        for (k = i + 1; k <= j; k++)
-          temp += (qm[i][k - 1]) * qqm[k];
-        if (ulength > 0)
-          qm2[i][j] = temp;           /* new qm2 computation done here */
-
-        for (k = i + 1; k <= j; k++)
-          temp += expMLbase[k - i] * qqm[k];
-        qm[i][j] = (temp + qqm[i]);
-
-        /* auxiliary matrix qq for cubic order q calculation below */
-        qbt1 = qb[i][j];
-        if (type)
-          qbt1 *= exp_E_ExtLoop(type, (i > 1) ? S1[i - 1] : -1, (j < n) ? S1[j + 1] : -1, pf_params);
-
-        qq[i] = qq1[i] * scale[1] + qbt1;
-
-        /* construction of partition function for segment i,j */
-        temp = 1.0 * scale[1 + j - i] + qq[i];
-        for (k = i; k <= j - 1; k++)
-          temp += q[i][k] * qq[k + 1];
-        q[i][j] = temp;
-
-        if (temp > Qmax) {
-          Qmax = temp;
-          if (Qmax > max_real / 10.)
-            vrna_message_warning("Q close to overflow: %d %d %g\n", i, j, temp);
-        }
-
-        if (temp >= max_real)
-          vrna_message_error("overflow in pf_fold while calculating q[%d,%d]\n"
-                             "use larger pf_scale", i, j);
-      } /* end for i */
-      tmp   = qq1;
-      qq1   = qq;
-      qq    = tmp;
-      tmp   = qqm1;
-      qqm1  = qqm;
-      qqm   = tmp;
-    }
-
-    /*
-     * just as a general service, I save here the free energy of the windows
-     * no output is generated, however,...
-     */
-    if ((j >= winSize) && (j <= n) && (ulength) && !(pUoutput)) {
-      double Fwindow = 0.;
-      Fwindow = (-log(q[j - winSize + 1][j]) - winSize * log(pf_params->pf_scale)) * pf_params->kT / 1000.0;
-
-      pU[j][0] = Fwindow;
-      /*
-       * if (ulength>=winSize)
-       * pU[j][winSize]=scale[winSize]/q[j-winSize+1][j];
-       */
-    }
 
-    if (j > winSize) {
-      Qmax = 0;
-      /* i=j-winSize; */
-      /* initialize multiloopfs */
-      for (k = j - winSize; k <= MIN2(n, j); k++) {
-        prml[k]   = 0;
-        prm_l[k]  = 0;
-        /*        prm_l1[k]=0;  others stay */
-      }
-      prm_l1[j - winSize] = 0;
-      k                   = j - winSize;
-      for (l = k + TURN + 1; l <= MIN2(n, k + winSize - 1); l++) {
-        int a;
-        pR[k][l]  = 0; /* set zero at start */
-        type      = ptype[k][l];
-        if (qb[k][l] == 0)
-          continue;
-
-        for (a = MAX2(1, l - winSize + 2); a < MIN2(k, n - winSize + 2); a++)
-          pR[k][l] += q[a][k - 1] * q[l + 1][a + winSize - 1] / q[a][a + winSize - 1];
-
-        if (l - k + 1 == winSize) {
-          pR[k][l] += 1. / q[k][l];
-        } else {
-          if (k + winSize - 1 <= n)    /* k outermost */
-            pR[k][l] += q[l + 1][k + winSize - 1] / q[k][k + winSize - 1];
+  data.cutoff   = cutoffb;
+  data.num_p    = 0;
+  data.max_p    = 1000;
+  data.pl       = (plist *)vrna_alloc(data.max_p * sizeof(plist));
+  data.spup     = spup;
+  data.num_dpp  = 0;
+  data.dpp      = (dpp2) ? *dpp2 : NULL;
+  data.ulength  = ulength;
+  data.pU       = pU;
+  data.pUfp     = pUfp;
 
-          if (l - winSize + 1 >= 1) /* l outermost */
-            pR[k][l] += q[l - winSize + 1][k - 1] / q[l - winSize + 1][l];
-        }
+  options = VRNA_PROBS_WINDOW_BPP;
 
-        pR[k][l] *= exp_E_ExtLoop(type, (k > 1) ? S1[k - 1] : -1, (l < n) ? S1[l + 1] : -1, pf_params);
+  if (ulength > 0)
+    options |= VRNA_PROBS_WINDOW_UP;
 
-        type_2  = ptype[k][l];
-        type_2  = rtype[type_2];
+  if ((ulength > 0) && (pUfp == NULL))
+    options |= VRNA_PROBS_WINDOW_PF;
 
-        for (i = MAX2(MAX2(l - winSize + 1, k - MAXLOOP - 1), 1); i <= k - 1; i++) {
-          for (m = l + 1; m <= MIN2(MIN2(l + MAXLOOP - k + i + 2, i + winSize - 1), n); m++) {
-            type = ptype[i][m];
-            if ((pR[i][m] > 0))
-              pR[k][l] += pR[i][m] * exp_E_IntLoop(k - i - 1, m - l - 1, type, type_2,
-                                                   S1[i + 1], S1[m - 1], S1[k - 1], S1[l + 1], pf_params) * scale[k - i + m - l];
-          }
-        }
-        if (ulength) {
-          /* NOT IF WITHIN INNER LOOP */
-          for (i = MAX2(MAX2(l - winSize + 1, k - MAXLOOP - 1), 1); i <= k - 1; i++) {
-            for (m = l + 1; m <= MIN2(MIN2(l + MAXLOOP - k + i + 2, i + winSize - 1), n); m++) {
-              type = ptype[i][m];
-              if ((pR[i][m] > 0)) {
-                temp = pR[i][m] * qb[k][l] * exp_E_IntLoop(k - i - 1, m - l - 1, type, type_2,
-                                                           S1[i + 1], S1[m - 1], S1[k - 1], S1[l + 1], pf_params) * scale[k - i + m - l];
-                QI5[l][m - l - 1] += temp;
-                QI5[i][k - i - 1] += temp;
-              }
-            }
-          }
-        }
-      }
-      /* 3. bonding k,l as substem of multi-loop enclosed by i,m */
-      prm_MLb = 0.;
-      if (k > 1) {
-        /* sonst nix! */
-        for (l = MIN2(n - 1, k + winSize - 2); l >= k + TURN + 1; l--) {
-          /* opposite direction */
-          m     = l + 1;
-          prmt  = prmt1 = 0.0;
-          tt    = ptype[k - 1][m];
-          tt    = rtype[tt];
-          prmt1 = pR[k - 1][m] *expMLclosing *exp_E_MLstem(tt,
-                                                           S1[l],
-                                                           S1[k],
-                                                           pf_params);
-
-
-          for (i = MAX2(1, l - winSize + 2); i < k - 1 /* TURN */; i++) {
-            tt    = ptype[i][m];
-            tt    = rtype[tt];
-            prmt  += pR[i][m] * exp_E_MLstem(tt, S1[m - 1], S1[i + 1], pf_params) * qm[i + 1][k - 1];
-          }
-          tt        = ptype[k][l];
-          prmt      *= expMLclosing;
-          prml[m]   = prmt;
-          prm_l[m]  = prm_l1[m] * expMLbase[1] + prmt1;
-
-          prm_MLb = prm_MLb * expMLbase[1] + prml[m];
-          /*
-           * same as:    prm_MLb = 0;
-           * for (i=n; i>k; i--)  prm_MLb += prml[i]*expMLbase[k-i-1];
-           */
-          prml[m] = prml[m] + prm_l[m];
-
-          if (qb[k][l] == 0.)
-            continue;
-
-          temp = prm_MLb;
-
-          if (ulength) {
-            double dang;
-            /* coefficient for computations of unpairedarrays */
-            dang = qb[k][l] * exp_E_MLstem(tt, S1[k - 1], S1[l + 1], pf_params) * scale[2];
-            for (m = MIN2(k + winSize - 2, n); m >= l + 2; m--) {
-              qmb[l][m - l - 1] += prml[m] * dang;
-              q2l[l][m - l - 1] += (prml[m] - prm_l[m]) * dang;
-            }
-          }
-
-          for (m = MIN2(k + winSize - 2, n); m >= l + 2; m--)
-            temp += prml[m] * qm[l + 1][m - 1];
-
-          temp      *= exp_E_MLstem(tt, (k > 1) ? S1[k - 1] : -1, (l < n) ? S1[l + 1] : -1, pf_params) * scale[2];
-          pR[k][l]  += temp;
-
-          if (pR[k][l] > Qmax) {
-            Qmax = pR[k][l];
-            if (Qmax > max_real / 10.)
-              vrna_message_warning("P close to overflow: %d %d %g %g\n",
-                                   i, m, pR[k][l], qb[k][l]);
-          }
-
-          if (pR[k][l] >= max_real) {
-            ov++;
-            pR[k][l] = FLT_MAX;
-          }
-        } /* end for (l=..) */
-      }
-
-      tmp     = prm_l1;
-      prm_l1  = prm_l;
-      prm_l   = tmp;
-
-      /* end for (l=..)   */
-      if ((ulength) && (k - MAXLOOP - 1 > 0)) {
-        /* if (pUoutput) pU[k-MAXLOOP-1]=(double *)vrna_alloc((ulength+2)*sizeof(double)); */
-        if (split) {
-          /* generate the new arrays, if you want them somewhere else, you have to generate them and overgive them ;) */
-          double  **pUO;
-          double  **pUI;
-          double  **pUM;
-          double  **pUH;
-          pUO = (double **)vrna_alloc((n + 1) * sizeof(double *));
-          pUI = (double **)vrna_alloc((n + 1) * sizeof(double *));
-          pUM = (double **)vrna_alloc((n + 1) * sizeof(double *));
-          pUH = (double **)vrna_alloc((n + 1) * sizeof(double *));
-          if (pUoutput) {
-            for (i = 1; i <= ulength; i++) {
-              pUH[i]  = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
-              pUI[i]  = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
-              pUO[i]  = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
-              pUM[i]  = (double *)vrna_alloc((MAX2(MAXLOOP, ulength) + 2) * sizeof(double));
-            }
-          }
-
-          //dont want to have that yet?
-          /*
-           *  else {
-           * for (i=1; i<=n; i++) pU[i]=(double *)vrna_alloc((MAX2(MAXLOOP,ulength)+2)*sizeof(double));
-           * }
-           */
-          compute_pU_splitup(k - MAXLOOP - 1, ulength, pU, pUO, pUH, pUI, pUM, winSize, n, sequence);
-          if (pUoutput) {
-            putoutpU_splitup(pUO, k - MAXLOOP - 1, ulength, pUfp, 'E');
-            putoutpU_splitup(pUH, k - MAXLOOP - 1, ulength, pUfp, 'H');
-            putoutpU_splitup(pUI, k - MAXLOOP - 1, ulength, pUfp, 'I');
-            putoutpU_splitup(pUM, k - MAXLOOP - 1, ulength, pUfp, 'M');
-          }
-        } else {
-          compute_pU(k - MAXLOOP - 1, ulength, pU, winSize, n, sequence);
-
-          /* here, we put out and free pUs not in use any more (hopefully) */
-          if (pUoutput)
-            putoutpU(pU, k - MAXLOOP - 1, ulength, pUfp);
-        }
-      }
+  if (data.dpp != NULL) {
+    options |= VRNA_PROBS_WINDOW_STACKP;
+    for (data.num_dpp = 0; data.dpp[data.num_dpp].i != 0; data.num_dpp++);
+  }
 
-      if (j - (2 * winSize + MAXLOOP + 1) > 0) {
-        printpbar(pR, winSize, j - (2 * winSize + MAXLOOP + 1), n);
-        if (simply_putout)
-          print_plist(n, j - (2 * winSize + MAXLOOP + 1), pR, winSize, spup);
-        else
-          pl = get_plistW(pl, n, j - (2 * winSize + MAXLOOP + 1), pR, winSize);
+#ifdef _OPENMP
+  /* split long sequences into chunks if more than one thread is available */
+  if ((omp_get_max_threads() > 1) && (!omp_in_parallel()))
+    vrna_probs_window_parallel(vc, ulength, options, &backward_compat_callback, (void *)&data);
+  else
+#endif
+  vrna_probs_window(vc, ulength, options, &backward_compat_callback, (void *)&data);
 
-        if (do_dpp)
-          dpp = get_deppp(dpp, j - (2 * winSize - MAXLOOP), pairSize, n);
+  free(backward_compat_pf_params);
+  backward_compat_pf_params = vrna_exp_params_copy(vc->exp_params);
 
-        FreeOldArrays(j - (2 * winSize + MAXLOOP + 1));
-      }
-    }   /* end if (do_backtrack) */
-  }/* end for j */
-
-  /* finish output and free */
-  for (j = MAX2(1, n - MAXLOOP); j <= n; j++) {
-    /* if (pUoutput) pU[j]=(double *)vrna_alloc((ulength+2)*sizeof(double)); */
-    if (ulength)
-      compute_pU(j, ulength, pU, winSize, n, sequence);
-
-    /* here, we put out and free pUs not in use any more (hopefully) */
-    if (pUoutput)
-      putoutpU(pU, j, ulength, pUfp);
-  }
-  for (j = MAX2(n - winSize - MAXLOOP, 1); j <= n; j++) {
-    printpbar(pR, winSize, j, n);
-    if (simply_putout)
-      print_plist(n, j, pR, winSize, spup);
-    else
-      pl = get_plistW(pl, n, j, pR, winSize);
+  vrna_fold_compound_free(vc);
 
-    if ((do_dpp) && j < n)
-      dpp = get_deppp(dpp, j, pairSize, n);
+  if (dpp2)
+    *dpp2 = data.dpp;
 
-    FreeOldArrays(j);
-  }
-  /* free_pf_arrays_L(); */
-  free(S);
-  free(S1);
-  S = S1 = NULL;
-  if (ov > 0)
-    vrna_message_warning("%d overflows occurred while backtracking;\n"
-                         "you might try a smaller pf_scale than %g\n",
-                         ov, pf_params->pf_scale);
-
-  free(qq);
-  free(qq1);
-  free(qqm);
-  free(qqm1);
-  free(prm_l);
-  free(prm_l1);
-  free(prml);
-
-  *dpp2 = dpp;
-
-  return pl;
+  return data.pl;
 }
 
 
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
 PRIVATE void
-scale_pf_params(unsigned int      length,
-                vrna_exp_param_t  *parameters)
+store_chunk_data(FLT_OR_DBL   *pr,
+                 int          pr_size,
+                 int          i,
+                 int          max,
+                 unsigned int type,
+                 void         *data)
 {
-  unsigned int  i;
-  double        kT, scaling_factor;
-
-  if (pf_params)
-    free(pf_params);
-
-  if (parameters) {
-    pf_params = vrna_exp_params_copy(parameters);
+  int           first, count;
+  chunk_buffer  *buf;
+  chunk_entry   *entry;
+
+  buf = (chunk_buffer *)data;
+
+  /* only keep the results for the core of the chunk */
+  if ((i + buf->shift < buf->first) || (i + buf->shift > buf->last))
+    return;
+
+  if (type & (VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_STACKP)) {
+    /* data is indexed by position */
+    first   = i;
+    count   = pr_size - i + 1;
+    pr_size += buf->shift;
+  } else if (type & VRNA_PROBS_WINDOW_UP) {
+    /* data is indexed by length */
+    first = 0;
+    count = pr_size + 1;
   } else {
-    vrna_md_t md;
-    set_model_details(&md);
-    pf_params = vrna_exp_params(&md);
+    first = 0;
+    count = 1;
   }
 
-  scaling_factor  = pf_params->pf_scale;
-  kT              = pf_params->kT; /* kT in cal/mol  */
-
-  /* scaling factors (to avoid overflows) */
-  if (scaling_factor == -1) {
-    /* mean energy for random sequences: 184.3*length cal */
-    scaling_factor = exp(-(-185 + (pf_params->temperature - 37.) * 7.27) / kT);
-    if (scaling_factor < 1)
-      scaling_factor = 1;
+  count = MAX2(count, 0);
 
-    pf_params->pf_scale = scaling_factor;
+  if (buf->num_entries == buf->max_entries) {
+    buf->max_entries  = (buf->max_entries) ? 2 * buf->max_entries : 1024;
+    buf->entries      = (chunk_entry *)vrna_realloc(buf->entries, sizeof(chunk_entry) * buf->max_entries);
   }
 
-  scale[0]      = 1.;
-  scale[1]      = 1. / scaling_factor;
-  expMLbase[0]  = 1;
-  expMLbase[1]  = pf_params->expMLbase / scaling_factor;
-  for (i = 2; i <= length; i++) {
-    scale[i]      = scale[i / 2] * scale[i - (i / 2)];
-    expMLbase[i]  = pow(pf_params->expMLbase, (double)i) * scale[i];
+  if (buf->num_values + count > buf->max_values) {
+    buf->max_values = MAX2(2 * buf->max_values, buf->num_values + count + 1024);
+    buf->values     = (FLT_OR_DBL *)vrna_realloc(buf->values, sizeof(FLT_OR_DBL) * buf->max_values);
   }
-}
 
+  entry           = buf->entries + buf->num_entries++;
+  entry->type     = type;
+  entry->i        = i + buf->shift;
+  entry->pr_size  = pr_size;
+  entry->max      = max;
+  entry->offset   = buf->num_values;
 
-PRIVATE void
-printpbar(FLT_OR_DBL  **prb,
-          int         winSize,
-          int         i,
-          int         n)
-{
-  int j;
-  int howoften = 0; /* how many samples do we have for this pair */
-  int pairdist;
-
-  for (j = i + TURN; j < MIN2(i + winSize, n + 1); j++) {
-    pairdist = (j - i + 1);
-    /* 4cases */
-    howoften  = MIN2(winSize - pairdist + 1, i);  /* pairdist,start */
-    howoften  = MIN2(howoften, n - j + 1);        /* end */
-    howoften  = MIN2(howoften, n - winSize + 1);  /* windowsize */
-    prb[i][j] *= qb[i][j] / howoften;
+  if (count > 0) {
+    memcpy(buf->values + buf->num_values, pr + first, sizeof(FLT_OR_DBL) * count);
+    buf->num_values += count;
   }
-  return;
 }
 
 
 PRIVATE void
-FreeOldArrays(int i)
+replay_chunk_data(chunk_buffer                *buf,
+                  vrna_probs_window_callback  *cb,
+                  void                        *data)
 {
-  /* free arrays no longer needed */
-  free(pR[i] + i);
-  free(q[i] + i);
-  free(qb[i] + i);
-  free(qm[i] + i);
-  if (ulength != 0) {
-    free(qm2[i] + i);
-    free(QI5[i]);
-    free(qmb[i]);
-    free(q2l[i]);
-  }
-
-  free(ptype[i] + i);
-  return;
-}
-
-
-PRIVATE void
-GetNewArrays(int  j,
-             int  winSize)
-{
-  /* allocate new part of arrays */
-  pR[j] = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-  pR[j] -= j;
-  q[j]  = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-  q[j]  -= j;
-  qb[j] = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-  qb[j] -= j;
-  qm[j] = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-  qm[j] -= j;
-  if (ulength != 0) {
-    qm2[j]  = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-    qm2[j]  -= j;
-    QI5[j]  = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-    qmb[j]  = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-    q2l[j]  = (FLT_OR_DBL *)vrna_alloc((winSize + 1) * sizeof(FLT_OR_DBL));
-  }
-
-  ptype[j]  = (char *)vrna_alloc((winSize + 1) * sizeof(char));
-  ptype[j]  -= j;
-  return;
-}
-
-
-PRIVATE void
-GetPtype(int          i,
-         int          winSize,
-         const short  *S,
-         int          n)
-{
-  /* make new entries in ptype array */
-  int j;
-  int type;
-
-  for (j = i; j <= MIN2(i + winSize, n); j++) {
-    type        = pair[S[i]][S[j]];
-    ptype[i][j] = (char)type;
-  }
-  return;
-}
-
-
-PRIVATE plist *
-get_plistW(plist      *pl,
-           int        length,
-           int        start,
-           FLT_OR_DBL **Tpr,
-           int        winSize)
-{
-  /* get pair probibilities out of pr array */
-  int j, max_p;
-
-  max_p = 1000;
-  while (max_p < num_p)
-    max_p *= 2;
+  size_t      e;
+  FLT_OR_DBL  *pr;
+  chunk_entry *entry;
 
-  for (j = start + 1; j <= MIN2(start + winSize, length); j++) {
-    if (Tpr[start][j] < cutoff)
-      continue;
+  for (e = 0; e < buf->num_entries; e++) {
+    entry = buf->entries + e;
+    pr    = buf->values + entry->offset;
 
-    if (num_p == max_p - 1) {
-      max_p *= 2;
-      pl    = (plist *)vrna_realloc(pl, max_p * sizeof(plist));
-    }
+    /* restore the indexing by position within the entire sequence */
+    if (entry->type & (VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_STACKP))
+      pr -= entry->i;
 
-    pl[num_p].i   = start;
-    pl[num_p].j   = j;
-    pl[num_p++].p = Tpr[start][j];
-  }
-
-  /* mark end of data with zeroes */
-  pl[num_p].i = 0;
-  pl[num_p].j = 0;
-  pl[num_p].p = 0.;
-  /* pl=(plist *)vrna_realloc(pl,(count)*sizeof(plist)); */
-  return pl;
-}
-
-
-PRIVATE plist *
-get_deppp(plist *pl,
-          int   start,
-          int   pairsize,
-          int   length)
-{
-  /* compute dependent pair probabilities */
-  int     i, j, count = 0;
-  double  tmp;
-  plist   *temp;
-
-  temp = (plist *)vrna_alloc(pairsize * sizeof(plist)); /* holds temporary deppp */
-  for (j = start + TURN; j < MIN2(start + pairsize, length); j++) {
-    if ((qb[start][j] * qb[start - 1][(j + 1)]) > 10e-200) {
-      int type    = ptype[start - 1][j + 1];
-      int type_2  = rtype[(unsigned char)ptype[start][j]];
-      tmp = qb[start][j] / qb[start - 1][(j + 1)] * exp_E_IntLoop(0, 0, type, type_2,
-                                                                  S1[start], S1[j], S1[start - 1], S1[j + 1], pf_params) * scale[2];
-      temp[count].i   = start;
-      temp[count].j   = j;
-      temp[count++].p = tmp;
-    }
-  }
-  /* write it to list of deppps */
-  for (i = 0; pl[i].i != 0; i++) ;
-  pl = (plist *)vrna_realloc(pl, (i + count + 1) * sizeof(plist));
-  for (j = 0; j < count; j++) {
-    pl[i + j].i = temp[j].i;
-    pl[i + j].j = temp[j].j;
-    pl[i + j].p = temp[j].p;
+    cb(pr, entry->pr_size, entry->i, entry->max, entry->type, data);
   }
-  pl[i + count].i = 0;
-  pl[i + count].j = 0;
-  pl[i + count].p = 0;
-  free(temp);
-  return pl;
 }
 
 
 PRIVATE void
-print_plist(int         length,
-            int         start,
-            FLT_OR_DBL  **Tpr,
-            int         winSize,
-            FILE        *fp)
+backward_compat_callback(FLT_OR_DBL   *pr,
+                         int          pr_size,
+                         int          i,
+                         int          max,
+                         unsigned int type,
+                         void         *data)
 {
-  /* print out of pr array, do not save */
-  int j;
+  int                   j;
+  backward_compat_data  *d = (backward_compat_data *)data;
 
+  switch (type) {
+    case VRNA_PROBS_WINDOW_BPP:
+      for (j = i + 1; j <= pr_size; j++) {
+        if (pr[j] < d->cutoff)
+          continue;
 
-  for (j = start + 1; j <= MIN2(start + winSize, length); j++) {
-    if (Tpr[start][j] < cutoff)
-      continue;
-
-    fprintf(fp, "%d  %d  %g\n", start, j, Tpr[start][j]);
-  }
-
-  /* mark end of data with zeroes */
-
-  return;
-}
+        if (d->spup) {
+          fprintf(d->spup, "%d  %d  %g\n", i, j, pr[j]);
+          continue;
+        }
 
+        if (d->num_p == d->max_p - 1) {
+          d->max_p  *= 2;
+          d->pl     = (plist *)vrna_realloc(d->pl, d->max_p * sizeof(plist));
+        }
 
-PRIVATE void
-compute_pU(int    k,
-           int    ulength,
-           double **pU,
-           int    winSize,
-           int    n,
-           char   *sequence)
-{
-  /*
-   *  here, we try to add a function computing all unpaired probabilities starting at some i,
-   *  going down to $unpaired, to be unpaired, i.e. a list with entries from 1 to unpaired for
-   *  every i, with the probability of a stretch of length x, starting at i-x+1, to be unpaired
-   */
-  int         startu;
-  int         i5;
-  int         j3, len, obp;
-  double      temp;
-  double      *QBE;
-  FLT_OR_DBL  expMLclosing = pf_params->expMLclosing;
-
-  QBE = (double *)vrna_alloc((MAX2(ulength, MAXLOOP) + 2) * sizeof(double));
-
-  /* first, we will */
-  /* for k<=ulength, pU[k][k]=0, because no bp can enclose it */
-  if (pUoutput && k + ulength <= n)
-    pU[k + ulength] = (double *)vrna_alloc((ulength + 2) * sizeof(double));
-
-  /*compute pu[k+ulength][ulength] */
-  for (i5 = MAX2(k + ulength - winSize + 1, 1); i5 <= k; i5++) {
-    for (j3 = k + ulength + 1; j3 <= MIN2(n, i5 + winSize - 1); j3++) {
-      /*
-       *  if (k>400) {
-       * printf("i%d j%d  ",i5,j3);
-       * fflush(stdout);
-       * }
-       */
-      if (ptype[i5][j3] != 0) {
-        /*
-         * (.. >-----|..........)
-         * i5  j     j+ulength  j3
-         */
-        /* Multiloops */
-        temp = (i5 < k) ? qm2[i5 + 1][k] * expMLbase[j3 - k - 1] : 0.; /* (..{}{}-----|......) */
-
-        if (j3 - 1 > k + ulength)
-          temp += qm2[k + ulength + 1][j3 - 1] * expMLbase[k + ulength - i5]; /* (..|-----|{}{}) */
-
-        if ((i5 < k) && (j3 - 1 > k + ulength))
-          temp += qm[i5 + 1][k] * qm[k + ulength + 1][j3 - 1] * expMLbase[ulength]; /* ({}|-----|{}) */
-
-        /* add dangles, multloopclosing etc. */
-        temp *= exp_E_MLstem(rtype[(unsigned char)ptype[i5][j3]], S1[j3 - 1], S1[i5 + 1], pf_params) * scale[2] * expMLclosing;
-        /* add hairpins */
-        temp += exp_E_Hairpin(j3 - i5 - 1, ptype[i5][j3], S1[i5 + 1], S1[j3 - 1], sequence + i5 - 1, pf_params) * scale[j3 - i5 + 1];
-        /* add outer probability */
-        temp                      *= pR[i5][j3];
-        pU[k + ulength][ulength]  += temp;
-      }
-    }
-  }
-  /* code doubling to avoid if within loop */
-#if 0
-  /* initialization for interior loops,
-   * it is not recomended to have verysmall ulengths!!
-   */
-  if (ulength < MAXLOOP) {
-    int k5;
-    int l3;
-    int outype;
-    /* kl bp is 5' */
-    /*
-     * MAXLOOP>((l5-k5-1)+(j3-l3-1)
-     * k-winSize+ulength<i5<k-TURN-1;
-     * k+ulength<j3<=k+MAXLOOP+1
-     * if i then use l3, it is easier by far:
-     * j3-MAXLOOP<=l3<=k
-     * i5<k5<k-TURN k5<=i5+l3+2+MAXLOOP-j3
-     * k5+TURN<l3<=k
-     */
-    for (i5 = MAX2(k + ulength - winSize, 1); i5 < k - TURN - 1; i5++) {
-      for (j3 = k + ulength + 1; j3 <= MIN2(n, MIN2(i5 + winSize - 1, k + MAXLOOP + 1)); j3++) {
-        double temp = 0;
-        if (outype = ptype[i5][j3] > 0) /* oder so halt */
-          for (l3 = MAX2(i5 + TURN + 1, j3 - MAXLOOP - 1); l3 <= k; l3++) {
-            for (k5 = i5 + 1; k5 <= MIN2(l3 - TURN - 1, MAXLOOP + i5 + l3 + 2 - j3); k5++)
-              if (ptype[k5][l3])
-                temp += qb[k5][l3] * expLoopEnergy(k5 - i5 - 1, j3 - l3 - 1, outype, rtype[ptype[k5][l3]], S1[i5 + 1], S1[j3 - 1], S1[k5 - 1], S1[l3 + 1]);
-          }
-
-        temp                      *= pR[i5][j3];
-        pU[k + ulength][ulength]  += temp;
+        d->pl[d->num_p].i   = i;
+        d->pl[d->num_p].j   = j;
+        d->pl[d->num_p++].p = pr[j];
       }
-    }
-    /* kl bp is 3' */
-    /*
-     * k+ulength-MAXLOOP<=i5<=k
-     * k+ulength+1+TURN<j3<i5+winSize
-     * k+ulength+1<=k5<i5+MAXLOOP+2 || k5<j3-TURN
-     * k5<l3<j3 || j3-k5-i5-2-ML<=l3<j3
-     */
-    for (i5 = MAX2(1, MAX2(k + ulength - winSize, k + ulength - MAXLOOP)); i5 <= k; i5++) {
-      for (j3 = k + ulength + TURN + 2; j3 < MIN2(n + 1, i5 + winSize); j3++) {
-        double temp = 0;
-        if (outype = ptype[i5][j3] > 0) /* oder so halt */
-          for (k5 = k + ulength + 1; k5 < MIN2(j3 - TURN - 1, i5 + MAXLOOP + 2); k5++) {
-            for (l3 = MAX2(k5 + TURN + 1, j3 + k5 - i5 - 2 - MAXLOOP); l3 < j3; l3++)
-              if (ptype[k5][l3])
-                temp += qb[k5][l3] * expLoopEnergy(k5 - i5 - 1, j3 - l3 - 1, outype, rtype[ptype[k5][l3]], S1[i5 + 1], S1[j3 - 1], S1[k5 - 1], S1[l3 + 1]);
-          }
-
-        temp                      *= pR[i5][j3];
-        pU[k + ulength][ulength]  += temp;
+
+      /* mark end of data with zeroes */
+      if (!d->spup) {
+        d->pl[d->num_p].i = 0;
+        d->pl[d->num_p].j = 0;
+        d->pl[d->num_p].p = 0.;
       }
-    }
-  }
 
-  /* Add up Is QI5[l][m-l-1] QI3 */
-  /* Add up Interior loop terms */
-  temp = 0.;
+      break;
 
-  for (len = winSize; len >= ulength; len--)
-    temp += QI3[k][len];
-  for (; len > 0; len--) {
-    temp      += QI3[k][len];
-    QBE[len]  += temp;
-  }
-#endif
-  temp = 0.;
-  for (len = winSize; len >= MAX2(ulength, MAXLOOP); len--)
-    temp += QI5[k][len];
-  for (; len > 0; len--) {
-    temp      += QI5[k][len];
-    QBE[len]  += temp; /* replace QBE with QI */
-  }
-  /* Add Hairpinenergy to QBE */
-  temp = 0.;
-  for (obp = MIN2(n, k + winSize - 1); obp > k + ulength; obp--)
-    if (ptype[k][obp])
-      temp += pR[k][obp] * exp_E_Hairpin(obp - k - 1, ptype[k][obp], S1[k + 1], S1[obp - 1], sequence + k - 1, pf_params) * scale[obp - k + 1];
+    case VRNA_PROBS_WINDOW_UP:
+      if (d->pUfp) {
+        fprintf(d->pUfp, "%d\t", i);
+        for (j = 1; j <= pr_size; j++)
+          fprintf(d->pUfp, "%.5g\t", pr[j]);
+        fprintf(d->pUfp, "\n");
+      } else {
+        for (j = 1; j <= pr_size; j++)
+          d->pU[i][j] = (double)pr[j];
+      }
 
-  for (obp = MIN2(n, MIN2(k + winSize - 1, k + ulength)); obp > k + 1; obp--) {
-    if (ptype[k][obp])
-      temp += pR[k][obp] * exp_E_Hairpin(obp - k - 1, ptype[k][obp], S1[k + 1], S1[obp - 1], sequence + k - 1, pf_params) * scale[obp - k + 1];
+      break;
 
-    QBE[obp - k - 1] += temp;  /* add hairpins to QBE (all in one array) */
-  }
-  /* doubling the code to get the if out of the loop */
-
-  /*
-   * Add up Multiloopterms  qmb[l][m]+=prml[m]*dang;
-   * q2l[l][m]+=(prml[m]-prm_l[m])*dang;
-   */
+    case VRNA_PROBS_WINDOW_STACKP:
+      for (j = i + 1; j <= pr_size; j++) {
+        if (pr[j] <= 0.)
+          continue;
 
-  temp = 0.;
-  for (len = winSize; len >= ulength; len--)
-    temp += q2l[k][len] * expMLbase[len];
-  for (; len > 0; len--) {
-    temp      += q2l[k][len] * expMLbase[len];
-    QBE[len]  += temp; /* add (()()____) type cont. to I3 */
-  }
-  for (len = 1; len < ulength; len++) {
-    for (obp = k + len + TURN; obp <= MIN2(n, k + winSize - 1); obp++)
-      /* add (()___()) */
-      QBE[len] += qmb[k][obp - k - 1] * qm[k + len + 1 /*2*/][obp - 1] * expMLbase[len];
-  }
-  for (len = 1; len < ulength; len++) {
-    for (obp = k + len + TURN + TURN; obp <= MIN2(n, k + winSize - 1); obp++) {
-      if (ptype[k][obp]) {
-        temp      = exp_E_MLstem(rtype[(unsigned char)ptype[k][obp]], S1[obp - 1], S1[k + 1], pf_params) * scale[2] * expMLbase[len] * expMLclosing;  /* k:obp */
-        QBE[len]  += pR[k][obp] * temp * qm2[k + len + 1][obp - 1];                                                                                   /* add (___()()) */
+        d->dpp                = (plist *)vrna_realloc(d->dpp, (d->num_dpp + 2) * sizeof(plist));
+        d->dpp[d->num_dpp].i  = i;
+        d->dpp[d->num_dpp].j  = j;
+        d->dpp[d->num_dpp].p  = pr[j];
+        d->num_dpp++;
+        d->dpp[d->num_dpp].i  = 0;
+        d->dpp[d->num_dpp].j  = 0;
+        d->dpp[d->num_dpp].p  = 0.;
       }
-    }
-  }
-  /*
-   * After computing all these contributions in QBE[len], that k is paired
-   * and the unpaired stretch is AT LEAST len long, we start to add that to
-   * the old unpaired thingies;
-   */
-  for (len = 1; len < MIN2(MAX2(ulength, MAXLOOP), n - k); len++)
-    pU[k + len][len] += pU[k + len][len + 1] + QBE[len];
 
-  /* open chain */
-  if ((ulength >= winSize) && (k >= ulength))
-    pU[k][winSize] = scale[winSize] / q[k - winSize + 1][k];
+      break;
 
-  /*
-   * now the not enclosed by any base pair terms for whatever it is we do not need anymore...
-   * ... which should be e.g; k, again
-   */
-  for (startu = MIN2(ulength, k); startu > 0; startu--) {
-    temp = 0.;
-    for (i5 = MAX2(1, k - winSize + 2); i5 <= MIN2(k - startu, n - winSize + 1); i5++)
-      temp += q[i5][k - startu] * q[k + 1][i5 + winSize - 1] * scale[startu] / q[i5][i5 + winSize - 1];
-    /* the 2 Cases where the borders are on the edge of the interval */
-    if ((k >= winSize) && (startu + 1 <= winSize))
-      temp += q[k - winSize + 1][k - startu] * scale[startu] / q[k - winSize + 1][k];
-
-    if ((k <= n - winSize + startu) && (k - startu >= 0) && (k < n) && (startu + 1 <= winSize))
-      temp += q[k + 1][k - startu + winSize] * scale[startu] / q[k - startu + 1][k - startu + winSize];
-
-    /* Divide by number of possible windows */
-    pU[k][startu] += temp;
-    {
-      int leftmost, rightmost;
+    case VRNA_PROBS_WINDOW_PF:
+      d->pU[i][0] = (double)pr[0];
+      break;
 
-      leftmost      = MAX2(1, k - winSize + 1);
-      rightmost     = MIN2(n - winSize + 1, k - startu + 1);
-      pU[k][startu] /= (rightmost - leftmost + 1);
-    }
+    default:
+      break;
   }
-  free(QBE);
-  return;
-}
-
-
-PRIVATE void
-putoutpU(double **pUx,
-         int    k,
-         int    ulength,
-         FILE   *fp)
-{
-  /* put out unpaireds for k, and free pU[k], make sure we don't need pU[k] any more!! */
-  /* could use that for hairpins, also! */
-  int i;
-
-  fprintf(fp, "%d\t", k);
-  for (i = 1; i <= MIN2(ulength, k); i++)
-    fprintf(fp, "%.5g\t", pUx[k][i]);
-  fprintf(fp, "\n");
-  free(pUx[k]);
-}
-
-
-PRIVATE void
-putoutpU_splitup(double **pUx,
-                 int    k,
-                 int    ulength,
-                 FILE   *fp,
-                 char   ident)
-{
-  /* put out unpaireds for k, and free pU[k], make sure we don't need pU[k] any more!! */
-  /* could use that for hairpins, also! */
-  int i;
-
-  fprintf(fp, "%d\t", k);
-  for (i = 1; i <= MIN2(ulength, k); i++)
-    fprintf(fp, "%.5g\t", pUx[k][i]);
-  fprintf(fp, "\t%c\n", ident);
-  free(pUx[k]);
 }
 
 
@@ -1250,7 +623,7 @@ putoutpU_prob(double  **pU,
               FILE    *fp,
               int     energies)
 {
-  putoutpU_prob_par(pU, length, ulength, fp, energies, pf_params);
+  putoutpU_prob_par(pU, length, ulength, fp, energies, backward_compat_pf_params);
 }
 
 
@@ -1305,7 +678,7 @@ putoutpU_prob_bin(double  **pU,
                   FILE    *fp,
                   int     energies)
 {
-  putoutpU_prob_bin_par(pU, length, ulength, fp, energies, pf_params);
+  putoutpU_prob_bin_par(pU, length, ulength, fp, energies, backward_compat_pf_params);
 }
 
 
@@ -1365,192 +738,6 @@ putoutpU_prob_bin_par(double            **pU,
 }
 
 
-/*
- * Here: Space for questions...
- */
-PRIVATE void
-compute_pU_splitup(int    k,
-                   int    ulength,
-                   double **pU,
-                   double **pUO,
-                   double **pUH,
-                   double **pUI,
-                   double **pUM,
-                   int    winSize,
-                   int    n,
-                   char   *sequence)
-{
-  /*
-   *  here, we try to add a function computing all unpaired probabilities starting at some i,
-   *  going down to $unpaired, to be unpaired, i.e. a list with entries from 1 to unpaired for
-   *  every i, with the probability of a stretch of length x, starting at i-x+1, to be unpaired
-   */
-  int         startu;
-  int         i5;
-  int         j3, len, obp;
-  double      temp;
-  double      *QBE;
-  double      *QBI;
-  double      *QBM;
-  double      *QBH;
-
-  FLT_OR_DBL  expMLclosing = pf_params->expMLclosing;
-
-  QBE = (double *)vrna_alloc((MAX2(ulength, MAXLOOP) + 2) * sizeof(double));
-  QBM = (double *)vrna_alloc((MAX2(ulength, MAXLOOP) + 2) * sizeof(double));
-  QBI = (double *)vrna_alloc((MAX2(ulength, MAXLOOP) + 2) * sizeof(double));
-  QBH = (double *)vrna_alloc((MAX2(ulength, MAXLOOP) + 2) * sizeof(double));
-
-  /* first, we will */
-  /* for k<=ulength, pU[k][k]=0, because no bp can enclose it */
-  if (pUoutput && k + ulength <= n)
-    pU[k + ulength] = (double *)vrna_alloc((ulength + 2) * sizeof(double));
-
-  /* compute pu[k+ulength][ulength] */
-  for (i5 = MAX2(k + ulength - winSize + 1, 1); i5 <= k; i5++) {
-    for (j3 = k + ulength + 1; j3 <= MIN2(n, i5 + winSize - 1); j3++) {
-      /*
-       *  if (k>400) {
-       * printf("i%d j%d  ",i5,j3);
-       * fflush(stdout);
-       * }
-       */
-      if (ptype[i5][j3] != 0) {
-        /*
-         * (.. >-----|..........)
-         * i5  j     j+ulength  j3
-         */
-        /* Multiloops */
-        temp = (i5 < k) ? qm2[i5 + 1][k] * expMLbase[j3 - k - 1] : 0.; /* (..{}{}-----|......) */
-
-        if (j3 - 1 > k + ulength)
-          temp += qm2[k + ulength + 1][j3 - 1] * expMLbase[k + ulength - i5]; /* (..|-----|{}{}) */
-
-        if ((i5 < k) && (j3 - 1 > k + ulength))
-          temp += qm[i5 + 1][k] * qm[k + ulength + 1][j3 - 1] * expMLbase[ulength]; /* ({}|-----|{}) */
-
-        /* add dangles, multloopclosing etc. */
-        temp *= exp_E_MLstem(rtype[(unsigned char)ptype[i5][j3]], S1[j3 - 1], S1[i5 + 1], pf_params) * scale[2] * expMLclosing;
-        /* add hairpins */
-        temp += exp_E_Hairpin(j3 - i5 - 1, ptype[i5][j3], S1[i5 + 1], S1[j3 - 1], sequence + i5 - 1, pf_params) * scale[j3 - i5 + 1];
-        /* add outer probability */
-        temp                      *= pR[i5][j3];
-        pU[k + ulength][ulength]  += temp;
-      }
-    }
-  }
-  /* code doubling to avoid if within loop */
-  temp = 0.;
-  for (len = winSize; len >= MAX2(ulength, MAXLOOP); len--)
-    temp += QI5[k][len];
-  for (; len > 0; len--) {
-    temp      += QI5[k][len];
-    QBI[len]  += temp;
-    QBE[len]  += temp; /* replace QBE with QI */
-  }
-  /* Add Hairpinenergy to QBE */
-  temp = 0.;
-  for (obp = MIN2(n, k + winSize - 1); obp > k + ulength; obp--)
-    if (ptype[k][obp])
-      temp += pR[k][obp] * exp_E_Hairpin(obp - k - 1, ptype[k][obp], S1[k + 1], S1[obp - 1], sequence + k - 1, pf_params) * scale[obp - k + 1];
-
-  for (obp = MIN2(n, MIN2(k + winSize - 1, k + ulength)); obp > k + 1; obp--) {
-    if (ptype[k][obp])
-      temp += pR[k][obp] * exp_E_Hairpin(obp - k - 1, ptype[k][obp], S1[k + 1], S1[obp - 1], sequence + k - 1, pf_params) * scale[obp - k + 1];
-
-    QBH[obp - k - 1]  += temp;
-    QBE[obp - k - 1]  += temp; /* add hairpins to QBE (all in one array) */
-  }
-  /* doubling the code to get the if out of the loop */
-
-  /*
-   * Add up Multiloopterms  qmb[l][m]+=prml[m]*dang;
-   * q2l[l][m]+=(prml[m]-prm_l[m])*dang;
-   */
-
-  temp = 0.;
-  for (len = winSize; len >= ulength; len--)
-    temp += q2l[k][len] * expMLbase[len];
-  for (; len > 0; len--) {
-    temp      += q2l[k][len] * expMLbase[len];
-    QBM[len]  += temp;
-    QBE[len]  += temp; /* add (()()____) type cont. to I3 */
-  }
-  for (len = 1; len < ulength; len++) {
-    for (obp = k + len + TURN; obp <= MIN2(n, k + winSize - 1); obp++) {
-      /* add (()___()) */
-      QBM[len]  += qmb[k][obp - k - 1] * qm[k + len + 1 /*2*/][obp - 1] * expMLbase[len];
-      QBE[len]  += qmb[k][obp - k - 1] * qm[k + len + 1 /*2*/][obp - 1] * expMLbase[len];
-    }
-  }
-  for (len = 1; len < ulength; len++) {
-    for (obp = k + len + TURN + TURN; obp <= MIN2(n, k + winSize - 1); obp++) {
-      if (ptype[k][obp]) {
-        temp      = exp_E_MLstem(rtype[(unsigned char)ptype[k][obp]], S1[obp - 1], S1[k + 1], pf_params) * scale[2] * expMLbase[len] * expMLclosing;  /* k:obp */
-        QBE[len]  += pR[k][obp] * temp * qm2[k + len + 1][obp - 1];                                                                                   /* add (___()()) */
-        QBM[len]  += pR[k][obp] * temp * qm2[k + len + 1][obp - 1];                                                                                   /* add (___()()) */
-      }
-    }
-  }
-  /*
-   * After computing all these contributions in QBE[len], that k is paired
-   * and the unpaired stretch is AT LEAST len long, we start to add that to
-   * the old unpaired thingies;
-   */
-  for (len = 1; len < MIN2(MAX2(ulength, MAXLOOP), n - k); len++) {
-    pU[k + len][len]  += pU[k + len][len + 1] + QBE[len];
-    pUH[k + len][len] += pUH[k + len][len + 1] + QBH[len];
-    pUM[k + len][len] += pUM[k + len][len + 1] + QBM[len];
-    pUI[k + len][len] += pUI[k + len][len + 1] + QBI[len];
-  }
-
-  /* open chain */
-  if ((ulength >= winSize) && (k >= ulength))
-    pUO[k][winSize] = scale[winSize] / q[k - winSize + 1][k];
-
-  /* open chain */
-  if ((ulength >= winSize) && (k >= ulength))
-    pU[k][winSize] = scale[winSize] / q[k - winSize + 1][k];
-
-  /*
-   * now the not enclosed by any base pair terms for whatever it is we do not need anymore...
-   * ... which should be e.g; k, again
-   */
-  for (startu = MIN2(ulength, k); startu > 0; startu--) {
-    temp = 0.;
-    for (i5 = MAX2(1, k - winSize + 2); i5 <= MIN2(k - startu, n - winSize + 1); i5++)
-      temp += q[i5][k - startu] * q[k + 1][i5 + winSize - 1] * scale[startu] / q[i5][i5 + winSize - 1];
-    /* the 2 Cases where the borders are on the edge of the interval */
-    if ((k >= winSize) && (startu + 1 <= winSize))
-      temp += q[k - winSize + 1][k - startu] * scale[startu] / q[k - winSize + 1][k];
-
-    if ((k <= n - winSize + startu) && (k - startu >= 0) && (k < n) && (startu + 1 <= winSize))
-      temp += q[k + 1][k - startu + winSize] * scale[startu] / q[k - startu + 1][k - startu + winSize];
-
-    /* Divide by number of possible windows */
-    pU[k][startu]   += temp;
-    pUO[k][startu]  += temp;
-
-    {
-      int leftmost, rightmost;
-
-      leftmost      = MAX2(1, k - winSize + 1);
-      rightmost     = MIN2(n - winSize + 1, k - startu + 1);
-      pU[k][startu] /= (rightmost - leftmost + 1);
-      /* Do we want to make a distinction between those? */
-      pUH[k][startu]  /= (rightmost - leftmost + 1);
-      pUO[k][startu]  /= (rightmost - leftmost + 1);
-      pUI[k][startu]  /= (rightmost - leftmost + 1);
-      pUM[k][startu]  /= (rightmost - leftmost + 1);
-    }
-  }
-  free(QBE);
-  free(QBI);
-  free(QBH);
-  free(QBM);
-  return;
-}
-
 
 PUBLIC void
 putoutpU_prob_splitup(double  **pU,
@@ -22,6 +22,157 @@
  */
 
 
+/**
+ *  \brief Flag to request pair probabilities from vrna_probs_window()
+ *
+ *  \ingroup local_pf_fold
+ *  \see vrna_probs_window(), #vrna_probs_window_callback
+ */
+#define VRNA_PROBS_WINDOW_BPP     4096U
+
+/**
+ *  \brief Flag to request unpaired probabilities from vrna_probs_window()
+ *
+ *  \ingroup local_pf_fold
+ *  \see vrna_probs_window(), #vrna_probs_window_callback
+ */
+#define VRNA_PROBS_WINDOW_UP      8192U
+
+/**
+ *  \brief Flag to request stacking probabilities from vrna_probs_window()
+ *
+ *  \ingroup local_pf_fold
+ *  \see vrna_probs_window(), #vrna_probs_window_callback
+ */
+#define VRNA_PROBS_WINDOW_STACKP  16384U
+
+/**
+ *  \brief Flag to request ensemble free energies of each window from vrna_probs_window()
+ *
+ *  \ingroup local_pf_fold
+ *  \see vrna_probs_window(), #vrna_probs_window_callback
+ */
+#define VRNA_PROBS_WINDOW_PF      32768U
+
+/**
+ *  \brief Callback that receives the results of vrna_probs_window()
+ *
+ *  The interpretation of the arguments depends on the data @p type that is passed:
+ *  - #VRNA_PROBS_WINDOW_BPP: @p pr[j] holds the mean probability of base pair (i,j),
+ *    averaged over all windows containing the pair, for all j with i < j <= @p pr_size.
+ *    @p max is the window size.
+ *  - #VRNA_PROBS_WINDOW_UP: @p pr[u] holds the mean probability that the stretch of
+ *    length u that ends at position i is unpaired, for all 1 <= u <= @p pr_size.
+ *    @p max is the maximum length of unpaired stretches.
+ *  - #VRNA_PROBS_WINDOW_STACKP: @p pr[j] holds the probability of base pair (i,j),
+ *    given that pair (i-1,j+1) is formed, for all j with i < j <= @p pr_size.
+ *    @p max is the maximum base pair span.
+ *  - #VRNA_PROBS_WINDOW_PF: @p pr[0] holds the ensemble free energy in kcal/mol of the
+ *    window that ends at position i. @p max is the window size.
+ *
+ *  Data for each position i is passed exactly once, and positions are passed in
+ *  increasing order for each type. The memory @p pr points to is owned by
+ *  vrna_probs_window() and must not be free'd or used after the callback returns.
+ *
+ *  \ingroup local_pf_fold
+ *
+ *  \param pr      The probabilities (or energies) for position @p i
+ *  \param pr_size The largest valid index of @p pr
+ *  \param i       The position the data belongs to
+ *  \param max     The maximum size of the data, see above
+ *  \param type    The type of the data
+ *  \param data    The auxiliary data passed to vrna_probs_window()
+ */
+typedef void (vrna_probs_window_callback)(FLT_OR_DBL    *pr,
+                                          int           pr_size,
+                                          int           i,
+                                          int           max,
+                                          unsigned int  type,
+                                          void          *data);
+
+
+/**
+ *  \brief Compute local pair and unpaired probabilities using a sliding window approach
+ *
+ *  This function computes partition functions for every window of size
+ *  #vrna_fold_compound_t.window_size in the sequence of @p vc, allowing only base
+ *  pairs with a span smaller than the maximum base pair span of the model details.
+ *  Pair probabilities are averaged over all windows containing the pair, and
+ *  handed over to the callback @p cb as soon as they are available. Only a band
+ *  of DP matrices that is proportional to the window size is kept in memory.
+ *
+ *  The fold compound must be created with option #VRNA_OPTION_WINDOW, e.g.
+ *  @code
+ *  vrna_md_t md;
+ *  vrna_md_set_default(&md);
+ *  md.window_size = 70;
+ *  md.max_bp_span = 40;
+ *  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+ *  vrna_probs_window(vc, 30, VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP, &my_callback, my_data);
+ *  @endcode
+ *
+ *  All state of the computations is stored within @p vc and local variables. Thus,
+ *  different fold compounds may be processed concurrently from different threads.
+ *
+ *  If #vrna_md_t.pf_float of the model details is set, the band of DP matrices is
+ *  kept in single precision. The results are still passed to @p cb as #FLT_OR_DBL.
+ *
+ *  \ingroup local_pf_fold
+ *
+ *  \see #vrna_probs_window_callback, pfl_fold_par(), #vrna_md_t.pf_float
+ *
+ *  \param vc      The fold compound
+ *  \param ulength The maximum length of unpaired stretches (only used with #VRNA_PROBS_WINDOW_UP)
+ *  \param options The data to compute, a bitwise OR of #VRNA_PROBS_WINDOW_BPP, #VRNA_PROBS_WINDOW_UP,
+ *                  #VRNA_PROBS_WINDOW_STACKP, and #VRNA_PROBS_WINDOW_PF
+ *  \param cb      The callback that receives the results
+ *  \param data    Auxiliary data passed through to the callback
+ *  \return        1 on success, 0 otherwise
+ */
+int vrna_probs_window(vrna_fold_compound_t        *vc,
+                      int                         ulength,
+                      unsigned int                options,
+                      vrna_probs_window_callback  *cb,
+                      void                        *data);
+
+
+/**
+ *  \brief Compute local pair and unpaired probabilities for long sequences in parallel
+ *
+ *  This function splits the sequence of @p vc into chunks that overlap by roughly
+ *  two window sizes, and processes them independently with vrna_probs_window(),
+ *  distributing the chunks among the available threads (if compiled with OpenMP
+ *  support). Since the results for each position only depend on the windows that
+ *  contain it, the results for the core region of each chunk are identical to those
+ *  obtained by vrna_probs_window() for the entire sequence.
+ *
+ *  The results of each chunk are handed over to the callback @p cb in the order of
+ *  the sequence, i.e. data of each type is passed in increasing order of positions,
+ *  and the callback is never invoked concurrently. However, the interleaving of the
+ *  different types of data may differ from that of vrna_probs_window(). Sequences that
+ *  are too short to be split are processed by vrna_probs_window() directly. The same
+ *  applies, after issuing a warning, to fold compounds with hard or soft constraints, or
+ *  unstructured domains attached, since these are not transferred to the chunks.
+ *
+ *  \ingroup local_pf_fold
+ *
+ *  \see vrna_probs_window(), #vrna_probs_window_callback
+ *
+ *  \param vc      The fold compound
+ *  \param ulength The maximum length of unpaired stretches (only used with #VRNA_PROBS_WINDOW_UP)
+ *  \param options The data to compute, a bitwise OR of #VRNA_PROBS_WINDOW_BPP, #VRNA_PROBS_WINDOW_UP,
+ *                  #VRNA_PROBS_WINDOW_STACKP, and #VRNA_PROBS_WINDOW_PF
+ *  \param cb      The callback that receives the results
+ *  \param data    Auxiliary data passed through to the callback
+ *  \return        1 on success, 0 otherwise
+ */
+int vrna_probs_window_parallel(vrna_fold_compound_t       *vc,
+                               int                        ulength,
+                               unsigned int               options,
+                               vrna_probs_window_callback *cb,
+                               void                       *data);
+
+
 /**
  *  \brief
  *
@@ -67,6 +218,10 @@ void update_pf_paramsLP_par(int               length,
  *  is not saved but put out imediately. If spup is given (i.e. is not NULL),
  *  the pair probabilities in pl are not saved but put out imediately.
  *
+ *  \note This function is a wrapper around vrna_probs_window() that is kept
+ *  for backward compatibility. If more than one OpenMP thread is available, long
+ *  sequences are processed in chunks using vrna_probs_window_parallel() instead.
+ *
  *  \ingroup local_pf_fold
  *
  *  \param  sequence  RNA sequence
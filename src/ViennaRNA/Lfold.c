@@ -46,11 +46,37 @@
 #define NONE -10000 /* score for forbidden pairs */
 
 
+/*
+ *  Sequence chunks processed by vrna_mfe_window_parallel_cb() consist of
+ *  a core region of CHUNK_FACTOR times the initial overlap
+ */
+#define CHUNK_FACTOR  16
+
+
 typedef struct {
   FILE  *output;
   int   dangle_model;
 } hit_data;
 
+/* a locally optimal structure predicted for a sequence chunk */
+typedef struct {
+  int   start;
+  int   end;
+  char  *structure;
+  float en;
+  float zscore;
+} chunk_hit;
+
+/* predictions of a sequence chunk, in global coordinates */
+typedef struct {
+  int       shift;        /* offset of the chunk within the entire sequence */
+  int       first;        /* smallest start position of a structure owned by this chunk */
+  int       last;         /* largest start position of a structure owned by this chunk */
+  chunk_hit *hits;
+  int       num_hits;
+  int       max_hits;
+} chunk_data;
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -78,6 +104,64 @@ PRIVATE float wrap_Lfold(vrna_fold_compound_t             *vc,
                          void                             *data);
 
 
+PRIVATE float wrap_Lfold_parallel(vrna_fold_compound_t            *vc,
+                                  int                             with_zsc,
+                                  double                          min_z,
+                                  vrna_mfe_window_callback        *cb,
+#ifdef VRNA_WITH_SVM
+                                  vrna_mfe_window_zscore_callback *cb_z,
+#endif
+                                  void                            *data);
+
+
+PRIVATE int *process_chunk(vrna_fold_compound_t *vc,
+                           int                  with_zsc,
+                           double               min_z,
+                           int                  from,
+                           int                  to,
+                           chunk_data           *chunk);
+
+
+PRIVATE int   chunk_is_exact(const int  *f3,
+                             const int  *f3_next,
+                             chunk_data *chunk,
+                             int        from,
+                             int        to,
+                             int        last,
+                             int        n,
+                             int        maxdist);
+
+
+PRIVATE void  free_chunk_hits(chunk_data *chunk);
+
+
+PRIVATE void  add_chunk_hit(chunk_data  *chunk,
+                            int         start,
+                            int         end,
+                            const char  *structure,
+                            float       en,
+                            float       zscore);
+
+
+PRIVATE void  store_chunk_hit(int         start,
+                              int         end,
+                              const char  *structure,
+                              float       en,
+                              void        *data);
+
+
+#ifdef VRNA_WITH_SVM
+PRIVATE void  store_chunk_hit_z(int         start,
+                                int         end,
+                                const char  *structure,
+                                float       en,
+                                float       zscore,
+                                void        *data);
+
+
+#endif
+
+
 PRIVATE void  make_ptypes(vrna_fold_compound_t  *vc,
                           int                   i);
 
@@ -233,6 +317,20 @@ vrna_mfe_window_cb(vrna_fold_compound_t     *vc,
 }
 
 
+PUBLIC float
+vrna_mfe_window_parallel_cb(vrna_fold_compound_t      *vc,
+                            vrna_mfe_window_callback  *cb,
+                            void                      *data)
+{
+  return wrap_Lfold_parallel(vc, 0, 0.0,
+                             cb,
+#ifdef VRNA_WITH_SVM
+                             NULL,
+#endif
+                             data);
+}
+
+
 #ifdef VRNA_WITH_SVM
 
 PUBLIC float
@@ -303,6 +401,16 @@ vrna_mfe_window_zscore_cb(vrna_fold_compound_t            *vc,
 }
 
 
+PUBLIC float
+vrna_mfe_window_zscore_parallel_cb(vrna_fold_compound_t             *vc,
+                                   double                           min_z,
+                                   vrna_mfe_window_zscore_callback  *cb,
+                                   void                             *data)
+{
+  return wrap_Lfold_parallel(vc, 1, min_z, NULL, cb, data);
+}
+
+
 #endif
 
 
@@ -413,6 +521,267 @@ wrap_Lfold(vrna_fold_compound_t             *vc,
 }
 
 
+/*
+ *  Locally optimal structures only depend on the sequence up to one window
+ *  size upstream, and on the differences of the f3 energies downstream. The
+ *  sequence is split into chunks that are extended by a little more than a
+ *  window upstream, and by some overlap downstream. Chunks are processed
+ *  independently, and then verified from 3' to 5': if the f3 energies of a
+ *  chunk differ from those of its (already verified) downstream neighbor by
+ *  a constant offset within one window, all predictions of its core are
+ *  identical to those of the entire sequence. Otherwise, the chunk is
+ *  recomputed with a larger overlap.
+ */
+PRIVATE float
+wrap_Lfold_parallel(vrna_fold_compound_t            *vc,
+                    int                             with_zsc,
+                    double                          min_z,
+                    vrna_mfe_window_callback        *cb,
+#ifdef VRNA_WITH_SVM
+                    vrna_mfe_window_zscore_callback *cb_z,
+#endif
+                    void                            *data)
+{
+  int   n, t, maxdist, upstream, downstream, chunk_size, num_chunks, *f3_next;
+  long  energy;
+
+  if (vc->type != VRNA_FC_TYPE_SINGLE)
+    return wrap_Lfold(vc, with_zsc, min_z,
+                      cb,
+#ifdef VRNA_WITH_SVM
+                      cb_z,
+#endif
+                      data);
+
+  n           = (int)vc->length;
+  maxdist     = vc->window_size;
+  upstream    = maxdist + 8;
+  downstream  = 4 * maxdist + 100;
+  chunk_size  = CHUNK_FACTOR * (upstream + downstream);
+  num_chunks  = (n + chunk_size - 1) / chunk_size;
+
+  if (num_chunks < 2)
+    return wrap_Lfold(vc, with_zsc, min_z,
+                      cb,
+#ifdef VRNA_WITH_SVM
+                      cb_z,
+#endif
+                      data);
+
+  f3_next = NULL;
+  energy  = 0;
+
+  /* process the chunks from 3' to 5' end to obtain the same order of predictions */
+#ifdef _OPENMP
+#pragma omp parallel for ordered schedule(dynamic, 1)
+#endif
+  for (t = 0; t < num_chunks; t++) {
+    int         c, h, first, last, from, to, overlap, *f3;
+    chunk_data  chunk;
+
+    c         = num_chunks - 1 - t;
+    first     = c * chunk_size + 1;
+    last      = MIN2(n, first + chunk_size - 1);
+    from      = (c > 0) ? first - upstream : 1;
+    overlap   = downstream;
+    to        = MIN2(n, last + overlap);
+
+    chunk.shift     = from - 1;
+    chunk.first     = (c > 0) ? first + 1 : 1;
+    chunk.last      = last + 1;
+    chunk.hits      = NULL;
+    chunk.num_hits  = chunk.max_hits = 0;
+
+    f3 = process_chunk(vc, with_zsc, min_z, from, to, &chunk);
+
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+    {
+      while (!chunk_is_exact(f3, f3_next, &chunk, from, to, last, n, maxdist)) {
+        /* extend the chunk further downstream and try again */
+        free(f3);
+        free_chunk_hits(&chunk);
+        overlap *= 2;
+        to      = MIN2(n, last + overlap);
+        f3      = process_chunk(vc, with_zsc, min_z, from, to, &chunk);
+      }
+
+      for (h = 0; h < chunk.num_hits; h++) {
+#ifdef VRNA_WITH_SVM
+        if (with_zsc)
+          cb_z(chunk.hits[h].start, chunk.hits[h].end, chunk.hits[h].structure,
+               chunk.hits[h].en, chunk.hits[h].zscore, data);
+        else
+#endif
+        cb(chunk.hits[h].start, chunk.hits[h].end, chunk.hits[h].structure, chunk.hits[h].en, data);
+      }
+
+      /* sum up the energy differences of all chunk cores */
+      energy += f3[first - from + 1];
+      if (last < n)
+        energy -= f3[last - from + 2];
+
+      /* keep the leading f3 energies for verification of the upstream chunk */
+      free(f3_next);
+      f3_next = (int *)vrna_alloc(sizeof(int) * (maxdist + 4));
+      for (h = 0; (h < maxdist + 4) && (first + h <= n); h++)
+        f3_next[h] = f3[first + h - from + 1];
+    }
+
+    free(f3);
+    free_chunk_hits(&chunk);
+  }
+
+  free(f3_next);
+
+  return (float)energy / 100.;
+}
+
+
+/*
+ *  Predict the locally optimal structures of the subsequence from..to, and
+ *  return a copy of its f3 array, indexed by position within the subsequence
+ */
+PRIVATE int *
+process_chunk(vrna_fold_compound_t  *vc,
+              int                   with_zsc,
+              double                min_z,
+              int                   from,
+              int                   to,
+              chunk_data            *chunk)
+{
+  int                   length, *f3;
+  char                  *sequence;
+  vrna_fold_compound_t  *fc;
+
+  length    = to - from + 1;
+  sequence  = (char *)vrna_alloc(sizeof(char) * (length + 1));
+  memcpy(sequence, vc->sequence + from - 1, sizeof(char) * length);
+
+  fc = vrna_fold_compound(sequence, &(vc->params->model_details), VRNA_OPTION_MFE | VRNA_OPTION_WINDOW);
+  vrna_params_subst(fc, vc->params);
+
+  (void)wrap_Lfold(fc, with_zsc, min_z,
+                   &store_chunk_hit,
+#ifdef VRNA_WITH_SVM
+                   &store_chunk_hit_z,
+#endif
+                   (void *)chunk);
+
+  f3 = (int *)vrna_alloc(sizeof(int) * (length + 2));
+  memcpy(f3, fc->matrices->f3_local, sizeof(int) * (length + 2));
+
+  vrna_fold_compound_free(fc);
+  free(sequence);
+
+  return f3;
+}
+
+
+PRIVATE int
+chunk_is_exact(const int  *f3,
+               const int  *f3_next,
+               chunk_data *chunk,
+               int        from,
+               int        to,
+               int        last,
+               int        n,
+               int        maxdist)
+{
+  int h, p, offset;
+
+  /* chunks that reach the 3' end of the sequence are always exact */
+  if (to == n)
+    return 1;
+
+  /* all predictions must be within the verified region */
+  for (h = 0; h < chunk->num_hits; h++)
+    if (chunk->hits[h].end > last + maxdist + 2)
+      return 0;
+
+  offset = f3[last - from + 2] - f3_next[0];
+
+  for (p = last + 1; (p <= last + maxdist + 4) && (p <= n); p++)
+    if (f3[p - from + 1] - f3_next[p - last - 1] != offset)
+      return 0;
+
+  return 1;
+}
+
+
+PRIVATE void
+free_chunk_hits(chunk_data *chunk)
+{
+  int h;
+
+  for (h = 0; h < chunk->num_hits; h++)
+    free(chunk->hits[h].structure);
+
+  free(chunk->hits);
+
+  chunk->hits     = NULL;
+  chunk->num_hits = chunk->max_hits = 0;
+}
+
+
+PRIVATE void
+add_chunk_hit(chunk_data  *chunk,
+              int         start,
+              int         end,
+              const char  *structure,
+              float       en,
+              float       zscore)
+{
+  chunk_hit *hit;
+
+  start += chunk->shift;
+
+  /* only keep structures that start within the core of the chunk */
+  if ((start < chunk->first) || (start > chunk->last))
+    return;
+
+  if (chunk->num_hits == chunk->max_hits) {
+    chunk->max_hits = (chunk->max_hits) ? 2 * chunk->max_hits : 128;
+    chunk->hits     = (chunk_hit *)vrna_realloc(chunk->hits, sizeof(chunk_hit) * chunk->max_hits);
+  }
+
+  hit             = chunk->hits + chunk->num_hits++;
+  hit->start      = start;
+  hit->end        = end + chunk->shift;
+  hit->structure  = strdup(structure);
+  hit->en         = en;
+  hit->zscore     = zscore;
+}
+
+
+PRIVATE void
+store_chunk_hit(int         start,
+                int         end,
+                const char  *structure,
+                float       en,
+                void        *data)
+{
+  add_chunk_hit((chunk_data *)data, start, end, structure, en, 0.);
+}
+
+
+#ifdef VRNA_WITH_SVM
+PRIVATE void
+store_chunk_hit_z(int         start,
+                  int         end,
+                  const char  *structure,
+                  float       en,
+                  float       zscore,
+                  void        *data)
+{
+  add_chunk_hit((chunk_data *)data, start, end, structure, en, zscore);
+}
+
+
+#endif
+
+
 PRIVATE int
 fill_arrays(vrna_fold_compound_t            *vc,
             int                             zsc,
@@ -982,7 +1351,7 @@ fill_arrays(vrna_fold_compound_t            *vc,
                     break;
                   } else if (pairpartner < length) {
                     cc = c[lind][pairpartner - lind] + E_ExtLoop(type, -1, S1[pairpartner + 1], P);
-                    if (fij == cc + f3[pairpartner + 1]) {
+                    if (fij == cc + f3[pairpartner + 2]) {
                       traced2 = 1;
                       break;
                     }
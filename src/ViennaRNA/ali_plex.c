@@ -1295,7 +1295,7 @@ PRIVATE short * encode_seq(const char *sequence) {
   short *S;
   l = strlen(sequence);
   S = (short *) vrna_alloc(sizeof(short)*(l+2));
-  S[0] = (short) l;
+  S[0] = (short)(unsigned short) l;
 
   /* make numerical encoding of sequence */
   for (i=1; i<=l; i++)
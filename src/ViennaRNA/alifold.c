@@ -163,7 +163,7 @@ wrap_alifold( const char **strings,
   vc = vrna_fold_compound_comparative(strings, &(P->model_details), VRNA_OPTION_DEFAULT);
 
   if(parameters){ /* replace params if necessary */
-    free(vc->params);
+    vrna_params_release(vc->params);
     vc->params = P;
   } else {
     free(P);
@@ -239,7 +239,7 @@ update_alifold_params(void){
     v = backward_compat_compound;
 
     if(v->params)
-      free(v->params);
+      vrna_params_release(v->params);
 
     vrna_md_t md;
     set_model_details(&md);
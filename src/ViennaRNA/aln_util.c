@@ -543,7 +543,7 @@ encode_ali_sequence(const char *sequence,
   unsigned int i,l;
   unsigned short p;
   l     = strlen(sequence);
-  S[0]  = (short) l;
+  S[0]  = (short)(unsigned short) l;
   s5[0] = s5[1] = 0;
 
   /* make numerical encoding of sequence */
@@ -15,6 +15,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
 
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/alphabet.h"
@@ -72,16 +73,17 @@ vrna_sequence_length_max(unsigned int options){
   if(options & VRNA_OPTION_WINDOW)
     return (unsigned int)INT_MAX;
 
-/*
-  return (unsigned int)sqrt((double)INT_MAX);
-*/
   /*
-      many functions in RNAlib still rely on the sequence length
-      at pos 0 in the integer encoded sequence array S. Since this
-      encoding is stored in a short * array, the maximum length
-      of any sequence is SHRT_MAX
+      global folding stores its DP matrices in triangular arrays
+      of size (n+1)(n+2)/2 that are addressed by 'int' offsets
+      (see vrna_idx_col_wise() and vrna_idx_row_wise()). Thus, the
+      largest sequence length n we can handle is the one where
+      (n+1)(n+2)/2 <= INT_MAX still holds, i.e. n = 65533.
+      Note, that this also covers the sequence length that is
+      stored at position 0 of the integer encoded sequence S,
+      which is interpreted as unsigned short.
   */
-  return (unsigned int)SHRT_MAX;
+  return (unsigned int)sqrt(2. * (double)INT_MAX) - 2;
 }
 
 
@@ -144,14 +146,14 @@ vrna_ptypes(const short *S,
   int n,i,j,k,l,*idx;
   int min_loop_size = md->min_loop_size;
 
-  n     = S[0];
+  n     = (unsigned short)S[0];
 
   if((unsigned int)n > vrna_sequence_length_max(VRNA_OPTION_DEFAULT)){
     vrna_message_warning("vrna_ptypes@alphabet.c: sequence length of %d exceeds addressable range", n);
     return NULL;
   }
 
-  ptype = (char *)vrna_alloc(sizeof(char)*((n*(n+1))/2+2));
+  ptype = (char *)vrna_alloc(sizeof(char)*(((size_t)n*(n+1))/2+2));
   idx   = vrna_idx_col_wise(n);
 
   for (k=1; k<n-min_loop_size; k++)
@@ -210,7 +212,8 @@ vrna_seq_encode_simple( const char *sequence,
       S[i]= (short) vrna_nucleotide_encode(toupper(sequence[i-1]), md);
 
     S[l+1] = S[1];
-    S[0] = (short) l;
+    /* length is stored as unsigned short, see vrna_sequence_length_max() */
+    S[0] = (short)(unsigned short) l;
   }
 
   return S;
@@ -345,8 +348,8 @@ wrap_get_ptypes(const short *S,
   char *ptype;
   int n,i,j,k,l,*idx;
 
-  n     = S[0];
-  ptype = (char *)vrna_alloc(sizeof(char)*((n*(n+1))/2+2));
+  n     = (unsigned short)S[0];
+  ptype = (char *)vrna_alloc(sizeof(char)*(((size_t)n*(n+1))/2+2));
   idx   = vrna_idx_row_wise(n);
   int min_loop_size = md->min_loop_size;
 
@@ -381,8 +384,8 @@ get_ptypes( const short *S,
             unsigned int idx_type){
 
   if(S){
-    if((unsigned int)S[0] > vrna_sequence_length_max(VRNA_OPTION_DEFAULT)){
-      vrna_message_warning("get_ptypes@alphabet.c: sequence length of %d exceeds addressable range", (int)S[0]);
+    if((unsigned int)(unsigned short)S[0] > vrna_sequence_length_max(VRNA_OPTION_DEFAULT)){
+      vrna_message_warning("get_ptypes@alphabet.c: sequence length of %d exceeds addressable range", (int)(unsigned short)S[0]);
       return NULL;
     }
 
@@ -28,6 +28,20 @@
 
 #include <ViennaRNA/model.h>
 
+/**
+ *  @brief Get the maximum sequence length that can be processed
+ *
+ *  For sliding-window computations (#VRNA_OPTION_WINDOW), this is INT_MAX. Global
+ *  folding is limited by the integer offsets used to address the triangular
+ *  dynamic programming matrices, which allows for sequences of up to 65533 nt.
+ *
+ *  @note   Pair tables (see vrna_ptable()) store nucleotide positions as @p short
+ *          and are, therefore, still restricted to sequences of at most SHRT_MAX nt.
+ *          This affects all structure based utilities, e.g. vrna_eval_structure().
+ *
+ *  @param  options The options that will be passed to vrna_fold_compound()
+ *  @return         The maximum sequence length
+ */
 unsigned int vrna_sequence_length_max(unsigned int options);
 
 int vrna_nucleotide_IUPAC_identity(char a, char b);
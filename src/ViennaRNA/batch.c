@@ -0,0 +1,278 @@
+/*
+ *  ViennaRNA/batch.c
+ *
+ *  Structure prediction for large sets of independent sequences
+ *
+ *  Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/data_structures.h"
+#include "ViennaRNA/model.h"
+#include "ViennaRNA/params.h"
+#include "ViennaRNA/mfe.h"
+#include "ViennaRNA/part_func.h"
+#include "ViennaRNA/part_func_co.h"
+#include "ViennaRNA/batch.h"
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+
+PRIVATE unsigned int *
+get_processing_order(const char   **sequences,
+                     unsigned int n);
+
+
+PRIVATE int
+compare_length_desc(const void  *a,
+                    const void  *b);
+
+
+PRIVATE vrna_fold_compound_t *
+get_fold_compound(vrna_fold_compound_t  **vc_thread,
+                  const char            *sequence,
+                  vrna_md_t             *md,
+                  unsigned int          options);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC float *
+vrna_mfe_batch(const char **sequences,
+               vrna_md_t  *md_p,
+               char       **structures)
+{
+  unsigned int  n, *order;
+  float         *mfe;
+  vrna_md_t     md;
+
+  if (!sequences)
+    return NULL;
+
+  for (n = 0; sequences[n]; n++);
+
+  if (n == 0)
+    return NULL;
+
+  if (md_p)
+    md = *md_p;
+  else
+    vrna_md_set_default(&md);
+
+  mfe   = (float *)vrna_alloc(sizeof(float) * n);
+  order = get_processing_order(sequences, n);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    int                   k;
+    unsigned int          i;
+    char                  *structure;
+    vrna_fold_compound_t  *vc_thread, *vc;
+
+    vc_thread = NULL;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+    for (k = 0; k < (int)n; k++) {
+      i         = order[k];
+      vc        = get_fold_compound(&vc_thread, sequences[i], &md, VRNA_OPTION_MFE);
+      structure = (structures) ? (char *)vrna_alloc(sizeof(char) * (strlen(sequences[i]) + 1)) : NULL;
+
+      if (vc->cutpoint > 0)
+        mfe[i] = vrna_mfe_dimer(vc, structure);
+      else
+        mfe[i] = vrna_mfe(vc, structure);
+
+      if (structures)
+        structures[i] = structure;
+
+      if (vc != vc_thread)
+        vrna_fold_compound_free(vc);
+    }
+
+    vrna_fold_compound_free(vc_thread);
+  }
+
+  free(order);
+
+  return mfe;
+}
+
+
+PUBLIC float *
+vrna_pf_batch(const char  **sequences,
+              vrna_md_t   *md_p,
+              const float *mfe,
+              char        **structures)
+{
+  unsigned int  n, *order;
+  float         *G;
+  vrna_md_t     md;
+
+  if (!sequences)
+    return NULL;
+
+  for (n = 0; sequences[n]; n++);
+
+  if (n == 0)
+    return NULL;
+
+  if (md_p)
+    md = *md_p;
+  else
+    vrna_md_set_default(&md);
+
+  G     = (float *)vrna_alloc(sizeof(float) * n);
+  order = get_processing_order(sequences, n);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    int                   k;
+    unsigned int          i;
+    char                  *structure;
+    double                e;
+    vrna_fold_compound_t  *vc_thread, *vc;
+
+    vc_thread = NULL;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+    for (k = 0; k < (int)n; k++) {
+      i         = order[k];
+      vc        = get_fold_compound(&vc_thread, sequences[i], &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+      structure = ((structures) && (md.compute_bpp)) ?
+                  (char *)vrna_alloc(sizeof(char) * (strlen(sequences[i]) + 1)) :
+                  NULL;
+
+      /*
+       *  scale the partition function according to the MFE if it is known. Otherwise,
+       *  vrna_pf() starts with the default estimate and adjusts the scaling factor
+       *  itself upon over- or underflow. The dimer partition function lacks such an
+       *  adjustment, so we compute the MFE in that case
+       */
+      if (vc->cutpoint > 0) {
+        e = (mfe) ? (double)mfe[i] : (double)vrna_mfe_dimer(vc, NULL);
+        vrna_exp_params_rescale(vc, &e);
+        G[i] = (float)vrna_pf_dimer(vc, structure).FAB;
+      } else {
+        if (mfe) {
+          e = (double)mfe[i];
+          vrna_exp_params_rescale(vc, &e);
+        }
+
+        G[i] = vrna_pf(vc, structure);
+      }
+
+      if (structures)
+        structures[i] = structure;
+
+      if (vc != vc_thread)
+        vrna_fold_compound_free(vc);
+    }
+
+    vrna_fold_compound_free(vc_thread);
+  }
+
+  free(order);
+
+  return G;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+
+/*
+ *  Process the longest sequences first, such that the remaining (cheaper) predictions
+ *  fill the gaps of the dynamic schedule, and the first fold compound of each thread
+ *  provides enough memory for all subsequent ones
+ */
+PRIVATE unsigned int *
+get_processing_order(const char   **sequences,
+                     unsigned int n)
+{
+  unsigned int  i, *order, (*pairs)[2];
+
+  pairs = vrna_alloc(sizeof(*pairs) * n);
+  order = (unsigned int *)vrna_alloc(sizeof(unsigned int) * n);
+
+  for (i = 0; i < n; i++) {
+    pairs[i][0] = (unsigned int)strlen(sequences[i]);
+    pairs[i][1] = i;
+  }
+
+  qsort(pairs, n, sizeof(*pairs), &compare_length_desc);
+
+  for (i = 0; i < n; i++)
+    order[i] = pairs[i][1];
+
+  free(pairs);
+
+  return order;
+}
+
+
+PRIVATE int
+compare_length_desc(const void  *a,
+                    const void  *b)
+{
+  const unsigned int  *p1, *p2;
+
+  p1  = (const unsigned int *)a;
+  p2  = (const unsigned int *)b;
+
+  if (p1[0] != p2[0])
+    return (p1[0] > p2[0]) ? -1 : 1;
+
+  /* keep input order for sequences of equal length */
+  return (p1[1] < p2[1]) ? -1 : ((p1[1] > p2[1]) ? 1 : 0);
+}
+
+
+/*
+ *  Re-target the fold compound of the current thread to the next sequence. Concatenated
+ *  sequences always receive a fold compound of their own that must be free'd by the caller
+ */
+PRIVATE vrna_fold_compound_t *
+get_fold_compound(vrna_fold_compound_t  **vc_thread,
+                  const char            *sequence,
+                  vrna_md_t             *md,
+                  unsigned int          options)
+{
+  if (strchr(sequence, '&'))
+    return vrna_fold_compound(sequence, md, options | VRNA_OPTION_HYBRID);
+
+  if (*vc_thread) {
+    if (vrna_fold_compound_reset_sequence(*vc_thread, sequence))
+      return *vc_thread;
+
+    vrna_fold_compound_free(*vc_thread);
+  }
+
+  *vc_thread = vrna_fold_compound(sequence, md, options);
+
+  return *vc_thread;
+}
@@ -0,0 +1,90 @@
+#ifndef VIENNA_RNA_PACKAGE_BATCH_H
+#define VIENNA_RNA_PACKAGE_BATCH_H
+
+#include <ViennaRNA/data_structures.h>
+#include <ViennaRNA/model.h>
+
+/**
+ *  @file     batch.h
+ *  @ingroup  batch_fold
+ *  @brief    Structure prediction for large sets of independent sequences
+ */
+
+/**
+ *  @addtogroup batch_fold
+ *  @brief  Predict structures for many independent sequences at once
+ *
+ *  The functions in this module take a list of sequences that share the same set
+ *  of model details and distribute the predictions among the available threads
+ *  (if compiled with OpenMP support). Sequences are processed in order of decreasing
+ *  length to balance the cubic costs of the individual predictions, and each thread
+ *  re-uses its #vrna_fold_compound_t, including energy parameters and dynamic
+ *  programming matrices, for all sequences it processes. The results are always
+ *  returned in the order of the input.
+ *
+ *  The number of threads may be controlled via the OpenMP runtime, e.g. using
+ *  omp_set_num_threads() or the @p OMP_NUM_THREADS environment variable.
+ *
+ *  Sequences may consist of two concatenated strands separated by an ampersand
+ *  character ('&'), in which case the dimer variants of the corresponding
+ *  algorithms are used.
+ *
+ *  @{
+ *  @ingroup  batch_fold
+ */
+
+/**
+ *  @brief  Compute minimum free energies and structures for a list of sequences
+ *
+ *  If @p structures is not @p NULL, it must provide space for one pointer per input
+ *  sequence. On return, each of them points to a newly allocated string containing
+ *  the MFE structure of the corresponding sequence that must be free'd by the caller.
+ *  Otherwise, no backtracking is performed.
+ *
+ *  @see    vrna_mfe(), vrna_mfe_dimer(), vrna_pf_batch()
+ *
+ *  @param  sequences   A @p NULL terminated list of sequences
+ *  @param  md_p        The model details used for all predictions (Maybe @p NULL)
+ *  @param  structures  An array that receives the MFE structures (Maybe @p NULL)
+ *  @return             An array with the MFE of each sequence in kcal/mol, or @p NULL on error
+ */
+float *
+vrna_mfe_batch(const char **sequences,
+               vrna_md_t  *md_p,
+               char       **structures);
+
+
+/**
+ *  @brief  Compute ensemble free energies for a list of sequences
+ *
+ *  If @p mfe is not @p NULL, e.g. the result of a preceding call to vrna_mfe_batch()
+ *  for the same list of sequences, the partition function of each sequence is scaled
+ *  according to its MFE. Otherwise, single sequences start with the default estimate
+ *  of the scaling factor, which vrna_pf() adjusts upon over- or underflow, while the
+ *  MFE of concatenated sequences is computed first.
+ *  If base pair probabilities are requested in the model details and @p structures
+ *  is not @p NULL, each of its entries receives a newly allocated string with the
+ *  pairing propensities of the corresponding sequence, see vrna_pf(). Otherwise,
+ *  all entries of @p structures are set to @p NULL.
+ *
+ *  @see    vrna_pf(), vrna_pf_dimer(), vrna_mfe_batch()
+ *
+ *  @param  sequences   A @p NULL terminated list of sequences
+ *  @param  md_p        The model details used for all predictions (Maybe @p NULL)
+ *  @param  mfe         The minimum free energies of all sequences in kcal/mol (Maybe @p NULL)
+ *  @param  structures  An array that receives the pairing propensity strings (Maybe @p NULL)
+ *  @return             An array with the ensemble free energy of each sequence in kcal/mol,
+ *                      or @p NULL on error
+ */
+float *
+vrna_pf_batch(const char  **sequences,
+              vrna_md_t   *md_p,
+              const float *mfe,
+              char        **structures);
+
+
+/**
+ * @}
+ */
+
+#endif
@@ -13,6 +13,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/energy_par.h"
@@ -34,6 +39,54 @@
 #################################
 */
 
+/* number of structures drawn from one random number stream by vrna_pbacktrack_cb() */
+#define SAMPLE_BLOCK_SIZE   256
+
+/* memory available for the decision tables of all threads in vrna_pbacktrack_cb() */
+#define SAMPLE_CACHE_MEMORY ((size_t)256 * 1024 * 1024)
+
+#define SAMPLE_EXT  0ULL
+#define SAMPLE_QB   1ULL
+#define SAMPLE_QM   2ULL
+#define SAMPLE_QM1  3ULL
+
+/* cumulative Boltzmann weights of all decompositions of a DP matrix cell */
+typedef struct {
+  FLT_OR_DBL    *cum;
+  int           *k;
+  int           *l;
+  unsigned int  size;
+  unsigned int  max_size;
+} decision_table;
+
+typedef struct {
+  uint64_t        key;
+  decision_table  *table;
+} decision_cache_entry;
+
+/* per-thread state of vrna_pbacktrack_cb() */
+typedef struct {
+  vrna_fold_compound_t  *vc;
+  uint64_t              rng;
+  decision_cache_entry  *cache;
+  size_t                cache_capacity;
+  size_t                cache_items;
+  size_t                mem_used;
+  size_t                mem_max;
+  decision_table        scratch;
+} batch_sampler;
+
+/* set of structures reported so far, used to reject duplicates */
+typedef struct {
+  char          **entries;
+  size_t        capacity;
+  size_t        items;
+  size_t        length;
+  char          **chunks;
+  unsigned int  num_chunks;
+  size_t        chunk_used;
+} structure_set;
+
 /*
 #################################
 # PRIVATE FUNCTION DECLARATIONS #
@@ -44,6 +97,27 @@ PRIVATE void  backtrack_qm(int i, int j, char *pstruc, vrna_fold_compound_t *vc)
 PRIVATE void  backtrack_qm1(int i,int j, char *pstruc, vrna_fold_compound_t *vc);
 PRIVATE void  backtrack_qm2(int u, int n, char *pstruc, vrna_fold_compound_t *vc);
 PRIVATE char  *wrap_pbacktrack_circ(vrna_fold_compound_t *vc);
+PRIVATE void  prepare_q1k_qln(vrna_fold_compound_t *vc);
+
+PRIVATE batch_sampler   *batch_sampler_init(vrna_fold_compound_t *vc, size_t mem_max);
+PRIVATE void            batch_sampler_free(batch_sampler *s);
+PRIVATE uint64_t        scramble_seed(uint64_t x);
+PRIVATE double          batch_urn(batch_sampler *s);
+PRIVATE decision_table  *get_decision_table(batch_sampler *s, uint64_t type, int i, int j);
+PRIVATE unsigned int    draw_decision(batch_sampler *s, decision_table *t);
+PRIVATE void            table_add(decision_table *t, FLT_OR_DBL w, int k, int l);
+PRIVATE void            fill_ext(batch_sampler *s, decision_table *t, int i);
+PRIVATE void            fill_qb(batch_sampler *s, decision_table *t, int i, int j);
+PRIVATE void            fill_qm(batch_sampler *s, decision_table *t, int i, int j);
+PRIVATE void            fill_qm1(batch_sampler *s, decision_table *t, int i, int j);
+PRIVATE void            sample_ext(batch_sampler *s, char *pstruc);
+PRIVATE void            sample_pair(batch_sampler *s, int i, int j, char *pstruc);
+PRIVATE void            sample_qm(batch_sampler *s, int i, int j, char *pstruc);
+PRIVATE void            sample_qm1(batch_sampler *s, int i, int j, char *pstruc);
+
+PRIVATE structure_set   *structure_set_init(size_t length);
+PRIVATE void            structure_set_free(structure_set *set);
+PRIVATE int             structure_set_insert(structure_set *set, const char *structure);
 
 PRIVATE void  backtrack_comparative(vrna_fold_compound_t *vc, char *pstruc, int i, int j, double *prob);
 PRIVATE void  backtrack_qm1_comparative(vrna_fold_compound_t *vc, char *pstruc, int i,int j, double *prob);
@@ -153,16 +227,9 @@ vrna_pbacktrack5( vrna_fold_compound_t *vc,
     pstruc[i] = '.';
 
   if(!(q1k && qln)){
-    matrices->q1k = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+1));
-    matrices->qln = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
+    prepare_q1k_qln(vc);
     q1k           = matrices->q1k;
     qln           = matrices->qln;
-    for (k=1; k<=n; k++) {
-      q1k[k] = q[my_iindx[1] - k];
-      qln[k] = q[my_iindx[k] - n];
-    }
-    q1k[0] = 1.0;
-    qln[n+1] = 1.0;
   }
 
 
@@ -285,6 +352,146 @@ vrna_pbacktrack5( vrna_fold_compound_t *vc,
   return pstruc;
 }
 
+PUBLIC unsigned int
+vrna_pbacktrack_cb( vrna_fold_compound_t              *vc,
+                    unsigned int                      num_samples,
+                    vrna_boltzmann_sampling_callback  *cb,
+                    void                              *data,
+                    unsigned int                      options){
+
+  unsigned int  count, num_blocks, round_new, remaining, b;
+  int           n, t, num_threads;
+  uint64_t      *seeds;
+  char          *s;
+  structure_set *set;
+  batch_sampler **samplers;
+
+  if((!vc) || (!vc->exp_params) || (!vc->exp_matrices) || (!cb)){
+    vrna_message_warning("vrna_pbacktrack_cb: partition function matrices required");
+    return 0;
+  }
+
+  if(!vc->exp_params->model_details.uniq_ML){
+    vrna_message_warning("vrna_pbacktrack_cb: unique multibranch loop decomposition (uniq_ML) required");
+    return 0;
+  }
+
+  n     = vc->length;
+  count = 0;
+  set   = (options & VRNA_PBACKTRACK_DISTINCT) ? structure_set_init(n) : NULL;
+
+  if((vc->type != VRNA_FC_TYPE_SINGLE) || (vc->exp_params->model_details.circ)){
+    /* no decision tables for these, sample one structure after the other */
+    unsigned int failed = 0;
+    while((count < num_samples) && (failed < SAMPLE_BLOCK_SIZE)){
+      s = vrna_pbacktrack(vc);
+      if(!s)
+        break;
+
+      if((!set) || (structure_set_insert(set, s))){
+        cb(s, data);
+        count++;
+        failed = 0;
+      } else {
+        failed++;
+      }
+
+      free(s);
+    }
+
+    structure_set_free(set);
+    return count;
+  }
+
+  if(!(vc->exp_matrices->q1k && vc->exp_matrices->qln))
+    prepare_q1k_qln(vc);
+
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#else
+  num_threads = 1;
+#endif
+
+  /* decision tables are kept across the rounds of sampling distinct structures */
+  samplers = (batch_sampler **)vrna_alloc(sizeof(batch_sampler *) * num_threads);
+  for(t = 0; t < num_threads; t++)
+    samplers[t] = batch_sampler_init(vc, SAMPLE_CACHE_MEMORY / num_threads);
+
+  do {
+    /*
+        one random number stream per block of samples, seeded from the global generator, such
+        that the samples do not depend on the number of threads. The seeds are scrambled since
+        consecutive states of the global generator would otherwise yield shifted copies of the
+        same stream
+    */
+    remaining   = num_samples - count;
+    if((set) && (remaining < SAMPLE_BLOCK_SIZE))
+      remaining = SAMPLE_BLOCK_SIZE;
+
+    num_blocks  = (remaining + SAMPLE_BLOCK_SIZE - 1) / SAMPLE_BLOCK_SIZE;
+    seeds       = (uint64_t *)vrna_alloc(sizeof(uint64_t) * num_blocks);
+    for(b = 0; b < num_blocks; b++)
+      seeds[b] = scramble_seed((uint64_t)(vrna_urn() * 281474976710656.));
+
+    round_new = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      unsigned int  x, block_count;
+      char          *buffer;
+      batch_sampler *sampler;
+
+#ifdef _OPENMP
+      sampler = samplers[omp_get_thread_num()];
+#else
+      sampler = samplers[0];
+#endif
+      buffer  = (char *)vrna_alloc(sizeof(char) * SAMPLE_BLOCK_SIZE * (n + 1));
+
+#ifdef _OPENMP
+#pragma omp for ordered schedule(dynamic, 1)
+#endif
+      for(b = 0; b < num_blocks; b++){
+        block_count = MIN2(SAMPLE_BLOCK_SIZE, remaining - b * SAMPLE_BLOCK_SIZE);
+        sampler->rng = seeds[b];
+
+        for(x = 0; x < block_count; x++)
+          sample_ext(sampler, buffer + x * (n + 1));
+
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+        {
+          for(x = 0; (x < block_count) && (count < num_samples); x++){
+            if((set) && (!structure_set_insert(set, buffer + x * (n + 1))))
+              continue;
+
+            cb(buffer + x * (n + 1), data);
+            count++;
+            round_new++;
+          }
+        }
+      }
+
+      free(buffer);
+    }
+
+    free(seeds);
+
+    /* stop sampling distinct structures if an entire round did not yield any new structure */
+  } while((set) && (count < num_samples) && (round_new > 0));
+
+  for(t = 0; t < num_threads; t++)
+    batch_sampler_free(samplers[t]);
+
+  free(samplers);
+  structure_set_free(set);
+
+  return count;
+}
+
 PRIVATE void
 backtrack_qm( int i,
               int j,
@@ -1107,3 +1314,743 @@ backtrack_qm1_comparative(vrna_fold_compound_t *vc,
   backtrack_comparative(vc, pstruc, i, l, prob);
 }
 
+
+PRIVATE void
+prepare_q1k_qln(vrna_fold_compound_t *vc){
+
+  int           k, n, *my_iindx;
+  FLT_OR_DBL    *q;
+  vrna_mx_pf_t  *matrices;
+
+  n         = vc->length;
+  my_iindx  = vc->iindx;
+  matrices  = vc->exp_matrices;
+  q         = matrices->q;
+
+  free(matrices->q1k);
+  free(matrices->qln);
+
+  matrices->q1k = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+1));
+  matrices->qln = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
+  for (k=1; k<=n; k++) {
+    matrices->q1k[k] = q[my_iindx[1] - k];
+    matrices->qln[k] = q[my_iindx[k] - n];
+  }
+  matrices->q1k[0]    = 1.0;
+  matrices->qln[n+1]  = 1.0;
+}
+
+
+/*
+  Batch sampling
+
+  Instead of scanning all decompositions of a DP matrix cell for each
+  random decision, the cumulative Boltzmann weights of the decompositions
+  are computed once per cell and kept in a (per-thread) cache, such that
+  each subsequent decision is a binary search. Once the cache reached its
+  memory limit, tables of new cells are computed in a scratch buffer.
+  The weights are computed exactly as in backtrack(), backtrack_qm(),
+  backtrack_qm1(), and vrna_pbacktrack5().
+*/
+PRIVATE batch_sampler *
+batch_sampler_init( vrna_fold_compound_t *vc,
+                    size_t mem_max){
+
+  batch_sampler *s = (batch_sampler *)vrna_alloc(sizeof(batch_sampler));
+
+  s->vc             = vc;
+  s->rng            = 0;
+  s->cache_capacity = 1024;
+  s->cache_items    = 0;
+  s->cache          = (decision_cache_entry *)vrna_alloc(sizeof(decision_cache_entry) * s->cache_capacity);
+  s->mem_used       = sizeof(decision_cache_entry) * s->cache_capacity;
+  s->mem_max        = mem_max;
+
+  s->scratch.max_size = (unsigned int)(vc->length + (MAXLOOP + 2) * (MAXLOOP + 2) + 2);
+  s->scratch.cum      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * s->scratch.max_size);
+  s->scratch.k        = (int *)vrna_alloc(sizeof(int) * s->scratch.max_size);
+  s->scratch.l        = (int *)vrna_alloc(sizeof(int) * s->scratch.max_size);
+  s->scratch.size     = 0;
+
+  return s;
+}
+
+
+PRIVATE void
+batch_sampler_free(batch_sampler *s){
+
+  size_t i;
+
+  for(i = 0; i < s->cache_capacity; i++)
+    if(s->cache[i].table){
+      free(s->cache[i].table->cum);
+      free(s->cache[i].table->k);
+      free(s->cache[i].table->l);
+      free(s->cache[i].table);
+    }
+
+  free(s->cache);
+  free(s->scratch.cum);
+  free(s->scratch.k);
+  free(s->scratch.l);
+  free(s);
+}
+
+
+/* splitmix64 finalizer, truncated to 48 bits */
+PRIVATE uint64_t
+scramble_seed(uint64_t x){
+
+  x += UINT64_C(0x9E3779B97F4A7C15);
+  x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+  x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+  x = x ^ (x >> 31);
+
+  return x & UINT64_C(0xFFFFFFFFFFFF);
+}
+
+
+/* 48 bit linear congruential generator, same as erand48() */
+PRIVATE double
+batch_urn(batch_sampler *s){
+
+  s->rng = (UINT64_C(0x5DEECE66D) * s->rng + UINT64_C(0xB)) & UINT64_C(0xFFFFFFFFFFFF);
+
+  return (double)s->rng / 281474976710656.;
+}
+
+
+PRIVATE decision_table *
+get_decision_table( batch_sampler *s,
+                    uint64_t type,
+                    int i,
+                    int j){
+
+  uint64_t        key;
+  size_t          h, mask, mem;
+  decision_table  *t;
+
+  key   = (type << 60) | ((uint64_t)i << 30) | (uint64_t)j;
+  mask  = s->cache_capacity - 1;
+  h     = (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 20) & mask;
+
+  while(s->cache[h].table){
+    if(s->cache[h].key == key)
+      return s->cache[h].table;
+    h = (h + 1) & mask;
+  }
+
+  t       = &(s->scratch);
+  t->size = 0;
+
+  switch(type){
+    case SAMPLE_EXT:  fill_ext(s, t, i);
+                      break;
+    case SAMPLE_QB:   fill_qb(s, t, i, j);
+                      break;
+    case SAMPLE_QM:   fill_qm(s, t, i, j);
+                      break;
+    case SAMPLE_QM1:  fill_qm1(s, t, i, j);
+                      break;
+  }
+
+  mem = sizeof(decision_table) + (sizeof(FLT_OR_DBL) + 2 * sizeof(int)) * t->size;
+
+  /* grow the hash table at a load factor of 1/2 */
+  if(2 * (s->cache_items + 1) > s->cache_capacity){
+    size_t                old_capacity  = s->cache_capacity;
+    decision_cache_entry  *old_cache    = s->cache;
+
+    if(s->mem_used + mem + sizeof(decision_cache_entry) * old_capacity * 2 > s->mem_max)
+      return t;
+
+    s->cache_capacity *= 2;
+    s->cache          = (decision_cache_entry *)vrna_alloc(sizeof(decision_cache_entry) * s->cache_capacity);
+    s->mem_used       += sizeof(decision_cache_entry) * old_capacity;
+    mask              = s->cache_capacity - 1;
+
+    for(h = 0; h < old_capacity; h++)
+      if(old_cache[h].table){
+        size_t hh = (size_t)((old_cache[h].key * UINT64_C(0x9E3779B97F4A7C15)) >> 20) & mask;
+        while(s->cache[hh].table)
+          hh = (hh + 1) & mask;
+        s->cache[hh] = old_cache[h];
+      }
+
+    free(old_cache);
+
+    h = (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 20) & mask;
+    while(s->cache[h].table)
+      h = (h + 1) & mask;
+  } else if(s->mem_used + mem > s->mem_max){
+    return t;
+  }
+
+  t           = (decision_table *)vrna_alloc(sizeof(decision_table));
+  t->size     = t->max_size = s->scratch.size;
+  t->cum      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (t->size + 1));
+  t->k        = (int *)vrna_alloc(sizeof(int) * (t->size + 1));
+  t->l        = (int *)vrna_alloc(sizeof(int) * (t->size + 1));
+  memcpy(t->cum, s->scratch.cum, sizeof(FLT_OR_DBL) * t->size);
+  memcpy(t->k, s->scratch.k, sizeof(int) * t->size);
+  memcpy(t->l, s->scratch.l, sizeof(int) * t->size);
+
+  s->cache[h].key   = key;
+  s->cache[h].table = t;
+  s->cache_items++;
+  s->mem_used += mem;
+
+  return t;
+}
+
+
+PRIVATE unsigned int
+draw_decision(batch_sampler *s,
+              decision_table *t){
+
+  unsigned int  lo, hi, mid;
+  FLT_OR_DBL    r;
+
+  if(t->size == 0)
+    vrna_message_error("backtracking failed, no decomposition with non-zero weight");
+
+  r   = batch_urn(s) * t->cum[t->size - 1];
+  lo  = 0;
+  hi  = t->size - 1;
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(t->cum[mid] > r)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
+}
+
+
+PRIVATE void
+table_add(decision_table *t,
+          FLT_OR_DBL w,
+          int k,
+          int l){
+
+  if(w <= 0.)
+    return;
+
+  if(t->size == t->max_size){
+    t->max_size *= 2;
+    t->cum  = (FLT_OR_DBL *)vrna_realloc(t->cum, sizeof(FLT_OR_DBL) * t->max_size);
+    t->k    = (int *)vrna_realloc(t->k, sizeof(int) * t->max_size);
+    t->l    = (int *)vrna_realloc(t->l, sizeof(int) * t->max_size);
+  }
+
+  t->cum[t->size] = (t->size > 0) ? t->cum[t->size - 1] + w : w;
+  t->k[t->size]   = k;
+  t->l[t->size]   = l;
+  t->size++;
+}
+
+
+/* exterior loop, i is unpaired (k = 0) or pairs with k */
+PRIVATE void
+fill_ext( batch_sampler *s,
+          decision_table *t,
+          int i){
+
+  int                   j, n, type, *my_iindx, *jindx;
+  char                  *ptype, *hard_constraints;
+  short                 *S1;
+  FLT_OR_DBL            qkl, q_temp, *qb, *qln, *scale;
+  vrna_fold_compound_t  *vc = s->vc;
+  vrna_sc_t             *sc = vc->sc;
+  vrna_exp_param_t      *pf_params = vc->exp_params;
+
+  n                 = vc->length;
+  my_iindx          = vc->iindx;
+  jindx             = vc->jindx;
+  ptype             = vc->ptype;
+  S1                = vc->sequence_encoding;
+  hard_constraints  = vc->hc->matrix;
+  qb                = vc->exp_matrices->qb;
+  qln               = vc->exp_matrices->qln;
+  scale             = vc->exp_matrices->scale;
+
+  if(vc->hc->up_ext[i]){
+    q_temp = qln[i+1]*scale[1];
+
+    if(sc){
+      if (sc->exp_energy_up)
+        q_temp *= sc->exp_energy_up[i][1];
+
+      if(sc->exp_f)
+        q_temp *= sc->exp_f(i, n, i+1, n, VRNA_DECOMP_EXT_EXT, sc->data);
+    }
+
+    table_add(t, q_temp, 0, 0);
+  }
+
+  for(j = i + 1; j <= n; j++){
+    if(hard_constraints[jindx[j] + i] & VRNA_CONSTRAINT_CONTEXT_EXT_LOOP){
+      type = ptype[jindx[j] + i];
+
+      if(type == 0)
+        type = 7;
+
+      qkl = qb[my_iindx[i] - j] * exp_E_ExtLoop(type, (i>1) ? S1[i-1] : -1, (j<n) ? S1[j+1] : -1, pf_params);
+
+      if (j<n){
+        qkl *= qln[j+1];
+        if(sc){
+          if(sc->exp_f)
+            qkl *= sc->exp_f(i, n, j, j+1, VRNA_DECOMP_EXT_STEM_EXT, sc->data);
+        }
+      } else {
+        if(sc){
+          if(sc->exp_f)
+            qkl *= sc->exp_f(i, j, i, j, VRNA_DECOMP_EXT_STEM, sc->data);
+        }
+      }
+
+      table_add(t, qkl, j, 0);
+    }
+  }
+}
+
+
+/* pair (i,j) closes a hairpin (k = l = 0), an interior loop with (k,l), or a multiloop split at -k */
+PRIVATE void
+fill_qb(batch_sampler *s,
+        decision_table *t,
+        int i,
+        int j){
+
+  int                   k, l, kl, u, u1, u2, max_k, min_l, ii, jj, tt, turn, noGUclosure, *rtype;
+  int                   *my_iindx, *jindx, *hc_up_int;
+  unsigned char         type, type_2;
+  char                  *ptype, *sequence, *hard_constraints, hc_decompose;
+  short                 *S1;
+  FLT_OR_DBL            q_temp, closingPair, *qb, *qm, *qm1, *scale;
+  vrna_fold_compound_t  *vc = s->vc;
+  vrna_sc_t             *sc = vc->sc;
+  vrna_exp_param_t      *pf_params = vc->exp_params;
+
+  sequence          = vc->sequence;
+  ptype             = vc->ptype;
+  S1                = vc->sequence_encoding;
+  my_iindx          = vc->iindx;
+  jindx             = vc->jindx;
+  hc_up_int         = vc->hc->up_int;
+  hard_constraints  = vc->hc->matrix;
+  qb                = vc->exp_matrices->qb;
+  qm                = vc->exp_matrices->qm;
+  qm1               = vc->exp_matrices->qm1;
+  scale             = vc->exp_matrices->scale;
+  noGUclosure       = pf_params->model_details.noGUclosure;
+  turn              = pf_params->model_details.min_loop_size;
+  rtype             = &(pf_params->model_details.rtype[0]);
+
+  type          = (unsigned char)ptype[jindx[j] + i];
+  hc_decompose  = hard_constraints[jindx[j] + i];
+
+  if(hc_decompose & VRNA_CONSTRAINT_CONTEXT_HP_LOOP){
+    if(type == 0)
+      type = 7;
+
+    u = j-i-1;
+
+    if (!(((type==3)||(type==4))&&noGUclosure)){
+      q_temp = exp_E_Hairpin(u, type, S1[i+1], S1[j-1], sequence+i-1, pf_params) * scale[u+2];
+
+      if(sc){
+        if(sc->exp_energy_up)
+          q_temp *= sc->exp_energy_up[i+1][u];
+
+        if(sc->exp_f)
+          q_temp *= sc->exp_f(i, j, i, j, VRNA_DECOMP_PAIR_HP, sc->data);
+      }
+
+      table_add(t, q_temp, 0, 0);
+    }
+  }
+
+  if(hc_decompose & VRNA_CONSTRAINT_CONTEXT_INT_LOOP){
+    if(type == 0)
+      type = 7;
+
+    max_k = i + MAXLOOP + 1;
+    max_k = MIN2(max_k, j - turn - 2);
+    max_k = MIN2(max_k, i + 1 + hc_up_int[i+1]);
+    for (k = i + 1; k<=max_k; k++) {
+      u1    = k-i-1;
+      min_l = MAX2(k+turn+1,j-1-MAXLOOP+u1);
+      kl    = my_iindx[k] - j + 1;
+      for (u2 = 0, l=j-1; l>=min_l; l--, kl++, u2++){
+        if(hc_up_int[l+1] < u2) break;
+        if(hard_constraints[jindx[l] + k] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC){
+          type_2 = (unsigned char)ptype[jindx[l] + k];
+          type_2 = rtype[type_2];
+
+          if(type_2 == 0)
+            type_2 = 7;
+
+          q_temp = qb[kl]
+                   * scale[u1+u2+2]
+                   * exp_E_IntLoop(u1, u2, type, type_2, S1[i+1], S1[j-1], S1[k-1], S1[l+1], pf_params);
+
+          if(sc){
+            if(sc->exp_energy_up)
+              q_temp *=   sc->exp_energy_up[i+1][u1]
+                        * sc->exp_energy_up[l+1][u2];
+
+            if(sc->exp_energy_stack)
+              if((i + 1 == k) && (j - 1 == l))
+                q_temp *=   sc->exp_energy_stack[i]
+                          * sc->exp_energy_stack[k]
+                          * sc->exp_energy_stack[l]
+                          * sc->exp_energy_stack[j];
+
+            if(sc->exp_f)
+              q_temp *= sc->exp_f(i, j, k, l, VRNA_DECOMP_PAIR_IL, sc->data);
+          }
+
+          table_add(t, q_temp, k, l);
+        }
+      }
+    }
+  }
+
+  /* multibranch loop */
+  tt = rtype[(unsigned char)ptype[jindx[j] + i]];
+  closingPair =   pf_params->expMLclosing
+                * exp_E_MLstem(tt, S1[j-1], S1[i+1], pf_params)
+                * scale[2];
+  if(sc){
+    if(sc->exp_f)
+      closingPair *= sc->exp_f(i, j, i, j, VRNA_DECOMP_PAIR_ML, sc->data);
+  }
+
+  i++; j--;
+  ii = my_iindx[i];
+  jj = jindx[j];
+  for (k=i+1; k<j; k++) {
+    q_temp = qm[ii-(k-1)] * qm1[jj+k] * closingPair;
+
+    if(sc){
+      if(sc->exp_f)
+        q_temp *= sc->exp_f(i, j, k-1, k, VRNA_DECOMP_ML_ML_ML, sc->data);
+    }
+
+    table_add(t, q_temp, -k, 0);
+  }
+}
+
+
+/* multiloop part [i..j] starts with the stem of qm1[k,j], preceeded by nothing (l = 0), unpaired bases (l = 1), or qm[i,k-1] (l = 2) */
+PRIVATE void
+fill_qm(batch_sampler *s,
+        decision_table *t,
+        int i,
+        int j){
+
+  int                   k, u, *my_iindx, *jindx, *hc_up_ml;
+  FLT_OR_DBL            q_temp, *qm, *qm1, *expMLbase;
+  vrna_fold_compound_t  *vc = s->vc;
+  vrna_sc_t             *sc = vc->sc;
+
+  my_iindx  = vc->iindx;
+  jindx     = vc->jindx;
+  hc_up_ml  = vc->hc->up_ml;
+  qm        = vc->exp_matrices->qm;
+  qm1       = vc->exp_matrices->qm1;
+  expMLbase = vc->exp_matrices->expMLbase;
+
+  table_add(t, qm1[jindx[j]+i], i, 0);
+
+  for(k = i + 1; k <= j; k++){
+    u = k - i;
+    if(hc_up_ml[i] >= u){
+      q_temp = expMLbase[u] * qm1[jindx[j]+k];
+
+      if(sc){
+        if(sc->exp_energy_up)
+          q_temp *= sc->exp_energy_up[i][u];
+
+        if(sc->exp_f)
+          q_temp *= sc->exp_f(i, j, k, j, VRNA_DECOMP_ML_ML, sc->data);
+      }
+
+      table_add(t, q_temp, k, 1);
+    }
+
+    q_temp = qm[my_iindx[i]-(k-1)] * qm1[jindx[j]+k];
+
+    if(sc){
+      if(sc->exp_f)
+        q_temp *= sc->exp_f(i, j, k-1, k, VRNA_DECOMP_ML_ML_ML, sc->data);
+    }
+
+    table_add(t, q_temp, k, 2);
+  }
+}
+
+
+/* i pairs with k in qm1[i,j] */
+PRIVATE void
+fill_qm1( batch_sampler *s,
+          decision_table *t,
+          int i,
+          int j){
+
+  int                   l, il, ii, u, type, turn, *my_iindx, *jindx, *hc_up_ml;
+  char                  *ptype, *hard_constraints;
+  short                 *S1;
+  FLT_OR_DBL            q_temp, *qb, *expMLbase;
+  vrna_fold_compound_t  *vc = s->vc;
+  vrna_sc_t             *sc = vc->sc;
+  vrna_exp_param_t      *pf_params = vc->exp_params;
+
+  my_iindx          = vc->iindx;
+  jindx             = vc->jindx;
+  ptype             = vc->ptype;
+  S1                = vc->sequence_encoding;
+  hc_up_ml          = vc->hc->up_ml;
+  hard_constraints  = vc->hc->matrix;
+  qb                = vc->exp_matrices->qb;
+  expMLbase         = vc->exp_matrices->expMLbase;
+  turn              = pf_params->model_details.min_loop_size;
+
+  ii = my_iindx[i];
+  for (l=j; l > i + turn; l--) {
+    il = jindx[l] + i;
+    if(hard_constraints[il] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP_ENC){
+      u = j - l;
+      if(hc_up_ml[l+1] < u)
+        break;
+
+      type = ptype[il];
+
+      if(type == 0)
+        type = 7;
+
+      q_temp =  qb[ii-l]
+                * exp_E_MLstem(type, S1[i-1], S1[l+1], pf_params)
+                * expMLbase[j-l];
+
+      if(sc){
+        if(sc->exp_energy_up)
+          q_temp *= sc->exp_energy_up[l+1][j-l];
+
+        if(sc->exp_f)
+          q_temp *= sc->exp_f(i, j, i, l, VRNA_DECOMP_ML_STEM, sc->data);
+      }
+
+      table_add(t, q_temp, l, 0);
+    }
+  }
+}
+
+
+PRIVATE void
+sample_ext( batch_sampler *s,
+            char *pstruc){
+
+  int             i, j, n;
+  decision_table  *t;
+
+  n = s->vc->length;
+  memset(pstruc, '.', n);
+  pstruc[n] = '\0';
+
+  for(i = 1; i < n;){
+    t = get_decision_table(s, SAMPLE_EXT, i, n);
+    j = t->k[draw_decision(s, t)];
+    if(j == 0){
+      i++;
+    } else {
+      sample_pair(s, i, j, pstruc);
+      i = j + 1;
+    }
+  }
+}
+
+
+PRIVATE void
+sample_pair(batch_sampler *s,
+            int i,
+            int j,
+            char *pstruc){
+
+  int             k, l;
+  unsigned int    d;
+  decision_table  *t;
+
+  while(1){
+    pstruc[i-1] = '(';
+    pstruc[j-1] = ')';
+
+    t = get_decision_table(s, SAMPLE_QB, i, j);
+    d = draw_decision(s, t);
+    k = t->k[d];
+    l = t->l[d];
+
+    if(k == 0) /* hairpin */
+      return;
+
+    if(k > 0){ /* interior loop */
+      i = k;
+      j = l;
+    } else { /* multibranch loop */
+      sample_qm1(s, -k, j - 1, pstruc);
+      sample_qm(s, i + 1, -k - 1, pstruc);
+      return;
+    }
+  }
+}
+
+
+PRIVATE void
+sample_qm(batch_sampler *s,
+          int i,
+          int j,
+          char *pstruc){
+
+  int             k, l;
+  unsigned int    d;
+  decision_table  *t;
+
+  while(1){
+    t = get_decision_table(s, SAMPLE_QM, i, j);
+    d = draw_decision(s, t);
+    k = t->k[d];
+    l = t->l[d];
+
+    sample_qm1(s, k, j, pstruc);
+
+    if(l != 2)
+      return;
+
+    j = k - 1;
+  }
+}
+
+
+PRIVATE void
+sample_qm1( batch_sampler *s,
+            int i,
+            int j,
+            char *pstruc){
+
+  int             l;
+  decision_table  *t;
+
+  t = get_decision_table(s, SAMPLE_QM1, i, j);
+  l = t->k[draw_decision(s, t)];
+
+  sample_pair(s, i, l, pstruc);
+}
+
+
+PRIVATE structure_set *
+structure_set_init(size_t length){
+
+  structure_set *set = (structure_set *)vrna_alloc(sizeof(structure_set));
+
+  set->capacity   = 1024;
+  set->items      = 0;
+  set->length     = length;
+  set->entries    = (char **)vrna_alloc(sizeof(char *) * set->capacity);
+  set->chunks     = NULL;
+  set->num_chunks = 0;
+  set->chunk_used = SAMPLE_BLOCK_SIZE; /* force allocation of the first chunk */
+
+  return set;
+}
+
+
+PRIVATE void
+structure_set_free(structure_set *set){
+
+  unsigned int i;
+
+  if(set){
+    for(i = 0; i < set->num_chunks; i++)
+      free(set->chunks[i]);
+
+    free(set->chunks);
+    free(set->entries);
+    free(set);
+  }
+}
+
+
+PRIVATE size_t
+structure_hash(const char *structure){
+
+  size_t h = 2166136261U;
+
+  while(*structure){
+    h ^= (unsigned char)*structure++;
+    h *= 16777619U;
+  }
+
+  return h;
+}
+
+
+/* returns 1 if the structure was not in the set before, 0 otherwise */
+PRIVATE int
+structure_set_insert( structure_set *set,
+                      const char *structure){
+
+  size_t  h, mask;
+  char    *copy;
+
+  mask  = set->capacity - 1;
+  h     = structure_hash(structure) & mask;
+
+  while(set->entries[h]){
+    if(!strcmp(set->entries[h], structure))
+      return 0;
+    h = (h + 1) & mask;
+  }
+
+  if(2 * (set->items + 1) > set->capacity){
+    size_t  i, old_capacity = set->capacity;
+    char    **old_entries   = set->entries;
+
+    set->capacity *= 2;
+    set->entries  = (char **)vrna_alloc(sizeof(char *) * set->capacity);
+    mask          = set->capacity - 1;
+
+    for(i = 0; i < old_capacity; i++)
+      if(old_entries[i]){
+        h = structure_hash(old_entries[i]) & mask;
+        while(set->entries[h])
+          h = (h + 1) & mask;
+        set->entries[h] = old_entries[i];
+      }
+
+    free(old_entries);
+
+    h = structure_hash(structure) & mask;
+    while(set->entries[h])
+      h = (h + 1) & mask;
+  }
+
+  /* structures are stored in chunks of SAMPLE_BLOCK_SIZE */
+  if(set->chunk_used == SAMPLE_BLOCK_SIZE){
+    set->chunks = (char **)vrna_realloc(set->chunks, sizeof(char *) * (set->num_chunks + 1));
+    set->chunks[set->num_chunks++]  = (char *)vrna_alloc(sizeof(char) * SAMPLE_BLOCK_SIZE * (set->length + 1));
+    set->chunk_used                 = 0;
+  }
+
+  copy = set->chunks[set->num_chunks - 1] + set->chunk_used * (set->length + 1);
+  memcpy(copy, structure, sizeof(char) * (set->length + 1));
+  set->chunk_used++;
+
+  set->entries[h] = copy;
+  set->items++;
+
+  return 1;
+}
@@ -43,4 +43,78 @@ char    *vrna_pbacktrack5(vrna_fold_compound_t *vc, int length);
  */
 char    *vrna_pbacktrack(vrna_fold_compound_t *vc);
 
+/**
+ *  @brief Option flag for vrna_pbacktrack_cb() to sample structures independently
+ *
+ *  @ingroup subopt_stochbt
+ */
+#define VRNA_PBACKTRACK_DEFAULT         0U
+
+/**
+ *  @brief Option flag for vrna_pbacktrack_cb() to report each sampled structure only once
+ *
+ *  Duplicates are rejected after sampling, see vrna_pbacktrack_cb() for details.
+ *
+ *  @ingroup subopt_stochbt
+ */
+#define VRNA_PBACKTRACK_DISTINCT        1U
+
+/**
+ *  @brief Callback that receives the structures sampled by vrna_pbacktrack_cb()
+ *
+ *  @ingroup subopt_stochbt
+ *
+ *  @param  structure The sampled secondary structure in dot-bracket notation (owned by vrna_pbacktrack_cb())
+ *  @param  data      The auxiliary data passed to vrna_pbacktrack_cb()
+ */
+typedef void (vrna_boltzmann_sampling_callback)(const char *structure, void *data);
+
+/**
+ *  @brief Sample a number of secondary structures from the Boltzmann ensemble and pass them to a callback
+ *
+ *  This function draws @p num_samples structures like vrna_pbacktrack() does, but is considerably
+ *  faster for large numbers of samples: The cumulative Boltzmann weights of the decompositions of
+ *  each DP matrix cell visited are computed only once and cached (up to a fixed memory limit), such
+ *  that every further decision in this cell is a binary search. Sampled structures are handed over
+ *  to the callback @p cb in blocks without allocating memory for each structure. The @p structure
+ *  string passed to @p cb must not be free'd and is only valid until the callback returns.
+ *
+ *  If compiled with OpenMP support, blocks of samples are drawn in parallel. Every block uses an
+ *  independent random number stream that is seeded from the global random number generator (see
+ *  vrna_urn()), so the sampled structures, and the order in which they are passed to @p cb, do not
+ *  depend on the number of threads. The callback is never invoked concurrently. However, soft constraint
+ *  callbacks (see vrna_sc_add_exp_f()) must be thread-safe.
+ *
+ *  With option #VRNA_PBACKTRACK_DISTINCT, every structure is reported at most once. This is a
+ *  best-effort rejection of duplicates rather than non-redundant sampling, i.e. the Boltzmann weights
+ *  of structures already drawn are not removed from the partition function. Each reported structure
+ *  still follows the Boltzmann distribution restricted to the structures not reported so far, but
+ *  sampling becomes inefficient once these structures dominate the ensemble. Sampling is repeated
+ *  until either @p num_samples distinct structures have been found, or a round of samples did not
+ *  yield any new structure. Hence, fewer than @p num_samples structures may be reported, even for
+ *  ensembles that contain more structures.
+ *
+ *  @note Fold compounds of type #VRNA_FC_TYPE_COMPARATIVE and circular RNAs are sampled one
+ *        structure after the other using vrna_pbacktrack().
+ *
+ *  @ingroup subopt_stochbt
+ *  @pre    The vrna_md_t.uniq_ML flag has to be non-zero before calling vrna_fold_compound()
+ *  @pre    vrna_pf() has to be called first to fill the partition function matrices
+ *
+ *  @see vrna_pbacktrack(), #vrna_boltzmann_sampling_callback, #VRNA_PBACKTRACK_DEFAULT,
+ *       #VRNA_PBACKTRACK_DISTINCT
+ *
+ *  @param  vc          The fold compound data structure
+ *  @param  num_samples The number of structures to sample
+ *  @param  cb          The callback that receives the sampled structures
+ *  @param  data        Auxiliary data passed through to the callback
+ *  @param  options     Either #VRNA_PBACKTRACK_DEFAULT or #VRNA_PBACKTRACK_DISTINCT
+ *  @return             The number of structures passed to @p cb
+ */
+unsigned int vrna_pbacktrack_cb(vrna_fold_compound_t              *vc,
+                                unsigned int                      num_samples,
+                                vrna_boltzmann_sampling_callback  *cb,
+                                void                              *data,
+                                unsigned int                      options);
+
 #endif
@@ -827,7 +827,7 @@ vrna_subopt_zuker(vrna_fold_compound_t *vc){
   vrna_mx_mfe_t *matrices;
   vrna_md_t     *md;
 
-  md                = &(vc->params->model_details);
+  md                = &(vrna_params_detach(vc)->model_details);
   turn              = md->min_loop_size;
 
   /* do some magic to re-use cofold code although vc is single sequence */
@@ -1002,7 +1002,7 @@ wrap_cofold(const char *string,
   vc = vrna_fold_compound(seq, &(P->model_details), 0);
 
   if(parameters){ /* replace params if necessary */
-    free(vc->params);
+    vrna_params_release(vc->params);
     vc->params = P;
   } else {
     free(P);
@@ -1085,7 +1085,7 @@ wrap_zukersubopt( const char *string,
   vc = vrna_fold_compound(string, &(P->model_details), VRNA_OPTION_DEFAULT);
 
   if(parameters){ /* replace params if necessary */
-    free(vc->params);
+    vrna_params_release(vc->params);
     vc->params = P;
   } else {
     free(P);
@@ -1184,7 +1184,7 @@ update_cofold_params(void){
     v = backward_compat_compound;
 
     if(v->params)
-      free(v->params);
+      vrna_params_release(v->params);
 
     set_model_details(&md);
     v->params = vrna_params(&md);
@@ -1200,7 +1200,7 @@ update_cofold_params_par(vrna_param_t *parameters){
     v = backward_compat_compound;
 
     if(v->params)
-      free(v->params);
+      vrna_params_release(v->params);
 
     if(parameters){
       v->params = vrna_params_copy(parameters);
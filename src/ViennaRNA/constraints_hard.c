@@ -175,7 +175,7 @@ vrna_hc_init(vrna_fold_compound_t *vc){
 
   /* allocate memory new hard constraints data structure */
   hc          = (vrna_hc_t *)vrna_alloc(sizeof(vrna_hc_t));
-  hc->matrix  = (char *)vrna_alloc(sizeof(char)*((n*(n+1))/2+2));
+  hc->matrix  = (char *)vrna_alloc(sizeof(char)*(((size_t)n*(n+1))/2+2));
   hc->up_ext  = (int *)vrna_alloc(sizeof(int)*(n+2));
   hc->up_hp   = (int *)vrna_alloc(sizeof(int)*(n+2));
   hc->up_int  = (int *)vrna_alloc(sizeof(int)*(n+2));
@@ -311,7 +311,7 @@ sc_add_bp(vrna_fold_compound_t *vc,
   if(sc->energy_bp)
     free(sc->energy_bp);
 
-  sc->energy_bp = (int *)vrna_alloc(sizeof(int) * (((n + 1) * (n + 2)) / 2));
+  sc->energy_bp = (int *)vrna_alloc(sizeof(int) * (((size_t)(n + 1) * (n + 2)) / 2));
 
   idx = vc->jindx;
   for(i = 1; i < n; i++)
@@ -338,7 +338,7 @@ sc_really_add_bp( vrna_fold_compound_t *vc,
   sc              = vc->sc;
 
   if(!sc->energy_bp)
-    sc->energy_bp = (int *)vrna_alloc(sizeof(int) * (((n + 1) * (n + 2)) / 2));
+    sc->energy_bp = (int *)vrna_alloc(sizeof(int) * (((size_t)(n + 1) * (n + 2)) / 2));
 
   idx = vc->jindx;
   sc->energy_bp[idx[j]+i] += (int)roundf(energy * 100.);
@@ -451,7 +451,7 @@ prepare_Boltzmann_weights_bp(vrna_fold_compound_t *vc){
 
     if(sc->exp_energy_bp)
       free(sc->exp_energy_bp);
-    sc->exp_energy_bp     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (((n + 1) * (n + 2)) / 2));
+    sc->exp_energy_bp     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (((size_t)(n + 1) * (n + 2)) / 2));
 
     idx   = vc->iindx;
     jidx  = vc->jindx;
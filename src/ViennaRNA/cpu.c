@@ -0,0 +1,43 @@
+/*
+ *  cpu.c
+ *
+ *  Runtime detection of CPU features
+ *
+ *  Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/cpu.h"
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC unsigned int
+vrna_cpu_simd_capabilities(void)
+{
+  unsigned int capabilities = VRNA_CPU_SIMD_NONE;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("sse4.1"))
+    capabilities |= VRNA_CPU_SIMD_SSE41;
+
+  if (__builtin_cpu_supports("avx2"))
+    capabilities |= VRNA_CPU_SIMD_AVX2;
+
+  if (__builtin_cpu_supports("avx512f"))
+    capabilities |= VRNA_CPU_SIMD_AVX512F;
+
+#endif
+
+  return capabilities;
+}
@@ -0,0 +1,55 @@
+#ifndef VIENNA_RNA_PACKAGE_CPU_H
+#define VIENNA_RNA_PACKAGE_CPU_H
+
+/**
+ *  @file     cpu.h
+ *  @ingroup  utils
+ *  @brief    Runtime detection of CPU features
+ */
+
+/**
+ *  @{
+ *  @ingroup   utils
+ */
+
+/**
+ *  @brief  No SIMD extension available
+ */
+#define VRNA_CPU_SIMD_NONE      0U
+
+/**
+ *  @brief  SSE4.1 instruction set extension
+ */
+#define VRNA_CPU_SIMD_SSE41     1U
+
+/**
+ *  @brief  AVX2 instruction set extension
+ */
+#define VRNA_CPU_SIMD_AVX2      2U
+
+/**
+ *  @brief  AVX-512 foundation instruction set extension
+ */
+#define VRNA_CPU_SIMD_AVX512F   4U
+
+
+/**
+ *  @brief  Get a bit-vector of SIMD extensions supported by the host CPU
+ *
+ *  Detection happens at runtime, i.e. the result reflects the machine the
+ *  program is currently executed on rather than the one it was compiled on.
+ *  Whether or not RNAlib was actually built with an optimized implementation
+ *  for a particular extension is a different matter, see vrna_fun_zip_add_min().
+ *
+ *  @see VRNA_CPU_SIMD_SSE41, VRNA_CPU_SIMD_AVX2, VRNA_CPU_SIMD_AVX512F
+ *
+ *  @return   A bit-vector of supported SIMD extensions
+ */
+unsigned int
+vrna_cpu_simd_capabilities(void);
+
+
+/**
+ *  @}
+ */
+#endif
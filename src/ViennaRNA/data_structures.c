@@ -76,6 +76,9 @@ PRIVATE void  set_fold_compound(vrna_fold_compound_t  *vc,
 PRIVATE void  make_pscores(vrna_fold_compound_t *vc);
 
 
+PRIVATE vrna_exp_param_t *get_exp_params(vrna_md_t *md_p);
+
+
 PRIVATE void  add_params(vrna_fold_compound_t *vc,
                          vrna_md_t            *md_p,
                          unsigned int         options);
@@ -97,7 +100,7 @@ vrna_fold_compound_free(vrna_fold_compound_t *vc)
     vrna_mx_pf_free(vc);
     free(vc->iindx);
     free(vc->jindx);
-    free(vc->params);
+    vrna_params_release(vc->params);
     free(vc->exp_params);
     free(vc->strand_number);
     vrna_hc_free(vc->hc);
@@ -152,15 +155,18 @@ vrna_fold_compound_free(vrna_fold_compound_t *vc)
     free(vc->mm1);
     free(vc->mm2);
 
-    /* free local folding related stuff (should be NULL if not used) */
+    /*
+     *  free local folding related stuff (should be NULL if not used). Rows are
+     *  rotated while the window slides, so any of them may still be allocated
+     */
     if (vc->ptype_local) {
-      for (s = 0; (s < vc->window_size + 5) && (s <= vc->length); s++)
+      for (s = 0; s <= vc->length; s++)
         free(vc->ptype_local[s]);
       free(vc->ptype_local);
     }
 
     if (vc->pscore_local) {
-      for (s = 0; (s < vc->window_size + 5) && (s <= vc->length); s++)
+      for (s = 0; s <= vc->length; s++)
         free(vc->pscore_local[s]);
       free(vc->pscore_local);
     }
@@ -258,6 +264,143 @@ vrna_fold_compound(const char   *sequence,
 }
 
 
+PUBLIC int
+vrna_fold_compound_reset_sequence(vrna_fold_compound_t  *vc,
+                                  const char            *sequence)
+{
+  int           had_ptype, had_ptype_compat;
+  unsigned int  length, old_length;
+  vrna_md_t     *md;
+
+  if ((!vc) || (!sequence))
+    return 0;
+
+  if ((vc->type != VRNA_FC_TYPE_SINGLE) || (vc->ptype_local) || (vc->cutpoint > 0)) {
+    vrna_message_warning("vrna_fold_compound_reset_sequence@data_structures.c: "
+                         "only available for single sequences in global folding mode");
+    return 0;
+  }
+
+  length = strlen(sequence);
+  if (length == 0) {
+    vrna_message_warning("vrna_fold_compound_reset_sequence@data_structures.c: sequence length must be greater 0");
+    return 0;
+  }
+
+  if (strchr(sequence, '&')) {
+    vrna_message_warning("vrna_fold_compound_reset_sequence@data_structures.c: "
+                         "concatenated sequences are not supported");
+    return 0;
+  }
+
+  if (length > vrna_sequence_length_max(VRNA_OPTION_DEFAULT)) {
+    vrna_message_warning("vrna_fold_compound_reset_sequence@data_structures.c: "
+                         "sequence length of %d exceeds addressable range", length);
+    return 0;
+  }
+
+  md                = &(vc->params->model_details);
+  old_length        = vc->length;
+  had_ptype         = (vc->ptype) ? 1 : 0;
+  had_ptype_compat  = (vc->ptype_pf_compat) ? 1 : 0;
+
+  /* release all sequence dependent data */
+  free(vc->sequence);
+  free(vc->sequence_encoding);
+  free(vc->sequence_encoding2);
+  free(vc->ptype);
+  free(vc->ptype_pf_compat);
+  free(vc->strand_number);
+  vrna_sc_remove(vc);
+
+  vc->sequence            = strdup(sequence);
+  vc->length              = length;
+  vc->sequence_encoding   = vrna_seq_encode(vc->sequence, md);
+  vc->sequence_encoding2  = vrna_seq_encode_simple(vc->sequence, md);
+  vc->strand_number       = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (length + 2));
+  vc->ptype               = (had_ptype) ? vrna_ptypes(vc->sequence_encoding2, md) : NULL;
+  vc->ptype_pf_compat     = (had_ptype_compat) ? get_ptypes(vc->sequence_encoding2, md, 1) : NULL;
+
+  if (length != old_length) {
+    free(vc->iindx);
+    free(vc->jindx);
+    vc->iindx = vrna_idx_row_wise(length);
+    vc->jindx = vrna_idx_col_wise(length);
+
+    /*
+     * global folding spans the entire sequence. Free energy parameters may be
+     * shared with other fold compounds and do not depend on the window size
+     */
+    if (vc->exp_params && (vc->exp_params->model_details.window_size == (int)old_length))
+      vc->exp_params->model_details.window_size = (int)length;
+  }
+
+  if (vc->hc)
+    vrna_hc_init(vc);
+
+  /*
+   *  DP matrices that are large enough are kept, anything else is
+   *  released and re-allocated upon the next call to vrna_fold_compound_prepare()
+   */
+  if (vc->matrices) {
+    if (vc->matrices->length < length) {
+      vrna_mx_mfe_free(vc);
+    } else if (vc->matrices->ggg) {
+      free(vc->matrices->ggg);
+      vc->matrices->ggg = get_gquad_matrix(vc->sequence_encoding2, vc->params);
+    }
+  }
+
+  if (vc->exp_matrices && (vc->exp_matrices->length < length))
+    vrna_mx_pf_free(vc);
+
+  /*
+   *  a scaling factor derived from the MFE of the previous sequence is meaningless
+   *  for the new one, so fall back to the default estimate
+   */
+  if (vc->exp_params) {
+    vc->exp_params->pf_scale = -1;
+    vrna_exp_params_rescale(vc, NULL);
+  }
+
+  return 1;
+}
+
+
+PUBLIC int
+vrna_fold_compound_has_callbacks(vrna_fold_compound_t *vc)
+{
+  int s;
+
+  if (!vc)
+    return 0;
+
+  if (vc->hc && vc->hc->f)
+    return 1;
+
+  if (!vrna_ud_default_callbacks(vc))
+    return 1;
+
+  switch (vc->type) {
+    case VRNA_FC_TYPE_SINGLE:
+      if (vc->sc && (vc->sc->f || vc->sc->exp_f || vc->sc->bt))
+        return 1;
+
+      break;
+
+    case VRNA_FC_TYPE_COMPARATIVE:
+      if (vc->scs)
+        for (s = 0; s < vc->n_seq; s++)
+          if (vc->scs[s] && (vc->scs[s]->f || vc->scs[s]->exp_f || vc->scs[s]->bt))
+            return 1;
+
+      break;
+  }
+
+  return 0;
+}
+
+
 PUBLIC vrna_fold_compound_t *
 vrna_fold_compound_comparative(const char   **sequences,
                                vrna_md_t    *md_p,
@@ -485,7 +628,7 @@ vrna_fold_compound_prepare(vrna_fold_compound_t *vc,
     switch (vc->type) {
       case VRNA_FC_TYPE_SINGLE:     /* get pre-computed Boltzmann factors if not present*/
         if (!vc->exp_params)
-          vc->exp_params = vrna_exp_params(&(vc->params->model_details));
+          vc->exp_params = get_exp_params(&(vc->params->model_details));
 
         if (!vc->ptype)
           vc->ptype = vrna_ptypes(vc->sequence_encoding2, &(vc->exp_params->model_details));
@@ -551,17 +694,40 @@ add_params(vrna_fold_compound_t *vc,
            vrna_md_t            *md_p,
            unsigned int         options)
 {
-  /* ALWAYS add regular energy parameters */
-  vc->params = vrna_params(md_p);
+  /* circular folding requires unique ML arrays, so settle this before parameters are shared */
+  if (md_p->circ)
+    md_p->uniq_ML = 1;
+
+  /* ALWAYS add regular energy parameters (shared among all fold compounds with the same model) */
+  vc->params = vrna_params_shared(md_p);
 
   if (options & VRNA_OPTION_PF) {
     vc->exp_params = (vc->type == VRNA_FC_TYPE_SINGLE) ? \
-                     vrna_exp_params(md_p) : \
+                     get_exp_params(md_p) : \
                      vrna_exp_params_comparative(vc->n_seq, md_p);
   }
 }
 
 
+/*
+ *  Boltzmann factors are modified by each fold compound, e.g. the scaling factor,
+ *  so we hand out a private copy of the shared set
+ */
+PRIVATE vrna_exp_param_t *
+get_exp_params(vrna_md_t *md_p)
+{
+  vrna_exp_param_t *shared, *pf;
+
+  shared            = vrna_exp_params_shared(md_p);
+  pf                = vrna_exp_params_copy(shared);
+  pf->model_details = *md_p;
+
+  vrna_exp_params_release(shared);
+
+  return pf;
+}
+
+
 PRIVATE void
 set_fold_compound(vrna_fold_compound_t  *vc,
                   vrna_md_t             *md_p,
@@ -644,9 +810,9 @@ set_fold_compound(vrna_fold_compound_t  *vc,
       vc->cons_seq  = consensus((const char **)sequences);
       vc->S_cons    = vrna_seq_encode_simple(vc->cons_seq, md_p);
 
-      vc->pscore = vrna_alloc(sizeof(int) * ((length * (length + 1)) / 2 + 2));
+      vc->pscore = vrna_alloc(sizeof(int) * (((size_t)length * (length + 1)) / 2 + 2));
       /* backward compatibility ptypes */
-      vc->pscore_pf_compat = (aux & WITH_PTYPE_COMPAT) ? vrna_alloc(sizeof(int) * ((length * (length + 1)) / 2 + 2)) : NULL;
+      vc->pscore_pf_compat = (aux & WITH_PTYPE_COMPAT) ? vrna_alloc(sizeof(int) * (((size_t)length * (length + 1)) / 2 + 2)) : NULL;
 
       oldAliEn = vc->oldAliEn = md_p->oldAliEn;
 
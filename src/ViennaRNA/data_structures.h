@@ -812,6 +812,53 @@ void
 vrna_fold_compound_free(vrna_fold_compound_t *vc);
 
 
+/**
+ *  @brief  Re-target an existing #vrna_fold_compound_t to a new sequence
+ *
+ *  This function replaces the sequence of a #vrna_fold_compound_t that has been created by
+ *  vrna_fold_compound() and only re-computes the sequence dependent data, such as the
+ *  sequence encodings and pair type arrays. Energy parameters and Boltzmann factors are
+ *  kept as they are, and so are DP matrices as long as they provide enough memory for the
+ *  new sequence. Otherwise, they are released and re-allocated by the next structure
+ *  prediction. This makes it much cheaper to process large numbers of (short) sequences
+ *  with the same model settings than creating a new #vrna_fold_compound_t for each of them.
+ *
+ *  The scaling factor of the Boltzmann factors is reset to its default estimate. Use
+ *  vrna_exp_params_rescale() with the MFE of the new sequence to obtain a better one.
+ *
+ *  Hard constraints are reset to their default state and soft constraints are removed.
+ *  Unstructured domains, auxiliary data, and callbacks remain attached.
+ *
+ *  @note   Only single sequences in global folding mode are supported. Neither the current,
+ *          nor the new sequence may consist of two concatenated sequences.
+ *
+ *  @see    vrna_fold_compound(), vrna_fold_compound_free()
+ *
+ *  @param  vc        The #vrna_fold_compound_t to re-target
+ *  @param  sequence  The new sequence
+ *  @return           1 on success, 0 otherwise
+ */
+int
+vrna_fold_compound_reset_sequence(vrna_fold_compound_t  *vc,
+                                  const char            *sequence);
+
+
+/**
+ *  @brief  Check whether a #vrna_fold_compound_t carries user supplied callbacks
+ *
+ *  Hard constraint, soft constraint, and unstructured domain callbacks are not required
+ *  to be thread-safe. This is true in particular for those supplied through the scripting
+ *  language interfaces. The default unstructured domain implementation set up by
+ *  vrna_ud_add_motif() does not count as a callback here. The OpenMP parallel recursions (see #vrna_md_t.wavefront) therefore
+ *  fall back to serial processing whenever this function returns non-zero.
+ *
+ *  @param  vc  The #vrna_fold_compound_t to check
+ *  @return     1 if any user supplied callback is attached, 0 otherwise
+ */
+int
+vrna_fold_compound_has_callbacks(vrna_fold_compound_t *vc);
+
+
 /**
  *  @brief  Add auxiliary data to the #vrna_fold_compound_t
  *
@@ -24,6 +24,7 @@
 #include "model.h"
 #include "utils.h"
 #include "gquad.h"
+#include "higher_order_functions.h"
 #include "dp_matrices.h"
 
 /*
@@ -76,12 +77,17 @@ PRIVATE unsigned int    get_mx_mfe_alloc_vector_current(vrna_mx_mfe_t *mx, vrna_
 PRIVATE unsigned int    get_mx_pf_alloc_vector_current(vrna_mx_pf_t *mx, vrna_mx_type_e mx_type);
 PRIVATE void            mfe_matrices_alloc_default(vrna_mx_mfe_t *vars, unsigned int m, unsigned int alloc_vector);
 PRIVATE void            mfe_matrices_free_default(vrna_mx_mfe_t *self);
+PRIVATE void            mfe_matrices_alloc_compact(vrna_mx_mfe_t *vars, unsigned int m, unsigned int alloc_vector);
+PRIVATE void            mfe_matrices_free_compact(vrna_mx_mfe_t *self);
+PRIVATE int             mfe_compact_supported(vrna_fold_compound_t *vc, unsigned int options);
 PRIVATE void            mfe_matrices_alloc_window(vrna_mx_mfe_t *vars, unsigned int m, unsigned int alloc_vector);
 PRIVATE void            mfe_matrices_free_window(vrna_mx_mfe_t *self, unsigned int length, unsigned int window_size);
 PRIVATE void            mfe_matrices_alloc_2Dfold(vrna_mx_mfe_t *vars, unsigned int m, unsigned int alloc_vector);
 PRIVATE void            mfe_matrices_free_2Dfold( vrna_mx_mfe_t *self, unsigned int length, int *indx);
 PRIVATE void            pf_matrices_alloc_default(vrna_mx_pf_t *vars, unsigned int m, unsigned int alloc_vector);
 PRIVATE void            pf_matrices_free_default(vrna_mx_pf_t *self);
+PRIVATE void            pf_matrices_alloc_window(vrna_mx_pf_t *vars, unsigned int m, unsigned int alloc_vector);
+PRIVATE void            pf_matrices_free_window(vrna_mx_pf_t *self, unsigned int length);
 PRIVATE void            pf_matrices_alloc_2Dfold(vrna_mx_pf_t *vars, unsigned int m, unsigned int alloc_vector);
 PRIVATE void            pf_matrices_free_2Dfold(vrna_mx_pf_t *self, unsigned int length, int *indx, int *jindx);
 PRIVATE vrna_mx_mfe_t   *get_mfe_matrices_alloc(unsigned int n, unsigned int m, vrna_mx_type_e type, unsigned int alloc_vector);
@@ -112,6 +118,9 @@ vrna_mx_mfe_free(vrna_fold_compound_t *vc){
         case VRNA_MX_2DFOLD:    mfe_matrices_free_2Dfold(self, vc->length, vc->iindx);
                                 break;
 
+        case VRNA_MX_COMPACT:   mfe_matrices_free_compact(self);
+                                break;
+
         default:                /* do nothing */
                                 break;
       }
@@ -131,6 +140,9 @@ vrna_mx_pf_free(vrna_fold_compound_t *vc){
         case VRNA_MX_DEFAULT:   pf_matrices_free_default(self);
                                 break;
 
+        case VRNA_MX_WINDOW:    pf_matrices_free_window(self, vc->length);
+                                break;
+
         case VRNA_MX_2DFOLD:    pf_matrices_free_2Dfold(self, vc->length, vc->iindx, vc->jindx);
                                 break;
 
@@ -223,6 +235,8 @@ vrna_mx_prepare(vrna_fold_compound_t *vc,
     if(options & VRNA_OPTION_MFE){  /* prepare for MFE computation */
       if(options & VRNA_OPTION_WINDOW){ /* Windowing approach, a.k.a. locally optimal */
         mx_type = VRNA_MX_WINDOW;
+      } else if(vc->matrices && (vc->matrices->type == VRNA_MX_COMPACT) && mfe_compact_supported(vc, options)){
+        mx_type = VRNA_MX_COMPACT;      /* keep compact matrices as long as the recursions support them */
       } else {                          /* default is regular MFE */
         mx_type = VRNA_MX_DEFAULT;
       }
@@ -250,7 +264,10 @@ vrna_mx_prepare(vrna_fold_compound_t *vc,
       if(!vc->exp_params) /* return failure if exp_params data is not present */
         return 0;
 
-      mx_type = VRNA_MX_DEFAULT;  /* for now, we only check default matrices */
+      if(options & VRNA_OPTION_WINDOW)  /* Windowing approach, a.k.a. locally optimal */
+        mx_type = VRNA_MX_WINDOW;
+      else                              /* default is regular PF */
+        mx_type = VRNA_MX_DEFAULT;
 
       if(vc->cutpoint > 0)
         options |= VRNA_OPTION_HYBRID;
@@ -283,6 +300,116 @@ vrna_mx_prepare(vrna_fold_compound_t *vc,
 
   return ret;
 }
+
+PUBLIC int
+vrna_mx_compact_get(const short *e,
+                    const int   *base,
+                    const int   *base_indx,
+                    const int   *indx,
+                    int         i,
+                    int         j){
+
+  short d;
+
+  if(i > j)
+    return INF;
+
+  d = e[indx[j] + i];
+
+  if(d == VRNA_MX_COMPACT_INF)
+    return INF;
+
+  return base[base_indx[j] + (i >> VRNA_MX_COMPACT_BLOCK_SHIFT)] + d;
+}
+
+PUBLIC int
+vrna_mx_compact_set(short     *e,
+                    int       *base,
+                    const int *base_indx,
+                    const int *indx,
+                    int       i,
+                    int       j,
+                    int       en){
+
+  int *b, d;
+
+  if(en >= INF / 2){ /* everything in this range is as good as INF */
+    e[indx[j] + i] = VRNA_MX_COMPACT_INF;
+    return 1;
+  }
+
+  b = base + base_indx[j] + (i >> VRNA_MX_COMPACT_BLOCK_SHIFT);
+
+  if(*b == INF)
+    *b = en;
+
+  d = en - *b;
+
+  if((d < SHRT_MIN) || (d >= VRNA_MX_COMPACT_INF))
+    return 0;
+
+  e[indx[j] + i] = (short)d;
+
+  return 1;
+}
+
+PUBLIC int
+vrna_mx_mfe_fML_column_min(const vrna_mx_mfe_t  *mx,
+                           const int            *indx,
+                           const int            *row,
+                           int                  j,
+                           int                  k_start,
+                           int                  k_end){
+
+  short *col;
+  int   p, p_start, p_end, block_end, base, b, en, decomp,
+        buffer[1 << VRNA_MX_COMPACT_BLOCK_SHIFT];
+
+  if(mx->type != VRNA_MX_COMPACT)
+    return vrna_fun_zip_add_min(row + k_start,
+                                mx->fML + indx[j] + k_start + 1,
+                                k_end - k_start + 1);
+
+  decomp  = INF;
+  col     = mx->fML_compact + indx[j];
+  p_end   = k_end + 1;
+
+  for(p_start = k_start + 1; p_start <= p_end; p_start = block_end + 1){
+    b         = p_start >> VRNA_MX_COMPACT_BLOCK_SHIFT;
+    block_end = ((b + 1) << VRNA_MX_COMPACT_BLOCK_SHIFT) - 1;
+    block_end = MIN2(block_end, p_end);
+    base      = mx->fML_base[mx->base_indx[j] + b];
+
+    if(base == INF) /* no finite entry in this block */
+      continue;
+
+    for(p = p_start; p <= block_end; p++)
+      buffer[p - p_start] = (col[p] == VRNA_MX_COMPACT_INF) ? INF : base + col[p];
+
+    en      = vrna_fun_zip_add_min(row + p_start - 1, buffer, block_end - p_start + 1);
+    decomp  = MIN2(decomp, en);
+  }
+
+  return decomp;
+}
+
+PUBLIC void
+vrna_mx_mfe_compact_reset(vrna_mx_mfe_t *mx){
+
+  int n, b, num_blocks;
+
+  if(mx && (mx->type == VRNA_MX_COMPACT)){
+    n           = (int)mx->length;
+    num_blocks  = mx->base_indx[n] + (n >> VRNA_MX_COMPACT_BLOCK_SHIFT) + 1;
+
+    for(b = 0; b < num_blocks; b++){
+      if(mx->c_base)
+        mx->c_base[b] = INF;
+      if(mx->fML_base)
+        mx->fML_base[b] = INF;
+    }
+  }
+}
 /*
 #####################################
 # BEGIN OF STATIC HELPER FUNCTIONS  #
@@ -312,6 +439,18 @@ get_mx_mfe_alloc_vector_current(vrna_mx_mfe_t *mx,
                               mx_alloc_vector |= ALLOC_CIRC;
                             break;
 
+      case VRNA_MX_COMPACT: if(mx->f5)
+                              mx_alloc_vector |= ALLOC_F5;
+                            if(mx->c_compact)
+                              mx_alloc_vector |= ALLOC_C;
+                            if(mx->fML_compact)
+                              mx_alloc_vector |= ALLOC_FML;
+                            if(mx->fM1)
+                              mx_alloc_vector |= ALLOC_UNIQ;
+                            if(mx->fM2)
+                              mx_alloc_vector |= ALLOC_CIRC;
+                            break;
+
       default:              break;
     }
   }
@@ -343,6 +482,14 @@ get_mx_pf_alloc_vector_current( vrna_mx_pf_t *mx,
                               mx_alloc_vector |= ALLOC_AUX;
                             break;
 
+      case VRNA_MX_WINDOW:  if(mx->q_local)
+                              mx_alloc_vector |= ALLOC_F;
+                            if(mx->qb_local)
+                              mx_alloc_vector |= ALLOC_C;
+                            if(mx->qm_local)
+                              mx_alloc_vector |= ALLOC_FML;
+                            break;
+
       default:              break;
     }
   }
@@ -427,6 +574,9 @@ get_mfe_matrices_alloc( unsigned int n,
     case VRNA_MX_2DFOLD:    mfe_matrices_alloc_2Dfold(vars, m, alloc_vector);
                             break;
 
+    case VRNA_MX_COMPACT:   mfe_matrices_alloc_compact(vars, m, alloc_vector);
+                            break;
+
     default:                /* do nothing */
                             break;
   }
@@ -442,7 +592,7 @@ get_pf_matrices_alloc(unsigned int n,
   unsigned int  lin_size;
   vrna_mx_pf_t  *vars;
 
-  if(n >= (unsigned int)sqrt((double)INT_MAX))
+  if((type != VRNA_MX_WINDOW) && (n >= (unsigned int)sqrt((double)INT_MAX)))
     vrna_message_error("get_pf_matrices_alloc@data_structures.c: sequence length exceeds addressable range");
 
   lin_size      = n + 2;
@@ -455,6 +605,9 @@ get_pf_matrices_alloc(unsigned int n,
     case VRNA_MX_DEFAULT:   pf_matrices_alloc_default(vars, n, alloc_vector);
                             break;
 
+    case VRNA_MX_WINDOW:    pf_matrices_alloc_window(vars, n, alloc_vector);
+                            break;
+
     case VRNA_MX_2DFOLD:    pf_matrices_alloc_2Dfold(vars, n, alloc_vector);
                             break;
 
@@ -486,15 +639,20 @@ get_mx_alloc_vector(vrna_md_t *md_p,
     v |= (mx_type == VRNA_MX_WINDOW) ? ALLOC_MFE_LOCAL : ALLOC_MFE_DEFAULT;
 
   /* default PF matrices ? */
-  if(options & VRNA_OPTION_PF)
-    v |= (md_p->compute_bpp) ? ALLOC_PF_DEFAULT : ALLOC_PF_WO_PROBS;
+  if(options & VRNA_OPTION_PF){
+    if(mx_type == VRNA_MX_WINDOW) /* local pair probabilities are passed on the fly */
+      v |= ALLOC_PF_WO_PROBS;
+    else
+      v |= (md_p->compute_bpp) ? ALLOC_PF_DEFAULT : ALLOC_PF_WO_PROBS;
+  }
 
   if(options & VRNA_OPTION_HYBRID)
     v |= ALLOC_HYBRID;
 
   /* matrices for circular folding ? */
   if(md_p->circ){
-    md_p->uniq_ML = 1; /* we need unique ML arrays for circular folding */
+    if(!md_p->uniq_ML)
+      md_p->uniq_ML = 1; /* we need unique ML arrays for circular folding */
     v |= ALLOC_CIRC;
   }
 
@@ -511,10 +669,11 @@ mfe_matrices_alloc_default( vrna_mx_mfe_t *vars,
                             unsigned int m,
                             unsigned int alloc_vector){
 
-  unsigned int  n, size, lin_size;
+  unsigned int  n, lin_size;
+  size_t        size;
 
   n             = vars->length;
-  size          = ((n + 1) * (m + 2)) / 2;
+  size          = ((size_t)(n + 1) * (m + 2)) / 2;
   lin_size      = n + 2;
 
   vars->f5  = NULL;
@@ -526,6 +685,12 @@ mfe_matrices_alloc_default( vrna_mx_mfe_t *vars,
   vars->fM2 = NULL;
   vars->ggg = NULL;
 
+  vars->c_compact   = NULL;
+  vars->fML_compact = NULL;
+  vars->c_base      = NULL;
+  vars->fML_base    = NULL;
+  vars->base_indx   = NULL;
+
   if(alloc_vector & ALLOC_F5)
     vars->f5  = (int *) vrna_alloc(sizeof(int) * lin_size);
 
@@ -565,6 +730,76 @@ mfe_matrices_free_default(vrna_mx_mfe_t *self){
   free(self->ggg);
 }
 
+PRIVATE void
+mfe_matrices_alloc_compact( vrna_mx_mfe_t *vars,
+                            unsigned int m,
+                            unsigned int alloc_vector){
+
+  unsigned int  n, j, i;
+  size_t        size, num_blocks;
+
+  /* all arrays but c and fML are the same as for the default matrices */
+  mfe_matrices_alloc_default(vars, m, alloc_vector & ~(ALLOC_C | ALLOC_FML));
+
+  n     = vars->length;
+  size  = ((size_t)(n + 1) * (m + 2)) / 2;
+
+  /*
+      each column j is split into blocks of consecutive entries that share
+      a common energy base. base_indx[j] holds the index of the first block
+      of column j
+  */
+  vars->base_indx = (int *) vrna_alloc(sizeof(int) * (n + 2));
+  for(num_blocks = 0, j = 1; j <= n; j++){
+    vars->base_indx[j]  = (int)num_blocks;
+    num_blocks          += (j >> VRNA_MX_COMPACT_BLOCK_SHIFT) + 1;
+  }
+
+  if(alloc_vector & ALLOC_C){
+    vars->c_compact = (short *) vrna_alloc(sizeof(short) * size);
+    vars->c_base    = (int *) vrna_alloc(sizeof(int) * num_blocks);
+    for(i = 0; i < num_blocks; i++)
+      vars->c_base[i] = INF;  /* energy base not assigned, yet */
+  }
+
+  if(alloc_vector & ALLOC_FML){
+    vars->fML_compact = (short *) vrna_alloc(sizeof(short) * size);
+    vars->fML_base    = (int *) vrna_alloc(sizeof(int) * num_blocks);
+    for(i = 0; i < num_blocks; i++)
+      vars->fML_base[i] = INF;
+  }
+}
+
+PRIVATE void
+mfe_matrices_free_compact(vrna_mx_mfe_t *self){
+
+  mfe_matrices_free_default(self);
+
+  free(self->c_compact);
+  free(self->fML_compact);
+  free(self->c_base);
+  free(self->fML_base);
+  free(self->base_indx);
+}
+
+PRIVATE int
+mfe_compact_supported(vrna_fold_compound_t *vc,
+                      unsigned int options){
+
+  /*
+      the single sequence MFE recursions access c and fML through
+      vrna_mx_mfe_c() and vrna_mx_mfe_fML(), while cofolding,
+      comparative, and local structure prediction do not
+  */
+  if(options & (VRNA_OPTION_WINDOW | VRNA_OPTION_HYBRID))
+    return 0;
+
+  if((vc->type != VRNA_FC_TYPE_SINGLE) || (vc->cutpoint > 0))
+    return 0;
+
+  return 1;
+}
+
 PRIVATE void
 mfe_matrices_alloc_window(vrna_mx_mfe_t *vars,
                           unsigned int m,
@@ -632,10 +867,11 @@ mfe_matrices_alloc_2Dfold(vrna_mx_mfe_t *vars,
                           unsigned int m,
                           unsigned int alloc_vector){
 
-  unsigned int  n, i, size, lin_size;
+  unsigned int  n, lin_size;
+  size_t        i, size;
 
   n               = vars->length;
-  size            = ((n + 1) * (m + 2)) / 2;
+  size            = ((size_t)(n + 1) * (m + 2)) / 2;
   lin_size        = n + 2;
 
   vars->E_F5      = NULL;
@@ -1084,10 +1320,11 @@ pf_matrices_alloc_default(vrna_mx_pf_t *vars,
                           unsigned int m,
                           unsigned int alloc_vector){
 
-  unsigned int  n, size, lin_size;
+  unsigned int  n, lin_size;
+  size_t        size;
 
   n             = vars->length;
-  size          = ((n + 1) * (n + 2)) / 2;
+  size          = ((size_t)(n + 1) * (n + 2)) / 2;
   lin_size      = n + 2;
 
   vars->q       = NULL;
@@ -1137,15 +1374,83 @@ pf_matrices_free_default( vrna_mx_pf_t *self){
   free(self->qln);
 }
 
+PRIVATE void
+pf_matrices_alloc_window( vrna_mx_pf_t *vars,
+                          unsigned int m,
+                          unsigned int alloc_vector){
+
+  unsigned int  n, lin_size;
+
+  n             = vars->length;
+  lin_size      = n + 2;
+
+  /*
+      only the row pointers are allocated here. The rows themselves are
+      allocated and free'd while the window slides along the sequence
+  */
+  vars->q_local   = NULL;
+  vars->qb_local  = NULL;
+  vars->qm_local  = NULL;
+
+  if(alloc_vector & ALLOC_F)
+    vars->q_local   = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+
+  if(alloc_vector & ALLOC_C)
+    vars->qb_local  = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+
+  if(alloc_vector & ALLOC_FML)
+    vars->qm_local  = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+
+  vars->pR        = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+  vars->qm2_local = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+  vars->QI5       = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+  vars->q2l       = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+  vars->qmb       = (FLT_OR_DBL **) vrna_alloc(sizeof(FLT_OR_DBL *) * lin_size);
+}
+
+PRIVATE void
+pf_matrices_free_window(vrna_mx_pf_t *self,
+                        unsigned int length){
+
+  unsigned int  i;
+
+  /* rows of the first four matrices are shifted by their row index */
+  for(i = 0; i <= length; i++){
+    if(self->q_local && self->q_local[i])
+      free(self->q_local[i] + i);
+    if(self->qb_local && self->qb_local[i])
+      free(self->qb_local[i] + i);
+    if(self->qm_local && self->qm_local[i])
+      free(self->qm_local[i] + i);
+    if(self->pR[i])
+      free(self->pR[i] + i);
+    if(self->qm2_local[i])
+      free(self->qm2_local[i] + i);
+    free(self->QI5[i]);
+    free(self->q2l[i]);
+    free(self->qmb[i]);
+  }
+
+  free(self->q_local);
+  free(self->qb_local);
+  free(self->qm_local);
+  free(self->pR);
+  free(self->qm2_local);
+  free(self->QI5);
+  free(self->q2l);
+  free(self->qmb);
+}
+
 PRIVATE void
 pf_matrices_alloc_2Dfold( vrna_mx_pf_t *vars,
                           unsigned int m,
                           unsigned int alloc_vector){
 
-  unsigned int  n, size, lin_size;
+  unsigned int  n, lin_size;
+  size_t        size;
 
   n             = vars->length;
-  size          = ((n + 1) * (n + 2)) / 2;
+  size          = ((size_t)(n + 1) * (n + 2)) / 2;
   lin_size      = n + 2;
 
   vars->Q           = NULL;
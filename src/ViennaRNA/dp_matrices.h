@@ -21,6 +21,8 @@ typedef struct  vrna_mx_mfe_s vrna_mx_mfe_t;
 /** @brief Typename for the Partition Function (PF) DP matrices data structure #vrna_mx_pf_s */
 typedef struct  vrna_mx_pf_s  vrna_mx_pf_t;
 
+#include <limits.h>
+
 #include <ViennaRNA/data_structures.h>
 
 /**
@@ -32,13 +34,27 @@ typedef enum {
   VRNA_MX_DEFAULT,  /**<  @brief  Default DP matrices */
   VRNA_MX_WINDOW,   /**<  @brief  DP matrices suitable for local structure prediction using
                           window approach.
-                          @see    vrna_mfe_window(), vrna_mfe_window_zscore(), pfl_fold()
+                          @see    vrna_mfe_window(), vrna_mfe_window_zscore(), vrna_probs_window()
                     */
-  VRNA_MX_2DFOLD    /**<  @brief  DP matrices suitable for distance class partitioned structure prediction
+  VRNA_MX_2DFOLD,   /**<  @brief  DP matrices suitable for distance class partitioned structure prediction
                           @see  vrna_mfe_TwoD(), vrna_pf_TwoD()
                     */
+  VRNA_MX_COMPACT   /**<  @brief  Memory efficient MFE matrices that store energies as 16-bit offsets
+                          @see    vrna_mx_mfe_add(), vrna_mfe()
+                    */
 } vrna_mx_type_e;
 
+/**
+ *  @brief  Energy offset that marks an INF entry in #VRNA_MX_COMPACT matrices
+ */
+#define VRNA_MX_COMPACT_INF           SHRT_MAX
+
+/**
+ *  @brief  Base-2 logarithm of the number of consecutive entries within a column of
+ *          #VRNA_MX_COMPACT matrices that share a common energy base
+ */
+#define VRNA_MX_COMPACT_BLOCK_SHIFT   5
+
 /**
  *  @brief  Minimum Free Energy (MFE) Dynamic Programming (DP) matrices data structure required within the #vrna_fold_compound_t
  */
@@ -78,6 +94,24 @@ struct vrna_mx_mfe_s {
         @}
        */
 
+      /** @name Compact DP matrices
+          @note These data fields are available if
+                @code vrna_mx_mfe_t.type == VRNA_MX_COMPACT @endcode
+                In this case, the arrays @p c and @p fML above are not allocated. Instead,
+                each entry is stored as a 16-bit offset to a 32-bit energy base that is shared
+                among blocks of (1 << #VRNA_MX_COMPACT_BLOCK_SHIFT) consecutive entries within
+                the same column. Offsets equal to #VRNA_MX_COMPACT_INF represent #INF.
+        @{
+       */
+      short   *c_compact;   /**<  @brief  Energy offsets of array c */
+      short   *fML_compact; /**<  @brief  Energy offsets of array fML */
+      int     *c_base;      /**<  @brief  Energy bases for blocks of array c */
+      int     *fML_base;    /**<  @brief  Energy bases for blocks of array fML */
+      int     *base_indx;   /**<  @brief  Index of the first energy base block of each column */
+      /**
+        @}
+       */
+
 #ifndef VRNA_DISABLE_C11_FEATURES
     /* C11 support for unnamed unions/structs */
     };
@@ -244,6 +278,31 @@ struct vrna_mx_pf_s {
       @}
    */
 
+#ifndef VRNA_DISABLE_C11_FEATURES
+    /* C11 support for unnamed unions/structs */
+    };
+    struct {
+#endif
+
+  /** @name Local Folding DP matrices using window approach
+      @note These data fields are available if
+            @code vrna_mx_pf_t.type == VRNA_MX_WINDOW @endcode
+            Only the rows of the current window are allocated, see vrna_probs_window()
+      @{
+   */
+      FLT_OR_DBL  **q_local;    /**<  @brief  Partition functions of segments [i:j] */
+      FLT_OR_DBL  **qb_local;   /**<  @brief  Partition functions of segments [i:j], given that i-j pair */
+      FLT_OR_DBL  **qm_local;   /**<  @brief  Multi-loop auxiliary partition functions */
+      FLT_OR_DBL  **pR;         /**<  @brief  Outside contributions and pair probabilities */
+      FLT_OR_DBL  **qm2_local;  /**<  @brief  Multi-loop contributions with at least two stems (unpaired probabilities only) */
+      FLT_OR_DBL  **QI5;        /**<  @brief  Interior loop contributions (unpaired probabilities only) */
+      FLT_OR_DBL  **q2l;        /**<  @brief  Multi-loop contributions (unpaired probabilities only) */
+      FLT_OR_DBL  **qmb;        /**<  @brief  Multi-loop contributions (unpaired probabilities only) */
+
+  /**
+      @}
+   */
+
 #ifndef VRNA_DISABLE_C11_FEATURES
     /* C11 support for unnamed unions/structs */
     };
@@ -366,6 +425,26 @@ vrna_mx_add(vrna_fold_compound_t *vc,
             vrna_mx_type_e type,
             unsigned int options);
 
+/**
+ *  @brief  Add Minimum Free Energy (MFE) Dynamic Programming (DP) matrices (allocate memory)
+ *
+ *  Passing #VRNA_MX_COMPACT as @p mx_type replaces the default MFE matrices of a
+ *  #vrna_fold_compound_t with a memory efficient variant that roughly halves the memory
+ *  required for the arrays @p c and @p fML. The compact matrices are kept by subsequent
+ *  calls to vrna_mfe() for single sequences, and support the same energy model, constraints,
+ *  and unstructured domains as the default matrices. Comparative, cofolding, and local
+ *  structure prediction transparently replace them by the default matrices. The same
+ *  happens if an energy does not fit into the 16-bit offset range. Compact matrices are
+ *  always filled row-wise, i.e. vrna_md_t.wavefront is ignored.
+ *
+ *  @see vrna_mx_add(), #VRNA_MX_COMPACT
+ *
+ *  @param  vc      The #vrna_fold_compound_t that holds pointers to the DP matrices
+ *  @param  mx_type The type of DP matrices requested
+ *  @param  options Option flags that specify auxiliary requirements
+ *  @returns        1 if DP matrices were properly allocated and attached,
+ *                  0 otherwise
+ */
 int
 vrna_mx_mfe_add(vrna_fold_compound_t *vc,
                 vrna_mx_type_e mx_type,
@@ -400,6 +479,180 @@ vrna_mx_mfe_free(vrna_fold_compound_t *vc);
 void
 vrna_mx_pf_free(vrna_fold_compound_t *vc);
 
+/**
+ *  @name Accessing the MFE energy arrays
+ *
+ *  The functions below read and write the triangular MFE arrays @p c and @p fML irrespective
+ *  of the actual matrix type. They are used throughout the MFE recursions and backtracking,
+ *  such that the very same code handles #VRNA_MX_DEFAULT and #VRNA_MX_COMPACT matrices.
+ *  Positions are given as nucleotide indices and translated into matrix offsets by means of
+ *  the @p indx array, i.e. vrna_fold_compound_t.jindx.
+ *
+ *  @{
+ */
+
+/**
+ *  @brief  Get the energy of a compact matrix entry
+ *
+ *  @see vrna_mx_mfe_c(), vrna_mx_mfe_fML()
+ *
+ *  @param  e         The energy offsets of the matrix
+ *  @param  base      The energy bases of the matrix
+ *  @param  base_indx The index of the first energy base of each column
+ *  @param  indx      The column offsets of the matrix
+ *  @param  i         The 5' position of the subsegment
+ *  @param  j         The 3' position of the subsegment
+ *  @return           The energy stored for the subsegment [i,j]
+ */
+int
+vrna_mx_compact_get(const short *e,
+                    const int   *base,
+                    const int   *base_indx,
+                    const int   *indx,
+                    int         i,
+                    int         j);
+
+/**
+ *  @brief  Store the energy of a compact matrix entry
+ *
+ *  The energy base of a block of entries is assigned by the first finite energy that
+ *  is written into it. Energies of #INF / 2 or more are stored as #INF.
+ *
+ *  @see vrna_mx_mfe_c_set(), vrna_mx_mfe_fML_set()
+ *
+ *  @param  e         The energy offsets of the matrix
+ *  @param  base      The energy bases of the matrix
+ *  @param  base_indx The index of the first energy base of each column
+ *  @param  indx      The column offsets of the matrix
+ *  @param  i         The 5' position of the subsegment
+ *  @param  j         The 3' position of the subsegment
+ *  @param  en        The energy to store
+ *  @return           1 on success, 0 if the energy does not fit into the 16-bit offset range
+ */
+int
+vrna_mx_compact_set(short     *e,
+                    int       *base,
+                    const int *base_indx,
+                    const int *indx,
+                    int       i,
+                    int       j,
+                    int       en);
+
+/**
+ *  @brief  Compute min_{k_start <= k <= k_end} row[k] + fML[k + 1, j]
+ *
+ *  This is the min-plus reduction that dominates the multibranch loop decomposition.
+ *  For compact matrices, blocks of the column are decoded into a small buffer first,
+ *  such that the reduction itself is still done by vrna_fun_zip_add_min().
+ *
+ *  @param  mx      The MFE matrices
+ *  @param  indx    The column offsets of the matrices
+ *  @param  row     The row of energies to add to column @p j of @p fML
+ *  @param  j       The column of @p fML
+ *  @param  k_start The first split point
+ *  @param  k_end   The last split point
+ *  @return         The minimum of all sums, or #INF
+ */
+int
+vrna_mx_mfe_fML_column_min(const vrna_mx_mfe_t  *mx,
+                           const int            *indx,
+                           const int            *row,
+                           int                  j,
+                           int                  k_start,
+                           int                  k_end);
+
+/**
+ *  @brief  Forget the energy bases of compact MFE matrices prior to a new fill
+ *
+ *  This function does nothing for any matrix type other than #VRNA_MX_COMPACT.
+ *
+ *  @param  mx  The MFE matrices
+ */
+void
+vrna_mx_mfe_compact_reset(vrna_mx_mfe_t *mx);
+
+#ifndef VRNA_MX_INLINE
+# ifdef __GNUC__
+#   define VRNA_MX_INLINE static inline
+# else
+#   define VRNA_MX_INLINE static
+# endif
+#endif
+
+/**
+ *  @brief  Get the energy of array @p c for the subsegment [i,j]
+ */
+VRNA_MX_INLINE int
+vrna_mx_mfe_c(const vrna_mx_mfe_t *mx,
+              const int           *indx,
+              int                 i,
+              int                 j)
+{
+  if (mx->type == VRNA_MX_COMPACT)
+    return vrna_mx_compact_get(mx->c_compact, mx->c_base, mx->base_indx, indx, i, j);
+
+  return mx->c[indx[j] + i];
+}
+
+
+/**
+ *  @brief  Get the energy of array @p fML for the subsegment [i,j]
+ */
+VRNA_MX_INLINE int
+vrna_mx_mfe_fML(const vrna_mx_mfe_t *mx,
+                const int           *indx,
+                int                 i,
+                int                 j)
+{
+  if (mx->type == VRNA_MX_COMPACT)
+    return vrna_mx_compact_get(mx->fML_compact, mx->fML_base, mx->base_indx, indx, i, j);
+
+  return mx->fML[indx[j] + i];
+}
+
+
+/**
+ *  @brief  Store the energy of array @p c for the subsegment [i,j]
+ *  @return 1 on success, 0 if the energy could not be stored in a compact matrix
+ */
+VRNA_MX_INLINE int
+vrna_mx_mfe_c_set(vrna_mx_mfe_t *mx,
+                  const int     *indx,
+                  int           i,
+                  int           j,
+                  int           en)
+{
+  if (mx->type == VRNA_MX_COMPACT)
+    return vrna_mx_compact_set(mx->c_compact, mx->c_base, mx->base_indx, indx, i, j, en);
+
+  mx->c[indx[j] + i] = en;
+  return 1;
+}
+
+
+/**
+ *  @brief  Store the energy of array @p fML for the subsegment [i,j]
+ *  @return 1 on success, 0 if the energy could not be stored in a compact matrix
+ */
+VRNA_MX_INLINE int
+vrna_mx_mfe_fML_set(vrna_mx_mfe_t *mx,
+                    const int     *indx,
+                    int           i,
+                    int           j,
+                    int           en)
+{
+  if (mx->type == VRNA_MX_COMPACT)
+    return vrna_mx_compact_set(mx->fML_compact, mx->fML_base, mx->base_indx, indx, i, j, en);
+
+  mx->fML[indx[j] + i] = en;
+  return 1;
+}
+
+
+/**
+ *  @}
+ */
+
 /**
  *  @}
  */
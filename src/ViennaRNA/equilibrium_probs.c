@@ -25,6 +25,10 @@
 #include "ViennaRNA/mfe.h"
 #include "ViennaRNA/part_func.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 /*
 #################################
 # GLOBAL VARIABLES              #
@@ -42,7 +46,7 @@
 # PRIVATE FUNCTION DECLARATIONS #
 #################################
 */
-PRIVATE void  pf_create_bppm(vrna_fold_compound_t *vc, char *structure);
+PRIVATE void  pf_create_bppm(vrna_fold_compound_t *vc, char *structure, vrna_plist_t **pl, double cutoff);
 PRIVATE void  alipf_create_bppm(vrna_fold_compound_t *vc, char *structure);
 PRIVATE INLINE void bppm_circ(vrna_fold_compound_t *vc);
 
@@ -77,7 +81,7 @@ vrna_pairing_probs( vrna_fold_compound_t *vc,
 
   if(vc){
     switch(vc->type){
-      case VRNA_FC_TYPE_SINGLE:     pf_create_bppm(vc, structure);
+      case VRNA_FC_TYPE_SINGLE:     pf_create_bppm(vc, structure, NULL, 0.);
                                     break;
 
       case VRNA_FC_TYPE_COMPARATIVE:  alipf_create_bppm(vc, structure);
@@ -89,10 +93,100 @@ vrna_pairing_probs( vrna_fold_compound_t *vc,
   }
 }
 
-/* calculate base pairing probs */
+PUBLIC vrna_plist_t *
+vrna_pairing_probs_sparse(vrna_fold_compound_t  *vc,
+                          double                cutoff){
+
+  int           k, n, *my_iindx;
+  FLT_OR_DBL    *q;
+  vrna_plist_t  *pl;
+  vrna_mx_pf_t  *matrices;
+
+  pl = NULL;
+
+  if(vc){
+    matrices = vc->exp_matrices;
+
+    if((!matrices) || (!matrices->qb) || (!matrices->q)){
+      vrna_message_warning("vrna_pairing_probs_sparse@equilibrium_probs.c: "
+                           "partition function forward recursion has to be done first");
+      return NULL;
+    }
+
+    n         = vc->length;
+    my_iindx  = vc->iindx;
+    q         = matrices->q;
+
+    /* the auxiliary arrays are only filled by the forward recursion if pair probabilities are requested */
+    if((vc->type == VRNA_FC_TYPE_SINGLE) && (!vc->exp_params->model_details.circ) && ((!matrices->q1k) || (!matrices->qln))){
+      free(matrices->q1k);
+      free(matrices->qln);
+      matrices->q1k = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 1));
+      matrices->qln = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+
+      for(k = 1; k <= n; k++){
+        matrices->q1k[k] = q[my_iindx[1] - k];
+        matrices->qln[k] = q[my_iindx[k] - n];
+      }
+      matrices->q1k[0]      = 1.0;
+      matrices->qln[n + 1]  = 1.0;
+    }
+
+    /*
+        keep an already present dense matrix consistent. G-quadruplexes, circular
+        and concatenated sequences, and alignments are also handled by the default
+        implementation, using a temporary matrix if necessary
+    */
+    if((matrices->probs) || (vc->type != VRNA_FC_TYPE_SINGLE) || (vc->cutpoint > 0) ||
+       (vc->exp_params->model_details.gquad) || (vc->exp_params->model_details.circ)){
+      int keep = (matrices->probs) ? 1 : 0;
+
+      if(!keep)
+        matrices->probs = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((((size_t)n + 1) * (n + 2)) / 2));
+
+      vrna_pairing_probs(vc, NULL);
+      pl = vrna_plist_from_probs(vc, cutoff);
+
+      if(!keep){
+        free(matrices->probs);
+        matrices->probs = NULL;
+      }
+
+      return pl;
+    }
+
+    /*
+        the outside recursion requires the outside partition functions of all
+        enclosing pairs. Of the exterior loop matrix q, it only reads the first
+        row and the last column through q1k and qln, so we store the outside
+        partition functions in q instead of allocating another dense matrix.
+        Afterwards, row and column are restored, such that the partition
+        functions of all prefixes and suffixes remain accessible
+    */
+    matrices->probs = q;
+
+    pf_create_bppm(vc, NULL, &pl, cutoff);
+
+    matrices->probs = NULL;
+
+    for(k = 1; k <= n; k++){
+      q[my_iindx[1] - k] = matrices->q1k[k];
+      q[my_iindx[k] - n] = matrices->qln[k];
+    }
+  }
+
+  return pl;
+}
+
+/*
+    calculate base pairing probs. If pl is not NULL, the probabilities
+    of at least cutoff are written to a list instead of the probs matrix
+*/
 PRIVATE void
 pf_create_bppm( vrna_fold_compound_t *vc,
-                char *structure){
+                char *structure,
+                vrna_plist_t **pl,
+                double cutoff){
 
   int n, i,j,k,l, ij, kl, ii, u, u1, u2, cnt, ov=0;
   unsigned char type, type_2, tt;
@@ -112,7 +206,7 @@ pf_create_bppm( vrna_fold_compound_t *vc,
   vrna_hc_t         *hc;
   vrna_sc_t         *sc;
   int               *my_iindx, *jindx;
-  int               circular, turn, with_ud, with_ud_outside;
+  int               circular, turn, with_ud, with_ud_outside, parallel_outside;
   vrna_exp_param_t  *pf_params;
   vrna_mx_pf_t      *matrices;
   vrna_md_t         *md;
@@ -130,6 +224,7 @@ pf_create_bppm( vrna_fold_compound_t *vc,
   circular          = md->circ;
   with_gquad        = md->gquad;
   turn              = md->min_loop_size;
+  parallel_outside  = md->wavefront && !vrna_fold_compound_has_callbacks(vc); /* callbacks need not be thread-safe */
 
   hc                = vc->hc;
   sc                = vc->sc;
@@ -176,7 +271,7 @@ pf_create_bppm( vrna_fold_compound_t *vc,
       it introduces only little memory overhead, e.g. ~450MB for
       sequences of length 30,000
     */
-    char *hc_local = (char *)vrna_alloc(sizeof(char) * (((n + 1) * (n + 2)) /2 + 2));
+    char *hc_local = (char *)vrna_alloc(sizeof(char) * (((size_t)(n + 1) * (n + 2)) /2 + 2));
     for(i = 1; i <= n; i++)
       for(j = i; j <= n; j++)
         hc_local[my_iindx[i] - j] = hard_constraints[jindx[j] + i];
@@ -184,6 +279,7 @@ pf_create_bppm( vrna_fold_compound_t *vc,
     FLT_OR_DBL *prm_l  = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
     FLT_OR_DBL *prm_l1 = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
     FLT_OR_DBL *prml   = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
+    FLT_OR_DBL *prm_MLbk = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
 
     int         ud_max_size = 0;
     FLT_OR_DBL  **pmlu      = NULL;
@@ -237,6 +333,9 @@ pf_create_bppm( vrna_fold_compound_t *vc,
     for (l = n; l > turn + 1; l--) {
 
       /* 2. bonding k,l as substem of 2:loop enclosed by i,j */
+#ifdef _OPENMP
+#pragma omp parallel for private(kl, type_2, type, i, j, ij, u1, u2, tmp2, temp) schedule(dynamic, 16) if(parallel_outside)
+#endif
       for(k = 1; k < l - turn; k++){
         kl      = my_iindx[k]-l;
         type_2  = (unsigned char)ptype[jindx[l] + k];
@@ -339,6 +438,9 @@ pf_create_bppm( vrna_fold_compound_t *vc,
         FLT_OR_DBL qe;
 
         if(l < n - 3){
+#ifdef _OPENMP
+#pragma omp parallel for private(kl, tmp2, i, j, ij, type, u1, qe) if(parallel_outside)
+#endif
           for(k = 2; k <= l - VRNA_GQUAD_MIN_BOX_SIZE + 1; k++){
             kl = my_iindx[k]-l;
             if (G[kl]==0.) continue;
@@ -361,6 +463,9 @@ pf_create_bppm( vrna_fold_compound_t *vc,
         }
 
         if (l < n - 1){
+#ifdef _OPENMP
+#pragma omp parallel for private(kl, tmp2, i, j, ij, type, u1, u2, qe) if(parallel_outside)
+#endif
           for (k=3; k<=l-VRNA_GQUAD_MIN_BOX_SIZE + 1; k++) {
             kl = my_iindx[k]-l;
             if (G[kl]==0.) continue;
@@ -385,6 +490,9 @@ pf_create_bppm( vrna_fold_compound_t *vc,
         }
 
         if(l < n){
+#ifdef _OPENMP
+#pragma omp parallel for private(kl, tmp2, i, j, ij, type, u2, qe) if(parallel_outside)
+#endif
           for(k = 4; k <= l - VRNA_GQUAD_MIN_BOX_SIZE + 1; k++){
             kl = my_iindx[k]-l;
             if (G[kl]==0.) continue;
@@ -415,9 +523,16 @@ pf_create_bppm( vrna_fold_compound_t *vc,
           prm_MLbu[u] = 0.;
       }
 
-      if (l<n)
+      if (l<n){
+        /*
+          3.1 compute the contributions of all multiloops closed by (i, j), i = k - 1,
+          where (k, l) is the left-most stem, or where l+1 pairs with i. These are
+          independent for each i
+        */
+#ifdef _OPENMP
+#pragma omp parallel for private(i, j, ij, ii, tt, prmt, prmt1, temp, u) schedule(dynamic, 16) if(parallel_outside)
+#endif
         for (k = 2; k < l - turn; k++) {
-          kl    = my_iindx[k] - l;
           i     = k - 1;
           prmt  = prmt1 = 0.0;
 
@@ -531,6 +646,18 @@ pf_create_bppm( vrna_fold_compound_t *vc,
             if(with_ud)
               pmlu[0][i] = prmt1;
           }
+        }
+
+        /*
+          3.2 accumulate the contributions of multiloops where (k, l) is the
+          left-most stem and i, ..., k - 1 are unpaired. This is a prefix sum
+          and therefore done sequentially
+        */
+        for (k = 2; k < l - turn; k++) {
+          FLT_OR_DBL ppp;
+
+          kl  = my_iindx[k] - l;
+          i   = k - 1;
 
           /* i is unpaired */
           if(hc->up_ml[i]){
@@ -578,6 +705,8 @@ pf_create_bppm( vrna_fold_compound_t *vc,
               prm_MLbu[0] = prml[i];
           }
 
+          prm_MLbk[k] = prm_MLb;
+
           prml[i] = prml[i] + prm_l[i];
 
           tt = ptype[jindx[l] + k];
@@ -588,9 +717,30 @@ pf_create_bppm( vrna_fold_compound_t *vc,
             if (qb[kl] == 0.) continue;
           }
 
+          /* rotate prm_MLbu entries required for unstructured domain feature */
+          if(with_ud){
+            for(u = ud_max_size; u > 0; u--)
+              prm_MLbu[u] = prm_MLbu[u - 1];
+          }
+        }
+
+        /* 3.3 finally, add all multiloop contributions to (k, l) */
+#ifdef _OPENMP
+#pragma omp parallel for private(i, kl, tt, temp) schedule(dynamic, 16) if(parallel_outside)
+#endif
+        for (k = 2; k < l - turn; k++) {
+          kl  = my_iindx[k] - l;
+          tt  = ptype[jindx[l] + k];
+
+          if(with_gquad){
+            if ((!tt) && (G[kl] == 0.)) continue;
+          } else {
+            if (qb[kl] == 0.) continue;
+          }
+
           if(hc_local[kl] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP_ENC){
 
-            temp = prm_MLb;
+            temp = prm_MLbk[k];
 
             for (i=1;i<=k-2; i++)
               temp += prml[i]*qm[my_iindx[i+1] - (k-1)];
@@ -609,7 +759,21 @@ pf_create_bppm( vrna_fold_compound_t *vc,
             }
 
             probs[kl]  += temp;
+          }
+        }
 
+        /* 3.4 check for overflows */
+        for (k = 2; k < l - turn; k++) {
+          kl  = my_iindx[k] - l;
+          tt  = ptype[jindx[l] + k];
+
+          if(with_gquad){
+            if ((!tt) && (G[kl] == 0.)) continue;
+          } else {
+            if (qb[kl] == 0.) continue;
+          }
+
+          if(hc_local[kl] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP_ENC){
             if (probs[kl]>Qmax) {
               Qmax = probs[kl];
               if (Qmax>max_real/10.)
@@ -621,13 +785,8 @@ pf_create_bppm( vrna_fold_compound_t *vc,
               probs[kl]=FLT_MAX;
             }
           }
-
-          /* rotate prm_MLbu entries required for unstructured domain feature */
-          if(with_ud){
-            for(u = ud_max_size; u > 0; u--)
-              prm_MLbu[u] = prm_MLbu[u - 1];
-          }
         } /* end for (k=..) */
+      }
 
       /* rotate prm_l and prm_l1 arrays */
       tmp = prm_l1; prm_l1=prm_l; prm_l=tmp;
@@ -699,22 +858,54 @@ pf_create_bppm( vrna_fold_compound_t *vc,
     }
     free(bp_correction);
 
-    for (i=1; i<=n; i++)
-      for (j=i+turn+1; j<=n; j++) {
-        ij = my_iindx[i]-j;
+    if(pl){
+      /* write probabilities straight to the list, row by row */
+      int size = 2 * n;
 
-        if(with_gquad){
-          if (qb[ij] > 0.)
-            probs[ij] *= qb[ij];
+      cnt = 0;
+      *pl = (vrna_plist_t *)vrna_alloc(sizeof(vrna_plist_t) * (size + 1));
 
-          if (G[ij] > 0.){
-            probs[ij] += q1k[i-1] * G[ij] * qln[j+1]/q1k[n];
+      for (i=1; i<=n; i++)
+        for (j=i+turn+1; j<=n; j++) {
+          ij = my_iindx[i]-j;
+
+          if (qb[ij] > 0.){
+            temp = probs[ij] * qb[ij];
+
+            if((temp > 0.) && (temp >= (FLT_OR_DBL)cutoff)){
+              if(cnt == size){
+                size *= 2;
+                *pl = (vrna_plist_t *)vrna_realloc(*pl, sizeof(vrna_plist_t) * (size + 1));
+              }
+              (*pl)[cnt].i      = i;
+              (*pl)[cnt].j      = j;
+              (*pl)[cnt].p      = (float)temp;
+              (*pl)[cnt++].type = VRNA_PLIST_TYPE_BASEPAIR;
+            }
           }
-        } else {
-          if (qb[ij] > 0.)
-            probs[ij] *= qb[ij];
         }
-      }
+
+      (*pl)[cnt].i  = 0;
+      (*pl)[cnt].j  = 0;
+      *pl           = (vrna_plist_t *)vrna_realloc(*pl, sizeof(vrna_plist_t) * (cnt + 1));
+    } else {
+      for (i=1; i<=n; i++)
+        for (j=i+turn+1; j<=n; j++) {
+          ij = my_iindx[i]-j;
+
+          if(with_gquad){
+            if (qb[ij] > 0.)
+              probs[ij] *= qb[ij];
+
+            if (G[ij] > 0.){
+              probs[ij] += q1k[i-1] * G[ij] * qln[j+1]/q1k[n];
+            }
+          } else {
+            if (qb[ij] > 0.)
+              probs[ij] *= qb[ij];
+          }
+        }
+    }
 
     if (structure!=NULL){
       char *s = vrna_db_from_probs(probs, (unsigned int)n);
@@ -731,6 +922,7 @@ pf_create_bppm( vrna_fold_compound_t *vc,
     free(prm_l);
     free(prm_l1);
     free(prml);
+    free(prm_MLbk);
 
     if(with_ud){
       for(u = 0; u <= ud_max_size; u++)
@@ -837,7 +1029,8 @@ ud_outside_hp_loops( vrna_fold_compound_t *vc){
   FLT_OR_DBL  *q1k, *qln, temp, *scale, outside, exp_motif_en, *probs, q1, q2;
 
   vrna_sc_t   *sc;
-  vrna_ud_t   *domains_up, *ud_bak;
+  vrna_ud_t   *domains_up;
+  vrna_fold_compound_t  vc_no_ud;
 
   n           = vc->length;
   my_iindx    = vc->iindx;
@@ -849,6 +1042,13 @@ ud_outside_hp_loops( vrna_fold_compound_t *vc){
   domains_up  = vc->domains_up;
   sc          = vc->sc;
 
+  /* shallow copy of the fold compound to evaluate hairpin loops without unstructured domains */
+  vc_no_ud            = *vc;
+  vc_no_ud.domains_up = NULL;
+
+#ifdef _OPENMP
+#pragma omp parallel for private(j, k, l, kl, u, cnt, motif_list, temp, outside, exp_motif_en, q1, q2) schedule(dynamic) if(vc->exp_params->model_details.wavefront && !vrna_fold_compound_has_callbacks(vc))
+#endif
   for(i = 1; i <= n; i++){
     motif_list = vrna_ud_get_motif_size_at(vc, i, VRNA_UNSTRUCTURED_DOMAIN_HP_LOOP);
 
@@ -873,10 +1073,7 @@ ud_outside_hp_loops( vrna_fold_compound_t *vc){
               for(l = j + 1; l <= n; l++){
                 kl = my_iindx[k] - l;
                 if(probs[kl] > 0.){
-                  ud_bak          = vc->domains_up;
-                  vc->domains_up  = NULL;
-                  temp            = vrna_exp_E_hp_loop(vc, k, l);
-                  vc->domains_up  = ud_bak;
+                  temp            = vrna_exp_E_hp_loop(&vc_no_ud, k, l);
 
                   /* add contribution of motif */
                   if(temp > 0.){
@@ -906,6 +1103,9 @@ ud_outside_hp_loops( vrna_fold_compound_t *vc){
         }
 
         if(outside > 0.)
+#ifdef _OPENMP
+#pragma omp critical (ud_outside_probs_add)
+#endif
           domains_up->probs_add(vc,
                                 i, j,
                                 VRNA_UNSTRUCTURED_DOMAIN_HP_LOOP | VRNA_UNSTRUCTURED_DOMAIN_MOTIF,
@@ -1020,7 +1220,8 @@ ud_outside_int_loops( vrna_fold_compound_t *vc){
   FLT_OR_DBL  *q1k, *qln, temp, *scale, q1, q2, q3, exp_motif_en, outside,
               *probs, *qb;
   vrna_sc_t   *sc;
-  vrna_ud_t   *domains_up, *ud_bak;
+  vrna_ud_t   *domains_up;
+  vrna_fold_compound_t  vc_no_ud;
 
   n           = vc->length;
   my_iindx    = vc->iindx;
@@ -1034,6 +1235,13 @@ ud_outside_int_loops( vrna_fold_compound_t *vc){
   sc          = vc->sc;
   turn        = vc->exp_params->model_details.min_loop_size;
 
+  /* shallow copy of the fold compound to evaluate interior loops without unstructured domains */
+  vc_no_ud            = *vc;
+  vc_no_ud.domains_up = NULL;
+
+#ifdef _OPENMP
+#pragma omp parallel for private(j, k, l, p, q, pq, kl, u, cnt, motif_list, kmin, pmax, qmin, lmax, temp, q1, q2, q3, exp_motif_en, outside) schedule(dynamic) if(vc->exp_params->model_details.wavefront && !vrna_fold_compound_has_callbacks(vc))
+#endif
   for(i = 2; i <= n; i++){
     motif_list = vrna_ud_get_motif_size_at(vc, i, VRNA_UNSTRUCTURED_DOMAIN_INT_LOOP);
 
@@ -1067,10 +1275,7 @@ ud_outside_int_loops( vrna_fold_compound_t *vc){
                   for(l = q + 1; l <= lmax; l++){
                     kl = my_iindx[k] - l;
                     if(probs[kl] > 0.){
-                      ud_bak          = vc->domains_up;
-                      vc->domains_up  = NULL;
-                      temp            = vrna_exp_E_interior_loop(vc, k, l, p, q);
-                      vc->domains_up  = ud_bak;
+                      temp            = vrna_exp_E_interior_loop(&vc_no_ud, k, l, p, q);
 
                       if(temp > 0.){
                         temp *= probs[kl] * qb[pq] * exp_motif_en;
@@ -1121,10 +1326,7 @@ ud_outside_int_loops( vrna_fold_compound_t *vc){
                   for(l = j + 1; l < lmax; l++){
                     kl = my_iindx[k] - l;
                     if(probs[kl] > 0.){
-                      ud_bak          = vc->domains_up;
-                      vc->domains_up  = NULL;
-                      temp            = vrna_exp_E_interior_loop(vc, k, l, p, q);
-                      vc->domains_up  = ud_bak;
+                      temp            = vrna_exp_E_interior_loop(&vc_no_ud, k, l, p, q);
 
                       if(temp > 0.){
                         FLT_OR_DBL q1, q2, q3;
@@ -1167,6 +1369,9 @@ ud_outside_int_loops( vrna_fold_compound_t *vc){
         }
 
         if(outside > 0.)
+#ifdef _OPENMP
+#pragma omp critical (ud_outside_probs_add)
+#endif
           domains_up->probs_add(vc,
                                 i, j,
                                 VRNA_UNSTRUCTURED_DOMAIN_INT_LOOP | VRNA_UNSTRUCTURED_DOMAIN_MOTIF,
@@ -1207,7 +1412,7 @@ ud_outside_int_loops2( vrna_fold_compound_t *vc){
   sc          = vc->sc;
   turn        = vc->exp_params->model_details.min_loop_size;
 
-  hc_local = (char *)vrna_alloc(sizeof(char) * (((n + 1) * (n + 2)) /2 + 2));
+  hc_local = (char *)vrna_alloc(sizeof(char) * (((size_t)(n + 1) * (n + 2)) /2 + 2));
   for(i = 1; i <= n; i++)
     for(j = i; j <= n; j++)
       hc_local[my_iindx[i] - j] = hard_constraints[jindx[j] + i];
@@ -1368,7 +1573,7 @@ ud_outside_mb_loops(vrna_fold_compound_t *vc){
   vrna_exp_param_t  *pf_params;
   vrna_md_t         *md;
   vrna_sc_t         *sc;
-  vrna_ud_t         *domains_up, *ud_bak;
+  vrna_ud_t         *domains_up;
 
   n             = vc->length;
   S             = vc->sequence_encoding;
@@ -1396,6 +1601,9 @@ ud_outside_mb_loops(vrna_fold_compound_t *vc){
     if(ud_max_size < domains_up->uniq_motif_size[u])
       ud_max_size = domains_up->uniq_motif_size[u];
 
+#ifdef _OPENMP
+#pragma omp parallel for private(j, k, l, kl, jkl, u, cnt, motif_list, tt, up, temp, outside, exp_motif_en, qmli, exp_motif_ml_left, exp_motif_ml_right) schedule(dynamic) if(vc->exp_params->model_details.wavefront && !vrna_fold_compound_has_callbacks(vc))
+#endif
   for(i = 1; i <= n; i++){
     motif_list = vrna_ud_get_motif_size_at(vc, i, VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP);
 
@@ -1632,6 +1840,9 @@ ud_outside_mb_loops(vrna_fold_compound_t *vc){
         }
 
         if(outside > 0.)
+#ifdef _OPENMP
+#pragma omp critical (ud_outside_probs_add)
+#endif
           domains_up->probs_add(vc,
                                 i, j,
                                 VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP | VRNA_UNSTRUCTURED_DOMAIN_MOTIF,
@@ -1685,7 +1896,7 @@ ud_outside_mb_loops2(vrna_fold_compound_t *vc){
   expMLbase     = vc->exp_matrices->expMLbase;
   expMLclosing  = pf_params->expMLclosing;
 
-  hc_local = (char *)vrna_alloc(sizeof(char) * (((n + 1) * (n + 2)) /2 + 2));
+  hc_local = (char *)vrna_alloc(sizeof(char) * (((size_t)(n + 1) * (n + 2)) /2 + 2));
   for(i = 1; i <= n; i++)
     for(j = i; j <= n; j++)
       hc_local[my_iindx[i] - j] = hc[jindx[j] + i];
@@ -1988,7 +2199,7 @@ bppm_circ(vrna_fold_compound_t *vc){
   unsigned char     type;
   char              *ptype, *sequence;
   char              *hard_constraints;
-  short             *S, *S1;
+  short             *S1;
   int               n, i,j,k,l, ij, *rtype, *my_iindx, *jindx, turn;
   FLT_OR_DBL        tmp2, expMLclosing, *qb, *qm, *qm1, *probs, *scale, *expMLbase, qo;
   vrna_hc_t         *hc;
@@ -1999,7 +2210,6 @@ bppm_circ(vrna_fold_compound_t *vc){
 
   pf_params         = vc->exp_params;
   md                = &(pf_params->model_details);
-  S                 = vc->sequence_encoding2;
   S1                = vc->sequence_encoding;
   my_iindx          = vc->iindx;
   jindx             = vc->jindx;
@@ -2020,7 +2230,7 @@ bppm_circ(vrna_fold_compound_t *vc){
 
   expMLclosing  = pf_params->expMLclosing;
   rtype         = &(pf_params->model_details.rtype[0]);
-  n             = S[0];
+  n             = vc->length;
 
   switch(vc->type){
     case  VRNA_FC_TYPE_SINGLE:    numerator_f = numerator_single;
@@ -2038,7 +2248,7 @@ bppm_circ(vrna_fold_compound_t *vc){
     it introduces only little memory overhead, e.g. ~450MB for
     sequences of length 30,000
   */
-  char *hc_local = (char *)vrna_alloc(sizeof(char) * (((n + 1) * (n + 2)) /2 + 2));
+  char *hc_local = (char *)vrna_alloc(sizeof(char) * (((size_t)(n + 1) * (n + 2)) /2 + 2));
   for(i = 1; i <= n; i++)
     for(j = i; j <= n; j++)
       hc_local[my_iindx[i] - j] = hard_constraints[jindx[j] + i];
@@ -2299,6 +2509,7 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
   FLT_OR_DBL        expMLclosing  = pf_params->expMLclosing;
   FLT_OR_DBL        *probs        = matrices->probs;
   char              *hard_constraints = hc->matrix;
+  int               parallel_outside  = md->wavefront && !vrna_fold_compound_has_callbacks(vc);
 
   double kTn;
   FLT_OR_DBL pp;
@@ -2306,6 +2517,7 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
   FLT_OR_DBL *prm_l   = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
   FLT_OR_DBL *prm_l1  = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
   FLT_OR_DBL *prml    = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
+  FLT_OR_DBL *prm_MLbk  = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL)*(n+2));
   type                = (int *)vrna_alloc(sizeof(int) * n_seq);
 
   if((matrices->q1k == NULL) || (matrices->qln == NULL)){
@@ -2574,17 +2786,15 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
   for (l=n; l>TURN+1; l--) {
 
     /* 2. bonding k,l as substem of 2:loop enclosed by i,j */
+#ifdef _OPENMP
+#pragma omp parallel for private(pp, kl, s, i, j, ij) schedule(dynamic, 16) if(parallel_outside)
+#endif
     for (k=1; k<l-TURN; k++) {
       pp = 0.;
       kl = my_iindx[k]-l;
       if (qb[kl] == 0.) continue;
       if(!(hard_constraints[jindx[l] + k] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC)) continue;
 
-      for (s=0; s<n_seq; s++) {
-        type[s] = md->pair[S[s][l]][S[s][k]];
-        if (type[s]==0) type[s]=7;
-      }
-
       for (i=MAX2(1,k-MAXLOOP-1); i<=k-1; i++){
         if(hc->up_int[i+1] < k - i - 1)
           continue;
@@ -2598,11 +2808,12 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
           if(hc->up_int[l+1] < j - l - 1) break;
 
           for (s=0; s<n_seq; s++) {
-            int typ, u1, u2;
+            int typ, typ_2, u1, u2;
             u1 = a2s[s][k-1] - a2s[s][i];
             u2 = a2s[s][j-1] - a2s[s][l];
             typ = md->pair[S[s][i]][S[s][j]]; if (typ==0) typ=7;
-            qloop *=  exp_E_IntLoop(u1, u2, typ, type[s], S3[s][i], S5[s][j], S5[s][k], S3[s][l], pf_params);
+            typ_2 = md->pair[S[s][l]][S[s][k]]; if (typ_2==0) typ_2=7;
+            qloop *=  exp_E_IntLoop(u1, u2, typ, typ_2, S3[s][i], S5[s][j], S5[s][k], S3[s][l], pf_params);
           }
 
           if(sc){
@@ -2641,12 +2852,19 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
     }
     /* 3. bonding k,l as substem of multi-loop enclosed by i,j */
     prm_MLb = 0.;
-    if (l<n)
+    if (l<n){
+      /*
+        3.1 compute the contributions of all multiloops closed by (i, j), i = k - 1,
+        where (k, l) is the left-most stem, or where l+1 pairs with i. These are
+        independent for each i
+      */
+#ifdef _OPENMP
+#pragma omp parallel for private(i, ii, ll, j, s, tt, pp, prmt, prmt1) schedule(dynamic, 16) if(parallel_outside)
+#endif
       for (k=2; k<l-TURN; k++) {
-      i = k-1;
-      prmt = prmt1 = 0.;
+        i = k-1;
+        prmt = prmt1 = 0.;
 
-      if(1 /* hard_constraints[jindx[l] + k] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP_ENC */){
         ii = my_iindx[i];     /* ii-j=[i,j]     */
         ll = my_iindx[l+1];   /* ll-j=[l+1,j-1] */
         if(hard_constraints[jindx[l+1] + i] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP){
@@ -2685,7 +2903,6 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
 
           prmt +=  probs[ii-j] * pp * qm[ll-(j-1)];
         }
-        kl = my_iindx[k]-l;
 
         prml[ i] = prmt;
 
@@ -2701,6 +2918,15 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
             }
         }
         prm_l[i] = pp + prmt1; /* expMLbase[1]^n_seq */
+      }
+
+      /*
+        3.2 accumulate the contributions of multiloops where (k, l) is the
+        left-most stem and i, ..., k - 1 are unpaired. This is a prefix sum
+        and therefore done sequentially
+      */
+      for (k=2; k<l-TURN; k++) {
+        i = k-1;
 
         pp = 0.;
         if(hc->up_ml[i]){
@@ -2718,11 +2944,21 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
         /* same as:    prm_MLb = 0;
            for (i=1; i<=k-1; i++) prm_MLb += prml[i]*expMLbase[k-i-1]; */
 
+        prm_MLbk[k] = prm_MLb;
+
         prml[i] = prml[ i] + prm_l[i];
+      }
+
+      /* 3.3 finally, add all multiloop contributions to (k, l) */
+#ifdef _OPENMP
+#pragma omp parallel for private(i, kl, s, tt, temp) schedule(dynamic, 16) if(parallel_outside)
+#endif
+      for (k=2; k<l-TURN; k++) {
+        kl = my_iindx[k]-l;
 
         if (qb[kl] == 0.) continue;
 
-        temp = prm_MLb;
+        temp = prm_MLbk[k];
 
         for (i=1;i<=k-2; i++)
           temp += prml[i]*qm[my_iindx[i+1] - (k-1)];
@@ -2732,22 +2968,27 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
           temp *= exp_E_MLstem(tt, S5[s][k], S3[s][l], pf_params);
         }
         probs[kl] += temp * scale[2] * exp(pscore[jindx[l]+k]/kTn);
-      } else { /* (k,l) not allowed to be substem of multiloop closed by (i,j) */
-        prml[i] = prm_l[i] = prm_l1[i] = 0.;
       }
 
 #ifdef USE_FLOAT_PF
-      if (probs[kl]>Qmax) {
-        Qmax = probs[kl];
-        if (Qmax>FLT_MAX/10.)
-          vrna_message_warning("%d %d %g %g\n", i,j,probs[kl],qb[kl]);
-      }
-      if (probs[kl]>FLT_MAX) {
-        ov++;
-        probs[kl]=FLT_MAX;
-      }
+      /* 3.4 check for overflows */
+      for (k=2; k<l-TURN; k++) {
+        kl = my_iindx[k]-l;
+
+        if (qb[kl] == 0.) continue;
+
+        if (probs[kl]>Qmax) {
+          Qmax = probs[kl];
+          if (Qmax>FLT_MAX/10.)
+            vrna_message_warning("%d %d %g %g\n", k,l,probs[kl],qb[kl]);
+        }
+        if (probs[kl]>FLT_MAX) {
+          ov++;
+          probs[kl]=FLT_MAX;
+        }
+      } /* end for (k=2..) */
 #endif
-    } /* end for (k=2..) */
+    }
     tmp = prm_l1; prm_l1=prm_l; prm_l=tmp;
 
   }  /* end for (l=..)   */
@@ -2774,5 +3015,6 @@ alipf_create_bppm(vrna_fold_compound_t *vc,
   free(prm_l);
   free(prm_l1);
   free(prml);
+  free(prm_MLbk);
 }
 
@@ -35,6 +35,46 @@
 
 void  vrna_pairing_probs(vrna_fold_compound_t *vc, char *structure);
 
+/**
+ *  @brief  Compute base pair probabilities and return only those above a threshold
+ *
+ *  For long sequences, usually only a number of pairs linear in the sequence length
+ *  has a probability worth considering. This function runs the outside recursion on
+ *  a fold compound whose partition function has been computed by vrna_pf(), and
+ *  writes all base pairs with probability @f$ p \geq @f$ @p cutoff straight into a
+ *  list that is ordered by @f$ i @f$ and @f$ j @f$ (i.e. in compressed row order).
+ *  The resulting list can be passed to any consumer of #vrna_plist_t, e.g. MEA(),
+ *  vrna_centroid_from_plist(), or PS_dot_plot_list().
+ *
+ *  If the fold compound has been created without base pair probability support, i.e.
+ *  with #vrna_md_t.compute_bpp = 0, the dense probability matrix is never attached to
+ *  it. For linear single sequences without G-quadruplex support, the outside partition
+ *  functions are then stored in the exterior loop matrix #vrna_mx_pf_t.q, such that no
+ *  additional quadratic memory is required. Only its first row and last column, i.e.
+ *  the partition functions of all prefixes and suffixes of the sequence, remain valid
+ *  afterwards. For all other cases, as well as for fold compounds that already provide
+ *  the dense matrix, the probabilities are computed as in vrna_pairing_probs(), using a
+ *  temporary matrix if necessary, and then converted by vrna_plist_from_probs().
+ *
+ *  @code
+ *  vrna_md_t md;
+ *  vrna_md_set_default(&md);
+ *  md.compute_bpp = 0;
+ *  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+ *  vrna_pf(vc, NULL);
+ *  pl = vrna_pairing_probs_sparse(vc, 1e-3);
+ *  @endcode
+ *
+ *  @ingroup pf_fold
+ *
+ *  @see vrna_pairing_probs(), vrna_plist_from_probs()
+ *
+ *  @param  vc      The fold compound data structure with precomputed partition functions
+ *  @param  cutoff  The minimum probability of the pairs in the list
+ *  @return         A list of base pairs (terminated by an entry with @f$ i = 0 @f$), or NULL on error
+ */
+vrna_plist_t *vrna_pairing_probs_sparse(vrna_fold_compound_t *vc, double cutoff);
+
 /**
  *  @brief Get the mean base pair distance in the thermodynamic ensemble from a probability matrix
  * 
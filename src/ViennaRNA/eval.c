@@ -348,8 +348,18 @@ vrna_eval_structure_v(vrna_fold_compound_t  *vc,
                       int                   verbosity_level,
                       FILE                  *file)
 {
-  short *pt = vrna_ptable(structure);
-  float en  = wrap_eval_structure(vc, structure, pt, file, verbosity_level);
+  short *pt;
+  float en;
+
+  if (strlen(structure) > SHRT_MAX) {
+    vrna_message_warning("vrna_eval_structure_v@eval.c: "
+                         "structures longer than %d nt can not be evaluated",
+                         SHRT_MAX);
+    return (float)(INF / 100.);
+  }
+
+  pt  = vrna_ptable(structure);
+  en  = wrap_eval_structure(vc, structure, pt, file, verbosity_level);
 
   free(pt);
   return en;
@@ -363,9 +373,20 @@ vrna_eval_covar_structure(vrna_fold_compound_t  *vc,
   int   res, gq, *loop_idx;
   short *pt;
 
+  if (strlen(structure) > SHRT_MAX) {
+    vrna_message_warning("vrna_eval_covar_structure@eval.c: "
+                         "structures longer than %d nt can not be evaluated",
+                         SHRT_MAX);
+    return (float)(INF / 100.);
+  }
+
   pt                              = vrna_ptable(structure);
   res                             = 0;
   gq                              = vc->params->model_details.gquad;
+
+  if (gq) /* switching off G-quadruplexes requires private energy parameters */
+    vrna_params_detach(vc);
+
   vc->params->model_details.gquad = 0;
 
   if (vc->type == VRNA_FC_TYPE_COMPARATIVE) {
@@ -775,6 +796,10 @@ wrap_eval_structure(vrna_fold_compound_t  *vc,
 
   res                             = INF;
   gq                              = vc->params->model_details.gquad;
+
+  if (gq) /* switching off G-quadruplexes requires private energy parameters */
+    vrna_params_detach(vc);
+
   vc->params->model_details.gquad = 0;
 
   switch (vc->type) {
@@ -1464,7 +1489,7 @@ energy_of_extLoop_pt(vrna_fold_compound_t *vc,
 
             case 2:
               mm5     = (a2s[ss][p] > 1) && (tt != 0) ? S5[ss][p] : -1;
-              mm3     = (a2s[ss][q] < a2s[ss][S[0][0]]) ? S3[ss][q] : -1;                                 /* why S[0][0] ??? */
+              mm3     = (a2s[ss][q] < a2s[ss][(unsigned short)S[0][0]]) ? S3[ss][q] : -1;                                 /* why S[0][0] ??? */
               energy  += E_ExtLoop(tt, mm5, mm3, P);
               break;
 
@@ -1816,7 +1841,7 @@ energy_of_ml_pt(vrna_fold_compound_t  *vc,
                 tt = 7;
 
               mm5     = ((a2s[ss][p] > 1) || circular) ? S5[ss][p] : -1;
-              mm3     = ((a2s[ss][q] < a2s[ss][S[0][0]]) || circular) ? S3[ss][q] : -1;
+              mm3     = ((a2s[ss][q] < a2s[ss][(unsigned short)S[0][0]]) || circular) ? S3[ss][q] : -1;
               energy  += E_MLstem(tt, mm5, mm3, P);
             }
 
@@ -2562,9 +2587,11 @@ recycle_last_call(const char    *string,
     if (backward_compat_compound) {
       if (!strcmp(string, backward_compat_compound->sequence)) {
         /* check if sequence is the same as before */
-        md->window_size = (int)backward_compat_compound->length;
-        if (!memcmp(md, &(backward_compat_compound->params->model_details), sizeof(vrna_md_t))) /* check if model_details are the same as before */
-          vc = backward_compat_compound;                                                        /* re-use previous vrna_fold_compound_t */
+        /* window size is irrelevant for the same sequence, and not considered for shared parameters */
+        vrna_md_t md_tmp = *md;
+        md_tmp.window_size = backward_compat_compound->params->model_details.window_size;
+        if (!memcmp(&md_tmp, &(backward_compat_compound->params->model_details), sizeof(vrna_md_t))) /* check if model_details are the same as before */
+          vc = backward_compat_compound;                                                             /* re-use previous vrna_fold_compound_t */
       }
     }
   }
@@ -2575,8 +2602,11 @@ recycle_last_call(const char    *string,
     seq                       = vrna_cut_point_insert(string, cut_point);
     backward_compat_compound  = vc = vrna_fold_compound(seq, md, VRNA_OPTION_EVAL_ONLY);
     if (P) {
-      free(vc->params);
+      vrna_params_release(vc->params);
       vc->params = get_updated_params(P, 1);
+    } else {
+      /* the backward compatibility wrappers modify the model details in place */
+      vrna_params_detach(vc);
     }
 
     free(seq);
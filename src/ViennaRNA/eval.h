@@ -55,6 +55,8 @@ extern int  eos_debug;
  *  @endcode
  *
  *  @note Accepts vrna_fold_compound_t of type #VRNA_FC_TYPE_SINGLE and #VRNA_FC_TYPE_COMPARATIVE
+ *  @note Evaluation relies on pair tables (see vrna_ptable()). For structures longer than
+ *        SHRT_MAX nt, a warning is issued and @f$ 100000 @f$ (INF/100) is returned instead.
  *
  *  @see  vrna_eval_structure_pt(), vrna_eval_structure_verbose(), vrna_eval_structure_pt_verbose(),
  *        vrna_fold_compound(), vrna_fold_compound_comparative(), vrna_eval_covar_structure()
@@ -180,7 +180,7 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
 {
   char                      *ptype, *hc;
   short                     *S;
-  int                       en, i, j, ij, type, length, *indx, *hc_up, *f5, *c, dangle_model,
+  int                       en, i, j, ij, cij, type, length, *indx, *hc_up, *f5, dangle_model,
                             *ggg, with_gquad, turn, k, u, with_ud;
   vrna_sc_t                 *sc;
   vrna_param_t              *P;
@@ -196,7 +196,6 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
   hc_up         = vc->hc->up_ext;
   sc            = vc->sc;
   f5            = vc->matrices->f5;
-  c             = vc->matrices->c;
   P             = vc->params;
   dangle_model  = P->model_details.dangles;
   ggg           = vc->matrices->ggg;
@@ -317,18 +316,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           for (i = j - turn - 1; i > 1; i--) {
             if (f5[i - 1] != INF) {
               ij = indx[j] + i;
+              cij = vrna_mx_mfe_c(vc->matrices, indx, i, j);
 
               if (with_gquad)
                 f5[j] = MIN2(f5[j], f5[i - 1] + ggg[ij]);
 
-              if (c[ij] != INF) {
+              if (cij != INF) {
                 if (evaluate(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                   type = ptype[ij];
 
                   if (type == 0)
                     type = 7;
 
-                  en    = f5[i - 1] + c[ij] + E_ExtLoop(type, -1, -1, P);
+                  en    = f5[i - 1] + cij + E_ExtLoop(type, -1, -1, P);
                   en    += sc->f(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, sc->data);
                   f5[j] = MIN2(f5[j], en);
                 }
@@ -339,18 +339,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           for (i = j - turn - 1; i > 1; i--) {
             if (f5[i - 1] != INF) {
               ij = indx[j] + i;
+              cij = vrna_mx_mfe_c(vc->matrices, indx, i, j);
 
               if (with_gquad)
                 f5[j] = MIN2(f5[j], f5[i - 1] + ggg[ij]);
 
-              if (c[ij] != INF) {
+              if (cij != INF) {
                 if (evaluate(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                   type = ptype[ij];
 
                   if (type == 0)
                     type = 7;
 
-                  en    = f5[i - 1] + c[ij] + E_ExtLoop(type, -1, -1, P);
+                  en    = f5[i - 1] + cij + E_ExtLoop(type, -1, -1, P);
                   f5[j] = MIN2(f5[j], en);
                 }
               }
@@ -358,18 +359,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           }
         }
         ij = indx[j] + 1;
+        cij = vrna_mx_mfe_c(vc->matrices, indx, 1, j);
 
         if (with_gquad)
           f5[j] = MIN2(f5[j], ggg[ij]);
 
-        if (c[ij] != INF) {
+        if (cij != INF) {
           if (evaluate(1, j, 1, j, VRNA_DECOMP_EXT_STEM, &hc_dat_local)) {
             type = ptype[ij];
 
             if (type == 0)
               type = 7;
 
-            en = c[ij] + E_ExtLoop(type, -1, -1, P);
+            en = cij + E_ExtLoop(type, -1, -1, P);
             if (sc)
               if (sc->f)
                 en += sc->f(1, j, 1, j, VRNA_DECOMP_EXT_STEM, sc->data);
@@ -423,18 +425,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           for (i = j - turn - 1; i > 1; i--) {
             if (f5[i - 1] != INF) {
               ij = indx[j] + i;
+              cij = vrna_mx_mfe_c(vc->matrices, indx, i, j);
 
               if (with_gquad)
                 f5[j] = MIN2(f5[j], f5[i - 1] + ggg[ij]);
 
-              if (c[ij] != INF) {
+              if (cij != INF) {
                 if (evaluate(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                   type = ptype[ij];
 
                   if (type == 0)
                     type = 7;
 
-                  en    = f5[i - 1] + c[ij] + E_ExtLoop(type, S[i - 1], S[j + 1], P);
+                  en    = f5[i - 1] + cij + E_ExtLoop(type, S[i - 1], S[j + 1], P);
                   en    += sc->f(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, sc->data);
                   f5[j] = MIN2(f5[j], en);
                 }
@@ -445,18 +448,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           for (i = j - turn - 1; i > 1; i--) {
             if (f5[i - 1] != INF) {
               ij = indx[j] + i;
+              cij = vrna_mx_mfe_c(vc->matrices, indx, i, j);
 
               if (with_gquad)
                 f5[j] = MIN2(f5[j], f5[i - 1] + ggg[ij]);
 
-              if (c[ij] != INF) {
+              if (cij != INF) {
                 if (evaluate(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                   type = ptype[ij];
 
                   if (type == 0)
                     type = 7;
 
-                  en    = f5[i - 1] + c[ij] + E_ExtLoop(type, S[i - 1], S[j + 1], P);
+                  en    = f5[i - 1] + cij + E_ExtLoop(type, S[i - 1], S[j + 1], P);
                   f5[j] = MIN2(f5[j], en);
                 }
               }
@@ -464,18 +468,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           }
         }
         ij = indx[j] + 1;
+        cij = vrna_mx_mfe_c(vc->matrices, indx, 1, j);
 
         if (with_gquad)
           f5[j] = MIN2(f5[j], ggg[ij]);
 
-        if (c[ij] != INF) {
+        if (cij != INF) {
           if (evaluate(1, j, 1, j, VRNA_DECOMP_EXT_STEM, &hc_dat_local)) {
             type = ptype[ij];
 
             if (type == 0)
               type = 7;
 
-            en = c[ij] + E_ExtLoop(type, -1, S[j + 1], P);
+            en = cij + E_ExtLoop(type, -1, S[j + 1], P);
             if (sc)
               if (sc->f)
                 en += sc->f(1, j, 1, j, VRNA_DECOMP_EXT_STEM, sc->data);
@@ -524,18 +529,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
         for (i = length - turn - 1; i > 1; i--) {
           if (f5[i - 1] != INF) {
             ij = indx[length] + i;
+            cij = vrna_mx_mfe_c(vc->matrices, indx, i, length);
 
             if (with_gquad)
               f5[length] = MIN2(f5[length], f5[i - 1] + ggg[ij]);
 
-            if (c[ij] != INF) {
+            if (cij != INF) {
               if (evaluate(1, length, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                 type = ptype[ij];
 
                 if (type == 0)
                   type = 7;
 
-                en          = f5[i - 1] + c[ij] + E_ExtLoop(type, S[i - 1], -1, P);
+                en          = f5[i - 1] + cij + E_ExtLoop(type, S[i - 1], -1, P);
                 en          += sc->f(1, length, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, sc->data);
                 f5[length]  = MIN2(f5[length], en);
               }
@@ -546,18 +552,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
         for (i = length - turn - 1; i > 1; i--) {
           if (f5[i - 1] != INF) {
             ij = indx[length] + i;
+            cij = vrna_mx_mfe_c(vc->matrices, indx, i, length);
 
             if (with_gquad)
               f5[length] = MIN2(f5[length], f5[i - 1] + ggg[ij]);
 
-            if (c[ij] != INF) {
+            if (cij != INF) {
               if (evaluate(1, length, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                 type = ptype[ij];
 
                 if (type == 0)
                   type = 7;
 
-                en          = f5[i - 1] + c[ij] + E_ExtLoop(type, S[i - 1], -1, P);
+                en          = f5[i - 1] + cij + E_ExtLoop(type, S[i - 1], -1, P);
                 f5[length]  = MIN2(f5[length], en);
               }
             }
@@ -565,18 +572,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
         }
       }
       ij = indx[length] + 1;
+      cij = vrna_mx_mfe_c(vc->matrices, indx, 1, length);
 
       if (with_gquad)
         f5[length] = MIN2(f5[length], ggg[ij]);
 
-      if (c[ij] != INF) {
+      if (cij != INF) {
         if (evaluate(1, length, 1, length, VRNA_DECOMP_EXT_STEM, &hc_dat_local)) {
           type = ptype[ij];
 
           if (type == 0)
             type = 7;
 
-          en = c[ij] + E_ExtLoop(type, -1, -1, P);
+          en = cij + E_ExtLoop(type, -1, -1, P);
           if (sc)
             if (sc->f)
               en += sc->f(1, length, 1, length, VRNA_DECOMP_EXT_STEM, sc->data);
@@ -626,18 +634,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
 
         for (i = j - turn - 1; i > 1; i--) {
           ij = indx[j] + i;
+          cij = vrna_mx_mfe_c(vc->matrices, indx, i, j);
           if (f5[i - 1] != INF) {
             if (with_gquad)
               f5[j] = MIN2(f5[j], f5[i - 1] + ggg[ij]);
 
-            if (c[ij] != INF) {
+            if (cij != INF) {
               if (evaluate(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
                 type = ptype[ij];
 
                 if (type == 0)
                   type = 7;
 
-                en = f5[i - 1] + c[ij] + E_ExtLoop(type, -1, -1, P);
+                en = f5[i - 1] + cij + E_ExtLoop(type, -1, -1, P);
                 if (sc)
                   if (sc->f)
                     en += sc->f(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM, sc->data);
@@ -646,14 +655,14 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
             }
           }
 
-          if ((f5[i - 2] != INF) && c[ij] != INF) {
+          if ((f5[i - 2] != INF) && cij != INF) {
             if (evaluate(1, j, i - 2, i, VRNA_DECOMP_EXT_EXT_STEM, &hc_dat_local)) {
               type = ptype[ij];
 
               if (type == 0)
                 type = 7;
 
-              en = f5[i - 2] + c[ij] + E_ExtLoop(type, S[i - 1], -1, P);
+              en = f5[i - 2] + cij + E_ExtLoop(type, S[i - 1], -1, P);
 
               if (sc) {
                 if (sc->energy_up)
@@ -666,7 +675,8 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           }
 
           ij = indx[j - 1] + i;
-          if (c[ij] != INF) {
+          cij = vrna_mx_mfe_c(vc->matrices, indx, i, j - 1);
+          if (cij != INF) {
             if (f5[i - 1] != INF) {
               if (evaluate(1, j, i - 1, i, VRNA_DECOMP_EXT_EXT_STEM1, &hc_dat_local)) {
                 type = ptype[ij];
@@ -674,7 +684,7 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
                 if (type == 0)
                   type = 7;
 
-                en = f5[i - 1] + c[ij] + E_ExtLoop(type, -1, S[j], P);
+                en = f5[i - 1] + cij + E_ExtLoop(type, -1, S[j], P);
 
                 if (sc) {
                   if (sc->energy_up)
@@ -693,7 +703,7 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
                 if (type == 0)
                   type = 7;
 
-                en = f5[i - 2] + c[ij] + E_ExtLoop(type, S[i - 1], S[j], P);
+                en = f5[i - 2] + cij + E_ExtLoop(type, S[i - 1], S[j], P);
 
                 if (sc) {
                   if (sc->energy_up)
@@ -708,18 +718,19 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
         }
 
         ij = indx[j] + 1;
+        cij = vrna_mx_mfe_c(vc->matrices, indx, 1, j);
 
         if (with_gquad)
           f5[j] = MIN2(f5[j], ggg[ij]);
 
-        if (c[ij] != INF) {
+        if (cij != INF) {
           if (evaluate(1, j, 1, j, VRNA_DECOMP_EXT_STEM, &hc_dat_local)) {
             type = ptype[ij];
 
             if (type == 0)
               type = 7;
 
-            en = c[ij] + E_ExtLoop(type, -1, -1, P);
+            en = cij + E_ExtLoop(type, -1, -1, P);
             if (sc)
               if (sc->f)
                 en += sc->f(1, j, 1, j, VRNA_DECOMP_EXT_STEM, sc->data);
@@ -727,14 +738,15 @@ E_ext_loop_5(vrna_fold_compound_t *vc)
           }
         }
         ij = indx[j - 1] + 1;
-        if (c[ij] != INF) {
+        cij = vrna_mx_mfe_c(vc->matrices, indx, 1, j - 1);
+        if (cij != INF) {
           if (evaluate(1, j, 1, j - 1, VRNA_DECOMP_EXT_STEM, &hc_dat_local)) {
             type = ptype[ij];
 
             if (type == 0)
               type = 7;
 
-            en = c[ij] + E_ExtLoop(type, -1, S[j], P);
+            en = cij + E_ExtLoop(type, -1, S[j], P);
 
             if (sc) {
               if (sc->energy_up)
@@ -859,7 +871,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
   char                      *ptype;
   short                     mm5, mm3, *S1;
   unsigned int              *sn;
-  int                       length, fij, fi, jj, u, en, e, *my_f5, *my_c, *my_ggg, *idx,
+  int                       length, fij, fi, jj, u, en, e, *my_f5, *my_ggg, *idx,
                             dangle_model, turn, with_gquad, cnt, ii, with_ud;
   vrna_param_t              *P;
   vrna_md_t                 *md;
@@ -876,7 +888,6 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
   hc            = vc->hc;
   sc            = vc->sc;
   my_f5         = vc->matrices->f5;
-  my_c          = vc->matrices->c;
   my_ggg        = vc->matrices->ggg;
   domains_up    = vc->domains_up;
   idx           = vc->jindx;
@@ -1014,7 +1025,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
           if (type == 0)
             type = 7;
 
-          en = my_c[idx[jj] + u];
+          en = vrna_mx_mfe_c(vc->matrices, idx, u, jj);
           if (sc)
             if (sc->f)
               en += sc->f(1, jj, u - 1, u, VRNA_DECOMP_EXT_EXT_STEM, sc->data);
@@ -1051,7 +1062,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
           if (type == 0)
             type = 7;
 
-          en = my_c[idx[jj] + u];
+          en = vrna_mx_mfe_c(vc->matrices, idx, u, jj);
           if (sc)
             if (sc->f)
               en += sc->f(1, jj, u - 1, u, VRNA_DECOMP_EXT_EXT_STEM, sc->data);
@@ -1085,7 +1096,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
         if (type == 0)
           type = 7;
 
-        en = my_c[idx[jj] + 1];
+        en = vrna_mx_mfe_c(vc->matrices, idx, 1, jj);
         if (sc)
           if (sc->f)
             en += sc->f(1, jj, 1, jj, VRNA_DECOMP_EXT_STEM, sc->data);
@@ -1109,7 +1120,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
           if (type == 0)
             type = 7;
 
-          en = my_c[idx[jj - 1] + 1];
+          en = vrna_mx_mfe_c(vc->matrices, idx, 1, jj - 1);
           if (sc) {
             if (sc->energy_up)
               en += sc->energy_up[jj][1];
@@ -1144,7 +1155,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
         if (type == 0)
           type = 7;
 
-        en = my_c[idx[jj] + u];
+        en = vrna_mx_mfe_c(vc->matrices, idx, u, jj);
         if (sn[jj] != sn[u])
           en += P->DuplexInit;
 
@@ -1188,7 +1199,7 @@ vrna_BT_ext_loop_f5(vrna_fold_compound_t  *vc,
         if (type == 0)
           type = 7;
 
-        en = my_c[idx[jj - 1] + u];
+        en = vrna_mx_mfe_c(vc->matrices, idx, u, jj - 1);
         if (sn[jj - 1] != sn[u])
           en += P->DuplexInit;
 
@@ -0,0 +1,654 @@
+/*
+ *  file_formats_pU.c
+ *
+ *  Indexed binary containers for unpaired probabilities as computed by
+ *  the sliding window partition function
+ *
+ *  ViennaRNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define USE_MMAP
+#endif
+
+#include "ViennaRNA/energy_const.h"
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/file_formats_pU.h"
+
+/*
+ #################################
+ # PRIVATE MACROS                #
+ #################################
+ */
+
+#define PU_MAGIC        "VRNA_pU"
+#define PU_VERSION      1
+#define PU_BYTE_ORDER   0x01020304U
+#define PU_QUANT_ZERO   65535U
+
+/*
+ #################################
+ # STATIC DECLARATIONS           #
+ #################################
+ */
+
+/* on-disk header, 64 bytes without any padding */
+typedef struct {
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  byte_order;
+  uint32_t  precision;
+  uint32_t  num_sequences;
+  uint64_t  index_offset;
+  double    kT;
+  char      reserved[24];
+} pU_header;
+
+/* on-disk index entry, 32 bytes without any padding */
+typedef struct {
+  uint64_t  data_offset;
+  uint64_t  id_offset;
+  uint32_t  length;
+  uint32_t  ulength;
+  uint32_t  id_length;
+  uint32_t  reserved;
+} pU_index_entry;
+
+typedef struct {
+  const char    *id;
+  unsigned int  s;
+} pU_id_lookup;
+
+struct vrna_pU_writer_s {
+  FILE            *fp;
+  char            *filename;
+  char            *tmp_filename;  /* data is written here and renamed upon success */
+  int             failed;
+  unsigned int    precision;
+  double          kT;
+  uint64_t        offset;
+  pU_index_entry  *index;
+  char            **ids;
+  unsigned int    num_sequences;
+  unsigned int    max_sequences;
+};
+
+struct vrna_pU_file_s {
+  unsigned char         *data;
+  size_t                size;
+  int                   mapped;
+  unsigned int          precision;
+  unsigned int          num_sequences;
+  double                kT;
+  const pU_index_entry  *index;
+  pU_id_lookup          *lookup;
+};
+
+
+PRIVATE size_t
+value_size(unsigned int precision);
+
+
+PRIVATE uint16_t
+quantize(double p);
+
+
+PRIVATE int
+compare_ids(const void  *a,
+            const void  *b);
+
+
+PRIVATE unsigned char *
+read_file(const char  *filename,
+          size_t      *size,
+          int         *mapped);
+
+
+PRIVATE void
+release_file(unsigned char  *data,
+             size_t         size,
+             int            mapped);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC vrna_pU_writer_t *
+vrna_file_pU_writer_open(const char   *filename,
+                         unsigned int precision,
+                         double       kT)
+{
+  char              *tmp_filename;
+  FILE              *fp;
+  pU_header         header;
+  vrna_pU_writer_t  *writer;
+
+  if ((!filename) || (value_size(precision) == 0)) {
+    vrna_message_warning("vrna_file_pU_writer_open: invalid arguments");
+    return NULL;
+  }
+
+  /*
+   *  write to a temporary file first, such that an existing container is never
+   *  replaced by a truncated one
+   */
+  tmp_filename  = vrna_strdup_printf("%s.tmp", filename);
+  fp            = fopen(tmp_filename, "wb");
+  if (!fp) {
+    vrna_message_warning("vrna_file_pU_writer_open: could not open file \"%s\" for writing", tmp_filename);
+    free(tmp_filename);
+    return NULL;
+  }
+
+  /* write a preliminary header, the index offset is filled in once all data is written */
+  memset(&header, 0, sizeof(pU_header));
+  if (fwrite(&header, sizeof(pU_header), 1, fp) != 1) {
+    vrna_message_warning("vrna_file_pU_writer_open: could not write to file \"%s\"", tmp_filename);
+    fclose(fp);
+    remove(tmp_filename);
+    free(tmp_filename);
+    return NULL;
+  }
+
+  writer                = (vrna_pU_writer_t *)vrna_alloc(sizeof(vrna_pU_writer_t));
+  writer->fp            = fp;
+  writer->filename      = strdup(filename);
+  writer->tmp_filename  = tmp_filename;
+  writer->failed        = 0;
+  writer->precision     = precision;
+  writer->kT            = kT;
+  writer->offset        = sizeof(pU_header);
+  writer->index         = NULL;
+  writer->ids           = NULL;
+  writer->num_sequences = 0;
+  writer->max_sequences = 0;
+
+  return writer;
+}
+
+
+PUBLIC int
+vrna_file_pU_write(vrna_pU_writer_t *writer,
+                   const char       *id,
+                   double           **pU,
+                   int              length,
+                   int              ulength)
+{
+  unsigned char   padding[8];
+  int             i, u;
+  size_t          row_size, pad;
+  void            *row;
+  pU_index_entry  *entry;
+
+  if ((!writer) || (writer->failed) || (!pU) || (length < 1) || (ulength < 1))
+    return 0;
+
+  if (writer->num_sequences == writer->max_sequences) {
+    writer->max_sequences += 32;
+    writer->index         = (pU_index_entry *)vrna_realloc(writer->index,
+                                                           sizeof(pU_index_entry) *
+                                                           writer->max_sequences);
+    writer->ids = (char **)vrna_realloc(writer->ids, sizeof(char *) * writer->max_sequences);
+  }
+
+  row_size  = value_size(writer->precision) * ulength;
+  row       = vrna_alloc(row_size);
+
+  for (i = 1; i <= length; i++) {
+    for (u = 1; u <= ulength; u++) {
+      double p = (u <= i) ? pU[i][u] : 0.;
+      if (writer->precision == VRNA_PU_FLOAT)
+        ((float *)row)[u - 1] = (float)p;
+      else
+        ((uint16_t *)row)[u - 1] = quantize(p);
+    }
+
+    if (fwrite(row, row_size, 1, writer->fp) != 1) {
+      free(row);
+      writer->failed = 1;
+      return 0;
+    }
+  }
+
+  free(row);
+
+  /* keep each data block aligned to 8 bytes */
+  pad = (8 - (row_size * length) % 8) % 8;
+  memset(padding, 0, 8);
+  if ((pad > 0) && (fwrite(padding, pad, 1, writer->fp) != 1)) {
+    writer->failed = 1;
+    return 0;
+  }
+
+  entry               = writer->index + writer->num_sequences;
+  entry->data_offset  = writer->offset;
+  entry->id_offset    = 0;
+  entry->length       = (uint32_t)length;
+  entry->ulength      = (uint32_t)ulength;
+  entry->id_length    = (id) ? (uint32_t)strlen(id) : 0;
+  entry->reserved     = 0;
+
+  writer->ids[writer->num_sequences++]  = (id) ? strdup(id) : NULL;
+  writer->offset                        += row_size * length + pad;
+
+  return 1;
+}
+
+
+PUBLIC int
+vrna_file_pU_writer_close(vrna_pU_writer_t *writer)
+{
+  unsigned int  s;
+  int           ret;
+  uint64_t      id_offset;
+  pU_header     header;
+
+  if (!writer)
+    return 0;
+
+  /* a partially written sequence leaves the container in an inconsistent state */
+  ret = (writer->failed) ? 0 : 1;
+
+  /* identifiers are stored right after the index */
+  id_offset = writer->offset + sizeof(pU_index_entry) * writer->num_sequences;
+  for (s = 0; s < writer->num_sequences; s++) {
+    writer->index[s].id_offset  = id_offset;
+    id_offset                   += writer->index[s].id_length + 1;
+  }
+
+  if ((writer->num_sequences > 0) &&
+      (fwrite(writer->index, sizeof(pU_index_entry), writer->num_sequences, writer->fp) !=
+       writer->num_sequences))
+    ret = 0;
+
+  for (s = 0; s < writer->num_sequences; s++) {
+    if (fwrite((writer->ids[s]) ? writer->ids[s] : "", writer->index[s].id_length + 1, 1,
+               writer->fp) != 1)
+      ret = 0;
+
+    free(writer->ids[s]);
+  }
+
+  memset(&header, 0, sizeof(pU_header));
+  memcpy(header.magic, PU_MAGIC, strlen(PU_MAGIC) + 1);
+  header.version        = PU_VERSION;
+  header.byte_order     = PU_BYTE_ORDER;
+  header.precision      = writer->precision;
+  header.num_sequences  = writer->num_sequences;
+  header.index_offset   = writer->offset;
+  header.kT             = writer->kT;
+
+  if ((fseek(writer->fp, 0, SEEK_SET) != 0) ||
+      (fwrite(&header, sizeof(pU_header), 1, writer->fp) != 1))
+    ret = 0;
+
+  if (fclose(writer->fp) != 0)
+    ret = 0;
+
+  if ((ret) && (rename(writer->tmp_filename, writer->filename) != 0))
+    ret = 0;
+
+  if (!ret) {
+    vrna_message_warning("vrna_file_pU_writer_close: failed to write unpaired probability container \"%s\"",
+                         writer->filename);
+    remove(writer->tmp_filename);
+  }
+
+  free(writer->filename);
+  free(writer->tmp_filename);
+  free(writer->index);
+  free(writer->ids);
+  free(writer);
+
+  return ret;
+}
+
+
+PUBLIC vrna_pU_file_t *
+vrna_file_pU_open(const char *filename)
+{
+  unsigned char         *data;
+  unsigned int          s;
+  int                   mapped;
+  size_t                size;
+  uint64_t              num_values;
+  const pU_header       *header;
+  const pU_index_entry  *entry;
+  vrna_pU_file_t        *pU_file;
+
+  if (!filename)
+    return NULL;
+
+  data = read_file(filename, &size, &mapped);
+  if (!data)
+    return NULL;
+
+  header = (const pU_header *)data;
+
+  if ((size < sizeof(pU_header)) ||
+      (memcmp(header->magic, PU_MAGIC, strlen(PU_MAGIC) + 1) != 0)) {
+    vrna_message_warning("vrna_file_pU_open: \"%s\" is not an unpaired probability container",
+                         filename);
+    release_file(data, size, mapped);
+    return NULL;
+  }
+
+  if ((header->version != PU_VERSION) ||
+      (header->byte_order != PU_BYTE_ORDER) ||
+      (value_size(header->precision) == 0) ||
+      (header->index_offset > size) ||
+      ((size - header->index_offset) / sizeof(pU_index_entry) < header->num_sequences)) {
+    vrna_message_warning("vrna_file_pU_open: unsupported or corrupted container \"%s\"", filename);
+    release_file(data, size, mapped);
+    return NULL;
+  }
+
+  /* make sure all data blocks and identifiers are within the file */
+  entry = (const pU_index_entry *)(data + header->index_offset);
+  for (s = 0; s < header->num_sequences; s++, entry++) {
+    num_values = (uint64_t)entry->length * entry->ulength;
+    if ((entry->data_offset > size) ||
+        ((size - entry->data_offset) / value_size(header->precision) < num_values) ||
+        (entry->id_offset >= size) ||
+        (size - entry->id_offset <= entry->id_length) ||
+        (data[entry->id_offset + entry->id_length] != '\0')) {
+      vrna_message_warning("vrna_file_pU_open: corrupted index in container \"%s\"", filename);
+      release_file(data, size, mapped);
+      return NULL;
+    }
+  }
+
+  pU_file                 = (vrna_pU_file_t *)vrna_alloc(sizeof(vrna_pU_file_t));
+  pU_file->data           = data;
+  pU_file->size           = size;
+  pU_file->mapped         = mapped;
+  pU_file->precision      = header->precision;
+  pU_file->num_sequences  = header->num_sequences;
+  pU_file->kT             = header->kT;
+  pU_file->index          = (const pU_index_entry *)(data + header->index_offset);
+  pU_file->lookup         = (pU_id_lookup *)vrna_alloc(sizeof(pU_id_lookup) *
+                                                       (pU_file->num_sequences + 1));
+
+  for (s = 0; s < pU_file->num_sequences; s++) {
+    pU_file->lookup[s].id = (const char *)(data + pU_file->index[s].id_offset);
+    pU_file->lookup[s].s  = s;
+  }
+
+  qsort(pU_file->lookup, pU_file->num_sequences, sizeof(pU_id_lookup), &compare_ids);
+
+  return pU_file;
+}
+
+
+PUBLIC void
+vrna_file_pU_close(vrna_pU_file_t *pU_file)
+{
+  if (pU_file) {
+    release_file(pU_file->data, pU_file->size, pU_file->mapped);
+    free(pU_file->lookup);
+    free(pU_file);
+  }
+}
+
+
+PUBLIC unsigned int
+vrna_file_pU_size(const vrna_pU_file_t *pU_file)
+{
+  return (pU_file) ? pU_file->num_sequences : 0;
+}
+
+
+PUBLIC int
+vrna_file_pU_find(const vrna_pU_file_t  *pU_file,
+                  const char            *id)
+{
+  pU_id_lookup  key, *hit;
+
+  if ((!pU_file) || (!id))
+    return -1;
+
+  key.id  = id;
+  key.s   = 0;
+  hit     = (pU_id_lookup *)bsearch(&key,
+                                    pU_file->lookup,
+                                    pU_file->num_sequences,
+                                    sizeof(pU_id_lookup),
+                                    &compare_ids);
+
+  return (hit) ? (int)hit->s : -1;
+}
+
+
+PUBLIC const char *
+vrna_file_pU_id(const vrna_pU_file_t  *pU_file,
+                unsigned int          s)
+{
+  if ((!pU_file) || (s >= pU_file->num_sequences))
+    return NULL;
+
+  return (const char *)(pU_file->data + pU_file->index[s].id_offset);
+}
+
+
+PUBLIC int
+vrna_file_pU_length(const vrna_pU_file_t  *pU_file,
+                    unsigned int          s)
+{
+  if ((!pU_file) || (s >= pU_file->num_sequences))
+    return 0;
+
+  return (int)pU_file->index[s].length;
+}
+
+
+PUBLIC int
+vrna_file_pU_ulength(const vrna_pU_file_t *pU_file,
+                     unsigned int         s)
+{
+  if ((!pU_file) || (s >= pU_file->num_sequences))
+    return 0;
+
+  return (int)pU_file->index[s].ulength;
+}
+
+
+PUBLIC double
+vrna_file_pU_kT(const vrna_pU_file_t *pU_file)
+{
+  return (pU_file) ? pU_file->kT : 0.;
+}
+
+
+PUBLIC double
+vrna_file_pU_prob(const vrna_pU_file_t  *pU_file,
+                  unsigned int          s,
+                  int                   i,
+                  int                   u)
+{
+  size_t                k;
+  uint16_t              q;
+  const pU_index_entry  *entry;
+
+  if ((!pU_file) || (s >= pU_file->num_sequences))
+    return 0.;
+
+  entry = pU_file->index + s;
+
+  if ((i < 1) || (i > (int)entry->length) || (u < 1) || (u > (int)entry->ulength) || (u > i))
+    return 0.;
+
+  k = (size_t)(i - 1) * entry->ulength + (u - 1);
+
+  if (pU_file->precision == VRNA_PU_FLOAT)
+    return (double)((const float *)(pU_file->data + entry->data_offset))[k];
+
+  q = ((const uint16_t *)(pU_file->data + entry->data_offset))[k];
+
+  return (q == PU_QUANT_ZERO) ? 0. : exp(-(double)q / VRNA_PU_QUANT_SCALE);
+}
+
+
+PUBLIC double
+vrna_file_pU_energy(const vrna_pU_file_t  *pU_file,
+                    unsigned int          s,
+                    int                   i,
+                    int                   u)
+{
+  double p = vrna_file_pU_prob(pU_file, s, i, u);
+
+  if (p <= 0.)
+    return (double)INF / 100.;
+
+  return -log(p) * pU_file->kT;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+PRIVATE size_t
+value_size(unsigned int precision)
+{
+  switch (precision) {
+    case VRNA_PU_FLOAT:
+      return sizeof(float);
+    case VRNA_PU_UINT16:
+      return sizeof(uint16_t);
+    default:
+      return 0;
+  }
+}
+
+
+PRIVATE uint16_t
+quantize(double p)
+{
+  double v;
+
+  if (p <= 0.)
+    return PU_QUANT_ZERO;
+
+  v = rint(-log(p) * VRNA_PU_QUANT_SCALE);
+
+  if (v < 0.)     /* probabilities slightly above 1 due to rounding errors */
+    return 0;
+
+  if (v >= (double)PU_QUANT_ZERO)
+    return PU_QUANT_ZERO;
+
+  return (uint16_t)v;
+}
+
+
+PRIVATE int
+compare_ids(const void  *a,
+            const void  *b)
+{
+  return strcmp(((const pU_id_lookup *)a)->id, ((const pU_id_lookup *)b)->id);
+}
+
+
+PRIVATE unsigned char *
+read_file(const char  *filename,
+          size_t      *size,
+          int         *mapped)
+{
+  unsigned char *data;
+
+#ifdef USE_MMAP
+  int           fd;
+  struct stat   st;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    vrna_message_warning("vrna_file_pU_open: could not open file \"%s\"", filename);
+    return NULL;
+  }
+
+  if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(pU_header))) {
+    vrna_message_warning("vrna_file_pU_open: \"%s\" is not an unpaired probability container",
+                         filename);
+    close(fd);
+    return NULL;
+  }
+
+  *size = (size_t)st.st_size;
+  data  = (unsigned char *)mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    vrna_message_warning("vrna_file_pU_open: could not map file \"%s\" into memory", filename);
+    return NULL;
+  }
+
+  *mapped = 1;
+#else
+  FILE          *fp;
+  long          fsize;
+
+  fp = fopen(filename, "rb");
+  if (!fp) {
+    vrna_message_warning("vrna_file_pU_open: could not open file \"%s\"", filename);
+    return NULL;
+  }
+
+  if ((fseek(fp, 0, SEEK_END) != 0) ||
+      ((fsize = ftell(fp)) < (long)sizeof(pU_header)) ||
+      (fseek(fp, 0, SEEK_SET) != 0)) {
+    vrna_message_warning("vrna_file_pU_open: \"%s\" is not an unpaired probability container",
+                         filename);
+    fclose(fp);
+    return NULL;
+  }
+
+  *size = (size_t)fsize;
+  data  = (unsigned char *)vrna_alloc(*size);
+
+  if (fread(data, *size, 1, fp) != 1) {
+    vrna_message_warning("vrna_file_pU_open: could not read file \"%s\"", filename);
+    free(data);
+    fclose(fp);
+    return NULL;
+  }
+
+  fclose(fp);
+  *mapped = 0;
+#endif
+
+  return data;
+}
+
+
+PRIVATE void
+release_file(unsigned char  *data,
+             size_t         size,
+             int            mapped)
+{
+#ifdef USE_MMAP
+  if (mapped) {
+    munmap(data, size);
+    return;
+  }
+
+#endif
+  free(data);
+}
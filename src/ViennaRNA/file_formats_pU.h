@@ -0,0 +1,271 @@
+#ifndef VIENNA_RNA_PACKAGE_FILE_FORMATS_PU_H
+#define VIENNA_RNA_PACKAGE_FILE_FORMATS_PU_H
+
+/**
+ *  @addtogroup   file_utils
+ *
+ *  @{
+ *
+ *  @file file_formats_pU.h
+ *  @brief Functions dealing with indexed binary containers of unpaired probabilities
+ *
+ *  Computing accessibilities with RNAplfold is usually done once per target, while
+ *  programs like RNAplex query them many times. Instead of writing (and re-parsing)
+ *  one large text table per sequence, the unpaired probabilities @f$ p^u(i, u) @f$,
+ *  i.e. the probabilities that the stretch of length @f$ u @f$ ending at position
+ *  @f$ i @f$ is unpaired, of any number of sequences can be stored in a single
+ *  binary container. The container is memory mapped for reading, such that each
+ *  value can be retrieved in constant time without loading the entire file.
+ *
+ *  The container consists of
+ *  - a header of 64 bytes: the magic string @c VRNA_pU plus terminating @c '\\0',
+ *    the format version (uint32), a byte order mark 0x01020304 (uint32), the
+ *    precision of the values (uint32, see #VRNA_PU_FLOAT, #VRNA_PU_UINT16),
+ *    the number of sequences (uint32), the offset of the index (uint64),
+ *    the thermal energy @f$ kT @f$ in kcal/mol the probabilities were computed
+ *    with (double), and 24 reserved bytes,
+ *  - one data block per sequence that holds the values for positions
+ *    @f$ i = 1 \ldots n @f$ in consecutive rows of @f$ u = 1 \ldots u_{max} @f$
+ *    entries each (entries with @f$ u > i @f$ are 0), padded to a multiple of 8 bytes,
+ *  - the index with one entry of 32 bytes per sequence: the offset of the data block
+ *    (uint64), the offset of the sequence identifier (uint64), the sequence length
+ *    (uint32), the maximum length of unpaired stretches (uint32), the length of the
+ *    identifier (uint32), and 4 reserved bytes,
+ *  - the '\\0'-terminated sequence identifiers.
+ *  .
+ *  All numbers are stored in the byte order of the machine that wrote the container.
+ *
+ */
+
+/**
+ *  @brief Option flag to store unpaired probabilities as single precision floating point numbers
+ *  @see vrna_file_pU_writer_open()
+ */
+#define VRNA_PU_FLOAT   1U
+
+/**
+ *  @brief Option flag to store quantized unpaired probabilities with 16 bits per value
+ *
+ *  Each probability @f$ p @f$ is stored as @f$ \min(65535, \mathrm{round}(-\ln(p) \cdot 1024)) @f$,
+ *  i.e. with a constant relative error below 0.05%. This corresponds to an error of the opening
+ *  energies of less than 0.0003 kcal/mol at 37 degrees Celsius. The largest value 65535 denotes
+ *  a probability of 0.
+ *
+ *  @see vrna_file_pU_writer_open(), #VRNA_PU_QUANT_SCALE
+ */
+#define VRNA_PU_UINT16  2U
+
+/**
+ *  @brief The scaling factor of quantized unpaired probabilities
+ *  @see #VRNA_PU_UINT16
+ */
+#define VRNA_PU_QUANT_SCALE   1024.
+
+/**
+ *  @brief A writer for binary unpaired probability containers
+ *  @see vrna_file_pU_writer_open(), vrna_file_pU_write(), vrna_file_pU_writer_close()
+ */
+typedef struct vrna_pU_writer_s vrna_pU_writer_t;
+
+/**
+ *  @brief A (memory mapped) binary unpaired probability container opened for reading
+ *  @see vrna_file_pU_open(), vrna_file_pU_prob(), vrna_file_pU_close()
+ */
+typedef struct vrna_pU_file_s vrna_pU_file_t;
+
+
+/**
+ *  @brief Create a new binary unpaired probability container
+ *
+ *  All data is written to a temporary file next to @p filename that replaces
+ *  @p filename only once vrna_file_pU_writer_close() succeeds. If any write
+ *  fails, the temporary file is removed and an existing container is kept.
+ *
+ *  @see vrna_file_pU_write(), vrna_file_pU_writer_close(), #VRNA_PU_FLOAT, #VRNA_PU_UINT16
+ *
+ *  @param  filename  The name of the container file
+ *  @param  precision The precision of the stored values, either #VRNA_PU_FLOAT or #VRNA_PU_UINT16
+ *  @param  kT        The thermal energy in kcal/mol the probabilities are computed with
+ *  @return           A writer for the container, or NULL on error
+ */
+vrna_pU_writer_t *
+vrna_file_pU_writer_open(const char   *filename,
+                         unsigned int precision,
+                         double       kT);
+
+
+/**
+ *  @brief Append the unpaired probabilities of a sequence to a binary container
+ *
+ *  The probabilities are expected in the layout produced by pfl_fold(), i.e.
+ *  @p pU[i][u] is the probability that the stretch of length @p u ending at
+ *  position @p i is unpaired.
+ *
+ *  @see vrna_file_pU_writer_open(), pfl_fold()
+ *
+ *  @param  writer  The container writer
+ *  @param  id      The identifier of the sequence (Maybe NULL)
+ *  @param  pU      The unpaired probabilities (1-based)
+ *  @param  length  The length of the sequence
+ *  @param  ulength The maximum length of unpaired stretches in @p pU
+ *  @return         1 on success, 0 otherwise
+ */
+int
+vrna_file_pU_write(vrna_pU_writer_t *writer,
+                   const char       *id,
+                   double           **pU,
+                   int              length,
+                   int              ulength);
+
+
+/**
+ *  @brief Write the index of a binary container and close the file
+ *
+ *  On success, the container is moved to its final location. Otherwise, e.g.
+ *  if a previous call to vrna_file_pU_write() failed, the incomplete file is removed.
+ *
+ *  @param  writer  The container writer
+ *  @return         1 on success, 0 otherwise
+ */
+int
+vrna_file_pU_writer_close(vrna_pU_writer_t *writer);
+
+
+/**
+ *  @brief Open a binary unpaired probability container for reading
+ *
+ *  The file is mapped into memory (if supported by the system), such that only
+ *  the pages that are actually accessed are read from disk.
+ *
+ *  @see vrna_file_pU_close(), vrna_file_pU_find(), vrna_file_pU_prob()
+ *
+ *  @param  filename  The name of the container file
+ *  @return           The opened container, or NULL if the file could not be read or is malformed
+ */
+vrna_pU_file_t *
+vrna_file_pU_open(const char *filename);
+
+
+/**
+ *  @brief Close a binary unpaired probability container
+ *
+ *  @param  pU_file The container
+ */
+void
+vrna_file_pU_close(vrna_pU_file_t *pU_file);
+
+
+/**
+ *  @brief Get the number of sequences stored in a binary container
+ *
+ *  @param  pU_file The container
+ *  @return         The number of sequences
+ */
+unsigned int
+vrna_file_pU_size(const vrna_pU_file_t *pU_file);
+
+
+/**
+ *  @brief Find a sequence in a binary container by its identifier
+ *
+ *  @param  pU_file The container
+ *  @param  id      The sequence identifier
+ *  @return         The number of the sequence (0-based), or -1 if it is not present
+ */
+int
+vrna_file_pU_find(const vrna_pU_file_t  *pU_file,
+                  const char            *id);
+
+
+/**
+ *  @brief Get the identifier of a sequence stored in a binary container
+ *
+ *  @param  pU_file The container
+ *  @param  s       The number of the sequence (0-based)
+ *  @return         The identifier, or NULL if @p s is out of range
+ */
+const char *
+vrna_file_pU_id(const vrna_pU_file_t  *pU_file,
+                unsigned int          s);
+
+
+/**
+ *  @brief Get the length of a sequence stored in a binary container
+ *
+ *  @param  pU_file The container
+ *  @param  s       The number of the sequence (0-based)
+ *  @return         The sequence length, or 0 if @p s is out of range
+ */
+int
+vrna_file_pU_length(const vrna_pU_file_t  *pU_file,
+                    unsigned int          s);
+
+
+/**
+ *  @brief Get the maximum length of unpaired stretches of a sequence stored in a binary container
+ *
+ *  @param  pU_file The container
+ *  @param  s       The number of the sequence (0-based)
+ *  @return         The maximum length of unpaired stretches, or 0 if @p s is out of range
+ */
+int
+vrna_file_pU_ulength(const vrna_pU_file_t *pU_file,
+                     unsigned int         s);
+
+
+/**
+ *  @brief Get the thermal energy the probabilities of a binary container were computed with
+ *
+ *  @param  pU_file The container
+ *  @return         The thermal energy @f$ kT @f$ in kcal/mol
+ */
+double
+vrna_file_pU_kT(const vrna_pU_file_t *pU_file);
+
+
+/**
+ *  @brief Get the probability that a stretch of a sequence is unpaired
+ *
+ *  @see vrna_file_pU_energy()
+ *
+ *  @param  pU_file The container
+ *  @param  s       The number of the sequence (0-based)
+ *  @param  i       The last position of the stretch (1-based)
+ *  @param  u       The length of the stretch
+ *  @return         The probability that positions @f$ i - u + 1 \ldots i @f$ are unpaired,
+ *                  or 0 if any argument is out of range
+ */
+double
+vrna_file_pU_prob(const vrna_pU_file_t  *pU_file,
+                  unsigned int          s,
+                  int                   i,
+                  int                   u);
+
+
+/**
+ *  @brief Get the opening energy of a stretch of a sequence
+ *
+ *  The opening energy is computed as @f$ -kT \ln p^u(i, u) @f$ using the
+ *  thermal energy stored in the container.
+ *
+ *  @see vrna_file_pU_prob(), vrna_file_pU_kT()
+ *
+ *  @param  pU_file The container
+ *  @param  s       The number of the sequence (0-based)
+ *  @param  i       The last position of the stretch (1-based)
+ *  @param  u       The length of the stretch
+ *  @return         The opening energy in kcal/mol, or INF/100. if the stretch
+ *                  can not be unpaired or any argument is out of range
+ */
+double
+vrna_file_pU_energy(const vrna_pU_file_t  *pU_file,
+                    unsigned int          s,
+                    int                   i,
+                    int                   u);
+
+
+/**
+ * @}
+ */
+
+#endif
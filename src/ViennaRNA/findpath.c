@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include "ViennaRNA/findpath.h"
 #include "ViennaRNA/data_structures.h"
@@ -18,13 +19,12 @@
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/structure_utils.h"
+#include "ViennaRNA/eval.h"
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
-#define LOOP_EN
-
 /**
  *  @brief
  */
@@ -40,11 +40,34 @@ typedef struct move {
  */
 typedef struct intermediate {
   short *pt;      /**<  @brief  pair table */
+  short *loop;    /**<  @brief  5' position of the pair enclosing the loop of each position (0 for the exterior loop) */
   int Sen;        /**<  @brief  saddle energy so far */
   int curr_en;    /**<  @brief  current energy */
   move_t *moves;  /**<  @brief  remaining moves to target */
+  uint64_t key;   /**<  @brief  hash of the moves applied so far */
 } intermediate_t;
 
+/**
+ *  @brief  A structure one move away from an intermediate
+ */
+typedef struct candidate {
+  intermediate_t *parent; /**<  @brief  intermediate it is derived from */
+  int move;       /**<  @brief  index of the move applied to the parent */
+  int Sen;        /**<  @brief  saddle energy so far */
+  int curr_en;    /**<  @brief  current energy */
+  uint64_t key;   /**<  @brief  hash of the moves applied so far */
+} candidate_t;
+
+/**
+ *  @brief  Memory of the intermediates of one distance class
+ */
+typedef struct pool {
+  intermediate_t  *inter;
+  short           *pt;
+  short           *loop;
+  move_t          *moves;
+} pool_t;
+
 /*
 #################################
 # GLOBAL VARIABLES              #
@@ -75,11 +98,17 @@ PRIVATE vrna_fold_compound_t  *backward_compat_compound = NULL;
 # PRIVATE FUNCTION DECLARATIONS #
 #################################
 */
-PRIVATE move_t  *copy_moves(move_t *mvs);
-PRIVATE int     compare_ptable(const void *A, const void *B);
-PRIVATE int     compare_energy(const void *A, const void *B);
+PRIVATE uint64_t move_key(int m);
+PRIVATE int     compare_candidate_key(const void *A, const void *B);
+PRIVATE int     compare_candidate_energy(const void *A, const void *B);
+PRIVATE int     compare_candidate_ptable(const void *A, const void *B);
 PRIVATE int     compare_moves_when(const void *A, const void *B);
-PRIVATE void    free_intermediate(intermediate_t *i);
+PRIVATE int     same_moves(const intermediate_t *a, int ma, const intermediate_t *b, int mb, int dist);
+PRIVATE void    make_loop_table(const short *pt, short *loop);
+PRIVATE void    apply_move(short *pt, short *loop, int i, int j);
+PRIVATE int     eval_move_local(vrna_fold_compound_t *vc, short *pt, const short *loop, int m1, int m2);
+PRIVATE void    pool_init(pool_t *p, int size, int len, int dist);
+PRIVATE void    pool_free(pool_t *p);
 
 #ifdef TEST_FINDPATH
 
@@ -89,7 +118,7 @@ PRIVATE void  usage(void);
 #endif
 
 PRIVATE int     find_path_once(vrna_fold_compound_t *vc, const char *struc1, const char *struc2, int maxE, int maxl);
-PRIVATE int     try_moves(vrna_fold_compound_t *vc, intermediate_t c, int maxE, intermediate_t *next, int dist);
+PRIVATE int     try_moves(vrna_fold_compound_t *vc, intermediate_t *c, int maxE, candidate_t *next);
 
 /*
 #################################
@@ -120,7 +149,7 @@ find_saddle(const char *seq,
 
   if(backward_compat_compound){
     if(!strcmp(seq, backward_compat_compound->sequence)){ /* check if sequence is the same as before */
-      md.window_size = backward_compat_compound->length;
+      md.window_size = backward_compat_compound->params->model_details.window_size; /* not considered for shared parameters */
       if(!memcmp(&md, &(backward_compat_compound->params->model_details), sizeof(vrna_md_t))){ /* check if model_details are the same as before */
         vc = backward_compat_compound; /* re-use previous vrna_fold_compound_t */
       }
@@ -286,63 +315,41 @@ vrna_path_findpath(vrna_fold_compound_t *vc,
 
 PRIVATE int
 try_moves(vrna_fold_compound_t *vc,
-          intermediate_t c,
+          intermediate_t *c,
           int maxE,
-          intermediate_t *next,
-          int dist){
+          candidate_t *next){
 
-  int *loopidx, len, num_next=0, en, oldE;
+  int num_next=0, en, m;
   move_t *mv;
-  short *pt;
 
-  len = c.pt[0];
-  loopidx = vrna_loopidx_from_ptable(c.pt);
-  oldE = c.Sen;
-  for (mv=c.moves; mv->i!=0; mv++) {
+  for (m=0, mv=c->moves; mv->i!=0; m++, mv++) {
     int i,j;
     if (mv->when>0) continue;
     i = mv->i; j = mv->j;
-    pt = (short *) vrna_alloc(sizeof(short)*(len+1));
-    memcpy(pt, c.pt,(len+1)*sizeof(short));
-    if (j<0) { /*it's a delete move */
-      pt[-i]=0;
-      pt[-j]=0;
-    } else { /* insert move */
-      if ((loopidx[i] == loopidx[j]) && /* i and j belong to same loop */
-          (pt[i] == 0) && (pt[j]==0)     /* ... and are unpaired */
-          ) {
-        pt[i]=j;
-        pt[j]=i;
-      } else {
-        free(pt);
-        continue; /* llegal move, try next; */
-      }
-    }
-#ifdef LOOP_EN
-    en = c.curr_en + vrna_eval_move_pt(vc, c.pt, i, j);
-#else
-    en = vrna_eval_structure_pt(vc, pt);
-#endif
+    if ((j > 0) && /* insert move */
+        ((c->pt[i] != 0) || (c->pt[j] != 0) ||  /* i or j is paired */
+         (c->loop[i] != c->loop[j])))           /* i and j belong to different loops */
+      continue; /* illegal move, try next; */
+
+    en = c->curr_en + eval_move_local(vc, c->pt, c->loop, i, j);
     if (en<maxE) {
-      next[num_next].Sen = (en>oldE)?en:oldE;
-      next[num_next].curr_en = en;
-      next[num_next].pt = pt;
-      mv->when=dist;
-      mv->E = en;
-      next[num_next++].moves = copy_moves(c.moves);
-      mv->when=0;
+      next[num_next].parent   = c;
+      next[num_next].move     = m;
+      next[num_next].Sen      = (en>c->Sen)?en:c->Sen;
+      next[num_next].curr_en  = en;
+      next[num_next++].key    = c->key ^ move_key(m);
     }
-    else free(pt);
   }
-  free(loopidx);
   return num_next;
 }
 
 PRIVATE int find_path_once(vrna_fold_compound_t *vc, const char *struc1, const char *struc2, int maxE, int maxl) {
   short *pt1, *pt2;
   move_t *mlist;
-  int i, len, d, dist=0, result;
-  intermediate_t *current, *next;
+  int i, len, d, dist=0, result, num_current;
+  intermediate_t *best;
+  candidate_t *next;
+  pool_t current, successor, tmp;
 
   pt1 = vrna_ptable(struc1);
   pt2 = vrna_ptable(struc2);
@@ -366,81 +373,302 @@ PRIVATE int find_path_once(vrna_fold_compound_t *vc, const char *struc1, const c
   }
   free(pt2);
   BP_dist = dist;
-  current = (intermediate_t *) vrna_alloc(sizeof(intermediate_t)*(maxl+1));
-  current[0].pt = pt1;
-  current[0].Sen = current[0].curr_en = vrna_eval_structure_pt(vc, pt1);
-  current[0].moves = mlist;
-  next = (intermediate_t *) vrna_alloc(sizeof(intermediate_t)*(dist*maxl+1));
+
+  /*  the intermediates of two consecutive distance classes live in two pools
+      that are swapped after each step, only the candidates that survive the
+      selection get a pair table, loop table and move list of their own */
+  pool_init(&current, maxl, len, dist);
+  pool_init(&successor, maxl, len, dist);
+  next = (candidate_t *) vrna_alloc(sizeof(candidate_t)*(dist*maxl+1));
+
+  best = current.inter;
+  memcpy(best->pt, pt1, sizeof(short)*(len+1));
+  make_loop_table(best->pt, best->loop);
+  memcpy(best->moves, mlist, sizeof(move_t)*(dist+1));
+  best->Sen = best->curr_en = vrna_eval_structure_pt(vc, pt1);
+  best->key = 0;
+  num_current = 1;
+  free(pt1);
+  free(mlist);
 
   for (d=1; d<=dist; d++) { /* go through the distance classes */
-    int c, u, num_next=0;
-    intermediate_t *cc;
+    int c, u, v, num_next=0;
+
+    for (c=0; c<num_current; c++)
+      num_next += try_moves(vc, current.inter + c, maxE, next+num_next);
 
-    for (c=0; current[c].pt != NULL; c++) {
-      num_next += try_moves(vc, current[c], maxE, next+num_next, d);
-    }
     if (num_next==0) {
-      for (cc=current; cc->pt != NULL; cc++) free_intermediate(cc);
-      current[0].Sen=INT_MAX;
+      num_current = 0;
       break;
     }
-    /* remove duplicates via sort|uniq
-       if this becomes a bottleneck we can use a hash instead */
-    qsort(next, num_next, sizeof(intermediate_t),compare_ptable);
-    for (u=0,c=1; c<num_next; c++) {
-      if (memcmp(next[u].pt,next[c].pt,sizeof(short)*len)!=0) {
-        next[++u] = next[c];
-      } else {
-        free_intermediate(next+c);
-      }
+
+    /*  different orders of the same moves lead to the same intermediate,
+        keep only the one with the lowest saddle energy */
+    qsort(next, num_next, sizeof(candidate_t), compare_candidate_key);
+    for (u=0,c=0; c<num_next; c++) {
+      for (v=u-1; (v>=0) && (next[v].key==next[c].key); v--)
+        if (same_moves(next[v].parent, next[v].move,
+                       next[c].parent, next[c].move, dist))
+          break;
+      if ((v<0) || (next[v].key!=next[c].key))
+        next[u++] = next[c];
     }
-    num_next = u+1;
-    qsort(next, num_next, sizeof(intermediate_t),compare_energy);
-    /* free the old stuff */
-    for (cc=current; cc->pt != NULL; cc++) free_intermediate(cc);
+    num_next = u;
+    qsort(next, num_next, sizeof(candidate_t), compare_candidate_energy);
+    /*  candidates of equal energies are ordered by their pair tables, which
+        only matters for those we keep */
+    for (u=0; u<maxl && u<num_next; u=v) {
+      for (v=u+1; (v<num_next) && (compare_candidate_energy(next+u, next+v)==0); v++);
+      if (v-u > 1)
+        qsort(next+u, v-u, sizeof(candidate_t), compare_candidate_ptable);
+    }
+
+    /* keep the best maxl intermediates */
     for (u=0; u<maxl && u<num_next; u++) {
-      current[u] = next[u];
+      intermediate_t *p = next[u].parent;
+      intermediate_t *n = successor.inter + u;
+      move_t *mv;
+
+      memcpy(n->pt, p->pt, sizeof(short)*(len+1));
+      memcpy(n->loop, p->loop, sizeof(short)*(len+1));
+      memcpy(n->moves, p->moves, sizeof(move_t)*(dist+1));
+      mv          = n->moves + next[u].move;
+      mv->when    = d;
+      mv->E       = next[u].curr_en;
+      n->Sen      = next[u].Sen;
+      n->curr_en  = next[u].curr_en;
+      n->key      = next[u].key;
+      apply_move(n->pt, n->loop, mv->i, mv->j);
     }
-    for (; u<num_next; u++)
-      free_intermediate(next+u);
-    num_next=0;
+    num_current = u;
+
+    tmp       = current;
+    current   = successor;
+    successor = tmp;
   }
   free(next);
-  path = current[0].moves;
-  result = current[0].Sen;
-  free(current[0].pt); free(current);
+
+  if (num_current > 0) {
+    path = (move_t *) vrna_alloc(sizeof(move_t)*(dist+1));
+    memcpy(path, current.inter[0].moves, sizeof(move_t)*(dist+1));
+    result = current.inter[0].Sen;
+  } else {
+    path = NULL;
+    result = INT_MAX;
+  }
+
+  pool_free(&current);
+  pool_free(&successor);
   return(result);
 }
 
-PRIVATE void free_intermediate(intermediate_t *i) {
-   free(i->pt);
-   free(i->moves);
-   i->pt = NULL;
-   i->moves = NULL;
-   i->Sen = INT_MAX;
- }
-
-PRIVATE int compare_ptable(const void *A, const void *B) {
-  intermediate_t *a, *b;
-  int c;
-  a = (intermediate_t *) A;
-  b = (intermediate_t *) B;
-
-  c = memcmp(a->pt, b->pt, a->pt[0]*sizeof(short));
-  if (c!=0) return c;
+PRIVATE void
+pool_init(pool_t *p,
+          int size,
+          int len,
+          int dist){
+
+  int k;
+
+  p->inter  = (intermediate_t *) vrna_alloc(sizeof(intermediate_t)*size);
+  p->pt     = (short *) vrna_alloc(sizeof(short)*(len+1)*size);
+  p->loop   = (short *) vrna_alloc(sizeof(short)*(len+1)*size);
+  p->moves  = (move_t *) vrna_alloc(sizeof(move_t)*(dist+1)*size);
+
+  for (k=0; k<size; k++) {
+    p->inter[k].pt    = p->pt + k*(len+1);
+    p->inter[k].loop  = p->loop + k*(len+1);
+    p->inter[k].moves = p->moves + k*(dist+1);
+  }
+}
+
+PRIVATE void
+pool_free(pool_t *p){
+
+  free(p->inter);
+  free(p->pt);
+  free(p->loop);
+  free(p->moves);
+}
+
+/*  loop[k] is the 5' position of the pair that closes the loop k belongs to,
+    where a pair belongs to the loop it branches off */
+PRIVATE void
+make_loop_table(const short *pt,
+                short *loop){
+
+  int k, n, enclosing = 0;
+
+  n = pt[0];
+  loop[0] = n;
+  for (k=1; k<=n; k++) {
+    if (pt[k] == 0) {
+      loop[k] = enclosing;
+    } else if (pt[k] > k) {
+      loop[k] = enclosing;
+      enclosing = k;
+    } else {
+      enclosing = loop[pt[k]];
+      loop[k] = enclosing;
+    }
+  }
+}
+
+/*  insert (i,j > 0) or delete (i,j < 0) a pair and move the positions of the
+    affected loop to the loop they belong to now, the interior of substructures
+    is skipped */
+PRIVATE void
+apply_move(short *pt,
+           short *loop,
+           int i,
+           int j){
+
+  int k, enclosing;
+
+  if (i < 0) {
+    i = -i;
+    j = -j;
+    pt[i] = pt[j] = 0;
+    enclosing = loop[i];
+  } else {
+    pt[i] = j;
+    pt[j] = i;
+    enclosing = i;
+  }
+
+  for (k=i+1; k<j; k++) {
+    loop[k] = enclosing;
+    if (pt[k] > k) {
+      k = pt[k];
+      loop[k] = enclosing;
+    }
+  }
+}
+
+/*  same as vrna_eval_move_pt() but takes the enclosing pair from the
+    loop table instead of searching for it */
+PRIVATE int
+eval_move_local(vrna_fold_compound_t *vc,
+               short *pt,
+               const short *loop,
+               int m1,
+               int m2){
+
+  int en_pre, en_post, i, k, l, cp;
+
+  k   = (m1 > 0) ? m1 : -m1;
+  l   = (m2 > 0) ? m2 : -m2;
+  cp  = vc->cutpoint;
+
+  /* moves that may change the cofold penalty */
+  if ((cp > 0) && (k < cp) && (l >= cp))
+    return vrna_eval_move_pt(vc, pt, m1, m2);
+
+  i       = loop[k];
+  en_pre  = vrna_eval_loop_pt(vc, i, (const short *)pt);
+  en_post = 0;
+  if (m1 < 0) { /* delete move */
+    en_pre  += vrna_eval_loop_pt(vc, k, (const short *)pt);
+    pt[k]   = 0;
+    pt[l]   = 0;
+  } else {      /* insert move */
+    pt[k]   = l;
+    pt[l]   = k;
+    en_post += vrna_eval_loop_pt(vc, k, (const short *)pt);
+  }
+
+  en_post += vrna_eval_loop_pt(vc, i, (const short *)pt);
+
+  /* restore pair table */
+  if (m1 < 0) {
+    pt[k] = l;
+    pt[l] = k;
+  } else {
+    pt[k] = 0;
+    pt[l] = 0;
+  }
+
+  return en_post - en_pre;
+}
+
+/* random bits for move m, an intermediate is hashed by the xor over its moves */
+PRIVATE uint64_t
+move_key(int m){
+
+  uint64_t z = (uint64_t)(m + 1) * 0x9e3779b97f4a7c15ULL;
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* check whether applying move ma to a and mb to b leads to the same intermediate */
+PRIVATE int
+same_moves(const intermediate_t *a,
+           int ma,
+           const intermediate_t *b,
+           int mb,
+           int dist){
+
+  int m;
+
+  for (m=0; m<dist; m++) {
+    int in_a = (a->moves[m].when > 0) || (m == ma);
+    int in_b = (b->moves[m].when > 0) || (m == mb);
+    if (in_a != in_b)
+      return 0;
+  }
+  return 1;
+}
+
+PRIVATE int compare_candidate_key(const void *A, const void *B) {
+  const candidate_t *a, *b;
+  a = (const candidate_t *) A;
+  b = (const candidate_t *) B;
+
+  if (a->key != b->key) return (a->key < b->key) ? -1 : 1;
   if ((a->Sen - b->Sen) != 0) return (a->Sen - b->Sen);
   return (a->curr_en - b->curr_en);
 }
 
-PRIVATE int compare_energy(const void *A, const void *B) {
-  intermediate_t *a, *b;
-  a = (intermediate_t *) A;
-  b = (intermediate_t *) B;
+PRIVATE int compare_candidate_energy(const void *A, const void *B) {
+  const candidate_t *a, *b;
+  a = (const candidate_t *) A;
+  b = (const candidate_t *) B;
 
   if ((a->Sen - b->Sen) != 0) return (a->Sen - b->Sen);
   return (a->curr_en - b->curr_en);
 }
 
+/*  order candidates by their pair tables like memcmp() would, without
+    building them: the pair table of a candidate is the one of its parent
+    except for the two positions of its move */
+PRIVATE int compare_candidate_ptable(const void *A, const void *B) {
+  int k, n;
+  short x, y;
+  const candidate_t *a, *b;
+  const move_t *ma, *mb;
+
+  a   = (const candidate_t *) A;
+  b   = (const candidate_t *) B;
+
+  n   = a->parent->pt[0];
+  ma  = a->parent->moves + a->move;
+  mb  = b->parent->moves + b->move;
+
+  for (k=0; k<n; k++) {
+    x = a->parent->pt[k];
+    if (k == abs(ma->i))      x = (ma->i > 0) ? ma->j : 0;
+    else if (k == abs(ma->j)) x = (ma->i > 0) ? ma->i : 0;
+    y = b->parent->pt[k];
+    if (k == abs(mb->i))      y = (mb->i > 0) ? mb->j : 0;
+    else if (k == abs(mb->j)) y = (mb->i > 0) ? mb->i : 0;
+    if (x != y)
+      return memcmp(&x, &y, sizeof(short));
+  }
+  return 0;
+}
+
 PRIVATE int compare_moves_when(const void *A, const void *B) {
   move_t *a, *b;
   a = (move_t *) A;
@@ -449,13 +677,6 @@ PRIVATE int compare_moves_when(const void *A, const void *B) {
   return(a->when - b->when);
 }
 
-PRIVATE move_t* copy_moves(move_t *mvs) {
-  move_t *new;
-  new = (move_t *) vrna_alloc(sizeof(move_t)*(BP_dist+1));
-  memcpy(new,mvs,sizeof(move_t)*(BP_dist+1));
-  return new;
-}
-
 #ifdef TEST_FINDPATH
 
 PUBLIC void print_path(const char *seq, const char *struc) {
@@ -199,7 +199,7 @@ wrap_fold( const char *string,
   vc = vrna_fold_compound(string, &(P->model_details), VRNA_OPTION_DEFAULT);
 
   if(parameters){ /* replace params if necessary */
-    free(vc->params);
+    vrna_params_release(vc->params);
     vc->params = P;
   } else {
     free(P);
@@ -344,10 +344,10 @@ PUBLIC int *get_gquad_matrix(short *S, vrna_param_t *P){
 
   int n, size, i, j, *gg, *my_index, *data;
 
-  n         = S[0];
+  n         = (unsigned short)S[0];
   my_index  = vrna_idx_col_wise(n);
   gg        = get_g_islands(S);
-  size      = (n * (n+1))/2 + 2;
+  size      = ((size_t)n * (n + 1))/2 + 2;
   data      = (int *)vrna_alloc(sizeof(int) * size);
 
   /* prefill the upper triangular matrix with INF */
@@ -375,8 +375,8 @@ PUBLIC FLT_OR_DBL *get_gquad_pf_matrix( short *S,
   FLT_OR_DBL *data;
 
 
-  n         = S[0];
-  size      = (n * (n+1))/2 + 2;
+  n         = (unsigned short)S[0];
+  size      = ((size_t)n * (n + 1))/2 + 2;
   data      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * size);
   gg        = get_g_islands(S);
   my_index  = vrna_idx_row_wise(n);
@@ -405,8 +405,8 @@ PUBLIC int *get_gquad_ali_matrix( short *S_cons,
   int i, j, *my_index;
 
 
-  n         = S[0][0];
-  size      = (n * (n+1))/2 + 2;
+  n         = (unsigned short)S[0][0];
+  size      = ((size_t)n * (n + 1))/2 + 2;
   data      = (int *)vrna_alloc(sizeof(int) * size);
   gg        = get_g_islands(S_cons);
   my_index  = vrna_idx_col_wise(n);
@@ -651,10 +651,10 @@ PUBLIC plist *get_plist_gquad_from_pr_max(short *S,
   FLT_OR_DBL pp, *tempprobs;
   plist *pl;
   
-  n         = S[0];
-  size      = (n * (n + 1))/2 + 2;
+  n         = (unsigned short)S[0];
+  size      = ((size_t)n * (n + 1))/2 + 2;
   tempprobs = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * size);
-  pl        = (plist *)vrna_alloc((S[0]*S[0])*sizeof(plist));
+  pl        = (plist *)vrna_alloc(((size_t)n * n) * sizeof(plist));
   gg        = get_g_islands_sub(S, gi, gj);
   counter   = 0;
   my_index  = vrna_idx_row_wise(n);
@@ -1015,7 +1015,7 @@ PRIVATE void gquad_interact(int i,
 }
 
 PRIVATE INLINE int *get_g_islands(short *S){
-  return get_g_islands_sub(S, 1, S[0]);
+  return get_g_islands_sub(S, 1, (unsigned short)S[0]);
 }
 
 PRIVATE INLINE int *get_g_islands_sub(short *S, int i, int j){
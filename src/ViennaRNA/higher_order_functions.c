@@ -0,0 +1,246 @@
+/*
+ *  higher_order_functions.c
+ *
+ *  Optimized kernels for frequently used reductions in the
+ *  dynamic programming recursions, including runtime dispatch
+ *  to SIMD implementations
+ *
+ *  Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/energy_const.h"
+#include "ViennaRNA/cpu.h"
+#include "ViennaRNA/higher_order_functions.h"
+
+/*
+ #################################
+ # PRIVATE VARIABLES and STRUCTS #
+ #################################
+ */
+
+/*
+ *  SIMD implementations, compiled in separate translation units
+ *  with the respective instruction set extension enabled
+ */
+#ifdef VRNA_WITH_SSE41_IMPLEMENTATION
+int
+vrna_fun_zip_add_min_sse41(const int  *e1,
+                           const int  *e2,
+                           int        count);
+
+
+double
+vrna_fun_zip_rmul_sum_sse41(const double  *e1,
+                            const double  *e2,
+                            int           count);
+
+
+#endif
+
+#ifdef VRNA_WITH_AVX2_IMPLEMENTATION
+int
+vrna_fun_zip_add_min_avx2(const int *e1,
+                          const int *e2,
+                          int       count);
+
+
+double
+vrna_fun_zip_rmul_sum_avx2(const double *e1,
+                           const double *e2,
+                           int          count);
+
+
+#endif
+
+#ifdef VRNA_WITH_AVX512_IMPLEMENTATION
+int
+vrna_fun_zip_add_min_avx512(const int *e1,
+                            const int *e2,
+                            int       count);
+
+
+double
+vrna_fun_zip_rmul_sum_avx512(const double *e1,
+                             const double *e2,
+                             int          count);
+
+
+#endif
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+PRIVATE int
+fun_zip_add_min_default(const int *e1,
+                        const int *e2,
+                        int       count);
+
+
+PRIVATE int
+fun_zip_add_min_dispatcher(const int  *e1,
+                           const int  *e2,
+                           int        count);
+
+
+PRIVATE FLT_OR_DBL
+fun_zip_rmul_sum_default(const FLT_OR_DBL *e1,
+                         const FLT_OR_DBL *e2,
+                         int              count);
+
+
+PRIVATE FLT_OR_DBL
+fun_zip_rmul_sum_dispatcher(const FLT_OR_DBL  *e1,
+                            const FLT_OR_DBL  *e2,
+                            int               count);
+
+
+/*
+ *  The function pointers initially point to the dispatchers that replace
+ *  them upon first invocation. Concurrent first calls from several threads
+ *  are harmless since they all store the same address.
+ */
+PRIVATE int (*fun_zip_add_min)(const int *,
+                               const int *,
+                               int) = &fun_zip_add_min_dispatcher;
+
+
+PRIVATE FLT_OR_DBL (*fun_zip_rmul_sum)(const FLT_OR_DBL *,
+                                       const FLT_OR_DBL *,
+                                       int) = &fun_zip_rmul_sum_dispatcher;
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC int
+vrna_fun_zip_add_min(const int  *e1,
+                     const int  *e2,
+                     int        count)
+{
+  return (*fun_zip_add_min)(e1, e2, count);
+}
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_rmul_sum(const FLT_OR_DBL  *e1,
+                      const FLT_OR_DBL  *e2,
+                      int               count)
+{
+  return (*fun_zip_rmul_sum)(e1, e2, count);
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+PRIVATE int
+fun_zip_add_min_dispatcher(const int  *e1,
+                           const int  *e2,
+                           int        count)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+  fun_zip_add_min = &fun_zip_add_min_default;
+
+#ifdef VRNA_WITH_SSE41_IMPLEMENTATION
+  if (features & VRNA_CPU_SIMD_SSE41)
+    fun_zip_add_min = &vrna_fun_zip_add_min_sse41;
+
+#endif
+
+#ifdef VRNA_WITH_AVX2_IMPLEMENTATION
+  if (features & VRNA_CPU_SIMD_AVX2)
+    fun_zip_add_min = &vrna_fun_zip_add_min_avx2;
+
+#endif
+
+#ifdef VRNA_WITH_AVX512_IMPLEMENTATION
+  if (features & VRNA_CPU_SIMD_AVX512F)
+    fun_zip_add_min = &vrna_fun_zip_add_min_avx512;
+
+#endif
+
+  return (*fun_zip_add_min)(e1, e2, count);
+}
+
+
+PRIVATE FLT_OR_DBL
+fun_zip_rmul_sum_dispatcher(const FLT_OR_DBL  *e1,
+                            const FLT_OR_DBL  *e2,
+                            int               count)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+  fun_zip_rmul_sum = &fun_zip_rmul_sum_default;
+
+  /* vectorized implementations are available for double precision only */
+#ifndef USE_FLOAT_PF
+# ifdef VRNA_WITH_SSE41_IMPLEMENTATION
+  if (features & VRNA_CPU_SIMD_SSE41)
+    fun_zip_rmul_sum = &vrna_fun_zip_rmul_sum_sse41;
+
+# endif
+
+# ifdef VRNA_WITH_AVX2_IMPLEMENTATION
+  if (features & VRNA_CPU_SIMD_AVX2)
+    fun_zip_rmul_sum = &vrna_fun_zip_rmul_sum_avx2;
+
+# endif
+
+# ifdef VRNA_WITH_AVX512_IMPLEMENTATION
+  if (features & VRNA_CPU_SIMD_AVX512F)
+    fun_zip_rmul_sum = &vrna_fun_zip_rmul_sum_avx512;
+
+# endif
+#else
+  (void)features;
+#endif
+
+  return (*fun_zip_rmul_sum)(e1, e2, count);
+}
+
+
+PRIVATE int
+fun_zip_add_min_default(const int *e1,
+                        const int *e2,
+                        int       count)
+{
+  int i, decomp = INF;
+
+  for (i = 0; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      decomp = MIN2(decomp, en);
+    }
+  }
+
+  return decomp;
+}
+
+
+PRIVATE FLT_OR_DBL
+fun_zip_rmul_sum_default(const FLT_OR_DBL *e1,
+                         const FLT_OR_DBL *e2,
+                         int              count)
+{
+  int         i;
+  FLT_OR_DBL  sum = 0.;
+
+  for (i = 0; i < count; i++)
+    sum += e1[i] * e2[count - 1 - i];
+
+  return sum;
+}
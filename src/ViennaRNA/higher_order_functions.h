@@ -0,0 +1,71 @@
+#ifndef VIENNA_RNA_PACKAGE_HIGHER_ORDER_FUNCTIONS_H
+#define VIENNA_RNA_PACKAGE_HIGHER_ORDER_FUNCTIONS_H
+
+#include <ViennaRNA/data_structures.h>
+
+/**
+ *  @file     higher_order_functions.h
+ *  @ingroup  utils
+ *  @brief    Optimized kernels for frequently used reductions in the dynamic programming recursions
+ *
+ *  The functions in this file are dispatched at runtime to the fastest
+ *  implementation available for the host CPU, e.g. SSE4.1, AVX2, or AVX-512
+ *  (see vrna_cpu_simd_capabilities()), provided that RNAlib has been compiled
+ *  with support for the respective instruction set extension. Otherwise, a
+ *  portable scalar implementation is used.
+ */
+
+/**
+ *  @{
+ *  @ingroup   utils
+ */
+
+/**
+ *  @brief  Get the minimum pairwise sum of two integer arrays (min-plus reduction)
+ *
+ *  Computes @f$ \min_{0 \leq i < count} e_1[i] + e_2[i] @f$, where all indices
+ *  @f$ i @f$ with either @f$ e_1[i] = INF @f$ or @f$ e_2[i] = INF @f$ are skipped.
+ *  This is the classical decomposition of a multibranch loop segment into two
+ *  smaller segments, i.e. @f$ \min_k fML[i,k] + fML[k+1,j] @f$.
+ *
+ *  The result is identical for all implementations.
+ *
+ *  @param  e1    A pointer to the first array
+ *  @param  e2    A pointer to the second array
+ *  @param  count The number of elements to process
+ *  @return       The minimum sum of any two non-INF values, or INF if there is none
+ */
+int
+vrna_fun_zip_add_min(const int  *e1,
+                     const int  *e2,
+                     int        count);
+
+
+/**
+ *  @brief  Get the sum of products of two arrays where the second array is traversed in reverse order
+ *
+ *  Computes @f$ \sum_{0 \leq i < count} e_1[i] \cdot e_2[count - 1 - i] @f$, i.e.
+ *  the partition function analog of vrna_fun_zip_add_min(). The reverse
+ *  traversal of @p e2 reflects the (row-wise, backwards) memory layout of the
+ *  partition function matrices, e.g. @f$ \sum_k Q^M_{i,k-1} \cdot Q^{M1}_{k,j} @f$.
+ *
+ *  @note   Vectorized implementations accumulate partial sums in several lanes.
+ *          The result may therefore differ in the last bits from the one obtained
+ *          by the scalar implementation. For a given machine, however, the
+ *          result is always the same.
+ *
+ *  @param  e1    A pointer to the first array
+ *  @param  e2    A pointer to the second array
+ *  @param  count The number of elements to process
+ *  @return       The sum of products
+ */
+FLT_OR_DBL
+vrna_fun_zip_rmul_sum(const FLT_OR_DBL  *e1,
+                      const FLT_OR_DBL  *e2,
+                      int               count);
+
+
+/**
+ *  @}
+ */
+#endif
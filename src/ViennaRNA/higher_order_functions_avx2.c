@@ -0,0 +1,138 @@
+/*
+ *  higher_order_functions_avx2.c
+ *
+ *  AVX2 implementations of the kernels in higher_order_functions.c
+ *  This file must be compiled with AVX2 support enabled, e.g. -mavx2
+ *
+ *  Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <immintrin.h>
+
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/energy_const.h"
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+PRIVATE int
+horizontal_min_Vec8i(__m256i a);
+
+
+PRIVATE double
+horizontal_sum_Vec4d(__m256d a);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+int
+vrna_fun_zip_add_min_avx2(const int *e1,
+                          const int *e2,
+                          int       count)
+{
+  int i, decomp;
+
+  i       = 0;
+  decomp  = INF;
+
+  if (count >= 8) {
+    __m256i inf   = _mm256_set1_epi32(INF);
+    __m256i vmin  = inf;
+
+    for (; i + 7 < count; i += 8) {
+      __m256i a = _mm256_loadu_si256((__m256i *)&e1[i]);
+      __m256i b = _mm256_loadu_si256((__m256i *)&e2[i]);
+
+      /* mask out all positions where either of the two values is INF */
+      __m256i mask = _mm256_or_si256(_mm256_cmpeq_epi32(a, inf),
+                                     _mm256_cmpeq_epi32(b, inf));
+      __m256i sum = _mm256_blendv_epi8(_mm256_add_epi32(a, b), inf, mask);
+
+      vmin = _mm256_min_epi32(vmin, sum);
+    }
+
+    decomp = horizontal_min_Vec8i(vmin);
+  }
+
+  for (; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      decomp = MIN2(decomp, en);
+    }
+  }
+
+  return decomp;
+}
+
+
+double
+vrna_fun_zip_rmul_sum_avx2(const double *e1,
+                           const double *e2,
+                           int          count)
+{
+  int     i;
+  double  sum;
+
+  i   = 0;
+  sum = 0.;
+
+  if (count >= 4) {
+    __m256d vsum = _mm256_setzero_pd();
+
+    for (; i + 3 < count; i += 4) {
+      __m256d a = _mm256_loadu_pd(&e1[i]);
+      __m256d b = _mm256_loadu_pd(&e2[count - 4 - i]);
+
+      /* reverse order of second operand */
+      b     = _mm256_permute4x64_pd(b, _MM_SHUFFLE(0, 1, 2, 3));
+      vsum  = _mm256_add_pd(vsum, _mm256_mul_pd(a, b));
+    }
+
+    sum = horizontal_sum_Vec4d(vsum);
+  }
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[count - 1 - i];
+
+  return sum;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+PRIVATE int
+horizontal_min_Vec8i(__m256i a)
+{
+  __m128i tmp;
+
+  tmp = _mm_min_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+  tmp = _mm_min_epi32(tmp, _mm_shuffle_epi32(tmp, _MM_SHUFFLE(1, 0, 3, 2)));
+  tmp = _mm_min_epi32(tmp, _mm_shuffle_epi32(tmp, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(tmp);
+}
+
+
+PRIVATE double
+horizontal_sum_Vec4d(__m256d a)
+{
+  __m128d tmp;
+
+  tmp = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+  tmp = _mm_add_sd(tmp, _mm_unpackhi_pd(tmp, tmp));
+
+  return _mm_cvtsd_f64(tmp);
+}
@@ -0,0 +1,95 @@
+/*
+ *  higher_order_functions_avx512.c
+ *
+ *  AVX-512 implementations of the kernels in higher_order_functions.c
+ *  This file must be compiled with AVX-512F support enabled, e.g. -mavx512f
+ *
+ *  Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <immintrin.h>
+
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/energy_const.h"
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+int
+vrna_fun_zip_add_min_avx512(const int *e1,
+                            const int *e2,
+                            int       count)
+{
+  int i, decomp;
+
+  i       = 0;
+  decomp  = INF;
+
+  if (count >= 16) {
+    __m512i inf   = _mm512_set1_epi32(INF);
+    __m512i vmin  = inf;
+
+    for (; i + 15 < count; i += 16) {
+      __m512i a = _mm512_loadu_si512((void *)&e1[i]);
+      __m512i b = _mm512_loadu_si512((void *)&e2[i]);
+
+      /* only consider positions where both values are not INF */
+      __mmask16 mask = _mm512_cmpneq_epi32_mask(a, inf) &
+                       _mm512_cmpneq_epi32_mask(b, inf);
+
+      vmin = _mm512_mask_min_epi32(vmin, mask, vmin, _mm512_add_epi32(a, b));
+    }
+
+    decomp = _mm512_reduce_min_epi32(vmin);
+  }
+
+  for (; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      decomp = MIN2(decomp, en);
+    }
+  }
+
+  return decomp;
+}
+
+
+double
+vrna_fun_zip_rmul_sum_avx512(const double *e1,
+                             const double *e2,
+                             int          count)
+{
+  int     i;
+  double  sum;
+
+  i   = 0;
+  sum = 0.;
+
+  if (count >= 8) {
+    __m512i reverse = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    __m512d vsum    = _mm512_setzero_pd();
+
+    for (; i + 7 < count; i += 8) {
+      __m512d a = _mm512_loadu_pd(&e1[i]);
+      __m512d b = _mm512_loadu_pd(&e2[count - 8 - i]);
+
+      /* reverse order of second operand */
+      b     = _mm512_permutexvar_pd(reverse, b);
+      vsum  = _mm512_add_pd(vsum, _mm512_mul_pd(a, b));
+    }
+
+    sum = _mm512_reduce_add_pd(vsum);
+  }
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[count - 1 - i];
+
+  return sum;
+}
@@ -0,0 +1,121 @@
+/*
+ *  higher_order_functions_sse41.c
+ *
+ *  SSE4.1 implementations of the kernels in higher_order_functions.c
+ *  This file must be compiled with SSE4.1 support enabled, e.g. -msse4.1
+ *
+ *  Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <smmintrin.h>
+
+#include "ViennaRNA/utils.h"
+#include "ViennaRNA/energy_const.h"
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+PRIVATE int
+horizontal_min_Vec4i(__m128i a);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+int
+vrna_fun_zip_add_min_sse41(const int  *e1,
+                           const int  *e2,
+                           int        count)
+{
+  int i, decomp;
+
+  i       = 0;
+  decomp  = INF;
+
+  if (count >= 4) {
+    __m128i inf   = _mm_set1_epi32(INF);
+    __m128i vmin  = inf;
+
+    for (; i + 3 < count; i += 4) {
+      __m128i a = _mm_loadu_si128((__m128i *)&e1[i]);
+      __m128i b = _mm_loadu_si128((__m128i *)&e2[i]);
+
+      /* mask out all positions where either of the two values is INF */
+      __m128i mask = _mm_or_si128(_mm_cmpeq_epi32(a, inf),
+                                  _mm_cmpeq_epi32(b, inf));
+      __m128i sum = _mm_blendv_epi8(_mm_add_epi32(a, b), inf, mask);
+
+      vmin = _mm_min_epi32(vmin, sum);
+    }
+
+    decomp = horizontal_min_Vec4i(vmin);
+  }
+
+  for (; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      decomp = MIN2(decomp, en);
+    }
+  }
+
+  return decomp;
+}
+
+
+double
+vrna_fun_zip_rmul_sum_sse41(const double  *e1,
+                            const double  *e2,
+                            int           count)
+{
+  int     i;
+  double  sum;
+
+  i   = 0;
+  sum = 0.;
+
+  if (count >= 2) {
+    __m128d vsum = _mm_setzero_pd();
+
+    for (; i + 1 < count; i += 2) {
+      __m128d a = _mm_loadu_pd(&e1[i]);
+      __m128d b = _mm_loadu_pd(&e2[count - 2 - i]);
+
+      /* reverse order of second operand */
+      b     = _mm_shuffle_pd(b, b, 1);
+      vsum  = _mm_add_pd(vsum, _mm_mul_pd(a, b));
+    }
+
+    sum = _mm_cvtsd_f64(_mm_add_sd(vsum, _mm_unpackhi_pd(vsum, vsum)));
+  }
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[count - 1 - i];
+
+  return sum;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+PRIVATE int
+horizontal_min_Vec4i(__m128i a)
+{
+  __m128i tmp;
+
+  tmp = _mm_min_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+  tmp = _mm_min_epi32(tmp, _mm_shuffle_epi32(tmp, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(tmp);
+}
@@ -35,6 +35,12 @@ E_int_loop(vrna_fold_compound_t *vc,
            int                  j);
 
 
+PRIVATE int
+E_int_loop_default(vrna_fold_compound_t *vc,
+                   int                  i,
+                   int                  j);
+
+
 PRIVATE int
 E_int_loop_comparative(vrna_fold_compound_t *vc,
                        int                  i,
@@ -47,12 +53,22 @@ exp_E_int_loop(vrna_fold_compound_t *vc,
                int                  j);
 
 
+PRIVATE FLT_OR_DBL
+exp_E_int_loop_default(vrna_fold_compound_t *vc,
+                       int                  i,
+                       int                  j);
+
+
 PRIVATE FLT_OR_DBL
 exp_E_int_loop_comparative(vrna_fold_compound_t *vc,
                            int                  i,
                            int                  j);
 
 
+PRIVATE INLINE int
+is_unconstrained(vrna_fold_compound_t *vc);
+
+
 PRIVATE INLINE int
 eval_interior_loop(vrna_fold_compound_t *vc,
                    int                  i,
@@ -110,7 +126,11 @@ vrna_E_int_loop(vrna_fold_compound_t  *vc,
   if (vc) {
     switch (vc->type) {
       case VRNA_FC_TYPE_SINGLE:
-        e = E_int_loop(vc, i, j);
+        if (is_unconstrained(vc))
+          e = E_int_loop_default(vc, i, j);
+        else
+          e = E_int_loop(vc, i, j);
+
         break;
 
       case VRNA_FC_TYPE_COMPARATIVE:
@@ -133,7 +153,11 @@ vrna_exp_E_int_loop(vrna_fold_compound_t  *vc,
   if (vc) {
     switch (vc->type) {
       case VRNA_FC_TYPE_SINGLE:
-        q = exp_E_int_loop(vc, i, j);
+        if (is_unconstrained(vc))
+          q = exp_E_int_loop_default(vc, i, j);
+        else
+          q = exp_E_int_loop(vc, i, j);
+
         break;
 
       case VRNA_FC_TYPE_COMPARATIVE:
@@ -227,9 +251,9 @@ E_int_loop(vrna_fold_compound_t *vc,
   char                      *ptype, *ptype_pq, *hc_pq, *hc, eval_loop;
   short                     *S, S_i1, S_j1, *S_p1, *S_q1;
   unsigned int              *sn;
-  int                       q, p, j_q, p_i, pq, *c_pq, max_q, max_p, tmp,
+  int                       q, p, j_q, p_i, pq, max_q, max_p, tmp,
                             *rtype, noGUclosure, no_close, energy, cp, en,
-                            *indx, *hc_up, ij, hc_decompose, e, *c, *ggg,
+                            *indx, *hc_up, ij, hc_decompose, e, *ggg,
                             with_gquad, turn;
   vrna_sc_t                 *sc;
   vrna_param_t              *P;
@@ -249,7 +273,6 @@ E_int_loop(vrna_fold_compound_t *vc,
   hc_decompose  = hc[ij];
   e             = INF;
   sn            = vc->strand_number;
-  c             = vc->matrices->c;
   ggg           = vc->matrices->ggg;
   md            = &(P->model_details);
   with_gquad    = md->gquad;
@@ -299,7 +322,6 @@ E_int_loop(vrna_fold_compound_t *vc,
         max_p = MIN2(max_p, tmp);
         tmp   = i + 1 + hc_up[i + 1];
         max_p = MIN2(max_p, tmp);
-        c_pq  = c + pq;
 
         ptype_pq  = ptype + pq;
         S_p1      = S + i;
@@ -307,11 +329,17 @@ E_int_loop(vrna_fold_compound_t *vc,
 
         hc_pq = hc + pq;
 
-        for (p = i + 1; p <= max_p; p++) {
+        /*
+         *  advance all pointers in the loop header such that a 'continue'
+         *  in the loop body does not leave them behind
+         */
+        for (p = i + 1;
+             p <= max_p;
+             p++, hc_pq++, p_i++, ptype_pq++, S_p1++, pq++) {
           eval_loop = *hc_pq & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC;
           /* discard this configuration if (p,q) is not allowed to be enclosed pair of an interior loop */
           if (eval_loop && evaluate(i, j, p, q, VRNA_DECOMP_PAIR_IL, &hc_dat_local)) {
-            energy = *c_pq;
+            energy = vrna_mx_mfe_c(matrices, indx, p, q);
             if (energy != INF) {
               type_2 = rtype[(unsigned char)*ptype_pq];
 
@@ -326,14 +354,6 @@ E_int_loop(vrna_fold_compound_t *vc,
               e       = MIN2(e, energy);
             }
           }
-          hc_pq++;    /* get hc[pq + 1] */
-          c_pq++;     /* get c[pq + 1] */
-          p_i++;      /* increase unpaired region [i+1...p-1] */
-
-          ptype_pq++; /* get ptype[pq + 1] */
-          S_p1++;
-
-          pq++;
         } /* end q-loop */
       }   /* end p-loop */
     } else {
@@ -352,17 +372,22 @@ E_int_loop(vrna_fold_compound_t *vc,
         tmp   = i + 1 + hc_up[i + 1];
         max_p = MIN2(max_p, tmp);
         hc_pq = hc + pq;
-        c_pq  = c + pq;
 
         ptype_pq  = ptype + pq;
         S_p1      = S + i;
         S_q1      = S + q + 1;
 
-        for (p = i + 1; p <= max_p; p++) {
+        /*
+         *  advance all pointers in the loop header such that a 'continue'
+         *  in the loop body does not leave them behind
+         */
+        for (p = i + 1;
+             p <= max_p;
+             p++, hc_pq++, p_i++, ptype_pq++, S_p1++, pq++) {
           eval_loop = *hc_pq & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC;
           /* discard this configuration if (p,q) is not allowed to be enclosed pair of an interior loop */
           if (eval_loop && evaluate(i, j, p, q, VRNA_DECOMP_PAIR_IL, &hc_dat_local)) {
-            energy = *c_pq;
+            energy = vrna_mx_mfe_c(matrices, indx, p, q);
             if (energy != INF) {
               type_2 = rtype[(unsigned char)*ptype_pq];
 
@@ -382,14 +407,6 @@ E_int_loop(vrna_fold_compound_t *vc,
               e = MIN2(e, energy);
             }
           }
-          hc_pq++;    /* get hc[pq + 1] */
-          c_pq++;     /* get c[pq + 1] */
-          p_i++;      /* increase unpaired region [i+1...p-1] */
-
-          ptype_pq++; /* get ptype[pq + 1] */
-          S_p1++;
-
-          pq++;
         } /* end q-loop */
       }   /* end p-loop */
     }
@@ -407,6 +424,112 @@ E_int_loop(vrna_fold_compound_t *vc,
 }
 
 
+/*
+ *  Specialized variant of E_int_loop() for the most common case where
+ *  neither a hard constraint callback, soft constraints, unstructured
+ *  domains, nor multiple strands are present. This removes all indirect
+ *  function calls and the corresponding branches from the inner loops.
+ *  Keep this in sync with E_int_loop()!
+ */
+PRIVATE int
+E_int_loop_default(vrna_fold_compound_t *vc,
+                   int                  i,
+                   int                  j)
+{
+  unsigned char type, type_2;
+  char          *ptype, *hc;
+  short         *S, S_i1, S_j1;
+  int           q, p, j_q, pq, max_q, max_p, tmp, *rtype, noGUclosure, no_close,
+                energy, *indx, *hc_up, ij, e, *ggg, with_gquad, turn;
+  vrna_param_t  *P;
+  vrna_md_t     *md;
+  vrna_mx_mfe_t *matrices;
+
+  indx  = vc->jindx;
+  hc    = vc->hc->matrix;
+  ij    = indx[j] + i;
+  e     = INF;
+
+  /* CONSTRAINED INTERIOR LOOP start */
+  if (hc[ij] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP) {
+    /* prepare necessary variables */
+    hc_up       = vc->hc->up_int;
+    P           = vc->params;
+    md          = &(P->model_details);
+    matrices    = vc->matrices;
+    ggg         = vc->matrices->ggg;
+    with_gquad  = md->gquad;
+    turn        = md->min_loop_size;
+    rtype       = &(md->rtype[0]);
+    noGUclosure = md->noGUclosure;
+    max_q       = i + turn + 2;
+    max_q       = MAX2(max_q, j - MAXLOOP - 1);
+
+    ptype     = vc->ptype;
+    type      = (unsigned char)ptype[ij];
+    no_close  = (((type == 3) || (type == 4)) && noGUclosure);
+    S         = vc->sequence_encoding;
+    S_i1      = S[i + 1];
+    S_j1      = S[j - 1];
+
+    if (type == 0)
+      type = 7;
+
+    for (q = j - 1; q >= max_q; q--) {
+      j_q = j - q - 1;
+
+      if (hc_up[q + 1] < j_q)
+        break;
+
+      pq    = indx[q] + i + 1;
+      max_p = i + 1;
+      tmp   = i + 1 + MAXLOOP - j_q;
+      max_p = MAX2(max_p, tmp);
+      tmp   = q - turn;
+      max_p = MIN2(max_p, tmp);
+      tmp   = i + 1 + hc_up[i + 1];
+      max_p = MIN2(max_p, tmp);
+
+      for (p = i + 1; p <= max_p; p++, pq++) {
+        /* discard this configuration if (p,q) is not allowed to be enclosed pair of an interior loop */
+        if (!(hc[pq] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC))
+          continue;
+
+        energy = vrna_mx_mfe_c(matrices, indx, p, q);
+        if (energy == INF)
+          continue;
+
+        type_2 = rtype[(unsigned char)ptype[pq]];
+
+        if (noGUclosure)
+          if (no_close || (type_2 == 3) || (type_2 == 4))
+            if ((p > i + 1) || (q < j - 1))
+              continue;                   /* continue unless stack */
+
+        if (type_2 == 0)
+          type_2 = 7;
+
+        energy += E_IntLoop(p - i - 1, j_q,
+                            type, type_2,
+                            S_i1, S_j1, S[p - 1], S[q + 1],
+                            P);
+        e = MIN2(e, energy);
+      }
+    }
+
+    if (with_gquad) {
+      /* include all cases where a g-quadruplex may be enclosed by base pair (i,j) */
+      if (!no_close) {
+        energy  = E_GQuad_IntLoop(i, j, type, S, ggg, indx, P);
+        e       = MIN2(e, energy);
+      }
+    }
+  }
+
+  return e;
+}
+
+
 PRIVATE INLINE int
 ubf_eval_int_loop_comparative(int             col_i,
                               int             col_j,
@@ -915,6 +1038,89 @@ exp_E_int_loop(vrna_fold_compound_t *vc,
 }
 
 
+/*
+ *  Specialized variant of exp_E_int_loop() for the most common case where
+ *  neither a hard constraint callback, soft constraints, unstructured
+ *  domains, nor multiple strands are present.
+ *  Keep this in sync with exp_E_int_loop()!
+ */
+PRIVATE FLT_OR_DBL
+exp_E_int_loop_default(vrna_fold_compound_t *vc,
+                       int                  i,
+                       int                  j)
+{
+  unsigned char     type, type_2;
+  char              *ptype, *hc;
+  short             *S1, S_i1, S_j1;
+  int               k, l, u1, u2, kl, maxk, minl, *rtype, noGUclosure, no_close,
+                    *my_iindx, *jindx, *hc_up, ij, turn;
+  FLT_OR_DBL        qbt1, *qb, *scale;
+  vrna_exp_param_t  *pf_params;
+  vrna_md_t         *md;
+
+  jindx = vc->jindx;
+  hc    = vc->hc->matrix;
+  ij    = jindx[j] + i;
+  qbt1  = 0.;
+
+  /* CONSTRAINED INTERIOR LOOP start */
+  if (hc[ij] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP) {
+    ptype       = vc->ptype;
+    S1          = vc->sequence_encoding;
+    S_i1        = S1[i + 1];
+    S_j1        = S1[j - 1];
+    my_iindx    = vc->iindx;
+    hc_up       = vc->hc->up_int;
+    pf_params   = vc->exp_params;
+    md          = &(pf_params->model_details);
+    turn        = md->min_loop_size;
+    qb          = vc->exp_matrices->qb;
+    scale       = vc->exp_matrices->scale;
+    type        = (unsigned char)ptype[ij];
+    rtype       = &(md->rtype[0]);
+    noGUclosure = md->noGUclosure;
+    no_close    = (((type == 3) || (type == 4)) && noGUclosure);
+    maxk        = i + MAXLOOP + 1;
+    maxk        = MIN2(maxk, j - turn - 2);
+    maxk        = MIN2(maxk, i + 1 + hc_up[i + 1]);
+
+    if (type == 0)
+      type = 7;
+
+    for (k = i + 1; k <= maxk; k++) {
+      u1    = k - i - 1;
+      minl  = MAX2(k + turn + 1, j - 1 - MAXLOOP + u1);
+      kl    = my_iindx[k] - j + 1;
+
+      for (u2 = 0, l = j - 1; l >= minl; l--, kl++, u2++) {
+        if (hc_up[l + 1] < u2)
+          break;
+
+        /* discard this configuration if (p,q) is not allowed to be enclosed pair of an interior loop */
+        if (hc[jindx[l] + k] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC) {
+          type_2 = rtype[(unsigned char)ptype[jindx[l] + k]];
+
+          if (type_2 == 0)
+            type_2 = 7;
+
+          qbt1 += qb[kl]
+                  * scale[u1 + u2 + 2]
+                  * exp_E_IntLoop(u1, u2, type, type_2, S_i1, S_j1, S1[k - 1], S1[l + 1], pf_params);
+        }
+      }
+    }
+
+    if (md->gquad) {
+      /* include all cases where a g-quadruplex may be enclosed by base pair (i,j) */
+      if (!no_close)
+        qbt1 += exp_E_GQuad_IntLoop(i, j, type, S1, vc->exp_matrices->G, scale, my_iindx, pf_params);
+    }
+  }
+
+  return qbt1;
+}
+
+
 PUBLIC FLT_OR_DBL
 vrna_exp_E_interior_loop(vrna_fold_compound_t *vc,
                          int                  i,
@@ -1217,7 +1423,7 @@ vrna_E_ext_int_loop(vrna_fold_compound_t  *vc,
 {
   unsigned char             type, type_2;
   int                       ij, q, p, e, s, u1, u2, qmin, energy, *rtype, *types,
-                            length, *indx, *hc_up, *c, turn, n_seq;
+                            length, *indx, *hc_up, turn, n_seq;
   char                      *ptype, *hc, eval_loop;
   unsigned short            **a2s;
   short                     *S, **SS, **S5, **S3;
@@ -1230,7 +1436,6 @@ vrna_E_ext_int_loop(vrna_fold_compound_t  *vc,
   length  = vc->length;
   indx    = vc->jindx;
   ptype   = vc->ptype;
-  c       = vc->matrices->c;
   hc      = vc->hc->matrix;
   hc_up   = vc->hc->up_int;
   P       = vc->params;
@@ -1336,7 +1541,7 @@ vrna_E_ext_int_loop(vrna_fold_compound_t  *vc,
               break;
           }
 
-          energy += c[indx[q] + p];
+          energy += vrna_mx_mfe_c(vc->matrices, indx, p, q);
 
           if (energy < e) {
             e = energy;
@@ -1505,7 +1710,7 @@ vrna_BT_stack(vrna_fold_compound_t  *vc,
   unsigned char             type, type_2;
   char                      *ptype, eval_loop;
   unsigned int              *sn;
-  int                       ij, p, q, *idx, *my_c, *rtype, cp;
+  int                       ij, p, q, *idx, *rtype, cp;
   vrna_param_t              *P;
   vrna_md_t                 *md;
   vrna_hc_t                 *hc;
@@ -1520,7 +1725,6 @@ vrna_BT_stack(vrna_fold_compound_t  *vc,
   hc    = vc->hc;
   sc    = vc->sc;
   sn    = vc->strand_number;
-  my_c  = vc->matrices->c;
   ij    = idx[*j] + *i;
   ptype = vc->ptype;
   type  = (unsigned char)ptype[ij];
@@ -1536,7 +1740,7 @@ vrna_BT_stack(vrna_fold_compound_t  *vc,
     evaluate = &hc_default;
   }
 
-  if (my_c[ij] == *en) {
+  if (vrna_mx_mfe_c(vc->matrices, idx, *i, *j) == *en) {
     /*  always true, if (i.j) closes canonical structure,
      * thus (i+1.j-1) must be a pair
      */
@@ -1607,7 +1811,7 @@ vrna_BT_int_loop(vrna_fold_compound_t *vc,
   short                     *S1;
   unsigned int              *sn;
   int                       cp, ij, p, q, minq, turn, *idx, noGUclosure, no_close,
-                            energy, new, *my_c, *rtype;
+                            energy, new, *rtype;
   vrna_param_t              *P;
   vrna_md_t                 *md;
   vrna_hc_t                 *hc;
@@ -1623,7 +1827,6 @@ vrna_BT_int_loop(vrna_fold_compound_t *vc,
   hc          = vc->hc;
   sc          = vc->sc;
   sn          = vc->strand_number;
-  my_c        = vc->matrices->c;
   turn        = md->min_loop_size;
   ij          = idx[*j] + *i;
   ptype       = vc->ptype;
@@ -1676,7 +1879,7 @@ vrna_BT_int_loop(vrna_fold_compound_t *vc,
                 continue;  /* continue unless stack */
 
           energy  = eval_interior_loop(vc, *i, *j, p, q);
-          new     = energy + my_c[idx[q] + p];
+          new     = energy + vrna_mx_mfe_c(vc->matrices, idx, p, q);
 
           if (new == en) {
             bp_stack[++(*stack_count)].i  = p;
@@ -1736,7 +1939,7 @@ vrna_BT_int_loop(vrna_fold_compound_t *vc,
                                      -1,
                                      P,
                                      sc);
-          new = energy + my_c[idx[q] + p];
+          new = energy + vrna_mx_mfe_c(vc->matrices, idx, p, q);
 
           if (new == en) {
             bp_stack[++(*stack_count)].i  = p;
@@ -1804,3 +2007,19 @@ hc_default_user(int   i,
 
   return dat->hc_f(i, j, k, l, d, dat->hc_dat);
 }
+
+
+/*
+ *  Check whether a fold compound allows for the specialized
+ *  constraint-free code paths, i.e. it has no hard constraint
+ *  callback, no soft constraints, no unstructured domains, and
+ *  consists of a single strand only
+ */
+PRIVATE INLINE int
+is_unconstrained(vrna_fold_compound_t *vc)
+{
+  return (vc->hc->f == NULL) &&
+         (vc->sc == NULL) &&
+         (vc->domains_up == NULL) &&
+         (vc->cutpoint <= 0);
+}
@@ -24,6 +24,10 @@
 #include <string.h>
 #include <limits.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/energy_par.h"
 #include "ViennaRNA/data_structures.h"
@@ -34,6 +38,7 @@
 #include "ViennaRNA/structured_domains.h"
 #include "ViennaRNA/unstructured_domains.h"
 #include "ViennaRNA/loop_energies.h"
+#include "ViennaRNA/higher_order_functions.h"
 #include "ViennaRNA/mfe.h"
 
 /* make this interface backward compatible with RNAlib < 2.2.0 */
@@ -41,6 +46,14 @@
 
 #define MAXSECTORS        500     /* dimension for a backtrack array */
 
+/* number of diagonals the wavefront fill keeps in its DML and CC helper arrays */
+#define DML_DIAGONALS     5
+#define CC_DIAGONALS      3
+
+#define DML_CELL(A, stride, i, j)   (A)[(((j) - (i)) % DML_DIAGONALS) * (stride) + (i)]
+#define CC_CELL(A, stride, i, j)    (A)[(((j) - (i)) % CC_DIAGONALS) * (stride) + (i)]
+#define CC_INIT(i, length, turn)    (((i) < (length) - (turn) - 1) ? INF : 0)
+
 /*
 #################################
 # GLOBAL VARIABLES              #
@@ -59,14 +72,22 @@
 #################################
 */
 
-PRIVATE int           fill_arrays(vrna_fold_compound_t *vc);
+PRIVATE int           fill_arrays(vrna_fold_compound_t *vc, int *overflow);
 PRIVATE void          fill_arrays_circ(vrna_fold_compound_t *vc, sect bt_stack[], int *bt);
 PRIVATE void          backtrack(vrna_fold_compound_t *vc, vrna_bp_stack_t *bp_stack, sect bt_stack[], int s);
 
 PRIVATE int           fill_arrays_comparative(vrna_fold_compound_t *vc);
+PRIVATE int           fill_f5_comparative(vrna_fold_compound_t *vc);
 PRIVATE void          fill_arrays_comparative_circ(vrna_fold_compound_t *vc, sect bt_stack[], int *bt);
 PRIVATE void          backtrack_comparative(vrna_fold_compound_t *vc, vrna_bp_stack_t *bp_stack, sect bt_stack[], int s);
 
+PRIVATE INLINE int    use_wavefront(vrna_fold_compound_t *vc);
+PRIVATE int           fill_arrays_wavefront(vrna_fold_compound_t *vc);
+PRIVATE void          fill_cell_wavefront(vrna_fold_compound_t *vc, int i, int j, int *DML, int *CC, int *fmi, int *dmli, int *dmli1, int *dmli2);
+PRIVATE void          fill_cell_wavefront_comparative(vrna_fold_compound_t *vc, int i, int j, int *DML, int *CC, int *fmi, int *dmli, int *dmli1, int *dmli2);
+PRIVATE INLINE void   load_row_cache_wavefront(vrna_fold_compound_t *vc, int i, int j, int *DML, int *dmli1, int *dmli2);
+PRIVATE INLINE int    get_cc1_wavefront(vrna_fold_compound_t *vc, int i, int j, int *CC);
+
 /*
 #################################
 # BEGIN OF FUNCTION DEFINITIONS #
@@ -78,7 +99,7 @@ vrna_mfe( vrna_fold_compound_t *vc,
           char *structure){
 
   char    *ss;
-  int     length, energy, s;
+  int     length, energy, s, overflow;
   float   mfe;
   sect    bt_stack[MAXSECTORS]; /* stack of partial structures for backtracking */
   vrna_bp_stack_t   *bp;
@@ -99,14 +120,33 @@ vrna_mfe( vrna_fold_compound_t *vc,
       vc->stat_cb(VRNA_STATUS_MFE_PRE, vc->auxdata);
 
     switch(vc->type){
-      case VRNA_FC_TYPE_SINGLE:     energy = fill_arrays(vc);
+      case VRNA_FC_TYPE_SINGLE:     if(vc->matrices->type == VRNA_MX_COMPACT){
+                                      /*  the wavefront fill requires an additional full size
+                                          helper array and concurrent writes into the matrices,
+                                          so compact matrices are always filled row-wise
+                                      */
+                                      energy = fill_arrays(vc, &overflow);
+                                      if(overflow){
+                                        /* energies exceed 16-bit offset range, re-do with default matrices */
+                                        vrna_message_warning("vrna_mfe@mfe.c: Energies exceed range of compact DP matrices, falling back to default matrices");
+                                        vrna_mx_mfe_add(vc, VRNA_MX_DEFAULT, VRNA_OPTION_MFE);
+                                        energy = fill_arrays(vc, &overflow);
+                                      }
+                                    } else if(use_wavefront(vc)){
+                                      energy = fill_arrays_wavefront(vc);
+                                    } else {
+                                      energy = fill_arrays(vc, &overflow);
+                                    }
                                     if(vc->params->model_details.circ){
                                       fill_arrays_circ(vc, bt_stack, &s);
                                       energy = vc->matrices->Fc;
                                     }
                                     break;
 
-      case VRNA_FC_TYPE_COMPARATIVE:  energy = fill_arrays_comparative(vc);
+      case VRNA_FC_TYPE_COMPARATIVE:  if(use_wavefront(vc))
+                                      energy = fill_arrays_wavefront(vc);
+                                    else
+                                      energy = fill_arrays_comparative(vc);
                                     if(vc->params->model_details.circ){
                                       fill_arrays_comparative_circ(vc, bt_stack, &s);
                                       energy = vc->matrices->Fc;
@@ -130,8 +170,6 @@ vrna_mfe( vrna_fold_compound_t *vc,
         case VRNA_FC_TYPE_COMPARATIVE:  backtrack_comparative(vc, bp, bt_stack, s);
                                       break;
 
-        case VRNA_FC_TYPE_SINGLE:     /* fall through */
-
         default:                      backtrack(vc, bp, bt_stack, s);
                                       break;
       }
@@ -143,9 +181,9 @@ vrna_mfe( vrna_fold_compound_t *vc,
     }
 
     if (vc->params->model_details.backtrack_type=='C')
-      mfe = (float) vc->matrices->c[vc->jindx[length]+1]/100.;
+      mfe = (float) vrna_mx_mfe_c(vc->matrices, vc->jindx, 1, length)/100.;
     else if (vc->params->model_details.backtrack_type=='M')
-      mfe = (float) vc->matrices->fML[vc->jindx[length]+1]/100.;
+      mfe = (float) vrna_mx_mfe_fML(vc->matrices, vc->jindx, 1, length)/100.;
     else
       mfe = (float) energy/100.;
 
@@ -158,16 +196,19 @@ vrna_mfe( vrna_fold_compound_t *vc,
 
 /**
 *** fill "c", "fML" and "f5" arrays and return  optimal energy
+*** For compact matrices, overflow is set to 1 if an energy could
+*** not be stored
 **/
 PRIVATE int
-fill_arrays(vrna_fold_compound_t *vc){
+fill_arrays(vrna_fold_compound_t *vc,
+            int *overflow){
 
   unsigned char     type;
   char              *ptype, *hard_constraints;
   int               i, j, ij, length, energy, new_c, stackEnergy, no_close, turn,
                     noGUclosure, noLP, uniq_ML, dangle_model, *indx, *my_f5,
-                    *my_c, *my_fML, *my_fM1, hc_decompose, *cc, *cc1, *Fmi, *DMLi,
-                    *DMLi1, *DMLi2;
+                    *my_fM1, hc_decompose, *cc, *cc1, *Fmi, *DMLi, *DMLi1, *DMLi2,
+                    e_c, stored;
   vrna_param_t      *P;
   vrna_mx_mfe_t     *matrices;
   vrna_hc_t         *hc;
@@ -186,10 +227,9 @@ fill_arrays(vrna_fold_compound_t *vc){
   hard_constraints  = hc->matrix;
   matrices          = vc->matrices;
   my_f5             = matrices->f5;
-  my_c              = matrices->c;
-  my_fML            = matrices->fML;
   my_fM1            = matrices->fM1;
   domains_up        = vc->domains_up;
+  stored            = 1;
 
   /* allocate memory for all helper arrays */
   cc    = (int *) vrna_alloc(sizeof(int)*(length + 2)); /* auxilary arrays for canonical structures     */
@@ -213,13 +253,17 @@ fill_arrays(vrna_fold_compound_t *vc){
 
 
   /* prefill matrices with init contributions */
+  vrna_mx_mfe_compact_reset(matrices);
   for(j = 1; j <= length; j++)
     for(i = (j > turn ? (j - turn) : 1); i <= j; i++){
-      my_c[indx[j] + i] = my_fML[indx[j] + i] = INF;
+      vrna_mx_mfe_c_set(matrices, indx, i, j, INF);
+      vrna_mx_mfe_fML_set(matrices, indx, i, j, INF);
       if(uniq_ML)
         my_fM1[indx[j] + i] = INF;
     }
 
+  *overflow = 0;
+
   /* start recursion */
 
   if (length <= turn){
@@ -271,17 +315,19 @@ fill_arrays(vrna_fold_compound_t *vc){
           stackEnergy = vrna_E_stack(vc, i, j);
           new_c       = MIN2(new_c, cc1[j-1]+stackEnergy);
           cc[j]       = new_c;
-          my_c[ij]    = cc1[j-1]+stackEnergy;
+          e_c         = cc1[j-1]+stackEnergy;
         } else {
-          my_c[ij]    = new_c;
+          e_c         = new_c;
         }
       } /* end >> if (pair) << */
 
-      else my_c[ij] = INF;
+      else e_c = INF;
+
+      stored &= vrna_mx_mfe_c_set(matrices, indx, i, j, e_c);
 
       /* done with c[i,j], now compute fML[i,j] and fM1[i,j] */
 
-      my_fML[ij] = vrna_E_ml_stems_fast(vc, i, j, Fmi, DMLi);
+      stored &= vrna_mx_mfe_fML_set(matrices, indx, i, j, vrna_E_ml_stems_fast(vc, i, j, Fmi, DMLi));
 
       if(uniq_ML){  /* compute fM1 for unique decomposition */
         my_fM1[ij] = E_ml_rightmost_stem(i, j, vc);
@@ -289,6 +335,12 @@ fill_arrays(vrna_fold_compound_t *vc){
 
     } /* end of j-loop */
 
+    if(!stored){
+      /* an energy exceeds the range of the compact matrices, no need to continue */
+      *overflow = 1;
+      break;
+    }
+
     {
       int *FF; /* rotate the auxilliary arrays */
       FF = DMLi2; DMLi2 = DMLi1; DMLi1 = DMLi; DMLi = FF;
@@ -298,7 +350,8 @@ fill_arrays(vrna_fold_compound_t *vc){
   } /* end of i-loop */
 
   /* calculate energies of 5' fragments */
-  E_ext_loop_5(vc);
+  if(!*overflow)
+    E_ext_loop_5(vc);
 
   /* clean up memory */
   free(cc);
@@ -314,6 +367,7 @@ fill_arrays(vrna_fold_compound_t *vc){
 #include "circfold.inc"
 
 
+
 /**
 *** the actual forward recursion to fill the energy arrays
 **/
@@ -321,34 +375,26 @@ PRIVATE int
 fill_arrays_comparative(vrna_fold_compound_t *vc){
 
   char              *hard_constraints;
-  unsigned short    **a2s;
-  short             **S, **S5, **S3;
-  int               i, j, turn, energy, stackEnergy, new_c, s, *type, tt, *cc,
+  short             **S;
+  int               i, j, turn, energy, stackEnergy, new_c, s, *type, *cc,
                     *cc1, *Fmi, *DMLi, *DMLi1, *DMLi2, n_seq, length, *indx,
-                    *c, *f5, *fML, *ggg, *pscore, dangle_model;
+                    *c, *f5, *fML, *pscore;
   vrna_param_t      *P;
   vrna_md_t         *md;
   vrna_hc_t         *hc;
-  vrna_sc_t         **sc;
 
   n_seq             = vc->n_seq;
   length            = vc->length;
   S                 = vc->S;
-  S5                = vc->S5;             /* S5[s][i] holds next base 5' of i in sequence s */
-  S3                = vc->S3;             /* Sl[s][i] holds next base 3' of i in sequence s */
-  a2s               = vc->a2s;
   P                 = vc->params;
   md                = &(P->model_details);
   indx              = vc->jindx;          /* index for moving in the triangle matrices c[] and fMl[] */
   c                 = vc->matrices->c;    /* energy array, given that i-j pair */
   f5                = vc->matrices->f5;   /* energy of 5' end */
   fML               = vc->matrices->fML;  /* multi-loop auxiliary energy array */
-  ggg               = vc->matrices->ggg;
   pscore            = vc->pscore;         /* precomputed array of pair types */
-  dangle_model      = md->dangles;
   turn              = md->min_loop_size;
   hc                = vc->hc;
-  sc                = vc->scs;
   hard_constraints  = hc->matrix;
 
   /* allocate some memory for helper arrays */
@@ -424,7 +470,57 @@ fill_arrays_comparative(vrna_fold_compound_t *vc){
       for (j=1; j<=length; j++) {cc[j]=Fmi[j]=DMLi[j]=INF; }
     }
   } /* END for i */
-  /* calculate energies of 5' and 3' fragments */
+  /* calculate energies of 5' fragments */
+  fill_f5_comparative(vc);
+
+  free(type);
+  free(cc);
+  free(cc1);
+  free(Fmi);
+  free(DMLi);
+  free(DMLi1);
+  free(DMLi2);
+  return(f5[length]);
+}
+
+
+/**
+*** fill the "f5" array of a comparative fold compound once the
+*** "c" and "fML" arrays are available, and return the optimal energy
+**/
+PRIVATE int
+fill_f5_comparative(vrna_fold_compound_t *vc){
+
+  char              *hard_constraints;
+  unsigned short    **a2s;
+  short             **S, **S5, **S3;
+  int               i, j, turn, energy, s, tt, n_seq, length, *indx,
+                    *c, *f5, *ggg, dangle_model;
+  vrna_param_t      *P;
+  vrna_md_t         *md;
+  vrna_hc_t         *hc;
+  vrna_sc_t         **sc;
+
+  n_seq             = vc->n_seq;
+  length            = vc->length;
+  S                 = vc->S;
+  S5                = vc->S5;
+  S3                = vc->S3;
+  a2s               = vc->a2s;
+  P                 = vc->params;
+  md                = &(P->model_details);
+  indx              = vc->jindx;
+  c                 = vc->matrices->c;
+  f5                = vc->matrices->f5;
+  ggg               = vc->matrices->ggg;
+  dangle_model      = md->dangles;
+  turn              = md->min_loop_size;
+  hc                = vc->hc;
+  sc                = vc->scs;
+  hard_constraints  = hc->matrix;
+
+  if((turn < 0) || (turn > length))
+    turn = length;
 
   f5[0] = 0;
   for(j = 1; j <= turn + 1; j++){
@@ -550,16 +646,328 @@ fill_arrays_comparative(vrna_fold_compound_t *vc){
               }
               break;
   }
-  free(type);
-  free(cc);
-  free(cc1);
-  free(Fmi);
-  free(DMLi);
-  free(DMLi1);
-  free(DMLi2);
   return(f5[length]);
 }
 
+/*
+ *  The wavefront fill only pays off if more than one thread works on the
+ *  diagonals. Callbacks need not be thread-safe, so with callbacks attached
+ *  we use the row-wise fill as well. Both give identical matrices
+ */
+PRIVATE INLINE int
+use_wavefront(vrna_fold_compound_t *vc){
+
+#ifdef _OPENMP
+  return  vc->params->model_details.wavefront &&
+          (omp_get_max_threads() > 1) &&
+          !vrna_fold_compound_has_callbacks(vc);
+#else
+  return 0;
+#endif
+}
+
+/**
+*** fill "c", "fML" (and "fM1") arrays along anti-diagonals d = j - i,
+*** distributing the cells of each diagonal among the available
+*** OpenMP threads. Every cell only depends on cells of smaller diagonals,
+*** and is evaluated in the same way as in fill_arrays() and
+*** fill_arrays_comparative(), thus the resulting matrices are identical
+**/
+PRIVATE int
+fill_arrays_wavefront(vrna_fold_compound_t *vc){
+
+  int               i, j, d, p, length, turn, noLP, uniq_ML, size, energy, stride,
+                    *indx, *row, *DML, *CC, *FMLr, *c, *fML, *fM1;
+  vrna_md_t         *md;
+  vrna_ud_t         *domains_up;
+
+  length      = (int)vc->length;
+  indx        = vc->jindx;
+  md          = &(vc->params->model_details);
+  noLP        = md->noLP;
+  uniq_ML     = (vc->type == VRNA_FC_TYPE_SINGLE) ? md->uniq_ML : 0;
+  turn        = md->min_loop_size;
+  c           = vc->matrices->c;
+  fML         = vc->matrices->fML;
+  fM1         = vc->matrices->fM1;
+  domains_up  = vc->domains_up;
+
+  if((turn < 0) || (turn > length))
+    turn = length;
+
+  /* pre-processing ligand binding production rule(s) */
+  if((vc->type == VRNA_FC_TYPE_SINGLE) && domains_up && domains_up->prod_cb)
+    domains_up->prod_cb(vc, domains_up->data);
+
+  /*  DML holds MIN(fML[i,k]+fML[k+1,j]), i.e. what the row-wise fill keeps
+      in DMLi, DMLi1, and DMLi2. CC holds the canonical energies (cc, cc1) in
+      case lonely pairs are prohibited. A cell only needs these values from
+      the previous four (two) diagonals, so both are kept for the last
+      DML_DIAGONALS (CC_DIAGONALS) diagonals only, see DML_CELL() and CC_CELL().
+      FMLr is a row-wise copy of fML that allows for cache friendly loading of
+      the Fmi row cache. It is the only helper array of quadratic size
+  */
+  size    = indx[length] + length + 1;
+  stride  = length + 2;
+  row     = (int *) vrna_alloc(sizeof(int) * (length + 2));
+  DML     = (int *) vrna_alloc(sizeof(int) * stride * DML_DIAGONALS);
+  FMLr    = (int *) vrna_alloc(sizeof(int) * size);
+  CC      = (noLP) ? (int *) vrna_alloc(sizeof(int) * stride * CC_DIAGONALS) : NULL;
+
+  for(p = 0, i = 1; i <= length; p += length - i + 1, i++)
+    row[i] = p - i; /* FMLr[row[i] + j] holds fML[i,j] */
+
+  for(p = 0; p < stride * DML_DIAGONALS; p++)
+    DML[p] = INF;
+
+  /*  the row-wise fill starts with zero-initialized helper arrays for
+      cc and cc1, and resets them to INF for all remaining rows
+  */
+  if(CC)
+    for(d = 0; d < CC_DIAGONALS; d++)
+      for(i = 1; i <= length; i++)
+        CC[d * stride + i] = CC_INIT(i, length, turn);
+
+  /* prefill matrices with init contributions */
+  for(j = 1; j <= length; j++)
+    for(i = (j > turn ? (j - turn) : 1); i <= j; i++){
+      if((vc->type == VRNA_FC_TYPE_COMPARATIVE) && (i == j))
+        continue;
+      c[indx[j] + i] = fML[indx[j] + i] = INF;
+      if(uniq_ML)
+        fM1[indx[j] + i] = INF;
+    }
+
+  if((length > turn) || (vc->type == VRNA_FC_TYPE_COMPARATIVE)){
+#ifdef _OPENMP
+#pragma omp parallel private(d, i, j, p)
+#endif
+    {
+      int *fmi, *dmli, *dmli1, *dmli2;
+
+      /* thread-local row caches for the loop energy evaluation functions */
+      fmi   = (int *) vrna_alloc(sizeof(int) * (length + 2));
+      dmli  = (int *) vrna_alloc(sizeof(int) * (length + 2));
+      dmli1 = (int *) vrna_alloc(sizeof(int) * (length + 2));
+      dmli2 = (int *) vrna_alloc(sizeof(int) * (length + 2));
+
+      for(p = 0; p <= length + 1; p++)
+        fmi[p] = dmli[p] = dmli1[p] = dmli2[p] = INF;
+
+      for(d = turn + 1; d < length; d++){
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for(i = 1; i <= length - d; i++){
+          j = i + d;
+          memcpy(fmi + i + turn + 1, FMLr + row[i] + i + turn + 1, sizeof(int) * (d - turn - 1));
+          for(p = j; p <= ((vc->cutpoint > 0) ? length : j); p++)
+            fmi[p] = INF;
+          /* (i,j) replaces (i,j-CC_DIAGONALS) in CC */
+          if(CC)
+            CC_CELL(CC, stride, i, j) = CC_INIT(i, length, turn);
+          if(vc->type == VRNA_FC_TYPE_COMPARATIVE)
+            fill_cell_wavefront_comparative(vc, i, j, DML, CC, fmi, dmli, dmli1, dmli2);
+          else
+            fill_cell_wavefront(vc, i, j, DML, CC, fmi, dmli, dmli1, dmli2);
+          FMLr[row[i] + j] = fML[indx[j] + i];
+        }
+        /* implicit barrier of the work-sharing loop completes diagonal d */
+      }
+
+      free(fmi);
+      free(dmli);
+      free(dmli1);
+      free(dmli2);
+    }
+  }
+
+  free(row);
+  free(DML);
+  free(FMLr);
+  free(CC);
+
+  if(vc->type == VRNA_FC_TYPE_COMPARATIVE)
+    return fill_f5_comparative(vc);
+
+  /* return free energy of unfolded chain */
+  if(length <= turn)
+    return 0;
+
+  /* calculate energies of 5' fragments */
+  E_ext_loop_5(vc);
+  energy = vc->matrices->f5[length];
+
+  return energy;
+}
+
+
+/* load the DMLi1 and DMLi2 row cache entries required to evaluate cell (i,j) */
+PRIVATE INLINE void
+load_row_cache_wavefront(vrna_fold_compound_t *vc,
+                          int i,
+                          int j,
+                          int *DML,
+                          int *dmli1,
+                          int *dmli2){
+
+  int k, stride;
+
+  stride  = (int)vc->length + 2;
+
+  for(k = j - 2; k <= j - 1; k++){
+    dmli1[k] = ((k >= i + 1) && (i + 1 <= (int)vc->length)) ? DML_CELL(DML, stride, i + 1, k) : INF;
+    dmli2[k] = ((k >= i + 2) && (i + 2 <= (int)vc->length)) ? DML_CELL(DML, stride, i + 2, k) : INF;
+  }
+}
+
+
+/* canonical energy of pair (i+1,j-1) as seen by the row-wise fill through cc1[j-1] */
+PRIVATE INLINE int
+get_cc1_wavefront(vrna_fold_compound_t *vc,
+                  int i,
+                  int j,
+                  int *CC){
+
+  int turn, length;
+
+  length  = (int)vc->length;
+  turn    = vc->params->model_details.min_loop_size;
+
+  if((turn < 0) || (turn > length))
+    turn = length;
+
+  if(j - 1 >= i + 1)
+    return CC_CELL(CC, length + 2, i + 1, j - 1);
+
+  return CC_INIT(i + 1, length, turn);
+}
+
+
+PRIVATE void
+fill_cell_wavefront(vrna_fold_compound_t *vc,
+                    int i,
+                    int j,
+                    int *DML,
+                    int *CC,
+                    int *fmi,
+                    int *dmli,
+                    int *dmli1,
+                    int *dmli2){
+
+  unsigned char     type;
+  int               ij, energy, new_c, stackEnergy, no_close, cc1, *c;
+  vrna_md_t         *md;
+
+  md      = &(vc->params->model_details);
+  c       = vc->matrices->c;
+  ij      = vc->jindx[j] + i;
+  type    = (unsigned char)vc->ptype[ij];
+
+  load_row_cache_wavefront(vc, i, j, DML, dmli1, dmli2);
+
+  no_close = (((type==3)||(type==4))&&md->noGUclosure);
+
+  if(vc->hc->matrix[ij]){   /* we evaluate this pair */
+    new_c = INF;
+
+    if(!no_close){
+      /* check for hairpin loop */
+      energy  = vrna_E_hp_loop(vc, i, j);
+      new_c   = MIN2(new_c, energy);
+
+      /* check for multibranch loops */
+      energy  = vrna_E_mb_loop_fast(vc, i, j, dmli1, dmli2);
+      new_c   = MIN2(new_c, energy);
+    }
+
+    if(md->dangles == 3){ /* coaxial stacking */
+      energy  = E_mb_loop_stack(i, j, vc);
+      new_c   = MIN2(new_c, energy);
+    }
+
+    /* check for interior loops */
+    energy  = vrna_E_int_loop(vc, i, j);
+    new_c   = MIN2(new_c, energy);
+
+    /* remember stack energy for --noLP option */
+    if(md->noLP){
+      cc1         = get_cc1_wavefront(vc, i, j, CC);
+      stackEnergy = vrna_E_stack(vc, i, j);
+      new_c       = MIN2(new_c, cc1 + stackEnergy);
+      CC_CELL(CC, vc->length + 2, i, j) = new_c;
+      c[ij]       = cc1 + stackEnergy;
+    } else {
+      c[ij]       = new_c;
+    }
+  } else {
+    c[ij] = INF;
+  }
+
+  /* done with c[i,j], now compute fML[i,j] and fM1[i,j] */
+  vc->matrices->fML[ij] = vrna_E_ml_stems_fast(vc, i, j, fmi, dmli);
+  DML_CELL(DML, vc->length + 2, i, j) = dmli[j];
+
+  if(md->uniq_ML)  /* compute fM1 for unique decomposition */
+    vc->matrices->fM1[ij] = E_ml_rightmost_stem(i, j, vc);
+}
+
+
+PRIVATE void
+fill_cell_wavefront_comparative(vrna_fold_compound_t *vc,
+                                int i,
+                                int j,
+                                int *DML,
+                                int *CC,
+                                int *fmi,
+                                int *dmli,
+                                int *dmli1,
+                                int *dmli2){
+
+  int               ij, psc, energy, new_c, stackEnergy, cc1, *c;
+  vrna_md_t         *md;
+
+  md      = &(vc->params->model_details);
+  c       = vc->matrices->c;
+  ij      = vc->jindx[j] + i;
+  psc     = vc->pscore[ij];
+
+  load_row_cache_wavefront(vc, i, j, DML, dmli1, dmli2);
+
+  if(vc->hc->matrix[ij]){   /* a pair to consider */
+    new_c = INF;
+
+    /* hairpin ----------------------------------------------*/
+    energy  = vrna_E_hp_loop(vc, i, j);
+    new_c   = MIN2(new_c, energy);
+
+    /* check for multibranch loops */
+    energy  = vrna_E_mb_loop_fast(vc, i, j, dmli1, dmli2);
+    new_c   = MIN2(new_c, energy);
+
+    /* check for interior loops */
+    energy  = vrna_E_int_loop(vc, i, j);
+    new_c   = MIN2(new_c, energy);
+
+    /* remember stack energy for --noLP option */
+    if(md->noLP){
+      cc1         = get_cc1_wavefront(vc, i, j, CC);
+      stackEnergy = vrna_E_stack(vc, i, j);
+      new_c       = MIN2(new_c, cc1 + stackEnergy);
+      CC_CELL(CC, vc->length + 2, i, j) = new_c - psc; /* add covariance bonnus/penalty */
+      c[ij]       = cc1 + stackEnergy - psc;
+    } else {
+      c[ij]       = new_c - psc; /* add covariance bonnus/penalty */
+    }
+  } else {
+    c[ij] = INF;
+  }
+
+  /* done with c[i,j], now compute fML[i,j] */
+  vc->matrices->fML[ij] = vrna_E_ml_stems_fast(vc, i, j, fmi, dmli);
+  DML_CELL(DML, vc->length + 2, i, j) = dmli[j];
+}
+
 #include "ViennaRNA/alicircfold.inc"
 
 PUBLIC void
@@ -595,12 +1003,11 @@ backtrack(vrna_fold_compound_t *vc,
 
   unsigned char   type;
   char            *string, *ptype, backtrack_type;
-  int             i, j, ij, k, length, no_close, b, *my_c, *indx, noLP, noGUclosure;
+  int             i, j, ij, k, length, no_close, b, *indx, noLP, noGUclosure;
   vrna_param_t    *P;
 
   b               = 0;
   length          = vc->length;
-  my_c            = vc->matrices->c;
   indx            = vc->jindx;
   P               = vc->params;
   noLP            = P->model_details.noLP;
@@ -683,7 +1090,7 @@ backtrack(vrna_fold_compound_t *vc,
     ij = indx[j]+i;
 
     if (canonical)
-      cij = my_c[ij];
+      cij = vrna_mx_mfe_c(vc->matrices, indx, i, j);
 
     type = (unsigned char)ptype[ij];
 
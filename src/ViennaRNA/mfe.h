@@ -104,6 +104,33 @@ float vrna_mfe_window_cb(vrna_fold_compound_t     *vc,
                          void                     *data);
 
 
+/**
+ *  @brief Local MFE prediction using a sliding window approach, with long sequences split into chunks
+ *
+ *  This function yields the same predictions as vrna_mfe_window_cb(), but splits long
+ *  sequences into overlapping chunks that are processed independently, and
+ *  distributed among the available threads (if compiled with OpenMP support).
+ *  Since locally optimal structures only depend on a limited stretch of the
+ *  sequence downstream, the chunks are verified against each other, and re-computed
+ *  with a larger overlap if necessary. The predicted structures are passed to the
+ *  callback @p cb in the same order as for vrna_mfe_window_cb(), and the callback
+ *  is never invoked concurrently. However, structures are only passed once all
+ *  chunks further downstream have been processed.
+ *
+ *  @ingroup local_mfe_fold
+ *
+ *  @see  vrna_mfe_window_cb(), vrna_probs_window_parallel()
+ *
+ *  @param  vc        The #vrna_fold_compound_t with preallocated memory for the DP matrices
+ *  @param  cb        The callback that receives the predicted structures
+ *  @param  data      Auxiliary data passed through to the callback
+ *  @return           The minimum free energy of the entire sequence in kcal/mol
+ */
+float vrna_mfe_window_parallel_cb(vrna_fold_compound_t      *vc,
+                                  vrna_mfe_window_callback  *cb,
+                                  void                      *data);
+
+
 #ifdef VRNA_WITH_SVM
 /**
  *  @brief Local MFE prediction using a sliding window approach (with z-score cut-off)
@@ -143,6 +170,27 @@ float vrna_mfe_window_zscore_cb(vrna_fold_compound_t            *vc,
                                 void                            *data);
 
 
+/**
+ *  @brief Local MFE prediction with z-score cut-off, with long sequences split into chunks
+ *
+ *  This is the z-score version of vrna_mfe_window_parallel_cb().
+ *
+ *  @ingroup local_mfe_fold
+ *
+ *  @see  vrna_mfe_window_zscore_cb(), vrna_mfe_window_parallel_cb()
+ *
+ *  @param  vc        The #vrna_fold_compound_t with preallocated memory for the DP matrices
+ *  @param  min_z     The minimal z-score for a predicted structure to appear in the output
+ *  @param  cb        The callback that receives the predicted structures
+ *  @param  data      Auxiliary data passed through to the callback
+ *  @return           The minimum free energy of the entire sequence in kcal/mol
+ */
+float vrna_mfe_window_zscore_parallel_cb(vrna_fold_compound_t             *vc,
+                                         double                           min_z,
+                                         vrna_mfe_window_zscore_callback  *cb,
+                                         void                             *data);
+
+
 #endif
 
 void
@@ -23,9 +23,9 @@ PUBLIC unsigned int maximumMatching(const char *string){
   unsigned int i, j, l, length, max = 0;
   unsigned int *mm;            /* holds maximum matching on subsequence [i,j] */
   short *encodedString = encode_sequence(string, 0);
-  int *iindx = vrna_idx_row_wise((unsigned) encodedString[0]);
+  int *iindx = vrna_idx_row_wise((unsigned short) encodedString[0]);
   make_pair_matrix();
-  length = (unsigned int)encodedString[0];
+  length = (unsigned short)encodedString[0];
   mm = (unsigned int *) vrna_alloc(sizeof(unsigned int)*((length*(length+1))/2+2));
   for(j = 1; j<=length; j++)
     for(i=(j>TURN?(j-TURN):1); i<j; i++)
@@ -50,9 +50,9 @@ PUBLIC unsigned int *maximumMatchingConstraint(const char *string, short *ptable
   unsigned int i, j, l, length, max = 0;
   unsigned int *mm;            /* holds maximum matching on subsequence [i,j] */
   short *encodedString = encode_sequence(string, 0);
-  int *iindx = vrna_idx_row_wise((unsigned) encodedString[0]);
+  int *iindx = vrna_idx_row_wise((unsigned short) encodedString[0]);
   make_pair_matrix();
-  length = (unsigned int)encodedString[0];
+  length = (unsigned short)encodedString[0];
   mm = (unsigned int *) vrna_alloc(sizeof(unsigned int)*((length*(length+1))/2+2));
   for(j = 1; j<=length; j++)
     for(i=(j>TURN?(j-TURN):1); i<j; i++)
@@ -78,9 +78,9 @@ PUBLIC unsigned int *maximumMatching2Constraint(const char *string, short *ptabl
   unsigned int i, j, l, length, max = 0;
   unsigned int *mm;            /* holds maximum matching on subsequence [i,j] */
   short *encodedString = encode_sequence(string, 0);
-  int *iindx = vrna_idx_row_wise((unsigned) encodedString[0]);
+  int *iindx = vrna_idx_row_wise((unsigned short) encodedString[0]);
   make_pair_matrix();
-  length = (unsigned int)encodedString[0];
+  length = (unsigned short)encodedString[0];
   mm = (unsigned int *) vrna_alloc(sizeof(unsigned int)*((length*(length+1))/2+2));
   for(j = 1; j<=length; j++)
     for(i=(j>TURN?(j-TURN):1); i<j; i++)
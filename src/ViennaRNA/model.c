@@ -124,6 +124,8 @@ PRIVATE vrna_md_t defaults = {
   VRNA_MODEL_DEFAULT_ALI_CV_FACT,
   VRNA_MODEL_DEFAULT_ALI_NC_FACT,
   1.07,
+  VRNA_MODEL_DEFAULT_WAVEFRONT,
+  VRNA_MODEL_DEFAULT_PF_FLOAT,
   {0, 2, 1, 4, 3, 6, 5, 7},
   {0, 1, 2, 3, 4, 3, 2, 0},
   {
@@ -313,6 +315,8 @@ vrna_md_defaults_reset(vrna_md_t *md_p){
   defaults.temperature       = VRNA_MODEL_DEFAULT_TEMPERATURE;
   defaults.betaScale         = VRNA_MODEL_DEFAULT_BETA_SCALE;
   defaults.sfact             = 1.07;
+  defaults.wavefront         = VRNA_MODEL_DEFAULT_WAVEFRONT;
+  defaults.pf_float          = VRNA_MODEL_DEFAULT_PF_FLOAT;
   defaults.nonstandards[0]   = '\0';
 
   if(md_p){ /* now try to apply user settings */
@@ -346,6 +350,8 @@ vrna_md_defaults_reset(vrna_md_t *md_p){
     vrna_md_defaults_temperature(md_p->temperature);
     vrna_md_defaults_betaScale(md_p->betaScale);
     vrna_md_defaults_sfact(md_p->sfact);
+    vrna_md_defaults_wavefront(md_p->wavefront);
+    vrna_md_defaults_pf_float(md_p->pf_float);
     copy_nonstandards(&defaults, &(md_p->nonstandards[0]));
   }
 
@@ -730,6 +736,30 @@ vrna_md_defaults_sfact_get(void){
   return defaults.sfact;
 }
 
+PUBLIC void
+vrna_md_defaults_wavefront(int flag){
+
+  defaults.wavefront = flag ? 1 : 0;
+}
+
+PUBLIC int
+vrna_md_defaults_wavefront_get(void){
+
+  return defaults.wavefront;
+}
+
+PUBLIC void
+vrna_md_defaults_pf_float(int flag){
+
+  defaults.pf_float = flag ? 1 : 0;
+}
+
+PUBLIC int
+vrna_md_defaults_pf_float_get(void){
+
+  return defaults.pf_float;
+}
+
 
 PUBLIC void
 vrna_md_update(vrna_md_t *md){
@@ -882,6 +912,8 @@ set_model_details(vrna_md_t *md){
     md->temperature       = temperature;
     md->betaScale         = VRNA_MODEL_DEFAULT_BETA_SCALE;
     md->sfact             = 1.07;
+    md->wavefront         = VRNA_MODEL_DEFAULT_WAVEFRONT;
+    md->pf_float          = VRNA_MODEL_DEFAULT_PF_FLOAT;
 
     if (nonstandards)
       copy_nonstandards(md, nonstandards);
@@ -167,6 +167,18 @@ typedef struct vrna_md_s  vrna_md_t;
  */
 #define VRNA_MODEL_DEFAULT_ALI_NC_FACT    1.
 
+/**
+ *  @brief  Default model behavior for the order in which DP matrices are filled
+ *  @see    #vrna_md_t.wavefront, vrna_md_defaults_reset(), vrna_md_set_default()
+ */
+#define VRNA_MODEL_DEFAULT_WAVEFRONT      0
+
+/**
+ *  @brief  Default model behavior for the precision of sliding window partition functions
+ *  @see    #vrna_md_t.pf_float, vrna_md_defaults_reset(), vrna_md_set_default()
+ */
+#define VRNA_MODEL_DEFAULT_PF_FLOAT       0
+
 
 #ifdef  VRNA_BACKWARD_COMPAT
 
@@ -241,6 +253,47 @@ struct vrna_md_s {
   double  cv_fact;                      /**<  @brief  Co-variance scaling factor for consensus structure prediction */
   double  nc_fact;                      /**<  @brief  Scaling factor to weight co-variance contributions of non-canonical pairs */
   double  sfact;                        /**<  @brief  Scaling factor for partition function scaling */
+  int     wavefront;                    /**<  @brief  Fill the DP matrices diagonal by diagonal
+
+                                              If non-zero, the forward recursions fill all cells of equal span
+                                              j - i at once and distribute them over the available OpenMP
+                                              threads. This applies to the MFE and the partition function forward
+                                              recursions. Additionally, the outside recursion for base pair
+                                              probabilities then distributes all pairs (k,l) of each column l
+                                              among the threads. The results are identical to those of the default
+                                              row/column-wise fill, since each matrix entry is still obtained by
+                                              the same sequence of (floating point) operations. Hence, partition
+                                              functions are bitwise reproducible regardless of the number of threads.
+                                              Without OpenMP support, with a single OpenMP thread, or if hard
+                                              constraint, soft constraint, or non-default unstructured domain
+                                              callbacks are attached to the fold compound (these are not required
+                                              to be thread-safe, see vrna_fold_compound_has_callbacks()), the
+                                              default row/column-wise fill is used instead, since the diagonal
+                                              order is considerably slower on a single core.
+                                              @note The diagonal fill requires additional memory: A row-wise copy
+                                              of the @p fML matrix for MFE prediction, i.e. about
+                                              @f$ n^2/2 @f$ integers, and a copy of the exterior loop helper
+                                              array @p qq for each column of the partition function matrices,
+                                              i.e. about @f$ n^2/2 @f$ #FLT_OR_DBL values. Unless the @p qm1 matrix is
+                                              allocated anyway (circular RNAs, unique multiloop decomposition),
+                                              the same amount is required again for the multibranch loop helper
+                                              array @p qqm. For a sequence of 15 kb, this amounts to roughly
+                                              450 MB (MFE) and 0.9 to 1.8 GB (partition function) on top of the
+                                              regular DP matrices.
+                                        */
+  int     pf_float;                     /**<  @brief  Use single precision DP matrices for sliding window partition functions
+
+                                              If non-zero, vrna_probs_window() (and thus vrna_probs_window_parallel()
+                                              and pfl_fold()) store the band of partition function matrices in single
+                                              precision floating point numbers. This halves the memory footprint and
+                                              bandwidth of the computations, at the cost of a relative error of the
+                                              resulting probabilities in the order of 1e-5. Since the range of
+                                              single precision numbers is much smaller, the Boltzmann factors must
+                                              be scaled properly, which is usually the case for window sizes up to a
+                                              few hundred nucleotides. Computations that do not use a sliding window
+                                              are not affected, and the flag has no effect if RNAlib is compiled with
+                                              single precision partition functions (USE_FLOAT_PF) anyway.
+                                        */
   int     rtype[8];                     /**<  @brief  Reverse base pair type array */
   short   alias[MAXALPHA+1];            /**<  @brief  alias of an integer nucleotide representation */
   int     pair[MAXALPHA+1][MAXALPHA+1]; /**<  @brief  Integer representation of a base pair */
@@ -692,6 +745,38 @@ vrna_md_defaults_sfact(double factor);
 double
 vrna_md_defaults_sfact_get(void);
 
+/**
+ *  @brief  Set default behavior for filling the DP matrices diagonal by diagonal (wavefront parallelization)
+ *  @see vrna_md_defaults_reset(), vrna_md_set_default(), #vrna_md_t, #VRNA_MODEL_DEFAULT_WAVEFRONT
+ *  @param  flag  On/Off switch (0 = OFF, else = ON)
+ */
+void
+vrna_md_defaults_wavefront(int flag);
+
+/**
+ *  @brief  Get default behavior for filling the DP matrices diagonal by diagonal (wavefront parallelization)
+ *  @see vrna_md_defaults_wavefront(), vrna_md_defaults_reset(), vrna_md_set_default(), #vrna_md_t, #VRNA_MODEL_DEFAULT_WAVEFRONT
+ *  @return The global default settings for wavefront parallelization of the DP matrix fill
+ */
+int
+vrna_md_defaults_wavefront_get(void);
+
+/**
+ *  @brief  Set default precision of the DP matrices of sliding window partition functions
+ *  @see vrna_md_defaults_reset(), vrna_md_set_default(), #vrna_md_t, #VRNA_MODEL_DEFAULT_PF_FLOAT
+ *  @param  flag  Use single precision (0 = OFF, else = ON)
+ */
+void
+vrna_md_defaults_pf_float(int flag);
+
+/**
+ *  @brief  Get default precision of the DP matrices of sliding window partition functions
+ *  @see vrna_md_defaults_pf_float(), vrna_md_defaults_reset(), vrna_md_set_default(), #vrna_md_t, #VRNA_MODEL_DEFAULT_PF_FLOAT
+ *  @return The global default settings for single precision sliding window partition functions
+ */
+int
+vrna_md_defaults_pf_float_get(void);
+
 #ifdef  VRNA_BACKWARD_COMPAT
 
 #define model_detailsT        vrna_md_t               /* restore compatibility of struct rename */
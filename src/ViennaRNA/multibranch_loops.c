@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include <string.h>
 #include "ViennaRNA/utils.h"
+#include "ViennaRNA/higher_order_functions.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/energy_par.h"
 #include "ViennaRNA/constraints.h"
@@ -87,6 +88,13 @@ extend_fm_3p(int                  i,
              vrna_fold_compound_t *vc);
 
 
+PRIVATE INLINE int
+get_fm(vrna_fold_compound_t *vc,
+       int                  *fm,
+       int                  i,
+       int                  j);
+
+
 PRIVATE char
 hc_default(int  i,
            int  j,
@@ -537,7 +545,7 @@ E_mb_loop_stack(int                   i,
 {
   unsigned char             type, type_2;
   char                      *ptype;
-  int                       e, decomp, en, i1k, k1j1, ij, k, *indx, *c, *fML, turn, *rtype;
+  int                       e, decomp, en, i1k, k1j1, ij, k, *indx, turn, *rtype;
   vrna_param_t              *P;
   vrna_md_t                 *md;
   vrna_hc_t                 *hc;
@@ -547,8 +555,6 @@ E_mb_loop_stack(int                   i,
 
   indx  = vc->jindx;
   hc    = vc->hc;
-  c     = vc->matrices->c;
-  fML   = vc->matrices->fML;
   P     = vc->params;
   md    = &(P->model_details);
   turn  = md->min_loop_size;
@@ -587,7 +593,8 @@ E_mb_loop_stack(int                   i,
         if (type_2 == 0)
           type_2 = 7;
 
-        en = c[i1k] + P->stack[type][type_2] + fML[k1j1];
+        en = vrna_mx_mfe_c(vc->matrices, indx, i + 1, k) + P->stack[type][type_2] +
+             vrna_mx_mfe_fML(vc->matrices, indx, k + 1, j - 1);
         if (sc)
           if (sc->f)
             en += sc->f(i, j, i + 1, k, VRNA_DECOMP_ML_COAXIAL, sc->data);
@@ -600,7 +607,8 @@ E_mb_loop_stack(int                   i,
         if (type_2 == 0)
           type_2 = 7;
 
-        en = c[k1j1] + P->stack[type][type_2] + fML[i1k];
+        en = vrna_mx_mfe_c(vc->matrices, indx, k + 1, j - 1) + P->stack[type][type_2] +
+             vrna_mx_mfe_fML(vc->matrices, indx, i + 1, k);
         if (sc)
           if (sc->f)
             en += sc->f(i, j, k + 1, j - 1, VRNA_DECOMP_ML_COAXIAL, sc->data);
@@ -637,7 +645,10 @@ E_ml_rightmost_stem(int                   i,
  * compose a multibranch loop part fm[i:j]
  * by either c[i,j]/ggg[i,j] or fm[i:j-1]
  *
- * This function can be used for fM and fM1
+ * This function can be used for fM and fM1. Passing
+ * NULL as fm selects fML, which is accessed through
+ * vrna_mx_mfe_fML() since it might be stored in compact
+ * matrices
  */
 PRIVATE int
 extend_fm_3p(int                  i,
@@ -647,7 +658,7 @@ extend_fm_3p(int                  i,
 {
   short                     *S;
   unsigned int              *sn;
-  int                       en, length, *indx, *c, *ggg, ij, type,
+  int                       en, length, *indx, *ggg, ij, type,
                             dangle_model, with_gquad, e, u, k, cnt, with_ud;
   vrna_param_t              *P;
   vrna_hc_t                 *hc;
@@ -663,7 +674,6 @@ extend_fm_3p(int                  i,
   sn            = vc->strand_number;
   hc            = vc->hc;
   sc            = vc->sc;
-  c             = vc->matrices->c;
   ggg           = vc->matrices->ggg;
   ij            = indx[j] + i;
   type          = vc->ptype[ij];
@@ -692,7 +702,7 @@ extend_fm_3p(int                  i,
         if (type == 0)
           type = 7;
 
-        e = c[ij];
+        e = vrna_mx_mfe_c(vc->matrices, indx, i, j);
         if (e != INF) {
           switch (dangle_model) {
             case 2:
@@ -719,8 +729,9 @@ extend_fm_3p(int                  i,
 
     if (sn[j - 1] == sn[j]) {
       if (evaluate(i, j, i, j - 1, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-        if (fm[indx[j - 1] + i] != INF) {
-          en = fm[indx[j - 1] + i] + P->MLbase;
+        en = get_fm(vc, fm, i, j - 1);
+        if (en != INF) {
+          en += P->MLbase;
           if (sc) {
             if (sc->energy_up)
               en += sc->energy_up[j][1];
@@ -738,13 +749,13 @@ extend_fm_3p(int                  i,
         k = j - u + 1;
         if ((k > i) && (sn[j - u] == sn[j])) {
           if (evaluate(i, j, i, k - 1, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-            if (fm[indx[k - 1] + i] != INF) {
+            if (get_fm(vc, fm, i, k - 1) != INF) {
               en = domains_up->energy_cb(vc,
                                          k, j,
                                          VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP | VRNA_UNSTRUCTURED_DOMAIN_MOTIF,
                                          domains_up->data);
               if (en != INF) {
-                en += fm[indx[k - 1] + i]
+                en += get_fm(vc, fm, i, k - 1)
                       + u * P->MLbase;
 
                 if (sc) {
@@ -765,6 +776,19 @@ extend_fm_3p(int                  i,
 }
 
 
+PRIVATE INLINE int
+get_fm(vrna_fold_compound_t *vc,
+       int                  *fm,
+       int                  i,
+       int                  j)
+{
+  if (fm)
+    return fm[vc->jindx[j] + i];
+
+  return vrna_mx_mfe_fML(vc->matrices, vc->jindx, i, j);
+}
+
+
 PRIVATE int
 E_ml_stems_fast(vrna_fold_compound_t  *vc,
                 int                   i,
@@ -776,8 +800,9 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
   short                     *S;
   unsigned int              *sn;
   int                       k, en, decomp, mm5, mm3, type_2, k1j, stop, length, *indx,
-                            *c, *fm, ij, dangle_model, turn, type, *rtype, circular, cp, e, u,
+                            ij, dangle_model, turn, type, *rtype, circular, cp, e, u,
                             cnt, with_ud;
+  vrna_mx_mfe_t             *matrices;
   vrna_hc_t                 *hc;
   vrna_sc_t                 *sc;
   vrna_param_t              *P;
@@ -792,8 +817,7 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
   sn            = vc->strand_number;
   hc            = vc->hc;
   sc            = vc->sc;
-  c             = vc->matrices->c;
-  fm            = vc->matrices->fML;
+  matrices      = vc->matrices;
   P             = vc->params;
   ij            = indx[j] + i;
   dangle_model  = P->model_details.dangles;
@@ -823,7 +847,7 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
    *  extension with one unpaired nucleotide at the right (3' site)
    *  or full branch of (i,j)
    */
-  e = extend_fm_3p(i, j, fm, vc);
+  e = extend_fm_3p(i, j, NULL, vc);
 
   /*
    *  extension with one unpaired nucleotide at 5' site
@@ -833,8 +857,9 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
   if (sn[i - 1] == sn[i]) {
     if (sn[i] == sn[i + 1]) {
       if (evaluate(i, j, i + 1, j, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-        if (fm[ij + 1] != INF) {
-          en = fm[ij + 1] + P->MLbase;
+        en = vrna_mx_mfe_fML(matrices, indx, i + 1, j);
+        if (en != INF) {
+          en += P->MLbase;
           if (sc) {
             if (sc->energy_up)
               en += sc->energy_up[i][1];
@@ -853,13 +878,13 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
         k = i + u - 1;
         if ((k < j) && (sn[i] == sn[k + 1])) {
           if (evaluate(i, j, k + 1, j, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-            if (fm[ij + u] != INF) {
+            if (vrna_mx_mfe_fML(matrices, indx, i + u, j) != INF) {
               en = domains_up->energy_cb(vc,
                                          i, k,
                                          VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP | VRNA_UNSTRUCTURED_DOMAIN_MOTIF,
                                          domains_up->data);
               if (en != INF) {
-                en += fm[ij + u]
+                en += vrna_mx_mfe_fML(matrices, indx, i + u, j)
                       + u * P->MLbase;
 
                 if (sc) {
@@ -884,13 +909,13 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
 
       if (sn[i] == sn[i + 1]) {
         if (evaluate(i, j, i + 1, j, VRNA_DECOMP_ML_STEM, &hc_dat_local)) {
-          if (c[ij + 1] != INF) {
+          if (vrna_mx_mfe_c(matrices, indx, i + 1, j) != INF) {
             type = ptype[ij + 1];
 
             if (type == 0)
               type = 7;
 
-            en = c[ij + 1] + E_MLstem(type, mm5, -1, P) + P->MLbase;
+            en = vrna_mx_mfe_c(matrices, indx, i + 1, j) + E_MLstem(type, mm5, -1, P) + P->MLbase;
             if (sc) {
               if (sc->energy_up)
                 en += sc->energy_up[i][1];
@@ -904,13 +929,13 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
 
       if (sn[j - 1] == sn[j]) {
         if (evaluate(i, j, i, j - 1, VRNA_DECOMP_ML_STEM, &hc_dat_local)) {
-          if (c[indx[j - 1] + i] != INF) {
+          if (vrna_mx_mfe_c(matrices, indx, i, j - 1) != INF) {
             type = ptype[indx[j - 1] + i];
 
             if (type == 0)
               type = 7;
 
-            en = c[indx[j - 1] + i] + E_MLstem(type, -1, mm3, P) + P->MLbase;
+            en = vrna_mx_mfe_c(matrices, indx, i, j - 1) + E_MLstem(type, -1, mm3, P) + P->MLbase;
             if (sc) {
               if (sc->energy_up)
                 en += sc->energy_up[j][1];
@@ -924,13 +949,13 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
 
       if ((sn[j - 1] == sn[j]) && (sn[i] == sn[i + 1])) {
         if (evaluate(i, j, i + 1, j - 1, VRNA_DECOMP_ML_STEM, &hc_dat_local)) {
-          if (c[indx[j - 1] + i + 1] != INF) {
+          if (vrna_mx_mfe_c(matrices, indx, i + 1, j - 1) != INF) {
             type = ptype[indx[j - 1] + i + 1];
 
             if (type == 0)
               type = 7;
 
-            en = c[indx[j - 1] + i + 1] + E_MLstem(type, mm5, mm3, P) + 2 * P->MLbase;
+            en = vrna_mx_mfe_c(matrices, indx, i + 1, j - 1) + E_MLstem(type, mm5, mm3, P) + 2 * P->MLbase;
             if (sc) {
               if (sc->energy_up)
                 en += sc->energy_up[j][1] + sc->energy_up[i][1];
@@ -945,73 +970,69 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
   }
 
   /* modular decomposition -------------------------------*/
-  k1j   = indx[j] + i + turn + 2;
   stop  = (cp > 0) ? (cp - 1) : (j - 2 - turn);
 
   /* duplicated code is faster than conditions in loop */
   if (hc->f) {
     if (sc && sc->f) {
-      for (decomp = INF, k = i + 1 + turn; k <= stop; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-          en      = fmi[k] + fm[k1j];
+      for (decomp = INF, k = i + 1 + turn; k <= stop; k++) {
+        en = vrna_mx_mfe_fML(matrices, indx, k + 1, j);
+        if ((fmi[k] != INF) && (en != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
+          en      += fmi[k];
           en      += sc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
           decomp  = MIN2(decomp, en);
         }
       }
-      k++; k1j++;
-      for (; k <= j - 2 - turn; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-          en      = fmi[k] + fm[k1j];
+      k++;
+      for (; k <= j - 2 - turn; k++) {
+        en = vrna_mx_mfe_fML(matrices, indx, k + 1, j);
+        if ((fmi[k] != INF) && (en != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
+          en      += fmi[k];
           en      += sc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
           decomp  = MIN2(decomp, en);
         }
       }
     } else {
-      for (decomp = INF, k = i + 1 + turn; k <= stop; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-          en      = fmi[k] + fm[k1j];
+      for (decomp = INF, k = i + 1 + turn; k <= stop; k++) {
+        en = vrna_mx_mfe_fML(matrices, indx, k + 1, j);
+        if ((fmi[k] != INF) && (en != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
+          en      += fmi[k];
           decomp  = MIN2(decomp, en);
         }
       }
-      k++; k1j++;
-      for (; k <= j - 2 - turn; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-          en      = fmi[k] + fm[k1j];
+      k++;
+      for (; k <= j - 2 - turn; k++) {
+        en = vrna_mx_mfe_fML(matrices, indx, k + 1, j);
+        if ((fmi[k] != INF) && (en != INF) && hc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
+          en      += fmi[k];
           decomp  = MIN2(decomp, en);
         }
       }
     }
   } else {
     if (sc && sc->f) {
-      for (decomp = INF, k = i + 1 + turn; k <= stop; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF)) {
-          en      = fmi[k] + fm[k1j];
+      for (decomp = INF, k = i + 1 + turn; k <= stop; k++) {
+        en = vrna_mx_mfe_fML(matrices, indx, k + 1, j);
+        if ((fmi[k] != INF) && (en != INF)) {
+          en      += fmi[k];
           en      += sc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
           decomp  = MIN2(decomp, en);
         }
       }
-      k++; k1j++;
-      for (; k <= j - 2 - turn; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF)) {
-          en      = fmi[k] + fm[k1j];
+      k++;
+      for (; k <= j - 2 - turn; k++) {
+        en = vrna_mx_mfe_fML(matrices, indx, k + 1, j);
+        if ((fmi[k] != INF) && (en != INF)) {
+          en      += fmi[k];
           en      += sc->f(i, j, k, k + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
           decomp  = MIN2(decomp, en);
         }
       }
     } else {
-      for (decomp = INF, k = i + 1 + turn; k <= stop; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF)) {
-          en      = fmi[k] + fm[k1j];
-          decomp  = MIN2(decomp, en);
-        }
-      }
-      k++; k1j++;
-      for (; k <= j - 2 - turn; k++, k1j++) {
-        if ((fmi[k] != INF) && (fm[k1j] != INF)) {
-          en      = fmi[k] + fm[k1j];
-          decomp  = MIN2(decomp, en);
-        }
-      }
+      /* vectorized min-plus reduction over both segments, skipping the cutpoint */
+      decomp  = vrna_mx_mfe_fML_column_min(matrices, indx, fmi, j, i + 1 + turn, stop);
+      en      = vrna_mx_mfe_fML_column_min(matrices, indx, fmi, j, stop + 2, j - 2 - turn);
+      decomp  = MIN2(decomp, en);
     }
   }
 
@@ -1034,7 +1055,8 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
         if (type_2 == 0)
           type_2 = 7;
 
-        en = c[ik] + c[k1j] + P->stack[type][type_2];
+        en = vrna_mx_mfe_c(matrices, indx, i, k) + vrna_mx_mfe_c(matrices, indx, k + 1, j) +
+             P->stack[type][type_2];
         if (sc)
           if (sc->f)
             en += sc->f(i, k, k + 1, j, VRNA_DECOMP_ML_COAXIAL_ENC, sc->data);
@@ -1053,7 +1075,8 @@ E_ml_stems_fast(vrna_fold_compound_t  *vc,
         if (type_2 == 0)
           type_2 = 7;
 
-        en = c[ik] + c[k1j] + P->stack[type][type_2];
+        en = vrna_mx_mfe_c(matrices, indx, i, k) + vrna_mx_mfe_c(matrices, indx, k + 1, j) +
+             P->stack[type][type_2];
         if (sc)
           if (sc->f)
             en += sc->f(i, k, k + 1, j, VRNA_DECOMP_ML_COAXIAL, sc->data);
@@ -1091,7 +1114,7 @@ E_ml_stems_fast_comparative(vrna_fold_compound_t  *vc,
   char            *hard_constraints;
   short           **S, **S5, **S3;
   unsigned short  **a2s;
-  int             e, energy, *c, *fML, *ggg, ij, *indx, s, n_seq, k,
+  int             e, energy, *c, *fML, *ggg, ij, *indx, s, n_seq,
                   dangle_model, decomp, turn, *type;
   vrna_param_t    *P;
   vrna_md_t       *md;
@@ -1172,8 +1195,9 @@ E_ml_stems_fast_comparative(vrna_fold_compound_t  *vc,
 
 
   /* modular decomposition -------------------------------*/
-  for (decomp = INF, k = i + 1 + turn; k <= j - 2 - turn; k++)
-    decomp = MIN2(decomp, fmi[k] + fML[indx[j] + k + 1]);
+  decomp = vrna_fun_zip_add_min(fmi + i + 1 + turn,
+                                fML + indx[j] + i + turn + 2,
+                                j - i - 2 * turn - 2);
 
   dmli[j] = decomp; /* store for later use in ML decompositon */
 
@@ -1388,7 +1412,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
   char          *ptype;
   short         mm5, mm3, *S1;
   unsigned int  *sn;
-  int           length, ii, jj, k, en, cp, fij, fi, *my_c, *my_fc, *my_ggg,
+  int           length, ii, jj, k, en, cp, fij, fi, *my_fc, *my_ggg,
                 *idx, with_gquad, dangle_model, turn;
   vrna_param_t  *P;
   vrna_md_t     *md;
@@ -1405,7 +1429,6 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
   S1            = vc->sequence_encoding;
   ptype         = vc->ptype;
   idx           = vc->jindx;
-  my_c          = vc->matrices->c;
   my_fc         = vc->matrices->fc;
   my_ggg        = vc->matrices->ggg;
   turn          = md->min_loop_size;
@@ -1450,7 +1473,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (type == 0)
               type = 7;
 
-            if (fij == my_fc[k + 1] + my_c[idx[k] + ii] + E_ExtLoop(type, -1, -1, P)) {
+            if (fij == my_fc[k + 1] + vrna_mx_mfe_c(vc->matrices, idx, ii, k) + E_ExtLoop(type, -1, -1, P)) {
               bp_stack[++(*stack_count)].i  = ii;
               bp_stack[(*stack_count)].j    = k;
               *u                            = k + 1;
@@ -1480,7 +1503,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (type == 0)
               type = 7;
 
-            if (fij == my_fc[k + 1] + my_c[idx[k] + ii] + E_ExtLoop(type, mm5, mm3, P)) {
+            if (fij == my_fc[k + 1] + vrna_mx_mfe_c(vc->matrices, idx, ii, k) + E_ExtLoop(type, mm5, mm3, P)) {
               bp_stack[++(*stack_count)].i  = ii;
               bp_stack[(*stack_count)].j    = k;
               *u                            = k + 1;
@@ -1509,7 +1532,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (type == 0)
               type = 7;
 
-            if (fij == my_fc[k + 1] + my_c[idx[k] + ii] + E_ExtLoop(type, -1, -1, P)) {
+            if (fij == my_fc[k + 1] + vrna_mx_mfe_c(vc->matrices, idx, ii, k) + E_ExtLoop(type, -1, -1, P)) {
               bp_stack[++(*stack_count)].i  = ii;
               bp_stack[(*stack_count)].j    = k;
               *u                            = k + 1;
@@ -1519,7 +1542,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             }
             if (hc->up_ext[k + 1]) {
               mm3 = (sn[k] == sn[k + 1]) ? S1[k + 1] : -1;
-              en  = my_c[idx[k] + ii];
+              en  = vrna_mx_mfe_c(vc->matrices, idx, ii, k);
               if (sc)
                 if (sc->energy_up)
                   en += sc->energy_up[k + 1][1];
@@ -1553,7 +1576,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
               if (type == 0)
                 type = 7;
 
-              en = my_c[idx[k] + ii + 1];
+              en = vrna_mx_mfe_c(vc->matrices, idx, ii + 1, k);
               if (sc)
                 if (sc->energy_up)
                   en += sc->energy_up[ii][1];
@@ -1631,7 +1654,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (type == 0)
               type = 7;
 
-            en = my_c[idx[jj] + k];
+            en = vrna_mx_mfe_c(vc->matrices, idx, k, jj);
             if (sn[k] != sn[jj])
               en += P->DuplexInit;
 
@@ -1665,7 +1688,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (type == 0)
               type = 7;
 
-            en = my_c[idx[jj] + k];
+            en = vrna_mx_mfe_c(vc->matrices, idx, k, jj);
             if (sn[k] != sn[jj])
               en += P->DuplexInit;
 
@@ -1698,7 +1721,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (type == 0)
               type = 7;
 
-            en = my_c[idx[jj] + k];
+            en = vrna_mx_mfe_c(vc->matrices, idx, k, jj);
             if (sn[k] != sn[jj])
               en += P->DuplexInit;
 
@@ -1738,7 +1761,7 @@ vrna_BT_mb_loop_fake(vrna_fold_compound_t *vc,
             if (hc->up_ext[jj]) {
               if (sn[jj - 1] == sn[jj]) {
                 mm3 = S1[jj];
-                en  = my_c[idx[jj - 1] + k];
+                en  = vrna_mx_mfe_c(vc->matrices, idx, k, jj - 1);
                 if (sn[k] != sn[jj - 1])
                   en += P->DuplexInit;         /* ??? */
                 if (sc)
@@ -1797,7 +1820,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
   unsigned char             type, type_2;
   char                      *ptype;
   short                     *S1;
-  int                       ij, ii, jj, fij, fi, u, en, *my_c, *my_fML, *my_ggg,
+  int                       ij, ii, jj, fij, fi, u, en, *my_ggg,
                             turn, *idx, with_gquad, dangle_model, *rtype, kk, cnt,
                             with_ud;
   vrna_param_t              *P;
@@ -1818,8 +1841,6 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
   S1          = vc->sequence_encoding;
   domains_up  = vc->domains_up;
 
-  my_c          = vc->matrices->c;
-  my_fML        = vc->matrices->fML;
   my_ggg        = vc->matrices->ggg;
   turn          = md->min_loop_size;
   with_gquad    = md->gquad;
@@ -1845,12 +1866,12 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
   if (with_ud) {
     /* nibble off unpaired stretches at 3' site */
     do {
-      fij = my_fML[idx[jj] + ii];
+      fij = vrna_mx_mfe_fML(vc->matrices, idx, ii, jj);
       fi  = INF;
 
       /* process regular unpaired nucleotides (unbound by ligand) first */
       if (evaluate(ii, jj, ii, jj - 1, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-        fi = my_fML[idx[jj - 1] + ii] + P->MLbase;
+        fi = vrna_mx_mfe_fML(vc->matrices, idx, ii, jj - 1) + P->MLbase;
 
         if (sc) {
           if (sc->energy_up)
@@ -1885,7 +1906,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
               en += sc->f(ii, jj, ii, jj - u, VRNA_DECOMP_ML_ML, sc->data);
           }
 
-          fi  = my_fML[idx[kk - 1] + ii] + u * P->MLbase;
+          fi  = vrna_mx_mfe_fML(vc->matrices, idx, ii, kk - 1) + u * P->MLbase;
           fi  += en;
 
           if (fij == fi) {
@@ -1902,12 +1923,12 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
 
     /* nibble off unpaired stretches at 5' site */
     do {
-      fij = my_fML[idx[jj] + ii];
+      fij = vrna_mx_mfe_fML(vc->matrices, idx, ii, jj);
       fi  = INF;
 
       /* again, process regular unpaired nucleotides (unbound by ligand) first */
       if (evaluate(ii, jj, ii + 1, jj, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-        fi = my_fML[idx[jj] + ii + 1] + P->MLbase;
+        fi = vrna_mx_mfe_fML(vc->matrices, idx, ii + 1, jj) + P->MLbase;
 
         if (sc) {
           if (sc->energy_up)
@@ -1942,7 +1963,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
               en += sc->f(ii, jj, ii + u, jj, VRNA_DECOMP_ML_ML, sc->data);
           }
 
-          fi  = my_fML[idx[jj] + kk + 1] + u * P->MLbase;
+          fi  = vrna_mx_mfe_fML(vc->matrices, idx, kk + 1, jj) + u * P->MLbase;
           fi  += en;
 
           if (fij == fi) {
@@ -1959,11 +1980,11 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
   } else {
     /* nibble off unpaired 3' bases */
     do {
-      fij = my_fML[idx[jj] + ii];
+      fij = vrna_mx_mfe_fML(vc->matrices, idx, ii, jj);
       fi  = INF;
 
       if (evaluate(ii, jj, ii, jj - 1, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-        fi = my_fML[idx[jj - 1] + ii] + P->MLbase;
+        fi = vrna_mx_mfe_fML(vc->matrices, idx, ii, jj - 1) + P->MLbase;
 
         if (sc) {
           if (sc->energy_up)
@@ -1979,11 +2000,11 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
 
     /* nibble off unpaired 5' bases */
     do {
-      fij = my_fML[idx[jj] + ii];
+      fij = vrna_mx_mfe_fML(vc->matrices, idx, ii, jj);
       fi  = INF;
 
       if (evaluate(ii, jj, ii + 1, jj, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-        fi = my_fML[idx[jj] + ii + 1] + P->MLbase;
+        fi = vrna_mx_mfe_fML(vc->matrices, idx, ii + 1, jj) + P->MLbase;
 
         if (sc) {
           if (sc->energy_up)
@@ -2017,7 +2038,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
   }
 
   type  = (unsigned char)ptype[ij];
-  en    = my_c[ij];
+  en    = vrna_mx_mfe_c(vc->matrices, idx, ii, jj);
 
   if (sc)
     if (sc->f)
@@ -2081,7 +2102,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
         if (type == 0)
           type = 7;
 
-        if (tmp_en == my_c[ij + 1] + E_MLstem(type, S1[ii], -1, P) + P->MLbase) {
+        if (tmp_en == vrna_mx_mfe_c(vc->matrices, idx, ii + 1, jj) + E_MLstem(type, S1[ii], -1, P) + P->MLbase) {
           *i          = *j = -1;
           *k          = ii + 1;
           *l          = jj;
@@ -2103,7 +2124,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
         if (type == 0)
           type = 7;
 
-        if (tmp_en == my_c[idx[jj - 1] + ii] + E_MLstem(type, -1, S1[jj], P) + P->MLbase) {
+        if (tmp_en == vrna_mx_mfe_c(vc->matrices, idx, ii, jj - 1) + E_MLstem(type, -1, S1[jj], P) + P->MLbase) {
           *i          = *j = -1;
           *k          = ii;
           *l          = jj - 1;
@@ -2125,7 +2146,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
         if (type == 0)
           type = 7;
 
-        if (tmp_en == my_c[idx[jj - 1] + ii + 1] + E_MLstem(type, S1[ii], S1[jj], P) + 2 * P->MLbase) {
+        if (tmp_en == vrna_mx_mfe_c(vc->matrices, idx, ii + 1, jj - 1) + E_MLstem(type, S1[ii], S1[jj], P) + 2 * P->MLbase) {
           *i          = *j = -1;
           *k          = ii + 1;
           *l          = jj - 1;
@@ -2139,7 +2160,7 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
 
   /* 2. Test for possible split point */
   for (u = ii + 1 + turn; u <= jj - 2 - turn; u++) {
-    en = my_fML[idx[u] + ii] + my_fML[idx[jj] + u + 1];
+    en = vrna_mx_mfe_fML(vc->matrices, idx, ii, u) + vrna_mx_mfe_fML(vc->matrices, idx, u + 1, jj);
     if (sc)
       if (sc->f)
         en += sc->f(ii, jj, u, u + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
@@ -2166,7 +2187,8 @@ vrna_BT_mb_loop_split(vrna_fold_compound_t  *vc,
         if (type_2 == 0)
           type_2 = 7;
 
-        tmp_en = my_c[ik] + my_c[k1j] + P->stack[type][type_2] + 2 * P->MLintern[1];
+        tmp_en = vrna_mx_mfe_c(vc->matrices, idx, ii, u) + vrna_mx_mfe_c(vc->matrices, idx, u + 1, jj) +
+                 P->stack[type][type_2] + 2 * P->MLintern[1];
         if (sc)
           if (sc->f)
             tmp_en += sc->f(ii, u, u + 1, jj, VRNA_DECOMP_ML_COAXIAL, sc->data);
@@ -2200,7 +2222,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
   short                     s5, s3, *S1;
   unsigned int              *sn;
   int                       ij, p, q, r, e, tmp_en, cp, *idx, turn, dangle_model,
-                            *my_c, *my_fML, *my_fc, *rtype;
+                            *my_fc, *rtype;
   vrna_param_t              *P;
   vrna_md_t                 *md;
   vrna_hc_t                 *hc;
@@ -2217,8 +2239,6 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
   sn            = vc->strand_number;
   hc            = vc->hc;
   sc            = vc->sc;
-  my_c          = vc->matrices->c;
-  my_fML        = vc->matrices->fML;
   my_fc         = vc->matrices->fc;
   turn          = md->min_loop_size;
   ptype         = vc->ptype;
@@ -2350,7 +2370,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
         }
         for (r = *i + 2 + turn; r < *j - 2 - turn; ++r) {
           if (evaluate(p, q, r, r + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-            tmp_en = my_fML[idx[r] + p] + my_fML[idx[q] + r + 1];
+            tmp_en = vrna_mx_mfe_fML(vc->matrices, idx, p, r) + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q);
             if (sc)
               if (sc->f)
                 tmp_en += sc->f(p, q, r, r + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
@@ -2370,7 +2390,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
         }
         for (r = p + turn + 1; r < q - turn - 1; ++r) {
           if (evaluate(p, q, r, r + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-            tmp_en = my_fML[idx[r] + p] + my_fML[idx[q] + r + 1];
+            tmp_en = vrna_mx_mfe_fML(vc->matrices, idx, p, r) + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q);
             if (sc)
               if (sc->f)
                 tmp_en += sc->f(p, q, r, r + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
@@ -2387,7 +2407,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
             e -= sc->energy_bp[ij];
         for (r = p + turn + 1; r < q - turn - 1; ++r) {
           if (evaluate(p, q, r, r + 1, VRNA_DECOMP_ML_ML_ML, &hc_dat_local)) {
-            tmp_en = my_fML[idx[r] + p] + my_fML[idx[q] + r + 1] + E_MLstem(type, -1, -1, P);
+            tmp_en = vrna_mx_mfe_fML(vc->matrices, idx, p, r) + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q) + E_MLstem(type, -1, -1, P);
             if (sc) {
               if (sc->f) {
                 tmp_en  += sc->f(*i, *j, p, q, VRNA_DECOMP_PAIR_ML, sc->data);
@@ -2409,7 +2429,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
                   tmp_en  -= sc->f(p + 1, q, r, r + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
                 }
               }
-              if (tmp_en == my_fML[idx[r] + p + 1] + my_fML[idx[q] + r + 1] + E_MLstem(type, -1, s3, P) + P->MLbase) {
+              if (tmp_en == vrna_mx_mfe_fML(vc->matrices, idx, p + 1, r) + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q) + E_MLstem(type, -1, s3, P) + P->MLbase) {
                 p += 1;
                 break;
               }
@@ -2427,7 +2447,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
                   tmp_en  -= sc->f(p, q - 1, r, r + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
                 }
               }
-              if (tmp_en == my_fML[idx[r] + p] + my_fML[idx[q - 1] + r + 1] + E_MLstem(type, s5, -1, P) + P->MLbase) {
+              if (tmp_en == vrna_mx_mfe_fML(vc->matrices, idx, p, r) + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q - 1) + E_MLstem(type, s5, -1, P) + P->MLbase) {
                 q -= 1;
                 break;
               }
@@ -2445,7 +2465,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
                   tmp_en  -= sc->f(p + 1, q - 1, r, r + 1, VRNA_DECOMP_ML_ML_ML, sc->data);
                 }
               }
-              if (tmp_en == my_fML[idx[r] + p + 1] + my_fML[idx[q - 1] + r + 1] + E_MLstem(type, s5, s3, P) + 2 * P->MLbase) {
+              if (tmp_en == vrna_mx_mfe_fML(vc->matrices, idx, p + 1, r) + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q - 1) + E_MLstem(type, s5, s3, P) + 2 * P->MLbase) {
                 p += 1;
                 q -= 1;
                 break;
@@ -2463,7 +2483,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
               if (type_2 == 0)
                 type_2 = 7;
 
-              tmp_en = my_c[idx[r] + p] + P->stack[tt][type_2] + my_fML[idx[q] + r + 1];
+              tmp_en = vrna_mx_mfe_c(vc->matrices, idx, p, r) + P->stack[tt][type_2] + vrna_mx_mfe_fML(vc->matrices, idx, r + 1, q);
               if (sc) {
                 if (sc->f) {
                   tmp_en  += sc->f(*i, *j, p, q, VRNA_DECOMP_PAIR_ML, sc->data);
@@ -2482,7 +2502,7 @@ vrna_BT_mb_loop(vrna_fold_compound_t  *vc,
               if (type_2 == 0)
                 type_2 = 7;
 
-              tmp_en = my_c[idx[q] + r + 1] + P->stack[tt][type_2] + my_fML[idx[r] + p];
+              tmp_en = vrna_mx_mfe_c(vc->matrices, idx, r + 1, q) + P->stack[tt][type_2] + vrna_mx_mfe_fML(vc->matrices, idx, p, r);
               if (sc) {
                 if (sc->f) {
                   tmp_en  += sc->f(*i, *j, p, q, VRNA_DECOMP_PAIR_ML, sc->data);
@@ -2801,8 +2821,7 @@ exp_E_ml_fast(vrna_fold_compound_t  *vc,
       temp    += q_temp;
     }
   } else {
-    for (k = j; k > i; k--, kl++)
-      temp += qm[kl] * qqm[k];
+    temp = vrna_fun_zip_rmul_sum(qm + kl, qqm + i + 1, j - i);
   }
 
   maxk  = MIN2(i + hc_up_ml[i], j);
@@ -2951,10 +2970,8 @@ exp_E_ml_fast_comparative(vrna_fold_compound_t  *vc,
    *  construction of qm matrix containing multiple loop
    *  partition function contributions from segment i,j
    */
-  temp  = 0.0;
   kl    = iidx[i] - j + 1; /* ii-k=[i,k-1] */
-  for (k = j; k > i; k--, kl++)
-    temp += qm[kl] * qqm[k];
+  temp  = vrna_fun_zip_rmul_sum(qm + kl, qqm + i + 1, j - i);
 
   maxk  = MIN2(i + hc_up_ml[i], j);
   ii    = maxk - i; /* length of unpaired stretch */
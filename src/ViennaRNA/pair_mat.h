@@ -137,7 +137,7 @@ static short *encode_sequence(const char *sequence, short how){
     case 0:   for(i=1; i<=l; i++) /* make numerical encoding of sequence */
                 S[i]= (short) encode_char(toupper(sequence[i-1]));
               S[l+1] = S[1];
-              S[0] = (short) l;
+              S[0] = (short)(unsigned short) l;
               break;
     /* encoding for mismatches of nostandard bases (normally used for S1) */
     case 1:   for(i=1; i<=l; i++)
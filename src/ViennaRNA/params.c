@@ -53,6 +53,26 @@ PRIVATE int pf_id=-1;
 #pragma omp threadprivate(id, pf_id)
 #endif
 
+/* maximum number of unreferenced parameter sets kept in the cache */
+#define PARAM_CACHE_MAX_UNUSED  16
+
+typedef enum {
+  PARAM_CACHE_ENERGIES,
+  PARAM_CACHE_BOLTZMANN
+} param_cache_type;
+
+typedef struct {
+  param_cache_type  type;
+  void              *data;      /* either vrna_param_t, or vrna_exp_param_t */
+  unsigned int      ref_count;
+  int               stale;      /* global energy tables changed after creation */
+} param_cache_entry;
+
+/* cache of shared, reference counted parameter sets (protected by critical section 'vrna_params_cache') */
+PRIVATE param_cache_entry *param_cache      = NULL;
+PRIVATE unsigned int      param_cache_size  = 0;
+PRIVATE unsigned int      param_cache_mem   = 0;
+
 /*
 #################################
 # PRIVATE FUNCTION DECLARATIONS #
@@ -63,6 +83,12 @@ PRIVATE vrna_param_t      *get_scaled_params(vrna_md_t *md);
 PRIVATE vrna_exp_param_t  *get_scaled_exp_params(vrna_md_t *md, double pfs);
 PRIVATE vrna_exp_param_t  *get_exp_params_ali(vrna_md_t *md, unsigned int n_seq, double pfs);
 PRIVATE void              rescale_params(vrna_fold_compound_t *vc);
+PRIVATE void              *param_cache_get(param_cache_type type, vrna_md_t *md);
+PRIVATE int               param_cache_release(void *data);
+PRIVATE int               param_cache_contains(void *data);
+PRIVATE void              param_cache_remove(unsigned int i);
+PRIVATE void              param_cache_evict(void);
+PRIVATE int               md_equal_shared(vrna_md_t *a, vrna_md_t *b);
 
 /*
 #################################
@@ -128,13 +154,136 @@ vrna_exp_params_copy(vrna_exp_param_t *par){
   return copy;
 }
 
+PUBLIC vrna_param_t *
+vrna_params_shared(vrna_md_t *md){
+
+  vrna_param_t  *P;
+  vrna_md_t     md_default;
+
+  if(!md){
+    vrna_md_set_default(&md_default);
+    md = &md_default;
+  }
+
+#ifdef _OPENMP
+#pragma omp critical (vrna_params_cache)
+#endif
+  {
+    P = (vrna_param_t *)param_cache_get(PARAM_CACHE_ENERGIES, md);
+  }
+
+  return P;
+}
+
+PUBLIC vrna_exp_param_t *
+vrna_exp_params_shared(vrna_md_t *md){
+
+  vrna_exp_param_t  *pf;
+  vrna_md_t         md_default;
+
+  if(!md){
+    vrna_md_set_default(&md_default);
+    md = &md_default;
+  }
+
+#ifdef _OPENMP
+#pragma omp critical (vrna_params_cache)
+#endif
+  {
+    pf = (vrna_exp_param_t *)param_cache_get(PARAM_CACHE_BOLTZMANN, md);
+  }
+
+  return pf;
+}
+
+PUBLIC void
+vrna_params_release(vrna_param_t *P){
+
+  int shared;
+
+  if(P){
+#ifdef _OPENMP
+#pragma omp critical (vrna_params_cache)
+#endif
+    {
+      shared = param_cache_release((void *)P);
+    }
+
+    if(!shared)
+      free(P);
+  }
+}
+
+PUBLIC void
+vrna_exp_params_release(vrna_exp_param_t *pf){
+
+  int shared;
+
+  if(pf){
+#ifdef _OPENMP
+#pragma omp critical (vrna_params_cache)
+#endif
+    {
+      shared = param_cache_release((void *)pf);
+    }
+
+    if(!shared)
+      free(pf);
+  }
+}
+
+PUBLIC vrna_param_t *
+vrna_params_detach(vrna_fold_compound_t *vc){
+
+  int           shared;
+  vrna_param_t  *P;
+
+  if(vc && vc->params){
+#ifdef _OPENMP
+#pragma omp critical (vrna_params_cache)
+#endif
+    {
+      shared = param_cache_contains((void *)vc->params);
+    }
+
+    if(shared){
+      P = vrna_params_copy(vc->params);
+      vrna_params_release(vc->params);
+      vc->params = P;
+    }
+
+    return vc->params;
+  }
+
+  return NULL;
+}
+
+PUBLIC void
+vrna_params_cache_clear(void){
+
+  unsigned int i;
+
+#ifdef _OPENMP
+#pragma omp critical (vrna_params_cache)
+#endif
+  {
+    /* parameter sets still in use are released once their last reference is dropped */
+    for(i = param_cache_size; i > 0; i--){
+      if(param_cache[i - 1].ref_count == 0)
+        param_cache_remove(i - 1);
+      else
+        param_cache[i - 1].stale = 1;
+    }
+  }
+}
+
 PUBLIC void
 vrna_params_subst( vrna_fold_compound_t *vc,
                     vrna_param_t *parameters){
 
   if(vc){
     if(vc->params)
-      free(vc->params);
+      vrna_params_release(vc->params);
     if(parameters){
       vc->params = vrna_params_copy(parameters);
     } else {
@@ -159,7 +308,7 @@ vrna_params_reset(vrna_fold_compound_t *vc,
       case VRNA_FC_TYPE_SINGLE:     /* fall through */
 
       case VRNA_FC_TYPE_COMPARATIVE:  if(vc->params)
-                                      free(vc->params);
+                                      vrna_params_release(vc->params);
                                     vc->params = vrna_params(md_p);
                                     break;
 
@@ -749,6 +898,147 @@ rescale_params(vrna_fold_compound_t *vc){
 }
 
 
+PRIVATE void *
+param_cache_get(param_cache_type  type,
+                vrna_md_t         *md){
+
+  unsigned int  i;
+  vrna_md_t     *md_cached;
+  void          *data;
+
+  for(i = 0; i < param_cache_size; i++){
+    if((param_cache[i].type != type) || (param_cache[i].stale))
+      continue;
+
+    md_cached = (type == PARAM_CACHE_ENERGIES) ? \
+                &(((vrna_param_t *)param_cache[i].data)->model_details) : \
+                &(((vrna_exp_param_t *)param_cache[i].data)->model_details);
+
+    if(md_equal_shared(md, md_cached)){
+      param_cache[i].ref_count++;
+      return param_cache[i].data;
+    }
+  }
+
+  data = (type == PARAM_CACHE_ENERGIES) ? \
+         (void *)get_scaled_params(md) : \
+         (void *)get_scaled_exp_params(md, -1.);
+
+  if(param_cache_size == param_cache_mem){
+    param_cache_mem = (param_cache_mem) ? 2 * param_cache_mem : 8;
+    param_cache     = (param_cache_entry *)vrna_realloc(param_cache, sizeof(param_cache_entry) * param_cache_mem);
+  }
+
+  param_cache[param_cache_size].type      = type;
+  param_cache[param_cache_size].data      = data;
+  param_cache[param_cache_size].ref_count = 1;
+  param_cache[param_cache_size].stale     = 0;
+  param_cache_size++;
+
+  param_cache_evict();
+
+  return data;
+}
+
+PRIVATE int
+param_cache_release(void *data){
+
+  unsigned int i;
+
+  for(i = 0; i < param_cache_size; i++)
+    if(param_cache[i].data == data){
+      if(param_cache[i].ref_count > 0)
+        param_cache[i].ref_count--;
+
+      if(param_cache[i].ref_count == 0){
+        if(param_cache[i].stale)
+          param_cache_remove(i);
+        else
+          param_cache_evict();
+      }
+
+      return 1;
+    }
+
+  return 0;
+}
+
+PRIVATE int
+param_cache_contains(void *data){
+
+  unsigned int i;
+
+  for(i = 0; i < param_cache_size; i++)
+    if(param_cache[i].data == data)
+      return 1;
+
+  return 0;
+}
+
+PRIVATE void
+param_cache_remove(unsigned int i){
+
+  free(param_cache[i].data);
+  memmove(param_cache + i, param_cache + i + 1, sizeof(param_cache_entry) * (param_cache_size - i - 1));
+  param_cache_size--;
+
+  if(param_cache_size == 0){
+    free(param_cache);
+    param_cache     = NULL;
+    param_cache_mem = 0;
+  }
+}
+
+/* drop the least recently created, unreferenced parameter sets */
+PRIVATE void
+param_cache_evict(void){
+
+  unsigned int  i, unused;
+
+  for(unused = 0, i = 0; i < param_cache_size; i++)
+    if(param_cache[i].ref_count == 0)
+      unused++;
+
+  for(i = 0; (i < param_cache_size) && (unused > PARAM_CACHE_MAX_UNUSED);){
+    if(param_cache[i].ref_count == 0){
+      param_cache_remove(i);
+      unused--;
+    } else {
+      i++;
+    }
+  }
+}
+
+/*
+ *  Compare two sets of model details for the purpose of parameter sharing.
+ *  The window size is not considered since the parameters do not depend on it,
+ *  and all recursions use the window size stored in the fold compound instead.
+ *  Any other member is part of the key, so we compare the raw memory of two
+ *  normalized copies rather than listing the members one by one. Differences
+ *  in padding bytes merely lead to a cache miss.
+ */
+PRIVATE int
+md_equal_shared(vrna_md_t *a,
+                vrna_md_t *b){
+
+  char      *end;
+  vrna_md_t ca, cb;
+
+  memcpy(&ca, a, sizeof(vrna_md_t));
+  memcpy(&cb, b, sizeof(vrna_md_t));
+
+  ca.window_size = cb.window_size = 0;
+
+  /* ignore anything beyond the end of the non-standard base pair string */
+  if((end = memchr(ca.nonstandards, '\0', sizeof(ca.nonstandards))))
+    memset(end, 0, ca.nonstandards + sizeof(ca.nonstandards) - end);
+  if((end = memchr(cb.nonstandards, '\0', sizeof(cb.nonstandards))))
+    memset(end, 0, cb.nonstandards + sizeof(cb.nonstandards) - end);
+
+  return (memcmp(&ca, &cb, sizeof(vrna_md_t))) ? 0 : 1;
+}
+
+
 #ifdef  VRNA_BACKWARD_COMPAT
 
 /*###########################################*/
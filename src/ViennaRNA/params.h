@@ -235,6 +235,97 @@ vrna_exp_params_comparative(unsigned int n_seq,
 vrna_exp_param_t *
 vrna_exp_params_copy(vrna_exp_param_t *par);
 
+/**
+ *  @brief  Get a shared, reference counted set of free energy parameters
+ *
+ *  Free energy parameters only depend on the model details and the currently loaded
+ *  energy parameter tables. This function therefore returns a parameter set from a
+ *  global cache that is shared among all callers requesting the same model details,
+ *  and creates it only upon the first request. Every call increases the reference
+ *  counter of the parameter set, and each reference must be dropped by a call to
+ *  vrna_params_release() once it is no longer needed.
+ *
+ *  The window size of the model details is not considered when looking up a shared
+ *  parameter set.
+ *
+ *  @note   Shared parameter sets are immutable, and thus may be used concurrently by
+ *          many #vrna_fold_compound_t and threads. Use vrna_params_detach() to obtain
+ *          a private copy in a #vrna_fold_compound_t that is about to be modified.
+ *
+ *  @see    vrna_params_release(), vrna_params_cache_clear(), vrna_exp_params_shared()
+ *
+ *  @param  md  A pointer to the model details of the parameter set (Maybe NULL)
+ *  @return     A pointer to the shared free energy parameters
+ */
+vrna_param_t *
+vrna_params_shared(vrna_md_t *md);
+
+/**
+ *  @brief  Get a shared, reference counted set of Boltzmann factors
+ *
+ *  This is the Boltzmann factor equivalent of vrna_params_shared(). The returned
+ *  data structure must neither be modified, nor be used for partition function
+ *  computations that change its scaling factor. Use vrna_exp_params_copy() to
+ *  obtain a private, modifiable copy instead.
+ *
+ *  @see    vrna_exp_params_release(), vrna_params_shared(), vrna_exp_params_copy()
+ *
+ *  @param  md  A pointer to the model details of the parameter set (Maybe NULL)
+ *  @return     A pointer to the shared Boltzmann factors
+ */
+vrna_exp_param_t *
+vrna_exp_params_shared(vrna_md_t *md);
+
+/**
+ *  @brief  Drop a reference to a set of free energy parameters
+ *
+ *  Shared parameter sets obtained from vrna_params_shared() stay in the cache for
+ *  later re-use when their last reference is dropped. Any other parameter set,
+ *  e.g. one obtained from vrna_params(), is simply free'd.
+ *
+ *  @see    vrna_params_shared()
+ *
+ *  @param  P   The free energy parameters to release (Maybe NULL)
+ */
+void
+vrna_params_release(vrna_param_t *P);
+
+/**
+ *  @brief  Drop a reference to a set of Boltzmann factors
+ *
+ *  @see    vrna_exp_params_shared(), vrna_params_release()
+ *
+ *  @param  pf  The Boltzmann factors to release (Maybe NULL)
+ */
+void
+vrna_exp_params_release(vrna_exp_param_t *pf);
+
+/**
+ *  @brief  Make the free energy parameters of a #vrna_fold_compound_t private
+ *
+ *  If the free energy parameters of the fold compound are shared with others, they
+ *  are replaced by a private copy that may then be modified safely.
+ *
+ *  @see    vrna_params_shared()
+ *
+ *  @param  vc  The fold compound data structure
+ *  @return     A pointer to the (now private) free energy parameters of `vc`
+ */
+vrna_param_t *
+vrna_params_detach(vrna_fold_compound_t *vc);
+
+/**
+ *  @brief  Clear the cache of shared energy parameters
+ *
+ *  This function is called automatically whenever a new energy parameter file is
+ *  read. Parameter sets that are still in use remain valid until their last reference
+ *  is dropped, but will not be handed out to subsequent requests anymore.
+ *
+ *  @see    vrna_params_shared(), vrna_exp_params_shared()
+ */
+void
+vrna_params_cache_clear(void);
+
 /**
  *  @brief  Update/Reset energy parameters data structure within a #vrna_fold_compound_t
  *
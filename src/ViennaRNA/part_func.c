@@ -29,6 +29,9 @@
 #include <omp.h>
 #endif
 
+/* maximum number of times the scaling factor is adjusted to avoid over- and underflows in vrna_pf() */
+#define PF_MAX_RESCALE  16
+
 /*
 #################################
 # GLOBAL VARIABLES              #
@@ -62,9 +65,16 @@ PRIVATE int                 backward_compat           = 0;
 #################################
 */
 PRIVATE void  pf_circ(vrna_fold_compound_t *vc);
-PRIVATE void  pf_linear(vrna_fold_compound_t *vc);
-PRIVATE void  alipf_linear(vrna_fold_compound_t *vc);
+PRIVATE int   pf_linear(vrna_fold_compound_t *vc);
+PRIVATE int   alipf_linear(vrna_fold_compound_t *vc);
 PRIVATE void  wrap_alipf_circ(vrna_fold_compound_t *vc, char *structure);
+PRIVATE int   pf_rescale(vrna_fold_compound_t *vc, int overflow, int *adjusted, double *range);
+PRIVATE int   pf_underflow(vrna_fold_compound_t *vc, double *Q, int *length);
+PRIVATE INLINE int use_wavefront(vrna_fold_compound_t *vc);
+PRIVATE int   pf_fill_wavefront(vrna_fold_compound_t *vc, vrna_mx_pf_aux_el_t *aux_mx_el, vrna_mx_pf_aux_ml_t *aux_mx_ml);
+PRIVATE void  pf_fill_cell_wavefront(vrna_fold_compound_t *vc, int i, int j, vrna_mx_pf_aux_el_t *el, vrna_mx_pf_aux_ml_t *ml, FLT_OR_DBL *QQ, FLT_OR_DBL *QQM1);
+PRIVATE vrna_mx_pf_aux_el_t *pf_aux_el_thread_copy(vrna_fold_compound_t *vc, vrna_mx_pf_aux_el_t *aux_mx);
+PRIVATE vrna_mx_pf_aux_ml_t *pf_aux_ml_thread_copy(vrna_fold_compound_t *vc, vrna_mx_pf_aux_ml_t *aux_mx);
 
 #ifdef  VRNA_BACKWARD_COMPAT
 
@@ -163,9 +173,9 @@ PUBLIC float
 vrna_pf(vrna_fold_compound_t  *vc,
         char                  *structure){
 
-  int               n;
+  int               n, overflow, underflow, attempt, adjusted, length;
   FLT_OR_DBL        Q;
-  double            free_energy;
+  double            free_energy, min_real, Qu, range[2];
   vrna_md_t         *md;
   vrna_exp_param_t  *params;
   vrna_mx_pf_t      *matrices;
@@ -201,77 +211,110 @@ vrna_pf(vrna_fold_compound_t  *vc,
     if(vc->stat_cb)
       vc->stat_cb(VRNA_STATUS_PF_PRE, vc->auxdata);
 
-    switch(vc->type){
-      case VRNA_FC_TYPE_SINGLE:     /* do the linear pf fold and fill all matrices  */
-                                    pf_linear(vc);
-
-                                    if(md->circ)
-                                      pf_circ(vc); /* do post processing step for circular RNAs */
-
-                                    break;
-
-      case VRNA_FC_TYPE_COMPARATIVE:  /* do the linear pf fold and fill all matrices  */
-                                    alipf_linear(vc);
-
-                                    /* calculate post processing step for circular  */
-                                    /* RNAs                                         */
-                                    if(md->circ)
-                                      wrap_alipf_circ(vc, structure);
+    /*
+        fill the matrices, and repeat with an adjusted scaling factor
+        whenever the partition functions over- or underflow
+    */
+    adjusted  = 0;
+    underflow = 0;
+    min_real  = (vrna_pf_float_precision()) ? FLT_MIN : DBL_MIN;
+    range[0]  = 0.;       /* largest scaling factor that led to an overflow */
+    range[1]  = DBL_MAX;  /* smallest scaling factor that led to a complete underflow */
+    for (attempt = 0; ; attempt++) {
+      switch(vc->type){
+        case VRNA_FC_TYPE_SINGLE:     /* do the linear pf fold and fill all matrices  */
+                                      overflow = pf_linear(vc);
+
+                                      if((!overflow) && (md->circ))
+                                        pf_circ(vc); /* do post processing step for circular RNAs */
+
+                                      break;
+
+        case VRNA_FC_TYPE_COMPARATIVE:  /* do the linear pf fold and fill all matrices  */
+                                      overflow = alipf_linear(vc);
+
+                                      /* calculate post processing step for circular  */
+                                      /* RNAs                                         */
+                                      if((!overflow) && (md->circ))
+                                        wrap_alipf_circ(vc, structure);
+
+                                      break;
+
+        default:                      vrna_message_warning("vrna_pf@part_func.c: Unrecognized fold compound type");
+                                      return free_energy;
+                                      break;
+      }
 
-                                    break;
+      if ((!overflow) && (md->circ) && (matrices->qo >= ((vrna_pf_float_precision()) ? FLT_MAX : DBL_MAX) / 10.))
+        overflow = n;
 
-      default:                      vrna_message_warning("vrna_pf@part_func.c: Unrecognized fold compound type");
-                                    return free_energy;
-                                    break;
+      if ((attempt == PF_MAX_RESCALE) || (!pf_rescale(vc, overflow, &adjusted, range)))
+        break;
     }
 
+    /*  the partition functions of the entire sequence and all its prefixes and suffixes
+        must be representable. Otherwise, the free energy is meaningless and the outside
+        recursion produces NaNs
+    */
+    if (!overflow) {
+      Qu        = (md->circ) ? matrices->qo : matrices->q[vc->iindx[1] - n];
+      underflow = pf_underflow(vc, &Qu, &length);
+    }
 
-    /* call user-defined recursion status callback function */
-    if(vc->stat_cb)
-      vc->stat_cb(VRNA_STATUS_PF_POST, vc->auxdata);
+    if (overflow || underflow) {
+      vrna_message_warning("vrna_pf@part_func.c: partition function %s despite %d adjustments "
+                           "of the scaling factor, no single pf_scale covers the range of "
+                           "Boltzmann weights of this sequence",
+                           (overflow) ? "overflows" : "underflows",
+                           attempt);
+    } else {
+      /* call user-defined recursion status callback function */
+      if(vc->stat_cb)
+        vc->stat_cb(VRNA_STATUS_PF_POST, vc->auxdata);
 
-    /* calculate base pairing probability matrix (bppm)  */
-    if(md->compute_bpp){
-      vrna_pairing_probs(vc, structure);
+      /* calculate base pairing probability matrix (bppm)  */
+      if(md->compute_bpp){
+        vrna_pairing_probs(vc, structure);
 
 #ifdef  VRNA_BACKWARD_COMPAT
 
-      /*
-      *  Backward compatibility:
-      *  This block may be removed if deprecated functions
-      *  relying on the global variable "pr" vanish from within the package!
-      */
-      pr = matrices->probs;
-      /*
-       {
-        if(pr) free(pr);
-        pr = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL) * ((n+1)*(n+2)/2));
-        memcpy(pr, probs, sizeof(FLT_OR_DBL) * ((n+1)*(n+2)/2));
-      }
-      */
+        /*
+        *  Backward compatibility:
+        *  This block may be removed if deprecated functions
+        *  relying on the global variable "pr" vanish from within the package!
+        */
+        pr = matrices->probs;
+        /*
+         {
+          if(pr) free(pr);
+          pr = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL) * ((size_t)(n+1)*(n+2)/2));
+          memcpy(pr, probs, sizeof(FLT_OR_DBL) * ((size_t)(n+1)*(n+2)/2));
+        }
+        */
 
 #endif
 
-    }
+      }
 
-    if (md->backtrack_type=='C')
-      Q = matrices->qb[vc->iindx[1]-n];
-    else if (md->backtrack_type=='M')
-      Q = matrices->qm[vc->iindx[1]-n];
-    else Q = (md->circ) ? matrices->qo : matrices->q[vc->iindx[1]-n];
+      if (md->backtrack_type=='C')
+        Q = matrices->qb[vc->iindx[1]-n];
+      else if (md->backtrack_type=='M')
+        Q = matrices->qm[vc->iindx[1]-n];
+      else Q = (md->circ) ? matrices->qo : matrices->q[vc->iindx[1]-n];
 
-    /* ensemble free energy in Kcal/mol              */
-    if (Q<=FLT_MIN)
-      vrna_message_warning("pf_scale too large");
+      /* ensemble free energy in Kcal/mol              */
+      if (Q <= min_real)
+        vrna_message_warning("pf_scale too large");
 
-    switch(vc->type){
-      case VRNA_FC_TYPE_COMPARATIVE:  free_energy = (-log(Q)-n*log(params->pf_scale))*params->kT/(1000.0 * vc->n_seq);
-                                    break;
+      switch(vc->type){
+        case VRNA_FC_TYPE_COMPARATIVE:  free_energy = (-log(Q)-n*log(params->pf_scale))*params->kT/(1000.0 * vc->n_seq);
+                                      break;
 
-      case VRNA_FC_TYPE_SINGLE:     /* fall through */
+        case VRNA_FC_TYPE_SINGLE:     /* fall through */
 
-      default:                      free_energy = (-log(Q)-n*log(params->pf_scale))*params->kT/1000.0;
-                                    break;
+        default:                      free_energy = (-log(Q)-n*log(params->pf_scale))*params->kT/1000.0;
+                                      break;
+      }
     }
 
 #ifdef SUN4
@@ -286,12 +329,16 @@ vrna_pf(vrna_fold_compound_t  *vc,
   return free_energy;
 }
 
-PRIVATE void
+/*
+    fill the DP matrices for single sequences, returns the length of the first
+    segment whose partition function (almost) overflowed, or 0 on success
+*/
+PRIVATE int
 pf_linear(vrna_fold_compound_t *vc){
 
   char                *hard_constraints;
   int                 n, i,j, k, ij, d, *my_iindx, *jindx, with_gquad, turn,
-                      with_ud, hc_decompose;
+                      with_ud, hc_decompose, overflow;
   FLT_OR_DBL          temp, Qmax, qbt1, *q, *qb, *qm, *qm1, *q1k, *qln;
   double              max_real;
   vrna_ud_t           *domains_up;
@@ -322,6 +369,7 @@ pf_linear(vrna_fold_compound_t *vc){
 
   with_ud           = (domains_up && domains_up->exp_energy_cb);
   Qmax              = 0;
+  overflow          = 0;
 
   max_real = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
 
@@ -346,52 +394,55 @@ pf_linear(vrna_fold_compound_t *vc){
       qb[ij] = 0.0;
     }
 
-  for (j = turn + 2; j <= n; j++) {
-    for (i = j - turn - 1; i >= 1; i--) {
-      /* construction of partition function of segment i,j */
-      /* firstly that given i binds j : qb(i,j) */
-      ij            = my_iindx[i] - j;
-      hc_decompose  = hard_constraints[jindx[j] + i];
-      qbt1          = 0;
-
-      if(hc_decompose){
-        /* process hairpin loop(s) */
-        qbt1 += vrna_exp_E_hp_loop(vc, i, j);
-        /* process interior loop(s) */
-        qbt1 += vrna_exp_E_int_loop(vc, i, j);
-        /* process multibranch loop(s) */
-        qbt1 += vrna_exp_E_mb_loop_fast(vc, i, j, aux_mx_ml->qqm1);
-      }
-      qb[ij] = qbt1;
+  if (use_wavefront(vc)) {
+    overflow = pf_fill_wavefront(vc, aux_mx_el, aux_mx_ml);
+  } else {
+    for (j = turn + 2; (j <= n) && (!overflow); j++) {
+      for (i = j - turn - 1; i >= 1; i--) {
+        /* construction of partition function of segment i,j */
+        /* firstly that given i binds j : qb(i,j) */
+        ij            = my_iindx[i] - j;
+        hc_decompose  = hard_constraints[jindx[j] + i];
+        qbt1          = 0;
+
+        if(hc_decompose){
+          /* process hairpin loop(s) */
+          qbt1 += vrna_exp_E_hp_loop(vc, i, j);
+          /* process interior loop(s) */
+          qbt1 += vrna_exp_E_int_loop(vc, i, j);
+          /* process multibranch loop(s) */
+          qbt1 += vrna_exp_E_mb_loop_fast(vc, i, j, aux_mx_ml->qqm1);
+        }
+        qb[ij] = qbt1;
 
-      /* Multibranch loop */
-      qm[ij] = vrna_exp_E_ml_fast(vc, i, j, aux_mx_ml);
+        /* Multibranch loop */
+        qm[ij] = vrna_exp_E_ml_fast(vc, i, j, aux_mx_ml);
 
-      if (qm1)
-        qm1[jindx[j] + i] = aux_mx_ml->qqm[i]; /* for stochastic backtracking and circfold */
+        if (qm1)
+          qm1[jindx[j] + i] = aux_mx_ml->qqm[i]; /* for stochastic backtracking and circfold */
 
-      /* Exterior loop */
-      q[ij] = temp = vrna_exp_E_ext_fast(vc, i, j, aux_mx_el);
+        /* Exterior loop */
+        q[ij] = temp = vrna_exp_E_ext_fast(vc, i, j, aux_mx_el);
 
-      if (temp>Qmax) {
-        Qmax = temp;
-        if (Qmax>max_real/10.)
-          vrna_message_warning("Q close to overflow: %d %d %g", i,j,temp);
-      }
-      if (temp>=max_real) {
-        vrna_message_error("overflow in pf_fold while calculating q[%d,%d]\n"
-                                  "use larger pf_scale", i,j);
+        /* (close to) overflow, the caller needs to adjust the scaling factor */
+        if (temp > Qmax) {
+          Qmax = temp;
+          if (Qmax > max_real/10.) {
+            overflow = j - i + 1;
+            break;
+          }
+        }
       }
-    }
 
-    /* rotate auxiliary arrays */
-    vrna_exp_E_ext_fast_rotate(vc, aux_mx_el);
-    vrna_exp_E_ml_fast_rotate(vc, aux_mx_ml);
+      /* rotate auxiliary arrays */
+      vrna_exp_E_ext_fast_rotate(vc, aux_mx_el);
+      vrna_exp_E_ml_fast_rotate(vc, aux_mx_ml);
 
+    }
   }
 
   /* prefill linear qln, q1k arrays */
-  if(q1k && qln){
+  if(q1k && qln && (!overflow)){
     for (k=1; k<=n; k++) {
       q1k[k] = q[my_iindx[1] - k];
       qln[k] = q[my_iindx[k] - n];
@@ -403,6 +454,8 @@ pf_linear(vrna_fold_compound_t *vc){
   /* free memory occupied by auxiliary arrays for fast exterior/multibranch loops */
   vrna_exp_E_ml_fast_free(vc, aux_mx_ml);
   vrna_exp_E_ext_fast_free(vc, aux_mx_el);
+
+  return overflow;
 }
 
 /* calculate partition function for circular case */
@@ -498,6 +551,130 @@ pf_circ(vrna_fold_compound_t *vc){
 }
 
 
+/*
+    adjust the scaling factor after the matrices have been filled, returns 1 if
+    the matrices need to be filled again.
+    If the partition function of a segment of length 'overflow' (almost) overflowed,
+    its scaled partition function is brought back to the order of 1. Otherwise, if the
+    partition function of the entire sequence is close to underflow, the scaling factor
+    is chosen such that it becomes 1. This is done only if the scaling factor has not
+    been adjusted before, since it may cause other segments to overflow, unless the
+    partition function underflowed, see pf_underflow(). In that case, the segment
+    reported there is brought back to the order of 1 instead.
+    Larger scaling factors only shrink the scaled partition functions, so 'range' keeps
+    track of the largest factor that overflowed and the smallest one that underflowed.
+    New factors outside this bracket are replaced by its geometric mean, and we give up
+    once the bracket is too narrow to change the partition function of the entire
+    sequence by more than a factor of e, i.e. no single scaling factor fits
+*/
+PRIVATE int
+pf_rescale(vrna_fold_compound_t *vc,
+           int                  overflow,
+           int                  *adjusted,
+           double               *range){
+
+  int               n, k;
+  double            Q, log_max, min_real, pf_scale;
+  FLT_OR_DBL        *q;
+  vrna_exp_param_t  *pf_params;
+  vrna_md_t         *md;
+
+  n         = vc->length;
+  q         = vc->exp_matrices->q;
+  pf_params = vc->exp_params;
+  md        = &(pf_params->model_details);
+  log_max   = log((vrna_pf_float_precision()) ? FLT_MAX : DBL_MAX);
+  min_real  = (vrna_pf_float_precision()) ? FLT_MIN : DBL_MIN;
+  pf_scale  = pf_params->pf_scale;
+
+  if (overflow) {
+    range[0]  = MAX2(range[0], pf_scale);
+    pf_scale  *= exp(log_max / overflow);
+  } else {
+    Q = (md->circ) ? vc->exp_matrices->qo : q[vc->iindx[1] - n];
+    k = n;
+
+    if (pf_scale <= 1.)
+      return 0;
+
+    if (pf_underflow(vc, &Q, &k)) {
+      range[1] = MIN2(range[1], pf_scale);
+      if (Q <= 0.)
+        return 0;
+    } else if ((Q > exp(-log_max / 2.)) || (*adjusted)) {
+      return 0;
+    }
+
+    pf_scale = MAX2(1., pf_scale * exp(log(Q) / k));
+  }
+
+  if ((range[0] > 0.) && (range[1] < DBL_MAX)) {
+    if (n * log(range[1] / range[0]) < 1.)
+      return 0;
+
+    if ((pf_scale <= range[0]) || (pf_scale >= range[1]))
+      pf_scale = sqrt(range[0] * range[1]);
+  }
+
+  /* also catches NaN */
+  if ((!(pf_scale < DBL_MAX)) || (pf_scale == pf_params->pf_scale))
+    return 0;
+
+  *adjusted           = 1;
+  pf_params->pf_scale = pf_scale;
+  vrna_exp_params_rescale(vc, NULL);
+
+  return 1;
+}
+
+
+/*
+    check whether the partition function 'Q' of the entire sequence, or the one of any
+    prefix or suffix the outside recursion relies on, underflowed. In that case, 'Q'
+    and 'length' are set to the scaled partition function and length of the longest
+    representable prefix, or the shortest prefix or suffix that became subnormal
+*/
+PRIVATE int
+pf_underflow(vrna_fold_compound_t *vc,
+             double               *Q,
+             int                  *length){
+
+  int         n, k, *my_iindx;
+  double      min_real, q1k, qkn;
+  FLT_OR_DBL  *q;
+
+  n         = vc->length;
+  q         = vc->exp_matrices->q;
+  my_iindx  = vc->iindx;
+  min_real  = (vrna_pf_float_precision()) ? FLT_MIN : DBL_MIN;
+
+  if (!(*Q > min_real)) {
+    for (k = n; (k > 1) && (q[my_iindx[1] - k] <= min_real); k--);
+    *Q      = q[my_iindx[1] - k];
+    *length = k;
+    return 1;
+  }
+
+  /* exact zeros may be due to hard constraints, subnormal numbers are not */
+  for (k = 1; k <= n; k++) {
+    q1k = q[my_iindx[1] - k];
+    qkn = q[my_iindx[n - k + 1] - n];
+    if ((q1k > 0.) && (q1k < min_real)) {
+      *Q      = q1k;
+      *length = k;
+      return 1;
+    }
+    if ((qkn > 0.) && (qkn < min_real)) {
+      *Q      = qkn;
+      *length = k;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
 PUBLIC int
 vrna_pf_float_precision(void){
 
@@ -505,11 +682,12 @@ vrna_pf_float_precision(void){
 }
 
 
-PRIVATE void
+/* same as pf_linear() for alignments */
+PRIVATE int
 alipf_linear( vrna_fold_compound_t *vc){
 
   char                *hard_constraints;
-  int                 i,j, ij, jij, d, turn, n, *my_iindx, *jindx, *pscore;
+  int                 i,j, ij, jij, d, turn, n, *my_iindx, *jindx, *pscore, overflow;
   FLT_OR_DBL          temp, Qmax, qbt1, *q, *qb, *qm, *qm1;
   double              kTn, max_real;
   vrna_exp_param_t    *pf_params;
@@ -535,6 +713,7 @@ alipf_linear( vrna_fold_compound_t *vc){
   turn              = md->min_loop_size;
   kTn               = pf_params->kT/10.;   /* kT in cal/mol  */
   Qmax              = 0.;
+  overflow          = 0;
 
   max_real          = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
 
@@ -552,60 +731,280 @@ alipf_linear( vrna_fold_compound_t *vc){
       qb[ij]  = 0.0;
     }
 
-  for (j = turn + 2; j <= n; j++) {
-    for (i = j - turn - 1; i >= 1; i--) {
-      int psc;
-      /* construction of partition function for segment i,j */
-      /* calculate pf given that i and j pair: qb(i,j)      */
-      ij  = my_iindx[i] - j;
-      jij = jindx[j] + i;
-
-      psc   = pscore[jij];
-      qbt1  = 0.;
-
-      if (hard_constraints[jij]) {
-        /* process hairpin loop(s) */
-        qbt1 += vrna_exp_E_hp_loop(vc, i, j);
-        /* process interior loop(s) */
-        qbt1 += vrna_exp_E_int_loop(vc, i, j);
-        /* process multibranch loop(s) */
-        qbt1 += vrna_exp_E_mb_loop_fast(vc, i, j, aux_mx_ml->qqm1);
-
-        qbt1 *= exp(psc/kTn);
+  if (use_wavefront(vc)) {
+    overflow = pf_fill_wavefront(vc, aux_mx_el, aux_mx_ml);
+  } else {
+    for (j = turn + 2; (j <= n) && (!overflow); j++) {
+      for (i = j - turn - 1; i >= 1; i--) {
+        int psc;
+        /* construction of partition function for segment i,j */
+        /* calculate pf given that i and j pair: qb(i,j)      */
+        ij  = my_iindx[i] - j;
+        jij = jindx[j] + i;
+
+        psc   = pscore[jij];
+        qbt1  = 0.;
+
+        if (hard_constraints[jij]) {
+          /* process hairpin loop(s) */
+          qbt1 += vrna_exp_E_hp_loop(vc, i, j);
+          /* process interior loop(s) */
+          qbt1 += vrna_exp_E_int_loop(vc, i, j);
+          /* process multibranch loop(s) */
+          qbt1 += vrna_exp_E_mb_loop_fast(vc, i, j, aux_mx_ml->qqm1);
+
+          qbt1 *= exp(psc/kTn);
+        }
+
+        qb[ij] = qbt1;
+
+        /* Multibranch loop */
+        qm[ij] = vrna_exp_E_ml_fast(vc, i, j, aux_mx_ml);
+
+        if (qm1)
+          qm1[jindx[j] + i] = aux_mx_ml->qqm[i]; /* for stochastic backtracking and circfold */
+
+        /* Exterior loop */
+        q[ij] = temp = vrna_exp_E_ext_fast(vc, i, j, aux_mx_el);
+
+        /* (close to) overflow, the caller needs to adjust the scaling factor */
+        if (temp > Qmax) {
+          Qmax = temp;
+          if (Qmax > max_real/10.) {
+            overflow = j - i + 1;
+            break;
+          }
+        }
       }
 
-      qb[ij] = qbt1;
+      /* rotate auxiliary arrays */
+      vrna_exp_E_ext_fast_rotate(vc, aux_mx_el);
+      vrna_exp_E_ml_fast_rotate(vc, aux_mx_ml);
+    }
+  }
 
-      /* Multibranch loop */
-      qm[ij] = vrna_exp_E_ml_fast(vc, i, j, aux_mx_ml);
+  /* free memory occupied by auxiliary arrays for fast exterior/multibranch loops */
+  vrna_exp_E_ml_fast_free(vc, aux_mx_ml);
+  vrna_exp_E_ext_fast_free(vc, aux_mx_el);
+
+  return overflow;
+}
+
+/*
+ *  The wavefront fill only pays off if more than one thread works on the
+ *  diagonals. Callbacks need not be thread-safe, so with callbacks attached
+ *  the column-wise recursion is used as well. Both give identical matrices
+ */
+PRIVATE INLINE int
+use_wavefront(vrna_fold_compound_t *vc){
+
+#ifdef _OPENMP
+  return  vc->exp_params->model_details.wavefront &&
+          (omp_get_max_threads() > 1) &&
+          !vrna_fold_compound_has_callbacks(vc);
+#else
+  return 0;
+#endif
+}
+
+/*
+ *  Anti-diagonal (wavefront) variant of the forward recursions of
+ *  pf_linear() and alipf_linear(). All cells (i,j) with j - i = d only
+ *  depend on cells with smaller span, so each diagonal is distributed
+ *  among the available OpenMP threads. The column-wise auxiliary arrays
+ *  qqm, qqm1, qq, qq1 (and their unstructured domain counterparts) are
+ *  reconstructed per cell in thread-local copies from triangular storage
+ *  of the qm1 and qq contributions. Thus, each cell is computed by exactly
+ *  the same sequence of floating point operations as in the column-wise
+ *  recursion, and the results do not depend on the number of threads.
+ */
+PRIVATE int
+pf_fill_wavefront(vrna_fold_compound_t *vc,
+                  vrna_mx_pf_aux_el_t  *aux_mx_el,
+                  vrna_mx_pf_aux_ml_t  *aux_mx_ml){
+
+  int                 n, i, j, d, turn, *my_iindx, *jindx, size, overflow;
+  FLT_OR_DBL          temp, Qmax, *q, *qm1, *QQM1, *QQ;
+  double              max_real;
+  vrna_md_t           *md;
+
+  n         = vc->length;
+  my_iindx  = vc->iindx;
+  jindx     = vc->jindx;
+  q         = vc->exp_matrices->q;
+  md        = &(vc->exp_params->model_details);
+  turn      = md->min_loop_size;
+  max_real  = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
+
+  /*  QQM1[jindx[j] + i] and QQ[jindx[j] + i] hold what the column-wise
+      recursion keeps in qqm[i] and qq[i] while processing column j. Each
+      cell reads entire columns of both, so they can not be restricted to
+      a few diagonals. QQM1 is exactly what ends up in the qm1 matrix, so
+      we use the latter whenever it is allocated anyway
+  */
+  size  = jindx[n] + n + 1;
+  qm1   = vc->exp_matrices->qm1;
+  QQM1  = (qm1) ? qm1 : (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL) * size);
+  QQ    = (FLT_OR_DBL *) vrna_alloc(sizeof(FLT_OR_DBL) * size);
+
+  /* cells of span <= turn are read but never written by the fill */
+  if (qm1)
+    for (j = 1; j <= n; j++)
+      for (i = (j > turn) ? j - turn : 1; i <= j; i++)
+        qm1[jindx[j] + i] = 0.;
+
+#ifdef _OPENMP
+#pragma omp parallel private(d, i, j)
+#endif
+  {
+    vrna_mx_pf_aux_el_t *el;
+    vrna_mx_pf_aux_ml_t *ml;
+
+    el = pf_aux_el_thread_copy(vc, aux_mx_el);
+    ml = pf_aux_ml_thread_copy(vc, aux_mx_ml);
+
+    for(d = turn + 1; d < n; d++){
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+      for(i = 1; i <= n - d; i++){
+        j = i + d;
+        pf_fill_cell_wavefront(vc, i, j, el, ml, QQ, QQM1);
+      }
+      /* implicit barrier of the work-sharing loop completes diagonal d */
+    }
 
-      if (qm1)
-        qm1[jindx[j] + i] = aux_mx_ml->qqm[i]; /* for stochastic backtracking and circfold */
+    vrna_exp_E_ml_fast_free(vc, ml);
+    vrna_exp_E_ext_fast_free(vc, el);
+  }
 
-      /* Exterior loop */
-      q[ij] = temp = vrna_exp_E_ext_fast(vc, i, j, aux_mx_el);
+  if (!qm1)
+    free(QQM1);
+  free(QQ);
 
+  /* check for overflows in the same order as the column-wise recursion does */
+  Qmax      = 0;
+  overflow  = 0;
+  for (j = turn + 2; (j <= n) && (!overflow); j++) {
+    for (i = j - turn - 1; i >= 1; i--) {
+      temp = q[my_iindx[i] - j];
       if (temp > Qmax) {
         Qmax = temp;
-        if (Qmax > max_real/10.)
-          vrna_message_warning("Q close to overflow: %d %d %g", i,j,temp);
-      }
-      if (temp >= max_real) {
-        vrna_message_error("overflow in pf_fold while calculating q[%d,%d]\n"
-                                  "use larger pf_scale", i,j);
+        if (Qmax > max_real/10.) {
+          overflow = j - i + 1;
+          break;
+        }
       }
     }
+  }
+
+  return overflow;
+}
 
-    /* rotate auxiliary arrays */
-    vrna_exp_E_ext_fast_rotate(vc, aux_mx_el);
-    vrna_exp_E_ml_fast_rotate(vc, aux_mx_ml);
+
+PRIVATE void
+pf_fill_cell_wavefront( vrna_fold_compound_t *vc,
+                        int                  i,
+                        int                  j,
+                        vrna_mx_pf_aux_el_t  *el,
+                        vrna_mx_pf_aux_ml_t  *ml,
+                        FLT_OR_DBL           *QQ,
+                        FLT_OR_DBL           *QQM1){
+
+  int         u, ij, *jindx;
+  FLT_OR_DBL  qbt1;
+
+  jindx = vc->jindx;
+  ij    = vc->iindx[i] - j;
+
+  /* load thread-local auxiliary arrays for column j */
+  memcpy(ml->qqm + i + 1, QQM1 + jindx[j] + i + 1, sizeof(FLT_OR_DBL) * (j - i));
+  memcpy(ml->qqm1 + i, QQM1 + jindx[j - 1] + i, sizeof(FLT_OR_DBL) * (j - i));
+  memcpy(el->qq + i + 1, QQ + jindx[j] + i + 1, sizeof(FLT_OR_DBL) * (j - i));
+  el->qq1[i] = QQ[jindx[j - 1] + i];
+
+  for(u = 1; u <= ml->qqmu_size; u++)
+    ml->qqmu[u][i] = (j - u >= i) ? QQM1[jindx[j - u] + i] : 0.;
+  for(u = 1; u <= el->qqu_size; u++)
+    el->qqu[u][i] = (j - u >= i) ? QQ[jindx[j - u] + i] : 0.;
+
+  /* construction of partition function of segment i,j */
+  /* firstly that given i binds j : qb(i,j) */
+  qbt1 = 0.;
+  if(vc->hc->matrix[jindx[j] + i]){
+    /* process hairpin loop(s) */
+    qbt1 += vrna_exp_E_hp_loop(vc, i, j);
+    /* process interior loop(s) */
+    qbt1 += vrna_exp_E_int_loop(vc, i, j);
+    /* process multibranch loop(s) */
+    qbt1 += vrna_exp_E_mb_loop_fast(vc, i, j, ml->qqm1);
+
+    if(vc->type == VRNA_FC_TYPE_COMPARATIVE)
+      qbt1 *= exp(vc->pscore[jindx[j] + i]/(vc->exp_params->kT/10.));
   }
+  vc->exp_matrices->qb[ij] = qbt1;
 
-  /* free memory occupied by auxiliary arrays for fast exterior/multibranch loops */
-  vrna_exp_E_ml_fast_free(vc, aux_mx_ml);
-  vrna_exp_E_ext_fast_free(vc, aux_mx_el);
+  /* Multibranch loop */
+  vc->exp_matrices->qm[ij] = vrna_exp_E_ml_fast(vc, i, j, ml);
+
+  /* Exterior loop */
+  vc->exp_matrices->q[ij] = vrna_exp_E_ext_fast(vc, i, j, el);
+
+  /* QQM1 might be the qm1 matrix used for stochastic backtracking and circfold */
+  QQM1[jindx[j] + i]  = ml->qqm[i];
+  QQ[jindx[j] + i]    = el->qq[i];
 }
 
+
+/* allocate thread-local auxiliary arrays with the same layout as the ones provided */
+PRIVATE vrna_mx_pf_aux_el_t *
+pf_aux_el_thread_copy(vrna_fold_compound_t *vc,
+                      vrna_mx_pf_aux_el_t  *aux_mx){
+
+  int                 u, n;
+  vrna_mx_pf_aux_el_t *el;
+
+  n             = vc->length;
+  el            = (vrna_mx_pf_aux_el_t *)vrna_alloc(sizeof(vrna_mx_pf_aux_el_t));
+  el->qq        = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  el->qq1       = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  el->qqu_size  = aux_mx->qqu_size;
+  el->qqu       = NULL;
+
+  if(aux_mx->qqu){
+    el->qqu = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (el->qqu_size + 1));
+    for(u = 0; u <= el->qqu_size; u++)
+      el->qqu[u] = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  }
+
+  return el;
+}
+
+
+PRIVATE vrna_mx_pf_aux_ml_t *
+pf_aux_ml_thread_copy(vrna_fold_compound_t *vc,
+                      vrna_mx_pf_aux_ml_t  *aux_mx){
+
+  int                 u, n;
+  vrna_mx_pf_aux_ml_t *ml;
+
+  n             = vc->length;
+  ml            = (vrna_mx_pf_aux_ml_t *)vrna_alloc(sizeof(vrna_mx_pf_aux_ml_t));
+  ml->qqm       = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  ml->qqm1      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  ml->qqmu_size = aux_mx->qqmu_size;
+  ml->qqmu      = NULL;
+
+  if(aux_mx->qqmu){
+    ml->qqmu = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (ml->qqmu_size + 1));
+    for(u = 0; u <= ml->qqmu_size; u++)
+      ml->qqmu[u] = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  }
+
+  return ml;
+}
+
+
 /* calculate partition function for circular case   */
 /* NOTE: this is the postprocessing step ONLY        */
 /* You have to call alipf_linear first to calculate  */
@@ -46,6 +46,15 @@
  *  If the parameter calculate_bppm is set to 0 base pairing probabilities will not
  *  be computed (saving CPU time), otherwise after calculations took place #pr will
  *  contain the probability that bases @a i and @a j pair.
+ *
+ *  The partition functions of all subsequences are scaled by the factor #vrna_exp_param_t.pf_scale
+ *  per nucleotide to avoid numerical over- and underflows. If the scaling factor turns out to be
+ *  too small (i.e. a partition function overflows), or too large (i.e. the partition function of
+ *  the entire sequence underflows), it is adjusted automatically, and the partition functions are
+ *  computed again. The adjusted factor is stored in the #vrna_exp_param_t of @p vc, such that
+ *  subsequent computations, e.g. stochastic backtracking, use the same scaling. If the partition
+ *  functions still overflow after a number of adjustments, a warning is issued, base pair
+ *  probabilities are not computed, and the function returns <tt>INF/100.</tt>
  * 
  *  @ingroup pf_fold
  *
@@ -1452,7 +1452,7 @@ PRIVATE  void  set_encoded_seq(const char *sequence, short **S, short **S1){
     for(i=1; i<=l; i++) /* make numerical encoding of sequence */
       (*S)[i]= (short) encode_char(toupper(sequence[i-1]));
     (*S)[l+1] = (*S)[1];
-    (*S)[0]   = (short) l;
+    (*S)[0]   = (short)(unsigned short) l;
   }
   /* S1 exists only for the special X K and I bases and energy_set!=0 */
   if(S1 != NULL){
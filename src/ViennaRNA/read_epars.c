@@ -18,6 +18,7 @@
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/energy_const.h"
 #include "ViennaRNA/energy_par.h"
+#include "ViennaRNA/params.h"
 #include "ViennaRNA/read_epars.h"
 
 #define PUBLIC
@@ -259,6 +260,9 @@ PUBLIC void read_parameter_file(const char fname[]){
   fclose(fp);
 
   check_symmetry();
+
+  /* previously cached parameter sets are outdated now */
+  vrna_params_cache_clear();
   return;
 }
 
@@ -1034,7 +1034,7 @@ PRIVATE void encode_seq(const char *sequence) {
   S = (short *) vrna_alloc(sizeof(short)*(l+2));
   S1= (short *) vrna_alloc(sizeof(short)*(l+2));
   /* S1 exists only for the special X K and I bases and energy_set!=0 */
-  S[0] = (short) l;
+  S[0] = (short)(unsigned short) l;
 
   for (i=1; i<=l; i++) { /* make numerical encoding of sequence */
     S[i]= (short) encode_char(toupper(sequence[i-1]));
@@ -1050,7 +1050,7 @@ PRIVATE short * aliencode_seq(const char *sequence) {
   short *Stemp;
   l = strlen(sequence);
   Stemp = (short *) vrna_alloc(sizeof(short)*(l+2));
-  Stemp[0] = (short) l;
+  Stemp[0] = (short)(unsigned short) l;
 
   /* make numerical encoding of sequence */
   for (i=1; i<=l; i++)
@@ -1080,7 +1080,7 @@ PUBLIC void snoupdate_fold_params(void)
 PRIVATE void make_ptypes(const short *S, const char *structure) {
   int n,i,j,k,l;
 
-  n=S[0];
+  n=(unsigned short)S[0];
   for (k=1; k<n-TURN; k++)
     for (l=1; l<=2; l++) {
       int type,ntype=0,otype=0;
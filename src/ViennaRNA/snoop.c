@@ -2544,7 +2544,7 @@ PRIVATE short * aliencode_seq(const char *sequence) {
   short *Stemp;
   l = strlen(sequence);
   Stemp = (short *) vrna_alloc(sizeof(short)*(l+2));
-  Stemp[0] = (short) l;
+  Stemp[0] = (short)(unsigned short) l;
 
   /* make numerical encoding of sequence */
   for (i=1; i<=l; i++)
@@ -2562,7 +2562,7 @@ PRIVATE short * encode_seq(const char *sequence) {
   l = strlen(sequence);
 extern double nc_fact;
   S = (short *) vrna_alloc(sizeof(short)*(l+2));
-  S[0] = (short) l;
+  S[0] = (short)(unsigned short) l;
 
   /* make numerical encoding of sequence */
   for (i=1; i<=l; i++)
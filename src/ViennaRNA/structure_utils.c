@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/utils.h"
@@ -41,6 +42,8 @@ wrap_plist( vrna_fold_compound_t *vc,
 
 PRIVATE void assign_elements_pair(short *pt, int i, int j, char *elements);
 
+PRIVATE short pair_table_length(const char *structure);
+
 /*
 #################################
 # BEGIN OF FUNCTION DEFINITIONS #
@@ -114,6 +117,19 @@ vrna_db_unpack(const char *packed){
   return struc;
 }
 
+/* pair tables store positions as short, refuse anything longer than SHRT_MAX */
+PRIVATE short
+pair_table_length(const char *structure){
+
+  size_t length = strlen(structure);
+
+  if (length > SHRT_MAX)
+    vrna_message_error("structure of length %lu exceeds the maximum length of %d nt for pair tables",
+                       (unsigned long)length, SHRT_MAX);
+
+  return (short)length;
+}
+
 PUBLIC short *
 vrna_ptable(const char *structure){
 
@@ -124,7 +140,7 @@ vrna_ptable(const char *structure){
    short *stack;
    short *table;
 
-   length = (short) strlen(structure);
+   length = pair_table_length(structure);
    stack = (short *) vrna_alloc(sizeof(short)*(length+1));
    table = (short *) vrna_alloc(sizeof(short)*(length+2));
    table[0] = length;
@@ -163,7 +179,7 @@ vrna_pt_pk_get(const char *structure){
    short *stack2;
    short *table;
 
-   length = (short) strlen(structure);
+   length = pair_table_length(structure);
    stack  = (short *) vrna_alloc(sizeof(short)*(length+1));
    stack2 = (short *) vrna_alloc(sizeof(short)*(length+1));
    table  = (short *) vrna_alloc(sizeof(short)*(length+2));
@@ -219,7 +235,7 @@ vrna_pt_snoop_get(const char *structure){
    short *stack;
    short *table;
 
-   length = (short) strlen(structure);
+   length = pair_table_length(structure);
    stack = (short *) vrna_alloc(sizeof(short)*(length+1));
    table = (short *) vrna_alloc(sizeof(short)*(length+2));
    table[0] = length;
@@ -261,7 +277,7 @@ vrna_pt_ali_get(const char *structure){
    short *stack;
    short *table;
 
-   length = (short) strlen(structure);
+   length = pair_table_length(structure);
    stack = (short *) vrna_alloc(sizeof(short)*(length+1));
    table = (short *) vrna_alloc(sizeof(short)*(length+2));
    table[0] = length;
@@ -429,7 +445,7 @@ vrna_refBPcnt_matrix( const short *reference_pt,
   unsigned int *array;
   unsigned int size;
   length = (unsigned int)reference_pt[0];
-  size  = ((length+1)*(length+2))/2;
+  size  = ((size_t)(length+1)*(length+2))/2;
   iindx = vrna_idx_row_wise(length);
   array = (unsigned int *) vrna_alloc(sizeof(unsigned int)*size);    /* matrix containing number of basepairs of reference structure1 in interval [i,j] */;
   for (k=0; k<=turn; k++)
@@ -461,7 +477,7 @@ vrna_refBPdist_matrix(const short *pt1,
   unsigned int *array;
   unsigned int n, size, i, j, ij, d;
   n = (unsigned int)pt1[0];
-  size = ((n+1)*(n+2))/2;
+  size = ((size_t)(n+1)*(n+2))/2;
   array = (unsigned int *)vrna_alloc(sizeof(unsigned int) * size);
   int *iindx = vrna_idx_row_wise(n);
   for(i = n - turn - 1; i>=1; i--){
@@ -77,6 +77,9 @@ char *vrna_db_unpack(const char *packed);
  *  Returns a newly allocated table, such that table[i]=j if (i.j) pair
  *  or 0 if i is unpaired, table[0] contains the length of the structure.
  *
+ *  @note   Positions are stored as @p short, so structures longer than
+ *          SHRT_MAX nt are rejected with an error message.
+ *
  *  @param  structure The secondary structure in dot-bracket notation
  *  @return           A pointer to the created pair_table
  */
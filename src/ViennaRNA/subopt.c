@@ -13,13 +13,13 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
 #include "ViennaRNA/fold.h"
 #include "ViennaRNA/constraints.h"
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/energy_par.h"
 #include "ViennaRNA/fold_vars.h"
-#include "list.h"
 #include "ViennaRNA/eval.h"
 #include "ViennaRNA/params.h"
 #include "ViennaRNA/loop_energies.h"
@@ -32,33 +32,123 @@
 
 #ifdef _OPENMP
 #include <omp.h>
+#include <sched.h>
 #endif
 
 #define true              1
 #define false             0
 #define ON_SAME_STRAND(I,J,C)  (((I)>=(C))||((J)<(C)))
 
+/* number of nodes allocated at once by the node pools of vrna_subopt_cb() */
+#define POOL_SLAB_SIZE  1024
+
+/* number of states per thread that are expanded before vrna_subopt_cb_parallel() distributes the work */
+#define PARALLEL_STATES_PER_THREAD  64
+
+/* number of structures a thread collects before passing them to the callback of vrna_subopt_cb_parallel() */
+#define PARALLEL_OUTPUT_BUFFER      1024
+
+/* maximum number of temporary files that are merged at once in sorted output mode */
+#define SORT_MERGE_FANIN            128
+
 /**
  *  @brief  Sequence interval stack element used in subopt.c
+ *
+ *  Interval stacks are immutable singly linked lists, i.e. states that are
+ *  derived from each other share the intervals they have in common. Each node
+ *  counts the number of states and nodes that reference it.
  */
 typedef struct INTERVAL {
-    int i;
-    int j;
-    int array_flag;
+    int             i;
+    int             j;
+    int             array_flag;
+    unsigned int    ref;
+    struct INTERVAL *next;
 } INTERVAL;
 
 typedef struct {
-    char *structure;
-    LIST *Intervals;
-    int partial_energy;
-    int is_duplex;
+    char      *structure;
+    INTERVAL  *Intervals;
+    int       partial_energy;
+    int       is_duplex;
     /* int best_energy;   */ /* best attainable energy */
 } STATE;
 
+/**
+ *  @brief  A pool of equally sized nodes that are allocated in slabs and recycled
+ */
+typedef struct {
+  size_t        size;       /* size of each node (in bytes) */
+  void          *free_list; /* recycled nodes */
+  char          **slabs;
+  unsigned int  num_slabs;
+  unsigned int  slab_used;  /* number of nodes handed out from the last slab */
+} node_pool;
+
+/**
+ *  @brief  Structures collected by a thread of vrna_subopt_cb_parallel()
+ *
+ *  In sorted mode, at most max_records structures are kept in memory. Beyond that,
+ *  the collected structures are sorted and written to a temporary file (a run).
+ */
+typedef struct {
+  float         *energies;
+  char          **structures;
+  unsigned int  size;
+  unsigned int  max_size;
+  unsigned int  max_records;  /* 0 = no limit */
+  int           sorted;
+  node_pool     strings;
+  FILE          **runs;
+  unsigned int  num_runs;
+  vrna_subopt_callback  *cb;
+  void                  *data;
+} subopt_output;
+
+/**
+ *  @brief  A sorted sequence of structures that is merged into the sorted output,
+ *          either the collected structures of a thread, or a temporary file
+ */
+typedef struct {
+  subopt_output *out;
+  unsigned int  pos;
+  FILE          *fp;
+  char          *buffer;
+  unsigned int  buffer_size;
+  char          *unpacked;
+  float         energy;
+  const char    *structure;
+} subopt_run;
+
 typedef struct {
-  LIST          *Intervals;
-  LIST          *Stack;
+  STATE         **Stack;
+  unsigned int  stack_bottom;   /* states below this index have been stolen by other threads */
+  unsigned int  stack_size;
+  unsigned int  stack_max;
   int           nopush;
+  int           length;
+  node_pool     states;
+  node_pool     intervals;
+  node_pool     structures;
+
+  /* settings of the current call */
+  int           threshold;
+  int           logML;
+  int           dangle_model;
+  int           cp;
+  double        min_en;
+  double        eprint;
+  float         correction;
+  int           *dos;
+  vrna_subopt_callback  *cb;
+  void                  *cb_data;
+
+  /* concurrent processing in vrna_subopt_cb_parallel() */
+  int           concurrent;
+  unsigned int  *pending;       /* number of states that still need to be processed by any thread */
+#ifdef _OPENMP
+  omp_lock_t    lock;           /* protects the stack */
+#endif
 } subopt_env;
 
 
@@ -118,24 +208,40 @@ PRIVATE void      make_pair(int i, int j, STATE *state);
 /* mark a gquadruplex in the resulting dot-bracket structure */
 PRIVATE void      make_gquad(int i, int L, int l[3], STATE *state);
 
-PRIVATE INTERVAL  *make_interval (int i, int j, int ml);
-/*@out@*/ PRIVATE STATE *make_state(/*@only@*/LIST *Intervals,
-                                    /*@only@*/ /*@null@*/ char *structure,
-                                    int partial_energy, int is_duplex, int length);
-PRIVATE STATE     *copy_state(STATE * state);
+PRIVATE void      pool_init(node_pool *pool, size_t size);
+PRIVATE void      pool_free(node_pool *pool);
+PRIVATE void      *pool_alloc(node_pool *pool);
+PRIVATE void      pool_release(node_pool *pool, void *node);
+PRIVATE void      push_interval(STATE *state, int i, int j, int ml, subopt_env *env);
+PRIVATE void      pop_interval(STATE *state, subopt_env *env);
+PRIVATE void      release_intervals(INTERVAL *node, subopt_env *env);
+PRIVATE void      ref_interval(INTERVAL *node, subopt_env *env);
+PRIVATE subopt_env *subopt_init(vrna_fold_compound_t *vc, int delta, vrna_subopt_callback *cb, void *data);
+PRIVATE void      subopt_env_free(subopt_env *env);
+PRIVATE void      process_state(vrna_fold_compound_t *vc, STATE *state, subopt_env *env);
+PRIVATE STATE     *steal(subopt_env **envs, int thief, int num_threads);
+PRIVATE void      subopt_parallel(vrna_fold_compound_t *vc, int delta, int sorted, size_t max_memory, int num_threads, vrna_subopt_callback *cb, void *data);
+PRIVATE void      output_init(subopt_output *out, int length, int sorted, size_t max_memory, vrna_subopt_callback *cb, void *data);
+PRIVATE void      output_store(const char *structure, float energy, void *data);
+PRIVATE void      output_flush(subopt_output *out);
+PRIVATE int       output_spill(subopt_output *out);
+PRIVATE void      output_merge(subopt_output *outs, int num_outs, vrna_subopt_callback *cb, void *data);
+PRIVATE void      output_free(subopt_output *out);
+PRIVATE FILE      *run_file_open(void);
+PRIVATE void      run_write(const char *structure, float energy, void *data);
+PRIVATE int       run_next(subopt_run *run);
+PRIVATE void      run_merge(subopt_run *runs, int num_runs, vrna_subopt_callback *cb, void *data);
+/*@out@*/ PRIVATE STATE *make_state(int partial_energy, int is_duplex, subopt_env *env);
+PRIVATE STATE     *copy_state(STATE * state, subopt_env *env);
 PRIVATE void      print_state(STATE * state);
-PRIVATE void      UNUSED print_stack(LIST * list);
-/*@only@*/ PRIVATE LIST *make_list(void);
-PRIVATE void      push(LIST * list, /*@only@*/ void *data);
-PRIVATE void      *pop(LIST * list);
+PRIVATE void      UNUSED print_stack(subopt_env *env);
+PRIVATE void      push(subopt_env *env, /*@only@*/ STATE *state);
+PRIVATE STATE     *pop(subopt_env *env);
 PRIVATE int       best_attainable_energy(vrna_fold_compound_t *vc, STATE * state);
 PRIVATE void      scan_interval(vrna_fold_compound_t *vc, int i, int j, int array_flag, int threshold, STATE * state, subopt_env *env);
-PRIVATE void      free_interval_node(/*@only@*/ INTERVAL * node);
-PRIVATE void      free_state_node(/*@only@*/ STATE * node);
-PRIVATE void      push_back(LIST *Stack, STATE * state);
-PRIVATE char*     get_structure(STATE * state);
+PRIVATE void      free_state_node(/*@only@*/ STATE * node, subopt_env *env);
+PRIVATE void      push_back(subopt_env *env, STATE * state);
 PRIVATE int       compare(const void *solution1, const void *solution2);
-PRIVATE void      make_output(SOLUTION *SL, int cp, FILE *fp);
 PRIVATE void      repeat(vrna_fold_compound_t *vc, int i, int j, STATE * state, int part_energy, int temp_energy, int best_energy, int threshold, subopt_env *env);
 PRIVATE void      repeat_gquad(vrna_fold_compound_t *vc, int i, int j, STATE *state, int part_energy, int temp_energy, int best_energy, int threshold, subopt_env *env);
 
@@ -176,64 +282,178 @@ make_gquad(int i, int L, int l[3], STATE *state)
 
 /*---------------------------------------------------------------------------*/
 
-PRIVATE INTERVAL *
-make_interval(int i, int j, int array_flag)
+PRIVATE void
+pool_init(node_pool *pool, size_t size)
+{
+  /* nodes must be able to hold the link of the free list, and be properly aligned */
+  size = MAX2(size, sizeof(void *));
+  size = (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+
+  pool->size      = size;
+  pool->free_list = NULL;
+  pool->slabs     = NULL;
+  pool->num_slabs = 0;
+  pool->slab_used = POOL_SLAB_SIZE;
+}
+
+/*---------------------------------------------------------------------------*/
+
+PRIVATE void
+pool_free(node_pool *pool)
+{
+  unsigned int i;
+
+  for (i = 0; i < pool->num_slabs; i++)
+    free(pool->slabs[i]);
+  free(pool->slabs);
+
+  pool->slabs     = NULL;
+  pool->num_slabs = 0;
+  pool->free_list = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+
+PRIVATE void *
+pool_alloc(node_pool *pool)
+{
+  void *node;
+
+  if (pool->free_list) {
+    node            = pool->free_list;
+    pool->free_list = *((void **)node);
+    return node;
+  }
+
+  if (pool->slab_used == POOL_SLAB_SIZE) {
+    pool->slabs = (char **)vrna_realloc(pool->slabs, sizeof(char *) * (pool->num_slabs + 1));
+    pool->slabs[pool->num_slabs] = (char *)malloc(pool->size * POOL_SLAB_SIZE);
+    if (!pool->slabs[pool->num_slabs])
+      vrna_message_error("out of memory");
+    pool->num_slabs++;
+    pool->slab_used = 0;
+  }
+
+  node = pool->slabs[pool->num_slabs - 1] + pool->size * pool->slab_used++;
+  return node;
+}
+
+/*---------------------------------------------------------------------------*/
+
+PRIVATE void
+pool_release(node_pool *pool, void *node)
+{
+  *((void **)node)  = pool->free_list;
+  pool->free_list   = node;
+}
+
+/*---------------------------------------------------------------------------*/
+
+PRIVATE void
+push_interval(STATE *state, int i, int j, int array_flag, subopt_env *env)
 {
   INTERVAL *interval;
 
-  interval = lst_newnode(sizeof(INTERVAL));
-  interval->i = i;
-  interval->j = j;
-  interval->array_flag = array_flag;
-  return interval;
+  /* the new node takes over the reference of the state to its previous intervals */
+  interval              = pool_alloc(&(env->intervals));
+  interval->i           = i;
+  interval->j           = j;
+  interval->array_flag  = array_flag;
+  interval->ref         = 1;
+  interval->next        = state->Intervals;
+  state->Intervals      = interval;
+}
+
+/*---------------------------------------------------------------------------*/
+
+PRIVATE void
+ref_interval(INTERVAL *node, subopt_env *env)
+{
+  if (!node)
+    return;
+
+#ifdef _OPENMP
+  if (env->concurrent) {
+    /* interval nodes may be shared with states processed by other threads */
+#pragma omp atomic
+    node->ref++;
+    return;
+  }
+#endif
+
+  node->ref++;
 }
 
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-free_interval_node(INTERVAL * node)
+pop_interval(STATE *state, subopt_env *env)
 {
-  lst_freenode(node);
+  INTERVAL *interval = state->Intervals;
+
+  state->Intervals = interval->next;
+  ref_interval(state->Intervals, env);
+
+  release_intervals(interval, env);
 }
 
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-free_state_node(STATE * node)
+release_intervals(INTERVAL *node, subopt_env *env)
 {
-  free(node->structure);
-  if (node->Intervals)
-    lst_kill(node->Intervals, lst_freenode);
-  lst_freenode(node);
+  INTERVAL      *next;
+  unsigned int  ref;
+
+  while (node) {
+#ifdef _OPENMP
+    if (env->concurrent) {
+#pragma omp atomic capture
+      ref = --node->ref;
+    } else {
+      ref = --node->ref;
+    }
+#else
+    ref = --node->ref;
+#endif
+
+    if (ref > 0)
+      break;
+
+    next = node->next;
+    pool_release(&(env->intervals), node);
+    node = next;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+
+PRIVATE void
+free_state_node(STATE * node, subopt_env *env)
+{
+  pool_release(&(env->structures), node->structure);
+  release_intervals(node->Intervals, env);
+  pool_release(&(env->states), node);
 }
 
 /*---------------------------------------------------------------------------*/
 
 PRIVATE STATE *
-make_state(LIST * Intervals,
-           char *structure,
-           int partial_energy,
+make_state(int partial_energy,
            int is_duplex,
-           int length)
+           subopt_env *env)
 {
   STATE *state;
 
-  state = lst_newnode(sizeof(STATE));
+  state = pool_alloc(&(env->states));
 
-  if (Intervals)
-    state->Intervals = Intervals;
-  else
-    state->Intervals = lst_init();
-  if (structure)
-    state->structure = structure;
-  else {
-    int i;
-    state->structure = (char *) vrna_alloc(length+1);
-    for (i=0; i<length; i++)
-      state->structure[i] = '.';
-  }
+  state->Intervals = NULL;
+  state->structure = pool_alloc(&(env->structures));
+  memset(state->structure, '.', env->length);
+  state->structure[env->length] = '\0';
 
   state->partial_energy = partial_energy;
+  state->is_duplex      = is_duplex;
 
   return state;
 }
@@ -241,29 +461,22 @@ make_state(LIST * Intervals,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE STATE *
-copy_state(STATE * state)
+copy_state(STATE * state, subopt_env *env)
 {
   STATE *new_state;
-  void *after;
-  INTERVAL *new_interval, *next;
 
-  new_state = lst_newnode(sizeof(STATE));
-  new_state->Intervals = lst_init();
+  new_state = pool_alloc(&(env->states));
   new_state->partial_energy = state->partial_energy;
+  new_state->is_duplex      = state->is_duplex;
   /* new_state->best_energy = state->best_energy; */
 
-  if (state->Intervals->count) {
-    after = LST_HEAD(new_state->Intervals);
-    for ( next = lst_first(state->Intervals); next; next = lst_next(next))
-      {
-        new_interval = lst_newnode(sizeof(INTERVAL));
-        *new_interval = *next;
-        lst_insertafter(new_state->Intervals, new_interval, after);
-        after = new_interval;
-      }
-  }
-  new_state->structure = strdup(state->structure);
-  if (!new_state->structure) vrna_message_error("out of memory");
+  /* intervals are shared until either of the states pushes or pops an interval */
+  new_state->Intervals = state->Intervals;
+  ref_interval(new_state->Intervals, env);
+
+  new_state->structure = pool_alloc(&(env->structures));
+  memcpy(new_state->structure, state->structure, sizeof(char) * (env->length + 1));
+
   return new_state;
 }
 
@@ -274,10 +487,10 @@ print_state(STATE * state)
 {
   INTERVAL *next;
 
-  if (state->Intervals->count)
+  if (state->Intervals)
     {
-      printf("%d intervals:\n", state->Intervals->count);
-      for (next = lst_first(state->Intervals); next; next = lst_next(next))
+      printf("intervals:\n");
+      for (next = state->Intervals; next; next = next->next)
         {
           printf("[%d,%d],%d ", next->i, next->j, next->array_flag);
         }
@@ -293,57 +506,80 @@ print_state(STATE * state)
 /*---------------------------------------------------------------------------*/
 
 /*@unused @*/ PRIVATE void
-print_stack(LIST * list)
+print_stack(subopt_env *env)
 {
-  void *rec;
+  unsigned int i;
 
   printf("================\n");
-  printf("%d states\n", list->count);
-  for (rec = lst_first(list); rec; rec = lst_next(rec))
+  printf("%u states\n", env->stack_size - env->stack_bottom);
+  for (i = env->stack_size; i > env->stack_bottom; i--)
     {
       printf("state-----------\n");
-      print_state(rec);
+      print_state(env->Stack[i - 1]);
     }
   printf("================\n");
 }
 
 /*---------------------------------------------------------------------------*/
 
-PRIVATE LIST *
-make_list(void)
+PRIVATE void
+push(subopt_env *env, STATE *state)
 {
-  return lst_init();
+#ifdef _OPENMP
+  if (env->concurrent) {
+#pragma omp atomic
+    (*(env->pending))++;
+
+    omp_set_lock(&(env->lock));
+  }
+#endif
+
+  if (env->stack_size == env->stack_max) {
+    if (env->stack_bottom > 0) {
+      /* reclaim the space of stolen states */
+      env->stack_size -= env->stack_bottom;
+      memmove(env->Stack, env->Stack + env->stack_bottom, sizeof(STATE *) * env->stack_size);
+      env->stack_bottom = 0;
+    }
+
+    if (env->stack_size == env->stack_max) {
+      env->stack_max  = (env->stack_max) ? 2 * env->stack_max : 1024;
+      env->Stack      = (STATE **)vrna_realloc(env->Stack, sizeof(STATE *) * env->stack_max);
+    }
+  }
+
+  env->Stack[env->stack_size++] = state;
+
+#ifdef _OPENMP
+  if (env->concurrent)
+    omp_unset_lock(&(env->lock));
+#endif
 }
 
 /*---------------------------------------------------------------------------*/
 
-PRIVATE void
-push(LIST * list, void *data)
+PRIVATE STATE *
+pop(subopt_env *env)
 {
-  lst_insertafter(list, data, LST_HEAD(list));
-}
+  STATE *state = NULL;
 
-/* PRIVATE void */
-/* push_stack(STATE *state) { */ /* keep the stack sorted by energy */
-/*   STATE *after, *next; */
-/*   nopush = false; */
-/*   next = after = LST_HEAD(Stack); */
-/*   while ( next = lst_next(next)) { */
-/*     if ( next->best_energy >= state->best_energy ) break; */
-/*     after = next; */
-/*   } */
-/*   lst_insertafter(Stack, state, after); */
-/* } */
+#ifdef _OPENMP
+  if (env->concurrent)
+    omp_set_lock(&(env->lock));
+#endif
 
-/*---------------------------------------------------------------------------*/
+  if (env->stack_size > env->stack_bottom) {
+    state = env->Stack[--env->stack_size];
+    if (env->stack_size == env->stack_bottom)
+      env->stack_size = env->stack_bottom = 0;
+  }
 
-PRIVATE void *
-pop(LIST * list)
-{
-  void *data;
+#ifdef _OPENMP
+  if (env->concurrent)
+    omp_unset_lock(&(env->lock));
+#endif
 
-  data = lst_deletenext(list, LST_HEAD(list));
-  return data;
+  return state;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -368,7 +604,7 @@ best_attainable_energy( vrna_fold_compound_t *vc,
 
   sum = state->partial_energy;  /* energy of already found elements */
 
-  for (next = lst_first(state->Intervals); next; next = lst_next(next))
+  for (next = state->Intervals; next; next = next->next)
     {
       if (next->array_flag == 0)
         sum += (md->circ) ? matrices->Fc : matrices->f5[next->j];
@@ -392,23 +628,12 @@ best_attainable_energy( vrna_fold_compound_t *vc,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-push_back(LIST *Stack, STATE * state)
+push_back(subopt_env *env, STATE * state)
 {
-  push(Stack, copy_state(state));
+  push(env, copy_state(state, env));
   return;
 }
 
-/*---------------------------------------------------------------------------*/
-
-PRIVATE char*
-get_structure(STATE * state)
-{
-  char* structure;
-
-  structure = strdup(state->structure);
-  return structure;
-}
-
 /*---------------------------------------------------------------------------*/
 PRIVATE int
 compare(const void *solution1, const void *solution2)
@@ -423,27 +648,16 @@ compare(const void *solution1, const void *solution2)
 
 /*---------------------------------------------------------------------------*/
 
-PRIVATE void make_output(SOLUTION *SL, int cp, FILE *fp)  /* prints stuff */
-{
-  SOLUTION *sol;
-
-  for (sol = SL; sol->structure!=NULL; sol++){
-    char *e_string = vrna_strdup_printf(" %6.2f", sol->energy);
-    print_structure(fp, sol->structure, e_string);
-    free(e_string);
-  }
-}
-
 PRIVATE STATE *
 derive_new_state( int i,
                   int j,
                   STATE *s,
                   int e,
-                  int flag){
+                  int flag,
+                  subopt_env *env){
 
-  STATE     *s_new  = copy_state(s);
-  INTERVAL  *ival   = make_interval(i, j, flag);
-  push(s_new->Intervals, ival);
+  STATE     *s_new  = copy_state(s, env);
+  push_interval(s_new, i, j, flag, env);
 
   s_new->partial_energy += e;
 
@@ -458,8 +672,8 @@ fork_state( int i,
             int flag,
             subopt_env *env){
 
-  STATE *s_new = derive_new_state(i, j, s, e, flag);
-  push(env->Stack, s_new);
+  STATE *s_new = derive_new_state(i, j, s, e, flag, env);
+  push(env, s_new);
   env->nopush = false;
 }
 
@@ -470,10 +684,10 @@ fork_int_state( int i, int j,
                 int e,
                 subopt_env *env){
 
-  STATE *s_new = derive_new_state(p, q, s, e, 2);
+  STATE *s_new = derive_new_state(p, q, s, e, 2, env);
   make_pair(i, j, s_new);
   make_pair(p, q, s_new);
-  push(env->Stack, s_new);
+  push(env, s_new);
   env->nopush = false;
 }
 
@@ -486,10 +700,10 @@ fork_state_pair(int i,
 
   STATE     *new_state;
 
-  new_state = copy_state(s);
+  new_state = copy_state(s, env);
   make_pair(i, j, new_state);
   new_state->partial_energy += e;
-  push(env->Stack, new_state);
+  push(env, new_state);
   env->nopush = false;
 }
 
@@ -503,23 +717,20 @@ fork_two_states_pair( int i,
                       int flag2,
                       subopt_env *env){
 
-  INTERVAL  *interval1, *interval2;
   STATE     *new_state;
 
-  new_state = copy_state(s);
-  interval1 = make_interval(i+1, k-1, flag1);
-  interval2 = make_interval(k, j-1, flag2);
+  new_state = copy_state(s, env);
   if (k-i < j-k) { /* push larger interval first */
-    push(new_state->Intervals, interval1);
-    push(new_state->Intervals, interval2);
+    push_interval(new_state, i+1, k-1, flag1, env);
+    push_interval(new_state, k, j-1, flag2, env);
   } else {
-    push(new_state->Intervals, interval2);
-    push(new_state->Intervals, interval1);
+    push_interval(new_state, k, j-1, flag2, env);
+    push_interval(new_state, i+1, k-1, flag1, env);
   }
   make_pair(i, j, new_state);
   new_state->partial_energy += e;
 
-  push(env->Stack, new_state);
+  push(env, new_state);
   env->nopush = false;
 }
 
@@ -535,23 +746,20 @@ fork_two_states(int i,
                 int flag2,
                 subopt_env *env){
 
-  INTERVAL  *interval1, *interval2;
   STATE     *new_state;
 
-  new_state = copy_state(s);
-  interval1 = make_interval(i, j, flag1);
-  interval2 = make_interval(p, q, flag2);
+  new_state = copy_state(s, env);
 
   if((j - i) < (q - p)){
-    push(new_state->Intervals, interval1);
-    push(new_state->Intervals, interval2);
+    push_interval(new_state, i, j, flag1, env);
+    push_interval(new_state, p, q, flag2, env);
   } else {
-    push(new_state->Intervals, interval2);
-    push(new_state->Intervals, interval1);
+    push_interval(new_state, p, q, flag2, env);
+    push_interval(new_state, i, j, flag1, env);
   }
   new_state->partial_energy += e;
 
-  push(env->Stack, new_state);
+  push(env, new_state);
   env->nopush = false;
 }
 
@@ -598,14 +806,16 @@ vrna_subopt(vrna_fold_compound_t *vc,
       vrna_mx_mfe_free(vc);
     }
     /* call subopt() */
-    vrna_subopt_cb(vc, delta, (!sorted && fp) ? &old_subopt_print : &old_subopt_store, (void *)&data);
+    if (sorted && fp)
+      /* sort with limited memory and print immediately */
+      subopt_parallel(vc, delta, 1, VRNA_SUBOPT_SORT_MEMORY, 1, &old_subopt_print, (void *)&data);
+    else
+      vrna_subopt_cb(vc, delta, fp ? &old_subopt_print : &old_subopt_store, (void *)&data);
 
-    if(sorted){
+    if(sorted && !fp){
       /* sort structures by energy */
       if(data.n_sol > 0)
         qsort(data.SolutionList, data.n_sol - 1, sizeof(SOLUTION), compare);
-      if(fp)
-        make_output(data.SolutionList, vc->cutpoint, fp);
     }
 
     if(fp){ /* we've printed everything -- free solutions */
@@ -628,11 +838,237 @@ vrna_subopt_cb( vrna_fold_compound_t *vc,
 
   subopt_env    *env;
   STATE         *state;
-  INTERVAL      *interval;
-  int           maxlevel, count, partial_energy, old_dangles, logML, dangle_model, length, circular, threshold, cp;
-  double        structure_energy, min_en, eprint;
-  char          *struc, *structure, *sequence;
-  float         correction;
+
+  env = subopt_init(vc, delta, cb, data);
+
+  /* forever, til nothing remains on stack */
+  while ((state = pop(env))) {                    /* current state to work with */
+    process_state(vc, state, env);
+    free_state_node(state, env);                  /* free the current state */
+  }
+
+  cb(NULL, 0, data); /* NULL (last time to call callback function */
+
+  /* cleanup memory */
+  subopt_env_free(env);
+}
+
+
+PUBLIC void
+vrna_subopt_cb_parallel(vrna_fold_compound_t *vc,
+                        int delta,
+                        int sorted,
+                        vrna_subopt_callback *cb,
+                        void *data){
+
+  int num_threads;
+
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#else
+  num_threads = 1;
+#endif
+
+  subopt_parallel(vc, delta, sorted, VRNA_SUBOPT_SORT_MEMORY, num_threads, cb, data);
+}
+
+
+PUBLIC void
+vrna_subopt_cb_sorted(vrna_fold_compound_t *vc,
+                      int delta,
+                      size_t max_memory,
+                      vrna_subopt_callback *cb,
+                      void *data){
+
+  int num_threads;
+
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#else
+  num_threads = 1;
+#endif
+
+  subopt_parallel(vc, delta, 1, max_memory, num_threads, cb, data);
+}
+
+
+PRIVATE void
+subopt_parallel(vrna_fold_compound_t *vc,
+                int delta,
+                int sorted,
+                size_t max_memory,
+                int num_threads,
+                vrna_subopt_callback *cb,
+                void *data){
+
+  int           t;
+  unsigned int  pending;
+  subopt_env    *master, **envs;
+  subopt_output *outputs;
+  STATE         *state;
+
+  if ((num_threads < 2) && (!sorted)) {
+    vrna_subopt_cb(vc, delta, cb, data);
+    return;
+  }
+
+  /* the memory budget is shared among all threads */
+  outputs = (subopt_output *)vrna_alloc(sizeof(subopt_output) * num_threads);
+  for (t = 0; t < num_threads; t++)
+    output_init(&(outputs[t]), vc->length, sorted, max_memory / num_threads, cb, data);
+
+  master          = subopt_init(vc, delta, &output_store, (void *)&(outputs[0]));
+  master->dos     = (int *)vrna_alloc(sizeof(int) * (MAXDOS + 1));
+
+  /* expand the first levels of the search serially until there is enough work for all threads */
+  while ((master->stack_size - master->stack_bottom > 0) &&
+         (master->stack_size - master->stack_bottom < PARALLEL_STATES_PER_THREAD * num_threads)) {
+    state = pop(master);
+    process_state(vc, state, master);
+    free_state_node(state, master);
+  }
+
+  /* deal the remaining states among the threads */
+  envs    = (subopt_env **)vrna_alloc(sizeof(subopt_env *) * num_threads);
+  envs[0] = master;
+  for (t = 1; t < num_threads; t++) {
+    envs[t]   = (subopt_env *)vrna_alloc(sizeof(subopt_env));
+    *envs[t]  = *master;
+
+    envs[t]->Stack        = NULL;
+    envs[t]->stack_bottom = 0;
+    envs[t]->stack_size   = 0;
+    envs[t]->stack_max    = 0;
+    envs[t]->dos          = (int *)vrna_alloc(sizeof(int) * (MAXDOS + 1));
+    envs[t]->cb_data      = (void *)&(outputs[t]);
+    pool_init(&(envs[t]->states), sizeof(STATE));
+    pool_init(&(envs[t]->intervals), sizeof(INTERVAL));
+    pool_init(&(envs[t]->structures), sizeof(char) * (vc->length + 1));
+  }
+
+  pending = 0;
+  for (t = 0; t < num_threads; t++) {
+    envs[t]->concurrent = 1;
+    envs[t]->pending    = &pending;
+#ifdef _OPENMP
+    omp_init_lock(&(envs[t]->lock));
+#endif
+  }
+
+  /* the master thread keeps every num_threads-th state */
+  {
+    unsigned int  k, num_states;
+    STATE         **states;
+
+    num_states  = master->stack_size - master->stack_bottom;
+    states      = (STATE **)vrna_alloc(sizeof(STATE *) * (num_states + 1));
+    memcpy(states, master->Stack + master->stack_bottom, sizeof(STATE *) * num_states);
+    master->stack_size = master->stack_bottom = 0;
+
+    for (k = 0; k < num_states; k++)
+      push(envs[k % num_threads], states[k]);
+
+    free(states);
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+  {
+    int         tid;
+    subopt_env  *env;
+    STATE       *s;
+
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#else
+    tid = 0;
+#endif
+    env = envs[tid];
+
+    while (1) {
+      s = pop(env);
+
+      if (!s)
+        s = steal(envs, tid, num_threads);
+
+      if (!s) {
+        unsigned int p;
+#ifdef _OPENMP
+#pragma omp atomic read
+        p = pending;
+#else
+        p = pending;
+#endif
+        if (p == 0)
+          break;
+
+#ifdef _OPENMP
+        sched_yield();
+#endif
+        continue;
+      }
+
+      process_state(vc, s, env);
+      free_state_node(s, env);
+
+#ifdef _OPENMP
+#pragma omp atomic
+      pending--;
+#else
+      pending--;
+#endif
+    }
+
+    if (!sorted) {
+#ifdef _OPENMP
+#pragma omp critical (subopt_output)
+#endif
+      output_flush(&(outputs[tid]));
+    }
+  }
+
+  if (sorted)
+    output_merge(outputs, num_threads, cb, data);
+
+  cb(NULL, 0, data);
+
+  /* collect the density of states */
+  for (t = 0; t < num_threads; t++) {
+    int e;
+    for (e = 0; e <= MAXDOS; e++)
+      density_of_states[e] += envs[t]->dos[e];
+  }
+
+  /*
+      states may have been released into the pools of other threads,
+      so the pools of all threads must not be free'd before all threads are done
+  */
+  for (t = num_threads - 1; t >= 0; t--) {
+#ifdef _OPENMP
+    omp_destroy_lock(&(envs[t]->lock));
+#endif
+    free(envs[t]->dos);
+    output_free(&(outputs[t]));
+    subopt_env_free(envs[t]);
+  }
+
+  free(envs);
+  free(outputs);
+}
+
+
+PRIVATE subopt_env *
+subopt_init(vrna_fold_compound_t *vc,
+            int delta,
+            vrna_subopt_callback *cb,
+            void *data){
+
+  subopt_env    *env;
+  STATE         *state;
+  int           old_dangles, logML, dangle_model, length, circular, threshold;
+  double        min_en;
+  char          *struc;
   vrna_param_t  *P;
   vrna_md_t     *md;
   int           minimal_energy;
@@ -641,10 +1077,8 @@ vrna_subopt_cb( vrna_fold_compound_t *vc,
 
   vrna_fold_compound_prepare(vc, VRNA_OPTION_MFE | VRNA_OPTION_HYBRID);
 
-  sequence            = vc->sequence;
   length              = vc->length;
-  cp                  = vc->cutpoint;
-  P                   = vc->params;
+  P                   = vrna_params_detach(vc); /* model details are modified below */
   md                  = &(P->model_details);
 
   /* do mfe folding to get fill arrays and get ground state energy  */
@@ -684,15 +1118,6 @@ vrna_subopt_cb( vrna_fold_compound_t *vc,
   }
 
   free(struc);
-  eprint = print_energy + min_en;
-
-  correction = (min_en < 0) ? -0.1 : 0.1;
-
-  /* Initialize ------------------------------------------------------------ */
-
-  maxlevel = 0;
-  count = 0;
-  partial_energy = 0;
 
   /* Initialize the stack ------------------------------------------------- */
 
@@ -705,89 +1130,535 @@ vrna_subopt_cb( vrna_fold_compound_t *vc,
 
   /* init env data structure */
   env = (subopt_env *)vrna_alloc(sizeof(subopt_env));
-  env->Stack      = NULL;
-  env->nopush     = true;
-  env->Stack      = make_list();                                                   /* anchor */
-  env->Intervals  = make_list();                                   /* initial state: */
-  interval   = make_interval(1, length, 0);          /* interval [1,length,0] */
-  push(env->Intervals, interval);
-  env->nopush = false;
-  state  = make_state(env->Intervals, NULL, partial_energy,0, length);
+  env->Stack        = NULL;
+  env->stack_bottom = 0;
+  env->stack_size   = 0;
+  env->stack_max    = 0;
+  env->nopush       = true;
+  env->length       = length;
+  env->threshold    = threshold;
+  env->logML        = logML;
+  env->dangle_model = dangle_model;
+  env->cp           = vc->cutpoint;
+  env->min_en       = min_en;
+  env->eprint       = print_energy + min_en;
+  env->correction   = (min_en < 0) ? -0.1 : 0.1;
+  env->dos          = density_of_states;
+  env->cb           = cb;
+  env->cb_data      = data;
+  env->concurrent   = 0;
+  env->pending      = NULL;
+
+  /* all states, intervals, and partial structures are taken from (and returned to) these pools */
+  pool_init(&(env->states), sizeof(STATE));
+  pool_init(&(env->intervals), sizeof(INTERVAL));
+  pool_init(&(env->structures), sizeof(char) * (length + 1));
+
+  state  = make_state(0, 0, env);                               /* initial state: */
+  push_interval(state, 1, length, 0, env);                      /* interval [1,length,0] */
   /* state->best_energy = minimal_energy; */
-  push(env->Stack, state);
+  push(env, state);
   env->nopush = false;
 
-  /* end initialize ------------------------------------------------------- */
+  return env;
+}
 
 
-  while (1) {                    /* forever, til nothing remains on stack */
+PRIVATE void
+subopt_env_free(subopt_env *env){
 
-    maxlevel = (env->Stack->count > maxlevel ? env->Stack->count : maxlevel);
+  pool_free(&(env->states));
+  pool_free(&(env->intervals));
+  pool_free(&(env->structures));
+  free(env->Stack);
+  free(env);
+}
 
-    if (LST_EMPTY (env->Stack))                   /* we are done! clean up and quit */
-      {
-        /* fprintf(stderr, "maxlevel: %d\n", maxlevel); */
 
-        lst_kill(env->Stack, free_state_node);
+PRIVATE void
+process_state(vrna_fold_compound_t *vc,
+              STATE *state,
+              subopt_env *env){
 
-        cb(NULL, 0, data); /* NULL (last time to call callback function */
+  INTERVAL  *interval;
+  double    structure_energy;
 
-        break;
+  if (!state->Intervals)
+    {
+      int e;
+      char *structure;
+      /* state has no intervals left: we got a solution */
+
+      structure = state->structure;
+      structure_energy = state->partial_energy / 100.;
+
+#ifdef CHECK_ENERGY
+      structure_energy = vrna_eval_structure(vc, structure);
+
+      if (!env->logML)
+        if ((double) (state->partial_energy / 100.) != structure_energy) {
+          vrna_message_error("%s %6.2f %6.2f",
+                                    structure,
+                                    state->partial_energy / 100.,
+                                    structure_energy );
+          exit(1);
+        }
+#endif
+      if (env->logML || (env->dangle_model==1) || (env->dangle_model==3)) { /* recalc energy */
+        structure_energy = vrna_eval_structure(vc, structure);
       }
 
-    /* pop the last element ---------------------------------------------- */
+      e = (int) ((structure_energy-env->min_en)*10. - env->correction); /* avoid rounding errors */
+      if (e>MAXDOS) e=MAXDOS;
+      if (e<0) e=0;                 /* re-evaluated energies may be below the MFE of the fold with dangles=2 */
+      env->dos[e]++;
+      if(structure_energy <= env->eprint){
+        char *outstruct = vrna_cut_point_insert(structure, env->cp);
+        env->cb((const char *)outstruct, structure_energy, env->cb_data);
+        free(outstruct);
+      }
+    }
+  else {
+    /* get (and remove) next interval of state to analyze */
+    int i, j, array_flag;
 
-    state = pop(env->Stack);                       /* current state to work with */
+    interval    = state->Intervals;
+    i           = interval->i;
+    j           = interval->j;
+    array_flag  = interval->array_flag;
+    pop_interval(state, env);
 
-    if (LST_EMPTY(state->Intervals))
-      {
-        int e;
-        /* state has no intervals left: we got a solution */
+    scan_interval(vc, i, j, array_flag, env->threshold, state, env);
+  }
+}
 
-        count++;
-        structure = get_structure(state);
-        structure_energy = state->partial_energy / 100.;
 
-#ifdef CHECK_ENERGY
-        structure_energy = vrna_eval_structure(vc, structure);
+/* take the oldest state, i.e. the one with (presumably) the largest remaining search tree, from another thread */
+PRIVATE STATE *
+steal(subopt_env **envs,
+      int thief,
+      int num_threads){
 
-        if (!logML)
-          if ((double) (state->partial_energy / 100.) != structure_energy) {
-            vrna_message_error("%s %6.2f %6.2f",
-                                      structure,
-                                      state->partial_energy / 100.,
-                                      structure_energy );
-            exit(1);
-          }
+  int         t;
+  STATE       *state = NULL;
+  subopt_env  *victim;
+
+  for (t = 1; (t < num_threads) && (!state); t++) {
+    victim = envs[(thief + t) % num_threads];
+
+#ifdef _OPENMP
+    omp_set_lock(&(victim->lock));
 #endif
-        if (logML || (dangle_model==1) || (dangle_model==3)) { /* recalc energy */
-          structure_energy = vrna_eval_structure(vc, structure);
-        }
 
-        e = (int) ((structure_energy-min_en)*10. - correction); /* avoid rounding errors */
-        if (e>MAXDOS) e=MAXDOS;
-        density_of_states[e]++;
-        if(structure_energy <= eprint){
-          char *outstruct = vrna_cut_point_insert(structure, cp);
-          cb((const char *)outstruct, structure_energy, data);
-          free(outstruct);
-        }
-        free(structure);
-      }
-    else {
-      /* get (and remove) next interval of state to analyze */
+    if (victim->stack_size > victim->stack_bottom) {
+      state = victim->Stack[victim->stack_bottom++];
+      if (victim->stack_size == victim->stack_bottom)
+        victim->stack_size = victim->stack_bottom = 0;
+    }
+
+#ifdef _OPENMP
+    omp_unset_lock(&(victim->lock));
+#endif
+  }
+
+  return state;
+}
+
+
+PRIVATE void
+output_init(subopt_output *out,
+            int length,
+            int sorted,
+            size_t max_memory,
+            vrna_subopt_callback *cb,
+            void *data){
+
+  size_t record_size;
+
+  out->size       = 0;
+  out->max_size   = PARALLEL_OUTPUT_BUFFER;
+  out->energies   = (float *)vrna_alloc(sizeof(float) * out->max_size);
+  out->structures = (char **)vrna_alloc(sizeof(char *) * out->max_size);
+  out->sorted     = sorted;
+  out->runs       = NULL;
+  out->num_runs   = 0;
+  out->cb         = cb;
+  out->data       = data;
+  pool_init(&(out->strings), sizeof(char) * (length + 2)); /* including the '&' of dimers */
+
+  /* memory required per structure, including the temporary array of output_sort() */
+  out->max_records = 0;
+  if (sorted && max_memory) {
+    record_size       = sizeof(char) * (length + 2) + sizeof(float) + sizeof(char *) + sizeof(SOLUTION);
+    out->max_records  = (unsigned int)MIN2(max_memory / record_size, (size_t)(UINT_MAX / 2));
+    out->max_records  = MAX2(out->max_records, PARALLEL_OUTPUT_BUFFER);
+  }
+}
+
+
+PRIVATE void
+output_store(const char *structure,
+             float energy,
+             void *data){
 
-      interval = pop(state->Intervals);
-      scan_interval(vc, interval->i, interval->j, interval->array_flag, threshold, state, env);
+  subopt_output *out = (subopt_output *)data;
 
-      free_interval_node(interval);        /* free the current interval */
+  if (out->size == out->max_size) {
+    if (!out->sorted) {
+#ifdef _OPENMP
+#pragma omp critical (subopt_output)
+#endif
+      output_flush(out);
+    } else if ((out->size != out->max_records) || (!output_spill(out))) {
+      out->max_size   *= 2;
+      if (out->max_records)
+        out->max_size = MIN2(out->max_size, out->max_records);
+
+      out->energies   = (float *)vrna_realloc(out->energies, sizeof(float) * out->max_size);
+      out->structures = (char **)vrna_realloc(out->structures, sizeof(char *) * out->max_size);
     }
+  }
 
-    free_state_node(state);                     /* free the current state */
-  } /* end of while (1) */
+  out->energies[out->size]    = energy;
+  out->structures[out->size]  = strcpy(pool_alloc(&(out->strings)), structure);
+  out->size++;
+}
 
-  /* cleanup memory */
-  free(env);
+
+/* pass all collected structures to the callback, the caller must ensure exclusive access to the callback */
+PRIVATE void
+output_flush(subopt_output *out){
+
+  unsigned int i;
+
+  for (i = 0; i < out->size; i++) {
+    out->cb((const char *)out->structures[i], out->energies[i], out->data);
+    pool_release(&(out->strings), out->structures[i]);
+  }
+
+  out->size = 0;
+}
+
+
+PRIVATE void
+output_sort(subopt_output *out){
+
+  unsigned int  i, j;
+  SOLUTION      *sol;
+
+  sol = (SOLUTION *)vrna_alloc(sizeof(SOLUTION) * (out->size + 1));
+  for (i = 0; i < out->size; i++) {
+    sol[i].energy     = out->energies[i];
+    sol[i].structure  = out->structures[i];
+  }
+
+  qsort(sol, out->size, sizeof(SOLUTION), compare);
+
+  for (j = 0; j < out->size; j++) {
+    out->energies[j]    = sol[j].energy;
+    out->structures[j]  = sol[j].structure;
+  }
+
+  free(sol);
+}
+
+
+/*
+    sort the collected structures and write them to a temporary file,
+    returns 0 if no temporary file could be created
+*/
+PRIVATE int
+output_spill(subopt_output *out){
+
+  unsigned int  i;
+  FILE          *fp;
+
+  fp = run_file_open();
+  if (!fp) {
+    vrna_message_warning("subopt: failed to create temporary file, sorting in memory");
+    out->max_records = 0;
+    return 0;
+  }
+
+  output_sort(out);
+
+  for (i = 0; i < out->size; i++) {
+    run_write((const char *)out->structures[i], out->energies[i], (void *)fp);
+    pool_release(&(out->strings), out->structures[i]);
+  }
+
+  if (fflush(fp) || ferror(fp))
+    vrna_message_error("subopt: failed to write temporary file");
+
+  out->runs = (FILE **)vrna_realloc(out->runs, sizeof(FILE *) * (out->num_runs + 1));
+  out->runs[out->num_runs++] = fp;
+  out->size = 0;
+
+  return 1;
+}
+
+
+/*
+    k-way merge of the sorted structures of all threads and all temporary files.
+    If there are too many temporary files, they are merged into larger ones first
+*/
+PRIVATE void
+output_merge(subopt_output *outs,
+             int num_outs,
+             vrna_subopt_callback *cb,
+             void *data){
+
+  int           t, num_runs, num_files, r;
+  unsigned int  i;
+  subopt_run    *runs;
+  FILE          *fp;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_outs)
+#endif
+  for (t = 0; t < num_outs; t++)
+    output_sort(&(outs[t]));
+
+  num_files = 0;
+  for (t = 0; t < num_outs; t++)
+    num_files += outs[t].num_runs;
+
+  runs      = (subopt_run *)vrna_alloc(sizeof(subopt_run) * (num_files + num_outs));
+  num_runs  = 0;
+
+  for (t = 0; t < num_outs; t++)
+    for (i = 0; i < outs[t].num_runs; i++) {
+      runs[num_runs++].fp = outs[t].runs[i];
+      outs[t].runs[i]     = NULL;
+    }
+
+  while (num_files > SORT_MERGE_FANIN) {
+    fp = run_file_open();
+    if (!fp)
+      vrna_message_error("subopt: failed to create temporary file");
+
+    run_merge(runs, SORT_MERGE_FANIN, &run_write, (void *)fp);
+
+    if (fflush(fp) || ferror(fp))
+      vrna_message_error("subopt: failed to write temporary file");
+
+    for (r = 0; r < SORT_MERGE_FANIN; r++)
+      fclose(runs[r].fp);
+
+    memmove(runs, runs + SORT_MERGE_FANIN, sizeof(subopt_run) * (num_files - SORT_MERGE_FANIN));
+    num_files -= SORT_MERGE_FANIN;
+    memset(runs + num_files, 0, sizeof(subopt_run) * SORT_MERGE_FANIN);
+    runs[num_files++].fp = fp;
+  }
+
+  num_runs = num_files;
+  for (t = 0; t < num_outs; t++)
+    runs[num_runs++].out = &(outs[t]);
+
+  run_merge(runs, num_runs, cb, data);
+
+  for (r = 0; r < num_files; r++)
+    fclose(runs[r].fp);
+
+  free(runs);
+}
+
+
+PRIVATE void
+output_free(subopt_output *out){
+
+  unsigned int i;
+
+  for (i = 0; i < out->num_runs; i++)
+    if (out->runs[i])
+      fclose(out->runs[i]);
+
+  pool_free(&(out->strings));
+  free(out->energies);
+  free(out->structures);
+  free(out->runs);
+}
+
+
+/* open an anonymous temporary file that is removed as soon as it is closed */
+PRIVATE FILE *
+run_file_open(void){
+
+  int         fd;
+  char        *name;
+  const char  *dir;
+  FILE        *fp = NULL;
+
+  dir = getenv("TMPDIR");
+  if ((!dir) || (*dir == '\0'))
+    dir = "/tmp";
+
+  name  = vrna_strdup_printf("%s/vrna_subopt_XXXXXX", dir);
+  fd    = mkstemp(name);
+
+  if (fd != -1) {
+    unlink(name);
+    fp = fdopen(fd, "w+b");
+    if (!fp)
+      close(fd);
+  }
+
+  free(name);
+
+  return fp;
+}
+
+
+/*
+    append a structure to a temporary file, structures consisting of
+    pairs and unpaired bases only are stored packed by vrna_db_pack()
+*/
+PRIVATE void
+run_write(const char *structure,
+          float energy,
+          void *data){
+
+  char  *packed;
+  FILE  *fp = (FILE *)data;
+
+  if (!structure)
+    return;
+
+  fwrite(&energy, sizeof(float), 1, fp);
+
+  if (structure[strspn(structure, "().")] == '\0') {
+    packed = vrna_db_pack(structure);
+    putc('p', fp);
+    fwrite(packed, sizeof(char), strlen(packed) + 1, fp);
+    free(packed);
+  } else {
+    putc('s', fp);
+    fwrite(structure, sizeof(char), strlen(structure) + 1, fp);
+  }
+}
+
+
+/* advance to the next structure of a run, returns 0 if the run is exhausted */
+PRIVATE int
+run_next(subopt_run *run){
+
+  int           c, kind;
+  unsigned int  l;
+
+  if (run->out) {
+    if (run->pos == run->out->size)
+      return 0;
+
+    run->energy     = run->out->energies[run->pos];
+    run->structure  = (const char *)run->out->structures[run->pos];
+    run->pos++;
+    return 1;
+  }
+
+  if (fread(&(run->energy), sizeof(float), 1, run->fp) != 1)
+    return 0;
+
+  kind = getc(run->fp);
+  l    = 0;
+  do {
+    if (l == run->buffer_size) {
+      run->buffer_size  = (run->buffer_size) ? 2 * run->buffer_size : 128;
+      run->buffer       = (char *)vrna_realloc(run->buffer, sizeof(char) * run->buffer_size);
+    }
+
+    c = getc(run->fp);
+    if (c == EOF)
+      vrna_message_error("subopt: failed to read temporary file");
+
+    run->buffer[l++] = (char)c;
+  } while (c != '\0');
+
+  free(run->unpacked);
+  run->unpacked = NULL;
+
+  if (kind == 'p') {
+    run->unpacked   = vrna_db_unpack(run->buffer);
+    run->structure  = (const char *)run->unpacked;
+  } else {
+    run->structure = (const char *)run->buffer;
+  }
+
+  return 1;
+}
+
+
+/* compare the current structures of two runs like compare() does */
+PRIVATE INLINE int
+run_compare(subopt_run *a,
+            subopt_run *b){
+
+  if (a->energy > b->energy)
+    return 1;
+  if (a->energy < b->energy)
+    return -1;
+  return strcmp(a->structure, b->structure);
+}
+
+
+/* k-way merge of sorted runs using a binary heap of the runs' current structures */
+PRIVATE void
+run_merge(subopt_run *runs,
+          int num_runs,
+          vrna_subopt_callback *cb,
+          void *data){
+
+  int         r, k, c, heap_size;
+  subopt_run  **heap, *run;
+
+  heap      = (subopt_run **)vrna_alloc(sizeof(subopt_run *) * num_runs);
+  heap_size = 0;
+
+  for (r = 0; r < num_runs; r++) {
+    run = &(runs[r]);
+    if (run->fp)
+      rewind(run->fp);
+
+    if (!run_next(run))
+      continue;
+
+    /* sift up */
+    for (k = heap_size++; k > 0; k = (k - 1) / 2) {
+      if (run_compare(heap[(k - 1) / 2], run) <= 0)
+        break;
+      heap[k] = heap[(k - 1) / 2];
+    }
+    heap[k] = run;
+  }
+
+  while (heap_size > 0) {
+    run = heap[0];
+    cb(run->structure, run->energy, data);
+
+    if (!run_next(run))
+      run = heap[--heap_size];
+
+    /* sift down */
+    for (k = 0; 2 * k + 1 < heap_size; k = c) {
+      c = 2 * k + 1;
+      if ((c + 1 < heap_size) && (run_compare(heap[c + 1], heap[c]) < 0))
+        c++;
+      if (run_compare(run, heap[c]) <= 0)
+        break;
+      heap[k] = heap[c];
+    }
+    if (heap_size > 0)
+      heap[k] = run;
+  }
+
+  for (r = 0; r < num_runs; r++) {
+    free(runs[r].buffer);
+    free(runs[r].unpacked);
+    runs[r].buffer      = NULL;
+    runs[r].unpacked    = NULL;
+    runs[r].buffer_size = 0;
+  }
+
+  free(heap);
 }
 
 
@@ -808,7 +1679,6 @@ scan_interval(vrna_fold_compound_t *vc,
   /* array_flag = 3:  trace back in fM1-array */
 
   STATE           *new_state, *temp_state;
-  INTERVAL        *new_interval;
   vrna_param_t    *P;
   vrna_md_t       *md;
   register int    k, fi, cij, ij;
@@ -868,7 +1738,7 @@ scan_interval(vrna_fold_compound_t *vc,
       state->partial_energy += f5[j];
     }
     if (env->nopush){
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
     return;
@@ -962,10 +1832,10 @@ scan_interval(vrna_fold_compound_t *vc,
             element_energy = E_MLstem(0, -1, -1, P);
             if(fML[indx[k]+i] + ggg[indx[j] + k + 1] + element_energy + best_energy <= threshold){
               
-              temp_state = derive_new_state(i, k, state, 0, array_flag);
+              temp_state = derive_new_state(i, k, state, 0, array_flag, env);
               env->nopush = false;
               repeat_gquad(vc, k+1, j, temp_state, element_energy, fML[indx[k]+i], best_energy, threshold, env);
-              free_state_node(temp_state);
+              free_state_node(temp_state, env);
             }
           }
         }
@@ -1000,10 +1870,10 @@ scan_interval(vrna_fold_compound_t *vc,
 
           if(ON_SAME_STRAND(k, k+1, cp)){
             if(fML[indx[k]+i] + c[k1j] + element_energy + best_energy <= threshold){
-              temp_state  = derive_new_state(i, k, state, 0, array_flag);
+              temp_state  = derive_new_state(i, k, state, 0, array_flag, env);
               env->nopush = false;
               repeat(vc, k+1, j, temp_state, element_energy, fML[indx[k]+i], best_energy, threshold, env);
-              free_state_node(temp_state);
+              free_state_node(temp_state, env);
             }
           }
         }
@@ -1116,11 +1986,11 @@ scan_interval(vrna_fold_compound_t *vc,
         if(ON_SAME_STRAND(k,j,cp)){
           element_energy = 0;
           if(f5[k-1] + ggg[kj] + element_energy + best_energy <= threshold){
-            temp_state = derive_new_state(1, k-1, state, 0, 0);
+            temp_state = derive_new_state(1, k-1, state, 0, 0, env);
             env->nopush = false;
             /* backtrace the quadruplex */
             repeat_gquad(vc, k, j, temp_state, element_energy, f5[k-1], best_energy, threshold, env);
-            free_state_node(temp_state);
+            free_state_node(temp_state, env);
           }
         }
       }
@@ -1148,10 +2018,10 @@ scan_interval(vrna_fold_compound_t *vc,
         }
 
         if (f5[k-1] + c[kj] + element_energy + best_energy <= threshold){
-          temp_state = derive_new_state(1, k-1, state, 0, 0);
+          temp_state = derive_new_state(1, k-1, state, 0, 0, env);
           env->nopush = false;
           repeat(vc, k, j, temp_state, element_energy, f5[k-1], best_energy, threshold, env);
-          free_state_node(temp_state);
+          free_state_node(temp_state, env);
         }
       }
     }
@@ -1207,9 +2077,9 @@ scan_interval(vrna_fold_compound_t *vc,
       }
 
       if(tmp_en <= threshold){
-        new_state = derive_new_state(1,2,state,0,0);
+        new_state = derive_new_state(1,2,state,0,0, env);
         new_state->partial_energy = 0;
-        push(env->Stack, new_state);
+        push(env, new_state);
         env->nopush = false;
       }
     }
@@ -1327,27 +2197,24 @@ scan_interval(vrna_fold_compound_t *vc,
             if(tmpE2 + fML[indx[k]+1] + P->MLclosing <= threshold){
               /* we've (hopefully) found a valid decomposition of fM2 and therefor we have all */
               /* three intervals for our new state to be pushed on stack R */
-              new_state = copy_state(state);
+              new_state = copy_state(state, env);
 
               /* first interval leads for search in fML array */
-              new_interval = make_interval(1, k, 1);
-              push(new_state->Intervals, new_interval);
+              push_interval(new_state, 1, k, 1, env);
               env->nopush = false;
 
               /* next, we have the first interval that has to be traced in fM1 */
-              new_interval = make_interval(k+1, l, 3);
-              push(new_state->Intervals, new_interval);
+              push_interval(new_state, k+1, l, 3, env);
               env->nopush = false;
 
               /* and the last of our three intervals is also one to be traced within fM1 array... */
-              new_interval = make_interval(l+1, j, 3);
-              push(new_state->Intervals, new_interval);
+              push_interval(new_state, l+1, j, 3, env);
               env->nopush = false;
 
               /* mmh, we add the energy for closing the multiloop now... */
               new_state->partial_energy += P->MLclosing;
               /* next we push our state onto the R stack */
-              push(env->Stack, new_state);
+              push(env, new_state);
               env->nopush = false;
 
             }
@@ -1390,10 +2257,10 @@ scan_interval(vrna_fold_compound_t *vc,
 
       if(with_gquad){
         if(fc[k+1] + ggg[ik] + best_energy <= threshold){
-          temp_state = derive_new_state(k+1, j, state, 0, 4);
+          temp_state = derive_new_state(k+1, j, state, 0, 4, env);
           env->nopush = false;
           repeat_gquad(vc, i, k, temp_state, 0, fc[k+1], best_energy, threshold, env);
-          free_state_node(temp_state);
+          free_state_node(temp_state, env);
         }
       }
 
@@ -1421,10 +2288,10 @@ scan_interval(vrna_fold_compound_t *vc,
 */
 
         if (fc[k+1] + c[ik] + element_energy + best_energy <= threshold){
-          temp_state = derive_new_state(k+1, j, state, 0, 4);
+          temp_state = derive_new_state(k+1, j, state, 0, 4, env);
           env->nopush = false;
           repeat(vc, i, k, temp_state, element_energy, fc[k+1], best_energy, threshold, env);
-          free_state_node(temp_state);
+          free_state_node(temp_state, env);
         }
       }
     }
@@ -1494,10 +2361,10 @@ scan_interval(vrna_fold_compound_t *vc,
 
       if(with_gquad){
         if(fc[k-1] + ggg[kj] + best_energy <= threshold){
-          temp_state = derive_new_state(i, k-1, state, 0, 5);
+          temp_state = derive_new_state(i, k-1, state, 0, 5, env);
           env->nopush = false;
           repeat_gquad(vc, k, j, temp_state, 0, fc[k-1], best_energy, threshold, env);
-          free_state_node(temp_state);
+          free_state_node(temp_state, env);
         }
       }
 
@@ -1526,10 +2393,10 @@ scan_interval(vrna_fold_compound_t *vc,
 */
 
         if (fc[k-1] + c[kj] + element_energy + best_energy <= threshold) {
-          temp_state = derive_new_state(i, k-1, state, 0, 5);
+          temp_state = derive_new_state(i, k-1, state, 0, 5, env);
           env->nopush = false;
           repeat(vc, k, j, temp_state, element_energy, fc[k-1], best_energy, threshold, env);
-          free_state_node(temp_state);
+          free_state_node(temp_state, env);
         }
       }
     }
@@ -1571,7 +2438,7 @@ scan_interval(vrna_fold_compound_t *vc,
   }
 
   if (env->nopush){
-    push_back(env->Stack, state);
+    push_back(env, state);
     env->nopush = false;
   }
   return;
@@ -1621,14 +2488,14 @@ repeat_gquad( vrna_fold_compound_t *vc,
       get_gquad_pattern_exhaustive(S1, i, j, P, L, l, threshold - best_energy);
 
       for(cnt = 0; L[cnt] != -1; cnt++){
-        new_state = copy_state(state);
+        new_state = copy_state(state, env);
 
         make_gquad(i, L[cnt], &(l[3*cnt]), new_state);
         new_state->partial_energy += part_energy;
         new_state->partial_energy += element_energy;
         /* new_state->best_energy =
            hairpin[unpaired] + element_energy + best_energy; */
-        push(env->Stack, new_state);
+        push(env, new_state);
         env->nopush = false;
       }
       free(L);
@@ -1735,12 +2602,12 @@ repeat( vrna_fold_compound_t *vc,
                 energy += sc->f(i, j, i+1, j-1, VRNA_DECOMP_PAIR_IL, sc->data);
             }
 
-            new_state = derive_new_state(i+1, j-1, state, part_energy + energy, 2);
+            new_state = derive_new_state(i+1, j-1, state, part_energy + energy, 2, env);
             make_pair(i, j, new_state);
             make_pair(i+1, j-1, new_state);
 
             /* new_state->best_energy = new + best_energy; */
-            push(env->Stack, new_state);
+            push(env, new_state);
             env->nopush = false;
             if (i==1 || state->structure[i-2]!='('  || state->structure[j]!=')')
               /* adding a stack is the only possible structure */
@@ -1902,12 +2769,12 @@ repeat( vrna_fold_compound_t *vc,
                         + sc->energy_up[q[cnt]+1][j - q[cnt] - 1];
           }
 
-          new_state = derive_new_state(p[cnt], q[cnt], state, tmp_en + part_energy, 6);
+          new_state = derive_new_state(p[cnt], q[cnt], state, tmp_en + part_energy, 6, env);
 
           make_pair(i, j, new_state);
 
           /* new_state->best_energy = new + best_energy; */
-          push(env->Stack, new_state);
+          push(env, new_state);
           env->nopush = false;
         }
       }
@@ -2030,7 +2897,7 @@ wrap_subopt(char *string,
   vc = vrna_fold_compound(seq, &(P->model_details), ((is_circular == 0) ? VRNA_OPTION_HYBRID : VRNA_OPTION_DEFAULT));
 
   if(parameters){ /* replace params if necessary */
-    free(vc->params);
+    vrna_params_release(vc->params);
     vc->params = P;
   } else {
     free(P);
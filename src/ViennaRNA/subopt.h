@@ -58,6 +58,14 @@ struct vrna_subopt_sol_s {
  */
 #define MAXDOS                1000
 
+/**
+ *  @brief Default memory budget (in bytes) for sorting suboptimal structures
+ *
+ *  @ingroup subopt_wuchty
+ *  @see vrna_subopt_cb_sorted(), vrna_subopt()
+ */
+#define VRNA_SUBOPT_SORT_MEMORY   268435456
+
 /**
  *  @addtogroup subopt_wuchty
  *  @{
@@ -74,6 +82,9 @@ struct vrna_subopt_sol_s {
  *  (fp==NULL) returned in a #vrna_subopt_solution_t * list terminated
  *  by an entry were the 'structure' member is NULL.
  *
+ *  If the structures are sorted and written to 'fp', at most #VRNA_SUBOPT_SORT_MEMORY bytes
+ *  are used to store them, see vrna_subopt_cb_sorted().
+ *
  *  @ingroup subopt_wuchty
  *
  *  @note This function requires all multibranch loop DP matrices for unique
@@ -141,6 +152,81 @@ vrna_subopt_cb( vrna_fold_compound_t *vc,
                 vrna_subopt_callback *cb,
                 void *data);
 
+/**
+ *  @brief  Generate suboptimal structures within an energy band arround the MFE using multiple threads
+ *
+ *  This function computes the same structures as vrna_subopt_cb(). However, the
+ *  partial structures of the search are distributed among all available OpenMP threads:
+ *  The first levels of the search are expanded by the calling thread, before each thread
+ *  continues the depth-first search on its own share of partial structures. Threads that
+ *  run out of work take over the partial structures closest to the root of another thread's
+ *  search.
+ *
+ *  The callback @p cb is never invoked concurrently. Structures are collected by each thread
+ *  and handed over in batches, so their order differs from that of vrna_subopt_cb() and may
+ *  change from run to run. If @p sorted is non-zero, the structures of each thread are sorted
+ *  by free energy (and lexicographically for equal free energies), and the sorted lists of
+ *  all threads are merged before being passed to @p cb, i.e. in the same order vrna_subopt()
+ *  produces. In that case, this function is equivalent to vrna_subopt_cb_sorted() with a memory
+ *  budget of #VRNA_SUBOPT_SORT_MEMORY.
+ *  As with vrna_subopt_cb(), the end of the output is indicated by passing NULL to the callback.
+ *
+ *  Without OpenMP support, or if only a single thread is available, this function is
+ *  equivalent to vrna_subopt_cb() (apart from the sorting).
+ *
+ *  @ingroup subopt_wuchty
+ *
+ *  @note Soft constraint callbacks of @p vc are invoked from multiple threads concurrently.
+ *
+ *  @see vrna_subopt_cb(), vrna_subopt_cb_sorted(), vrna_subopt_callback, vrna_subopt()
+ *  @param  vc      fold compount with the sequence data
+ *  @param  delta   Energy band arround the MFE in 10cal/mol, i.e. deka-calories
+ *  @param  sorted  Sort results by energy in ascending order
+ *  @param  cb      Pointer to a callback function that handles the backtracked structure and its free energy in kcal/mol
+ *  @param  data    Pointer to some data structure that is passed along to the callback
+ */
+void
+vrna_subopt_cb_parallel(vrna_fold_compound_t *vc,
+                        int delta,
+                        int sorted,
+                        vrna_subopt_callback *cb,
+                        void *data);
+
+/**
+ *  @brief  Generate suboptimal structures within an energy band arround the MFE sorted by free energy
+ *
+ *  This function passes the same structures as vrna_subopt_cb() to the callback @p cb, but
+ *  sorted by free energy in ascending order, and lexicographically for equal free energies,
+ *  i.e. in the same order as vrna_subopt() with sorting enabled.
+ *
+ *  Sorting requires all structures to be generated before the first one can be passed to
+ *  the callback. To keep the memory requirements predictable, at most @p max_memory bytes
+ *  are used to store structures. Whenever the budget is exhausted, the collected structures
+ *  are sorted and written to an (anonymous) temporary file. The sorted files are merged once
+ *  the search is complete. Structures that consist of base pairs and unpaired bases only are
+ *  stored compressed (see vrna_db_pack()). Temporary files are created in the directory given by
+ *  the environment variable @p TMPDIR, or in @p /tmp. If no temporary file can be created,
+ *  all structures are kept in memory.
+ *
+ *  The search is distributed among all available OpenMP threads as in vrna_subopt_cb_parallel(),
+ *  each of which receives an equal share of the memory budget.
+ *
+ *  @ingroup subopt_wuchty
+ *
+ *  @see vrna_subopt_cb(), vrna_subopt_cb_parallel(), vrna_subopt(), #VRNA_SUBOPT_SORT_MEMORY
+ *  @param  vc          fold compount with the sequence data
+ *  @param  delta       Energy band arround the MFE in 10cal/mol, i.e. deka-calories
+ *  @param  max_memory  Maximum amount of memory in bytes used to store structures (0 = no limit)
+ *  @param  cb          Pointer to a callback function that handles the backtracked structure and its free energy in kcal/mol
+ *  @param  data        Pointer to some data structure that is passed along to the callback
+ */
+void
+vrna_subopt_cb_sorted(vrna_fold_compound_t *vc,
+                      int delta,
+                      size_t max_memory,
+                      vrna_subopt_callback *cb,
+                      void *data);
+
 /**
  *  @brief Compute Zuker type suboptimal structures
  *
@@ -245,6 +245,25 @@ vrna_ud_add_motif(vrna_fold_compound_t  *vc,
 }
 
 
+PUBLIC int
+vrna_ud_default_callbacks(vrna_fold_compound_t *vc){
+
+  vrna_ud_t *ud;
+
+  if(!vc || !vc->domains_up)
+    return 1;
+
+  ud = vc->domains_up;
+
+  return  ((!ud->prod_cb        || (ud->prod_cb == &default_prod_rule)) &&
+           (!ud->exp_prod_cb    || (ud->exp_prod_cb == &default_exp_prod_rule)) &&
+           (!ud->energy_cb      || (ud->energy_cb == &default_energy)) &&
+           (!ud->exp_energy_cb  || (ud->exp_energy_cb == &default_exp_energy)) &&
+           (!ud->probs_add      || (ud->probs_add == &default_probs_add)) &&
+           (!ud->probs_get      || (ud->probs_get == &default_probs_get))) ? 1 : 0;
+}
+
+
 PUBLIC int *
 vrna_ud_get_motif_size_at(vrna_fold_compound_t  *vc,
                           int                   i,
@@ -715,7 +734,7 @@ prepare_matrices( vrna_fold_compound_t *vc,
   vrna_ud_t   *domains_up;
 
   n             = (int)vc->length;
-  size          = ((n+1)*(n+2))/2 + 1;
+  size          = ((size_t)(n+1)*(n+2))/2 + 1;
   domains_up    = vc->domains_up;
 
   free_default_data_matrices(data);
@@ -769,7 +788,7 @@ prepare_exp_matrices( vrna_fold_compound_t *vc,
   vrna_ud_t   *domains_up;
 
   n             = (int)vc->length;
-  size          = ((n+1)*(n+2))/2 + 1;
+  size          = ((size_t)(n+1)*(n+2))/2 + 1;
   domains_up    = vc->domains_up;
 
   free_default_data_exp_matrices(data);
@@ -879,7 +898,7 @@ default_prod_rule(vrna_fold_compound_t *vc,
   int           *energies_mb;
 
   n             = (int)vc->length;
-  size          = ((n+1)*(n+2))/2 + 1;
+  size          = ((size_t)(n+1)*(n+2))/2 + 1;
   idx           = vc->jindx;
   domains_up    = vc->domains_up;
   data          = (struct ligands_up_data_default *)d;
@@ -998,7 +1017,7 @@ default_exp_prod_rule(vrna_fold_compound_t *vc,
   double        kT;
 
   n             = (int)vc->length;
-  size          = ((n+1)*(n+2))/2 + 1;
+  size          = ((size_t)(n+1)*(n+2))/2 + 1;
   idx           = vc->iindx;
   domains_up    = vc->domains_up;
   data          = (struct ligands_up_data_default *)d;
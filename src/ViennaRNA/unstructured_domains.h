@@ -248,6 +248,20 @@ vrna_ud_detect_motifs(vrna_fold_compound_t *vc,
  */
 void  vrna_ud_remove(vrna_fold_compound_t *vc);
 
+
+/**
+ *  @brief Check whether the unstructured domain callbacks are the default implementation
+ *
+ *  The default callbacks, i.e. those set by vrna_ud_add_motif(), may safely be called from
+ *  several threads at once. Callbacks that replace them need not be thread-safe.
+ *
+ *  @ingroup domains_up
+ *
+ *  @param  vc  The #vrna_fold_compound_t data structure
+ *  @return     1 if no unstructured domains or only the default callbacks are present, 0 otherwise
+ */
+int   vrna_ud_default_callbacks(vrna_fold_compound_t *vc);
+
 /**
  *  @brief  Attach an auxiliary data structure
  *
@@ -80,14 +80,14 @@ PRIVATE uint32_t  rj_mix( uint32_t a, uint32_t b, uint32_t c);
 /* include the following two functions only if not including <dmalloc.h> */
 
 PUBLIC void *
-vrna_alloc(unsigned size){
+vrna_alloc(size_t size){
 
   void *pointer;
 
-  if ( (pointer = (void *) calloc(1, (size_t) size)) == NULL) {
+  if ( (pointer = (void *) calloc(1, size)) == NULL) {
 #ifdef EINVAL
     if (errno==EINVAL) {
-      fprintf(stderr,"vrna_alloc: requested size: %d\n", size);
+      fprintf(stderr,"vrna_alloc: requested size: %lu\n", (unsigned long)size);
       vrna_message_error("Memory allocation failure -> EINVAL");
     }
     if (errno==ENOMEM)
@@ -98,7 +98,7 @@ vrna_alloc(unsigned size){
 }
 
 PUBLIC void *
-vrna_realloc(void *p, unsigned size){
+vrna_realloc(void *p, size_t size){
 
   if (p == NULL)
     return vrna_alloc(size);
@@ -106,7 +106,7 @@ vrna_realloc(void *p, unsigned size){
   if (p == NULL) {
 #ifdef EINVAL
     if (errno==EINVAL) {
-      fprintf(stderr,"vrna_realloc: requested size: %d\n", size);
+      fprintf(stderr,"vrna_realloc: requested size: %lu\n", (unsigned long)size);
       vrna_message_error("vrna_realloc allocation failure -> EINVAL");
     }
     if (errno==ENOMEM)
@@ -144,7 +144,7 @@ the library or stays hidden */
  *  @param size The size of the memory to be allocated in bytes
  *  @return     A pointer to the allocated memory
  */
-void  *vrna_alloc(unsigned size);
+void  *vrna_alloc(size_t size);
 
 /**
  *  @brief Reallocate space safely
@@ -153,7 +153,7 @@ void  *vrna_alloc(unsigned size);
  *  @param size The size of the memory to be allocated in bytes
  *  @return     A pointer to the newly allocated memory
  */
-void  *vrna_realloc(void *p, unsigned size);
+void  *vrna_realloc(void *p, size_t size);
 
 #endif
 
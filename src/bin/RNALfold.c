@@ -27,6 +27,10 @@
 #include "gengetopt_helper.h"
 #include "input_id_helper.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/color_output.inc"
 
 typedef struct {
@@ -64,7 +68,8 @@ main(int  argc,
   char                        *ParamFile, *ns_bases, *rec_sequence, *rec_id, **rec_rest,
                               *orig_sequence, *infile, *outfile, *id_prefix, *id_delim, *filename_delim;
   unsigned int                rec_type, read_opt;
-  int                         length, istty, noconv, maxdist, zsc, tofile, auto_id, id_digits, filename_full;
+  int                         length, istty, noconv, maxdist, zsc, tofile, auto_id, id_digits, filename_full,
+                              jobs;
   long int                    seq_number;
   double                      min_en, min_z;
   vrna_md_t                   md;
@@ -87,6 +92,7 @@ main(int  argc,
   tofile        = 0;
   filename_full = 0;
   auto_id       = 0;
+  jobs          = 0;
 
   /* apply default model details */
   vrna_md_set_default(&md);
@@ -169,6 +175,16 @@ main(int  argc,
   if (args_info.gquad_given)
     md.gquad = gquad = 1;
 
+  /* parallel processing of long sequences */
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    jobs = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_max_threads();
+    omp_set_num_threads(jobs);
+#else
+    vrna_message_error("\'j\' option is available only if compiled with OpenMP support!");
+#endif
+  }
+
   if (args_info.outfile_given) {
     tofile = 1;
     if (args_info.outfile_arg)
@@ -311,9 +327,17 @@ main(int  argc,
     data.dangle_model = md.dangles;
 
 #ifdef VRNA_WITH_SVM
-    min_en = (zsc) ? vrna_mfe_window_zscore_cb(vc, min_z, &default_callback_z, (void *)&data) : vrna_mfe_window_cb(vc, &default_callback, (void *)&data);
+    if (jobs)
+      min_en = (zsc) ? vrna_mfe_window_zscore_parallel_cb(vc, min_z, &default_callback_z, (void *)&data) : vrna_mfe_window_parallel_cb(vc, &default_callback, (void *)&data);
+    else
+      min_en = (zsc) ? vrna_mfe_window_zscore_cb(vc, min_z, &default_callback_z, (void *)&data) : vrna_mfe_window_cb(vc, &default_callback, (void *)&data);
+
 #else
-    min_en = vrna_mfe_window_cb(vc, &default_callback, (void *)&data);
+    if (jobs)
+      min_en = vrna_mfe_window_parallel_cb(vc, &default_callback, (void *)&data);
+    else
+      min_en = vrna_mfe_window_cb(vc, &default_callback, (void *)&data);
+
 #endif
     fprintf(output, "%s\n", orig_sequence);
 
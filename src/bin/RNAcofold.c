@@ -26,12 +26,27 @@
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/utils.h"
 #include "ViennaRNA/read_epars.h"
+#include "ViennaRNA/batch.h"
 #include "RNAcofold_cmdl.h"
 #include "gengetopt_helper.h"
 #include "input_id_helper.h"
 
 #include "ViennaRNA/color_output.inc"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* number of input sequences collected per thread before starting parallel predictions */
+#define JOBS_PER_THREAD   256
+
+typedef struct {
+  char  *id;              /* FASTA header */
+  char  *SEQ_ID;          /* sequence ID used to construct file names */
+  char  *sequence;        /* upper case sequence used for predictions */
+  char  *orig_sequence;   /* case-unmodified input sequence */
+} job_data;
+
 PRIVATE vrna_dimer_pf_t do_partfunc(char              *string,
                                     int               length,
                                     int               Switch,
@@ -52,6 +67,14 @@ PRIVATE void            do_concentrations(double            FEAB,
                                           vrna_exp_param_t  *parameters);
 
 
+PRIVATE void            process_jobs(job_data     *jobs,
+                                     unsigned int num_jobs,
+                                     vrna_md_t    *md,
+                                     int          noPS,
+                                     const char   *id_delim,
+                                     const char   *filename_delim);
+
+
 PRIVATE double bppmThreshold;
 
 /*--------------------------------------------------------------------------*/
@@ -67,8 +90,10 @@ main(int  argc,
   unsigned int                      rec_type, read_opt;
   int                               i, length, cl, pf, istty, noconv, noPS, enforceConstraints,
                                     doT, doC, cofi, auto_id, id_digits, istty_in, istty_out, batch,
-                                    filename_full;
+                                    filename_full, jobs;
+  unsigned int                      num_jobs, max_jobs;
   long int                          seq_number;
+  job_data                          *job_queue;
   double                            min_en, kT, *ConcAandB;
   plist                             *prAB, *prAA, *prBB, *prA, *prB, *mfAB, *mfAA, *mfBB, *mfA, *mfB;
   vrna_md_t                         md;
@@ -97,6 +122,10 @@ main(int  argc,
   command_file  = NULL;
   commands      = NULL;
   filename_full = 0;
+  jobs          = 0;
+  num_jobs      = 0;
+  max_jobs      = 0;
+  job_queue     = NULL;
 
   set_model_details(&md);
   /*
@@ -185,6 +214,16 @@ main(int  argc,
   if (args_info.filename_full_given)
     filename_full = 1;
 
+  /* parallel processing of the input sequences */
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    jobs = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_max_threads();
+    omp_set_num_threads(jobs);
+#else
+    vrna_message_error("\'j\' option is available only if compiled with OpenMP support!");
+#endif
+  }
+
   /* free allocated memory of command line data structure */
   RNAcofold_cmdline_parser_free(&args_info);
 
@@ -214,6 +253,20 @@ main(int  argc,
     }
   }
 
+  /* parallel processing only supports plain MFE predictions of non-interactive input */
+  if (jobs) {
+    if (fold_constrained || commands || pf) {
+      vrna_message_warning("Parallel processing is not available for the selected options, "
+                           "processing input sequences one after another");
+      jobs = 0;
+    } else if (istty) {
+      jobs = 0;
+    } else {
+      max_jobs  = JOBS_PER_THREAD * jobs;
+      job_queue = (job_data *)vrna_alloc(sizeof(job_data) * max_jobs);
+    }
+  }
+
   /* set options we wanna pass to vrna_file_fasta_read_record() */
   if (istty)
     read_opt |= VRNA_INPUT_NOSKIP_BLANK_LINES;
@@ -255,6 +308,31 @@ main(int  argc,
     /* convert sequence to uppercase letters only */
     vrna_seq_toupper(rec_sequence);
 
+    if (jobs) {
+      /* postpone predictions until enough input sequences are available */
+      job_queue[num_jobs].id            = rec_id;
+      job_queue[num_jobs].SEQ_ID        = SEQ_ID;
+      job_queue[num_jobs].sequence      = rec_sequence;
+      job_queue[num_jobs].orig_sequence = orig_sequence;
+
+      if (++num_jobs == max_jobs) {
+        process_jobs(job_queue, num_jobs, &md, noPS, id_delim, filename_delim);
+        num_jobs = 0;
+      }
+
+      if (rec_rest) {
+        for (i = 0; rec_rest[i]; i++)
+          free(rec_rest[i]);
+        free(rec_rest);
+      }
+
+      rec_id    = rec_sequence = orig_sequence = NULL;
+      rec_rest  = NULL;
+
+      ID_number_increase(seq_number, "Sequence");
+      continue;
+    }
+
     vrna_fold_compound_t *vc = vrna_fold_compound(rec_sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_HYBRID | ((pf) ? VRNA_OPTION_PF : 0));
     length    = vc->length;
     structure = (char *)vrna_alloc((unsigned)length + 1);
@@ -396,6 +474,7 @@ main(int  argc,
     if (pf) {
       vrna_dimer_pf_t AB, AA, BB;
       if (md.dangles == 1) {
+        vrna_params_detach(vc);
         vc->params->model_details.dangles = dangles = 2;   /* recompute with dangles as in pf_fold() */
         min_en                            = vrna_eval_structure(vc, structure);
         vc->params->model_details.dangles = dangles = 1;
@@ -677,6 +756,12 @@ main(int  argc,
     }
   }
 
+  /* process remaining input sequences */
+  if (num_jobs > 0)
+    process_jobs(job_queue, num_jobs, &md, noPS, id_delim, filename_delim);
+
+  free(job_queue);
+
   free(command_file);
   vrna_commands_free(commands);
 
@@ -689,6 +774,84 @@ main(int  argc,
 }
 
 
+/*
+ *  Predict MFE structures for a batch of input sequences in parallel and
+ *  print the results in order of the input
+ */
+PRIVATE void
+process_jobs(job_data     *jobs,
+             unsigned int num_jobs,
+             vrna_md_t    *md,
+             int          noPS,
+             const char   *id_delim,
+             const char   *filename_delim)
+{
+  char          **sequences, **structures, *pstruct, *filename_plot, *annot, *tmp_string, *msg;
+  int           cp, length;
+  unsigned int  i;
+  float         *mfe;
+
+  sequences   = (char **)vrna_alloc(sizeof(char *) * (num_jobs + 1));
+  structures  = (char **)vrna_alloc(sizeof(char *) * num_jobs);
+
+  for (i = 0; i < num_jobs; i++)
+    sequences[i] = jobs[i].sequence;
+
+  mfe = vrna_mfe_batch((const char **)sequences, md, structures);
+
+  for (i = 0; i < num_jobs; i++) {
+    tmp_string  = strchr(jobs[i].sequence, '&');
+    cp          = (tmp_string) ? (int)(tmp_string - jobs[i].sequence) + 1 : -1;
+    length      = (int)strlen(structures[i]);
+    pstruct     = vrna_cut_point_insert(structures[i], cp);
+
+    print_fasta_header(stdout, jobs[i].id);
+    fprintf(stdout, "%s\n", jobs[i].orig_sequence);
+
+    msg = vrna_strdup_printf(" (%6.2f)", mfe[i]);
+    print_structure(stdout, pstruct, msg);
+    free(msg);
+    (void)fflush(stdout);
+
+    if (!noPS) {
+      annot = NULL;
+      if (jobs[i].SEQ_ID) {
+        filename_plot = vrna_strdup_printf("%s%sss.ps", jobs[i].SEQ_ID, id_delim);
+        tmp_string    = vrna_filename_sanitize(filename_plot, filename_delim);
+        free(filename_plot);
+        filename_plot = tmp_string;
+      } else {
+        filename_plot = strdup("rna.ps");
+      }
+
+      if (cp >= 0) {
+        annot = vrna_strdup_printf("1 %d 9  0 0.9 0.2 omark\n"
+                                   "%d %d 9  1 0.1 0.2 omark\n",
+                                   cp - 1,
+                                   cp + 1,
+                                   length + 1);
+      }
+
+      (void)vrna_file_PS_rnaplot_a(jobs[i].orig_sequence, pstruct, filename_plot, annot, NULL, md);
+
+      free(filename_plot);
+      free(annot);
+    }
+
+    free(pstruct);
+    free(structures[i]);
+    free(jobs[i].id);
+    free(jobs[i].SEQ_ID);
+    free(jobs[i].sequence);
+    free(jobs[i].orig_sequence);
+  }
+
+  free(sequences);
+  free(structures);
+  free(mfe);
+}
+
+
 PRIVATE vrna_dimer_pf_t
 do_partfunc(char              *string,
             int               length,
@@ -23,6 +23,7 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <string.h>
+#include <limits.h>
 #include "ViennaRNA/fold.h"
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/fold_vars.h"
@@ -40,12 +41,40 @@
 #include "ViennaRNA/unstructured_domains.h"
 #include "ViennaRNA/file_formats.h"
 #include "ViennaRNA/commands.h"
+#include "ViennaRNA/batch.h"
 #include "RNAfold_cmdl.h"
 #include "gengetopt_helper.h"
 #include "input_id_helper.h"
 
 #include "ViennaRNA/color_output.inc"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* number of input sequences collected per thread before starting parallel predictions */
+#define JOBS_PER_THREAD   256
+
+typedef struct {
+  char  *id;              /* FASTA header */
+  char  *SEQ_ID;          /* sequence ID used to construct file names */
+  char  *prefix;          /* output file prefix */
+  char  *sequence;        /* upper case sequence used for predictions */
+  char  *orig_sequence;   /* case-unmodified input sequence */
+} job_data;
+
+
+static void process_jobs(job_data     *jobs,
+                         unsigned int num_jobs,
+                         vrna_md_t    *md,
+                         int          pf,
+                         int          noPS,
+                         const char   *infile,
+                         const char   *outfile,
+                         const char   *id_delim,
+                         const char   *filename_delim);
+
+
 static char *annotate_ligand_motif(vrna_fold_compound_t *vc,
                                    const char           *structure,
                                    const char           *structure_name,
@@ -80,8 +109,10 @@ main(int  argc,
   unsigned int                      rec_type, read_opt;
   int                               i, length, l, cl, istty, pf, noPS, noconv, enforceConstraints,
                                     batch, auto_id, id_digits, doMEA, lucky, with_shapes,
-                                    verbose, istty_in, istty_out, filename_full;
+                                    verbose, istty_in, istty_out, filename_full, jobs;
+  unsigned int                      num_jobs, max_jobs;
   long int                          seq_number;
+  job_data                          *job_queue;
   double                            energy, min_en, kT, MEAgamma, bppmThreshold;
   vrna_cmd_t                        *commands;
   vrna_md_t                         md;
@@ -107,6 +138,10 @@ main(int  argc,
   command_file  = NULL;
   commands      = NULL;
   filename_full = 0;
+  jobs          = 0;
+  num_jobs      = 0;
+  max_jobs      = 0;
+  job_queue     = NULL;
 
   /* apply default model details */
   set_model_details(&md);
@@ -218,6 +253,16 @@ main(int  argc,
   if (args_info.filename_full_given)
     filename_full = 1;
 
+  /* parallel processing of the input sequences */
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    jobs = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_max_threads();
+    omp_set_num_threads(jobs);
+#else
+    vrna_message_error("\'j\' option is available only if compiled with OpenMP support!");
+#endif
+  }
+
   /* free allocated memory of command line data structure */
   RNAfold_cmdline_parser_free(&args_info);
 
@@ -259,6 +304,21 @@ main(int  argc,
     }
   }
 
+  /* parallel processing only supports plain predictions of non-interactive input */
+  if (jobs) {
+    if (fold_constrained || with_shapes || ligandMotif || commands || lucky || doMEA ||
+        (pf && md.compute_bpp)) {
+      vrna_message_warning("Parallel processing is not available for the selected options, "
+                           "processing input sequences one after another");
+      jobs = 0;
+    } else if (istty) {
+      jobs = 0;
+    } else {
+      max_jobs  = JOBS_PER_THREAD * jobs;
+      job_queue = (job_data *)vrna_alloc(sizeof(job_data) * max_jobs);
+    }
+  }
+
   /* set options we wanna pass to vrna_file_fasta_read_record() */
   if (istty)
     read_opt |= VRNA_INPUT_NOSKIP_BLANK_LINES;
@@ -307,6 +367,35 @@ main(int  argc,
         prefix = vrna_strdup_printf("%s", outfile);
     }
 
+    /*
+     *  structure plots, and the evaluation of structures after the partition function
+     *  (dangles = 1, centroid, MEA) rely on pair tables that are limited to SHRT_MAX nt.
+     *  Reject such sequences before spending hours on their DP matrices
+     */
+    if ((strlen(rec_sequence) > SHRT_MAX) &&
+        ((!noPS) || (pf && (md.compute_bpp || (md.dangles == 1))))) {
+      vrna_message_warning("Skipping sequence of length %lu. Structure plots and partition function "
+                           "post-processing are limited to %d nt, use --noPS and -p0 without -d1 instead",
+                           (unsigned long)strlen(rec_sequence), SHRT_MAX);
+
+      if (rec_rest) {
+        for (i = 0; rec_rest[i]; i++)
+          free(rec_rest[i]);
+        free(rec_rest);
+      }
+
+      free(rec_id);
+      free(rec_sequence);
+      free(SEQ_ID);
+      free(prefix);
+
+      rec_id    = rec_sequence = NULL;
+      rec_rest  = NULL;
+
+      ID_number_increase(seq_number, "Sequence");
+      continue;
+    }
+
     /* convert DNA alphabet to RNA if not explicitely switched off */
     if (!noconv)
       vrna_seq_toRNA(rec_sequence);
@@ -316,6 +405,32 @@ main(int  argc,
     /* convert sequence to uppercase letters only */
     vrna_seq_toupper(rec_sequence);
 
+    if (jobs) {
+      /* postpone predictions until enough input sequences are available */
+      job_queue[num_jobs].id            = rec_id;
+      job_queue[num_jobs].SEQ_ID        = SEQ_ID;
+      job_queue[num_jobs].prefix        = prefix;
+      job_queue[num_jobs].sequence      = rec_sequence;
+      job_queue[num_jobs].orig_sequence = orig_sequence;
+
+      if (++num_jobs == max_jobs) {
+        process_jobs(job_queue, num_jobs, &md, pf, noPS, infile, outfile, id_delim, filename_delim);
+        num_jobs = 0;
+      }
+
+      if (rec_rest) {
+        for (i = 0; rec_rest[i]; i++)
+          free(rec_rest[i]);
+        free(rec_rest);
+      }
+
+      rec_id    = rec_sequence = orig_sequence = NULL;
+      rec_rest  = NULL;
+
+      ID_number_increase(seq_number, "Sequence");
+      continue;
+    }
+
     vrna_fold_compound_t *vc = vrna_fold_compound(rec_sequence, &md, VRNA_OPTION_MFE | ((pf) ? VRNA_OPTION_PF : 0));
 
     length = vc->length;
@@ -455,6 +570,7 @@ main(int  argc,
     if (pf) {
       char *pf_struc = (char *)vrna_alloc((unsigned)length + 1);
       if (vc->params->model_details.dangles == 1) {
+        vrna_params_detach(vc);
         vc->params->model_details.dangles = 2;   /* recompute with dangles as in pf_fold() */
         min_en                            = vrna_eval_structure(vc, structure);
         vc->params->model_details.dangles = 1;
@@ -797,6 +913,12 @@ main(int  argc,
     }
   }
 
+  /* process remaining input sequences */
+  if (num_jobs > 0)
+    process_jobs(job_queue, num_jobs, &md, pf, noPS, infile, outfile, id_delim, filename_delim);
+
+  free(job_queue);
+
   if (input)
     fclose(input);
 
@@ -814,6 +936,121 @@ main(int  argc,
 }
 
 
+/*
+ *  Predict structures for a batch of input sequences in parallel and
+ *  print the results in order of the input
+ */
+static void
+process_jobs(job_data     *jobs,
+             unsigned int num_jobs,
+             vrna_md_t    *md,
+             int          pf,
+             int          noPS,
+             const char   *infile,
+             const char   *outfile,
+             const char   *id_delim,
+             const char   *filename_delim)
+{
+  char          **sequences, **structures, *v_file_name, *filename_plot, *tmp_string, *msg;
+  unsigned int  i;
+  float         *mfe, *G;
+  double        min_en, kT;
+  FILE          *output;
+  vrna_md_t     md_eval;
+
+  sequences   = (char **)vrna_alloc(sizeof(char *) * (num_jobs + 1));
+  structures  = (char **)vrna_alloc(sizeof(char *) * num_jobs);
+
+  for (i = 0; i < num_jobs; i++)
+    sequences[i] = jobs[i].sequence;
+
+  mfe = vrna_mfe_batch((const char **)sequences, md, structures);
+  G   = (pf) ? vrna_pf_batch((const char **)sequences, md, mfe, NULL) : NULL;
+  kT  = md->betaScale * (md->temperature + K0) * GASCONST / 1000.;
+
+  for (i = 0; i < num_jobs; i++) {
+    output = stdout;
+
+    if (outfile) {
+      v_file_name = vrna_strdup_printf("%s.fold", jobs[i].prefix);
+      tmp_string  = vrna_filename_sanitize(v_file_name, filename_delim);
+      free(v_file_name);
+      v_file_name = tmp_string;
+
+      if (infile && !strcmp(infile, v_file_name))
+        vrna_message_error("Input and output file names are identical");
+
+      output = fopen((const char *)v_file_name, "a");
+      if (!output)
+        vrna_message_error("Failed to open file for writing");
+
+      free(v_file_name);
+    }
+
+    print_fasta_header(output, jobs[i].id);
+    fprintf(output, "%s\n", jobs[i].orig_sequence);
+
+    msg = vrna_strdup_printf(" (%6.2f)", mfe[i]);
+    print_structure(output, structures[i], msg);
+    free(msg);
+
+    if (!noPS) {
+      if (jobs[i].SEQ_ID) {
+        filename_plot = vrna_strdup_printf("%s%sss.ps", jobs[i].SEQ_ID, id_delim);
+        tmp_string    = vrna_filename_sanitize(filename_plot, filename_delim);
+        free(filename_plot);
+        filename_plot = tmp_string;
+      } else {
+        filename_plot = strdup("rna.ps");
+      }
+
+      (void)vrna_file_PS_rnaplot_a(jobs[i].orig_sequence, structures[i], filename_plot, NULL, NULL, md);
+      free(filename_plot);
+    }
+
+    if (pf) {
+      min_en = (double)mfe[i];
+
+      if (md->dangles == 1) {
+        /* recompute with dangles as in pf_fold() */
+        vrna_fold_compound_t *vc;
+        md_eval         = *md;
+        md_eval.dangles = 2;
+        vc              = vrna_fold_compound(jobs[i].sequence, &md_eval, VRNA_OPTION_EVAL_ONLY);
+        min_en          = vrna_eval_structure(vc, structures[i]);
+        vrna_fold_compound_free(vc);
+      }
+
+      msg = vrna_strdup_printf(" free energy of ensemble = %6.2f kcal/mol", G[i]);
+      print_structure(output, NULL, msg);
+      free(msg);
+
+      msg = vrna_strdup_printf(" frequency of mfe structure in ensemble %g;",
+                               exp(((double)G[i] - min_en) / kT));
+      print_structure(output, NULL, msg);
+      free(msg);
+    }
+
+    (void)fflush(output);
+
+    if (outfile)
+      fclose(output);
+
+    free(structures[i]);
+    free(jobs[i].id);
+    free(jobs[i].SEQ_ID);
+    free(jobs[i].prefix);
+    free(jobs[i].sequence);
+    free(jobs[i].orig_sequence);
+  }
+
+  free(sequences);
+  free(structures);
+  free(mfe);
+  free(G);
+}
+
+
 static void
 add_ligand_motif(vrna_fold_compound_t *vc,
                  char                 *motifstring,
@@ -30,6 +30,7 @@
 #include "ViennaRNA/plex.h"
 #include "ViennaRNA/PS_dot.h"
 #include "ViennaRNA/read_epars.h"
+#include "ViennaRNA/file_formats_pU.h"
 #include "RNAplex_cmdl.h"
 
 
@@ -57,14 +58,15 @@ EndTimer(clock_t begin)
 /* --------------------end include timer */
 extern int subopt_sorted;
 /* static int print_struc(duplexT const *dup); */
-static int **average_accessibility_target(char      **names,
-                                          char      **ALN,
-                                          int       number,
-                                          char      *access,
-                                          double    verhaeltnis,
-                                          const int alignment_length,
-                                          int       binaries,
-                                          int       fast);
+static int **average_accessibility_target(char            **names,
+                                          char            **ALN,
+                                          int             number,
+                                          char            *access,
+                                          double          verhaeltnis,
+                                          const int       alignment_length,
+                                          int             binaries,
+                                          vrna_pU_file_t  *pU_file,
+                                          int             fast);
 
 
 /* static int ** average_accessibility_query(char **names, char **ALN, int number, char *access, double verhaeltnis); */
@@ -92,6 +94,16 @@ static int **read_plfold_i_bin(char       *fname,
                                int        fast);
 
 
+/* Read opening energies from an indexed binary unpaired probability container */
+static int **read_plfold_i_pU(vrna_pU_file_t  *pU_file,
+                              const char      *id,
+                              const int       beg,
+                              const int       end,
+                              double          verhaeltnis,
+                              const int       length,
+                              int             fast);
+
+
 /* Compute and pass opening energies in case of f=2*/
 static int get_sequence_length_from_alignment(char *sequence);
 
@@ -169,6 +181,7 @@ main(int  argc,
   char                            *tname  = NULL;
   char                            *qname  = NULL;
   char                            *access = NULL;
+  vrna_pU_file_t                  *pU_file = NULL;
   char                            fname[FILENAME_MAX_LENGTH];
   char                            *ParamFile  = NULL;
   char                            *ns_bases   = NULL, *c;
@@ -242,6 +255,17 @@ main(int  argc,
   if (args_info.accessibility_dir_given)
     access = strdup(args_info.accessibility_dir_arg);
 
+  /*accessibility from a binary unpaired probability container*/
+  if (args_info.accessibility_file_given) {
+    pU_file = vrna_file_pU_open(args_info.accessibility_file_arg);
+    if (!pU_file)
+      vrna_message_error("Could not read accessibility file %s", args_info.accessibility_file_arg);
+
+    /* the accessibility modes are triggered by the accessibility directory */
+    if (!access)
+      access = strdup(".");
+  }
+
   /*produce ps arg*/
   if (args_info.produce_ps_given) {
     Resultfile  = strdup(args_info.produce_ps_arg);
@@ -614,7 +638,9 @@ main(int  argc,
           strcat(file_s1, "/");
           strcat(file_s1, id_s1);
           strcat(file_s1, "_openen");
-          if (!binaries) {
+          if (pU_file) {
+            access_s1 = read_plfold_i_pU(pU_file, id_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
+          } else if (!binaries) {
             access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
           } else {
             strcat(file_s1, "_bin");
@@ -688,7 +714,9 @@ main(int  argc,
             strcat(file_s2, "/");
             strcat(file_s2, id_s2);
             strcat(file_s2, "_openen");
-            if (!binaries) {
+            if (pU_file) {
+              access_s2 = read_plfold_i_pU(pU_file, id_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
+            } else if (!binaries) {
               access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
             } else {
               strcat(file_s2, "_bin");
@@ -945,7 +973,9 @@ main(int  argc,
           strcat(file_s1, "/");
           strcat(file_s1, id_s1);
           strcat(file_s1, "_openen");
-          if (!binaries) {
+          if (pU_file) {
+            access_s1 = read_plfold_i_pU(pU_file, id_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
+          } else if (!binaries) {
             access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
           } else {
             strcat(file_s1, "_bin");
@@ -1038,7 +1068,9 @@ main(int  argc,
             strcat(file_s2, "/");
             strcat(file_s2, id_s2);
             strcat(file_s2, "_openen");
-            if (!binaries) {
+            if (pU_file) {
+              access_s2 = read_plfold_i_pU(pU_file, id_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
+            } else if (!binaries) {
               access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
             } else {
               strcat(file_s2, "_bin");
@@ -1380,7 +1412,9 @@ main(int  argc,
         strcat(file_s2, id_s2);
         strcat(file_s1, "_openen");
         strcat(file_s2, "_openen");
-        if (!binaries) {
+        if (pU_file) {
+          access_s1 = read_plfold_i_pU(pU_file, id_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
+        } else if (!binaries) {
           access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
         } else {
           strcat(file_s1, "_bin");
@@ -1397,7 +1431,9 @@ main(int  argc,
           continue;
         }
 
-        if (!binaries) {
+        if (pU_file) {
+          access_s2 = read_plfold_i_pU(pU_file, id_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
+        } else if (!binaries) {
           access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
         } else {
           strcat(file_s2, "_bin");
@@ -1511,8 +1547,8 @@ main(int  argc,
       aliLduplexfold((const char **)AS1, (const char **)AS2, n_seq * delta, extension_cost, alignment_length, deltaz, fast, il_a, il_b, b_a, b_b);
     } else {
       int **target_access = NULL, **query_access = NULL;
-      target_access = average_accessibility_target(names1, AS1, n_seq, access, verhaeltnis, alignment_length, binaries, fast); /* get averaged accessibility for alignments */
-      query_access  = average_accessibility_target(names2, AS2, n_seq, access, verhaeltnis, alignment_length, binaries, fast);
+      target_access = average_accessibility_target(names1, AS1, n_seq, access, verhaeltnis, alignment_length, binaries, pU_file, fast); /* get averaged accessibility for alignments */
+      query_access  = average_accessibility_target(names2, AS2, n_seq, access, verhaeltnis, alignment_length, binaries, pU_file, fast);
       if (!(target_access && query_access)) {
         for (i = 0; AS1[i]; i++) {
           free(AS1[i]);
@@ -1553,6 +1589,8 @@ main(int  argc,
     access = NULL;
   }
 
+  vrna_file_pU_close(pU_file);
+
   if (qname) {
     free(tname);
     access = NULL;
@@ -1810,6 +1848,56 @@ read_plfold_i_bin(char      *fname,
 }
 
 
+static int **
+read_plfold_i_pU(vrna_pU_file_t *pU_file,
+                 const char     *id,
+                 const int      beg,
+                 const int      end,
+                 double         verhaeltnis,
+                 const int      length,
+                 int            fast)
+{
+  int i, u, s, ulength, **access;
+
+  s = vrna_file_pU_find(pU_file, id);
+  if (s < 0) {
+    vrna_message_warning("Sequence ' %s ' not found in accessibility file", id);
+    return NULL;
+  }
+
+  ulength = vrna_file_pU_ulength(pU_file, s);
+  if (length > ulength && fast == 0) {
+    printf("Interaction length %d is larger than the length of the largest region %d \nfor which the opening energy was computed (-u parameter of RNAplfold)\n", length, ulength);
+    printf("Please recompute your profiles with a larger -u or set -l to a smaller interaction length\n");
+    return NULL;
+  }
+
+  if (end - 20 > vrna_file_pU_length(pU_file, s)) {
+    printf("Accessibility files contains %d less entries than expected based on the sequence length\n", end - 20 - vrna_file_pU_length(pU_file, s));
+    printf("Please recompute your profiles so that profile length and sequence length match\n");
+    return NULL;
+  }
+
+  /* same layout as for read_plfold_i(), i.e. 10 leading entries for the N's */
+  access = (int **)vrna_alloc(sizeof(int *) * (ulength + 2));
+  for (u = 0; u < ulength + 2; u++) {
+    access[u] = (int *)vrna_alloc(sizeof(int) * (end - beg + 1));
+    for (i = 0; i < end - beg + 1; i++)
+      access[u][i] = INF;
+  }
+  access[0][0] = ulength + 2;
+
+  /* inaccessible stretches yield INF, which must not overflow once scaled */
+  for (i = beg; i <= end - 20; i++)
+    for (u = 1; u <= MIN2(i, ulength); u++) {
+      double e = rint(100 * vrna_file_pU_energy(pU_file, s, i, u)) * verhaeltnis;
+      access[u][i - beg + 11] = (e < (double)INF) ? (int)e : INF;
+    }
+
+  return access;
+}
+
+
 static int
 get_max_u(const char  *s,
           char        delim)
@@ -1829,14 +1917,15 @@ get_max_u(const char  *s,
 
 
 static int **
-average_accessibility_target(char       **names,
-                             char       **ALN,
-                             int        number,
-                             char       *access,
-                             double     verhaeltnis,
-                             const int  alignment_length,
-                             int        binaries,
-                             int        fast)
+average_accessibility_target(char            **names,
+                             char            **ALN,
+                             int             number,
+                             char            *access,
+                             double          verhaeltnis,
+                             const int       alignment_length,
+                             int             binaries,
+                             vrna_pU_file_t  *pU_file,
+                             int             fast)
 {
   int           i;
   int           ***master_access  = NULL;           /* contains the accessibility arrays for different */
@@ -1864,6 +1953,7 @@ average_accessibility_target(char       **names,
     location_flag = 0;
 
   char *file_s1 = NULL;
+  char *seq_id  = NULL;
   for (i = 0; i < number; i++) {
     /*  be careful!!!! Name should contain all characters from begin till the "/" character */
     /* char *s1; */
@@ -1905,6 +1995,7 @@ average_accessibility_target(char       **names,
       strcpy(file_s1, access);
       strcat(file_s1, "/");
       strcat(file_s1, bla);
+      seq_id = bla;
     } else {
       if (location_flag == 1) {
         vrna_message_warning("\n!! Line %d in your target alignment does not contain location information\n"
@@ -1917,10 +2008,13 @@ average_accessibility_target(char       **names,
       strcpy(file_s1, access);
       strcat(file_s1, "/");
       strcat(file_s1, names[i]);
+      seq_id = names[i];
     }
 
     strcat(file_s1, "_openen");
-    if (!binaries) {
+    if (pU_file) {
+      master_access[i] = read_plfold_i_pU(pU_file, seq_id, begin, end, verhaeltnis, alignment_length, fast);
+    } else if (!binaries) {
       master_access[i] = read_plfold_i(file_s1, begin, end, verhaeltnis, alignment_length, fast); /* read */
     } else {
       strcat(file_s1, "_bin");
@@ -25,10 +25,15 @@
 #include "ViennaRNA/LPfold.h"
 #include "ViennaRNA/params.h"
 #include "ViennaRNA/file_formats.h"
+#include "ViennaRNA/file_formats_pU.h"
 #include "RNAplfold_cmdl.h"
 #include "gengetopt_helper.h"
 #include "input_id_helper.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/color_output.inc"
 
 int unpaired;
@@ -46,8 +51,9 @@ main(int  argc,
   FILE                        *pUfp, *spup;
   struct RNAplfold_args_info  args_info;
   char                        *structure, *ParamFile, *ns_bases, *rec_sequence, *rec_id,
-                              **rec_rest, *orig_sequence, *id_prefix, *id_delim, *filename_delim;
-  unsigned int                rec_type, read_opt;
+                              **rec_rest, *orig_sequence, *id_prefix, *id_delim, *filename_delim,
+                              *pU_filename;
+  unsigned int                rec_type, read_opt, pU_precision;
   int                         length, istty, winsize, pairdist, tempwin, temppair, tempunpaired, noconv,
                               plexoutput, simply_putout, openenergies, binaries, auto_id, id_digits, filename_full;
   long int                    seq_number;
@@ -56,6 +62,7 @@ main(int  argc,
   plist                       *pl, *dpp;
   vrna_exp_param_t            *pf_parameters;
   vrna_md_t                   md;
+  vrna_pU_writer_t            *pU_writer;
 
   pUfp          = NULL;
   spup          = NULL;
@@ -69,6 +76,9 @@ main(int  argc,
   betaScale     = 1.;
   simply_putout = plexoutput = openenergies = noconv = 0;
   binaries      = 0;
+  pU_filename   = NULL;
+  pU_precision  = VRNA_PU_FLOAT;
+  pU_writer     = NULL;
   tempwin       = temppair = tempunpaired = 0;
   structure     = ParamFile = ns_bases = NULL;
   rec_type      = read_opt = 0;
@@ -128,6 +138,25 @@ main(int  argc,
   if (args_info.noconv_given)
     noconv = 1;
 
+  /* parallel processing of long sequences (pfl_fold_par() uses all available threads) */
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    if (args_info.jobs_arg > 0)
+      omp_set_num_threads(args_info.jobs_arg);
+
+#else
+    vrna_message_error("\'j\' option is available only if compiled with OpenMP support!");
+#endif
+  } else {
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+  }
+
+  /* use single precision DP matrices */
+  if (args_info.single_precision_given)
+    md.pf_float = 1;
+
   /* set energy model */
   if (args_info.energyModel_given)
     md.energy_set = energy_set = args_info.energyModel_arg;
@@ -172,6 +201,13 @@ main(int  argc,
   if (args_info.binaries_given)
     binaries = 1;
 
+  /* collect unpaired probabilities of all sequences in an indexed binary file */
+  if (args_info.pU_file_given)
+    pU_filename = strdup(args_info.pU_file_arg);
+
+  if (args_info.pU_quantize_given)
+    pU_precision = VRNA_PU_UINT16;
+
   if (args_info.betaScale_given)
     md.betaScale = betaScale = args_info.betaScale_arg;
 
@@ -211,7 +247,7 @@ main(int  argc,
     vrna_md_set_nonstandards(&md, ns_bases);
 
   /* check parameter options again and reset to reasonable values if needed */
-  if (openenergies && !unpaired)
+  if ((openenergies || pU_filename) && !unpaired)
     unpaired = 31;
 
   if (pairdist == 0)
@@ -389,6 +425,18 @@ main(int  argc,
         pl = pfl_fold_par(rec_sequence, winsize, pairdist, cutoff, pup, &dpp, pUfp, spup, pf_parameters);
         PS_dot_plot_turn(orig_sequence, pl, ffname, pairdist);
         if (unpaired > 0) {
+          if (pU_filename) {
+            if (!pU_writer) {
+              pU_writer = vrna_file_pU_writer_open(pU_filename,
+                                                   pU_precision,
+                                                   pf_parameters->kT / 1000.);
+              if (!pU_writer)
+                vrna_message_error("Failed to create unpaired probability file \"%s\"", pU_filename);
+            }
+
+            vrna_file_pU_write(pU_writer, SEQ_ID, pup, length, unpaired);
+          }
+
           if (plexoutput) {
             pUfp = fopen(fname3, "w");
             putoutphakim_u(pup, length, unpaired, pUfp);
@@ -439,6 +487,10 @@ main(int  argc,
       vrna_message_input_seq_simple();
   }
 
+  if (pU_writer && !vrna_file_pU_writer_close(pU_writer))
+    vrna_message_error("Failed to write unpaired probability file \"%s\"", pU_filename);
+
+  free(pU_filename);
   free(id_prefix);
   free(id_delim);
   free(filename_delim);
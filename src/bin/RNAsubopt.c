@@ -28,16 +28,39 @@
 #include "ViennaRNA/constraints.h"
 #include "ViennaRNA/constraints_SHAPE.h"
 #include "ViennaRNA/file_formats.h"
+#include "ViennaRNA/boltzmann_sampling.h"
 #include "RNAsubopt_cmdl.h"
 #include "gengetopt_helper.h"
 #include "input_id_helper.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/color_output.inc"
 
 PRIVATE void putoutzuker(FILE                   *output,
                          vrna_subopt_solution_t *zukersolution);
 
 
+typedef struct {
+  FILE                  *output;
+  vrna_fold_compound_t  *vc;
+  int                   with_energies;
+  double                ens_en;
+  double                kT;
+} sample_output;
+
+
+PRIVATE void print_sample(const char  *structure,
+                          void        *data);
+
+
+PRIVATE void print_subopt(const char  *structure,
+                          float       energy,
+                          void        *data);
+
+
 int
 main(int  argc,
      char *argv[])
@@ -51,8 +74,9 @@ main(int  argc,
   unsigned int                        rec_type, read_opt;
   int                                 i, length, cl, istty, delta, n_back, noconv, dos, zuker, with_shapes,
                                       verbose, enforceConstraints, st_back_en, batch, auto_id, id_digits,
-                                      tofile, filename_full;
+                                      tofile, filename_full, distinct, jobs;
   long int                            seq_number;
+  size_t                              sort_memory;
   double                              deltap;
   vrna_md_t                           md;
 
@@ -65,6 +89,9 @@ main(int  argc,
   cstruc        = structure = NULL;
   verbose       = 0;
   st_back_en    = 0;
+  distinct      = 0;
+  jobs          = 0;
+  sort_memory   = VRNA_SUBOPT_SORT_MEMORY;
   auto_id       = 0;
   infile        = NULL;
   outfile       = NULL;
@@ -137,6 +164,14 @@ main(int  argc,
   if (args_info.sorted_given)
     subopt_sorted = 1;
 
+  /* memory budget for sorting */
+  if (args_info.sort_memory_given) {
+    if (args_info.sort_memory_arg < 0)
+      vrna_message_error("sort memory must not be negative");
+
+    sort_memory = (size_t)args_info.sort_memory_arg * 1024 * 1024;
+  }
+
   /* stochastic backtracking */
   if (args_info.stochBT_given) {
     n_back = args_info.stochBT_arg;
@@ -151,6 +186,24 @@ main(int  argc,
     vrna_init_rand();
   }
 
+  if (args_info.distinct_given)
+    distinct = 1;
+
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    jobs = 1;
+    if (args_info.jobs_arg > 0)
+      omp_set_num_threads(args_info.jobs_arg);
+
+#else
+    vrna_message_error("\'j\' option is available only if compiled with OpenMP support!");
+#endif
+  } else {
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+  }
+
   /* density of states */
   if (args_info.dos_given) {
     dos           = 1;
@@ -397,20 +450,18 @@ main(int  argc,
 
       free(ss);
 
-      for (i = 0; i < n_back; i++) {
-        char *s, *e_string = NULL;
-        s = vrna_pbacktrack(vc);
-        if (st_back_en) {
-          double e, prob;
-          e         = vrna_eval_structure(vc, s);
-          prob      = exp((ens_en - e) / kT);
-          e_string  = vrna_strdup_printf(" %6.2f %6g", e, prob);
-        }
-
-        print_structure(output, s, e_string);
-        free(s);
-        free(e_string);
-      }
+      sample_output sample_data;
+      sample_data.output        = output;
+      sample_data.vc            = vc;
+      sample_data.with_energies = st_back_en;
+      sample_data.ens_en        = ens_en;
+      sample_data.kT            = kT;
+
+      vrna_pbacktrack_cb(vc,
+                         (unsigned int)n_back,
+                         &print_sample,
+                         (void *)&sample_data,
+                         distinct ? VRNA_PBACKTRACK_DISTINCT : VRNA_PBACKTRACK_DEFAULT);
     }
     /* normal subopt */
     else if (!zuker) {
@@ -421,7 +472,25 @@ main(int  argc,
         free(head);
       }
 
-      vrna_subopt(vc, delta, subopt_sorted, output);
+      if (jobs || subopt_sorted) {
+        float mfe;
+        char  *seq_cut, *energies;
+
+        /* same header as printed by vrna_subopt() */
+        mfe       = (vc->cutpoint > 0) ? vrna_mfe_dimer(vc, NULL) : vrna_mfe(vc, NULL);
+        seq_cut   = vrna_cut_point_insert(vc->sequence, vc->cutpoint);
+        energies  = vrna_strdup_printf(" %6.2f %6.2f", mfe, (float)delta / 100.);
+        print_structure(output, seq_cut, energies);
+        free(seq_cut);
+        free(energies);
+
+        if (subopt_sorted)
+          vrna_subopt_cb_sorted(vc, delta, sort_memory, &print_subopt, (void *)output);
+        else
+          vrna_subopt_cb_parallel(vc, delta, 0, &print_subopt, (void *)output);
+      } else {
+        vrna_subopt(vc, delta, subopt_sorted, output);
+      }
 
       if (dos) {
         int i;
@@ -529,3 +598,37 @@ putoutzuker(FILE                    *output,
   }
   return;
 }
+
+
+PRIVATE void
+print_sample(const char *structure,
+             void       *data)
+{
+  char          *e_string = NULL;
+  sample_output *d        = (sample_output *)data;
+
+  if (d->with_energies) {
+    double e, prob;
+    e         = vrna_eval_structure(d->vc, structure);
+    prob      = exp((d->ens_en - e) / d->kT);
+    e_string  = vrna_strdup_printf(" %6.2f %6g", e, prob);
+  }
+
+  print_structure(d->output, structure, e_string);
+  free(e_string);
+}
+
+
+PRIVATE void
+print_subopt(const char *structure,
+             float      energy,
+             void       *data)
+{
+  char *e_string;
+
+  if (structure) {
+    e_string = vrna_strdup_printf(" %6.2f", energy);
+    print_structure((FILE *)data, structure, e_string);
+    free(e_string);
+  }
+}
@@ -0,0 +1,80 @@
+echo "Testing Kinfold (fixed seed trajectories):"
+
+# Kinfold is an optional sub-package, skip if it was not built
+if ! type Kinfold > /dev/null 2>&1 ; then
+  echo "...Kinfold not found, skipping"
+  exit 77
+fi
+
+RETURN=0
+
+function failed {
+    RETURN=1
+    echo " [ NOT OK ]"
+}
+
+function passed {
+    echo " [ OK ]"
+}
+
+function testline {
+  echo -en "...testing $1:\t\t"
+}
+
+# Kinfold appends to its log file, so start from scratch for every run
+function kinfold {
+  rm -f tmp.kinfold.log
+  Kinfold --seed=7=8=9 --jobs=1 --log=tmp.kinfold "$@" > tmp.kinfold.traj
+}
+
+# Test default mode (open chain to MFE structure)
+testline "Trajectories (Kinfold default mode)"
+kinfold --num 5 < ${DATADIR}/kinfold.hpin.in
+diff=$(${DIFF} ${KINFOLD_RESULTSDIR}/kinfold.hpin.traj.gold tmp.kinfold.traj)
+diff=${diff}$(${DIFF} -I Date ${KINFOLD_RESULTSDIR}/kinfold.hpin.log.gold tmp.kinfold.log)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test canonical move set (includes double insertions and deletions)
+testline "Trajectories (Kinfold --noLP --verbose)"
+kinfold --num 5 --noLP --verbose < ${DATADIR}/kinfold.hpin.in
+diff=$(${DIFF} ${KINFOLD_RESULTSDIR}/kinfold.hpin.noLP.traj.gold tmp.kinfold.traj)
+diff=${diff}$(${DIFF} -I Date ${KINFOLD_RESULTSDIR}/kinfold.hpin.noLP.log.gold tmp.kinfold.log)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test refolding mode (start structure and multiple stop structures)
+testline "First passage times (Kinfold --start --stop)"
+kinfold --num 10 --start --stop --silent < ${DATADIR}/kinfold.hpin.in
+diff=$(${DIFF} -I Date ${KINFOLD_RESULTSDIR}/kinfold.hpin.refold.log.gold tmp.kinfold.log)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test longer trajectories, i.e. restarts from a non-trivial tree
+testline "First passage times (Kinfold, 100nt)"
+kinfold --num 4 --time 50 --silent < ${DATADIR}/kinfold.seq
+diff=$(${DIFF} -I Date ${KINFOLD_RESULTSDIR}/kinfold.seq.log.gold tmp.kinfold.log)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+testline "First passage times (Kinfold --noShift --logML, 100nt)"
+kinfold --num 4 --time 50 --noShift --logML --silent < ${DATADIR}/kinfold.seq
+diff=$(${DIFF} -I Date ${KINFOLD_RESULTSDIR}/kinfold.seq.noShift.log.gold tmp.kinfold.log)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test cofolding of two strands
+testline "First passage times (Kinfold, dimer)"
+kinfold --num 4 --time 50 --silent < ${DATADIR}/kinfold.dimer.seq
+diff=$(${DIFF} -I Date ${KINFOLD_RESULTSDIR}/kinfold.dimer.log.gold tmp.kinfold.log)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test parallel trajectories, results must not depend on the number of threads
+testline "First passage times (Kinfold --jobs)"
+rm -f tmp.kinfold.log
+Kinfold --seed=7=8=9 --jobs=2 --log=tmp.kinfold --num 6 --time 50 --silent < ${DATADIR}/kinfold.seq > /dev/null
+grep -v Date tmp.kinfold.log | sort > tmp.kinfold.traj
+rm -f tmp.kinfold.log
+Kinfold --seed=7=8=9 --jobs=3 --log=tmp.kinfold --num 6 --time 50 --silent < ${DATADIR}/kinfold.seq > /dev/null
+diff=$(grep -v Date tmp.kinfold.log | sort | ${DIFF} tmp.kinfold.traj -)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# clean up
+rm -f tmp.kinfold.traj tmp.kinfold.log
+
+exit ${RETURN}
@@ -27,6 +27,24 @@ RNAfold --noPS < ${DATADIR}/rnafold.fasta > tmp.fold
 diff=$(${DIFF} ${RNAFOLD_RESULTSDIR}/rnafold.fasta.mfe.gold tmp.fold)
 if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
 
+# MFE for a sequence that exceeds the former SHRT_MAX length limit.
+# This needs several GB of memory and a long time to run, so it is only
+# performed upon 'make check-long', i.e. when RNA_CHECK_LONG is set.
+# The hairpin is flanked by A-tails that cannot pair, so the MFE must
+# equal the one of the same hairpin with a single flanking A on either side
+if [ "x${RNA_CHECK_LONG}" != "x" ] ; then
+  testline "MFE prediction (> 32768 nt)"
+  hp="GGGGCGCAAAGCGCCCC"
+  printf ">small\nA%sA\n" ${hp} | RNAfold --noPS > tmp.fold
+  tail=$(awk 'BEGIN { s = ""; for (i = 0; i < 16500; i++) s = s "A"; print s }')
+  printf ">huge\n%s%s%s\n" ${tail} ${hp} ${tail} | RNAfold --noPS > tmp.huge.fold
+  len=$(sed -n '3p' tmp.huge.fold | cut -d ' ' -f 1 | tr -d '\n' | wc -c)
+  en_small=$(sed -n '3p' tmp.fold | sed 's/.* (\(.*\))$/\1/' | tr -d ' ')
+  en_huge=$(sed -n '3p' tmp.huge.fold | sed 's/.* (\(.*\))$/\1/' | tr -d ' ')
+  if [ "x${len}" != "x33017" ] || [ "x${en_small}" != "x${en_huge}" ] ; then failed; echo -e "length: ${len}, energies: ${en_small} vs. ${en_huge}"; else passed; fi
+  rm tmp.huge.fold
+fi
+
 # clean up
 rm tmp.fold
 
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <ViennaRNA/data_structures.h>
+#include <ViennaRNA/model.h>
+#include <ViennaRNA/utils.h>
+#include <ViennaRNA/findpath.h>
+
+/* checksum over structures and energies along a path */
+static unsigned int
+checksum_path(vrna_path_t *path)
+{
+  unsigned int  h = 2166136261U;
+  char          energy[16], *c;
+  vrna_path_t   *r;
+
+  for (r = path; r->s; r++) {
+    for (c = r->s; *c; c++)
+      h = (h ^ (unsigned char)*c) * 16777619U;
+    sprintf(energy, " %6.2f\n", r->en);
+    for (c = energy; *c; c++)
+      h = (h ^ (unsigned char)*c) * 16777619U;
+  }
+
+  return h;
+}
+
+static void
+free_path_list(vrna_path_t *path)
+{
+  vrna_path_t *r;
+
+  for (r = path; r->s; r++)
+    free(r->s);
+  free(path);
+}
+
+#suite Findpath
+
+#tcase Paths
+
+#test test_findpath
+  const char  sequence[]  = "UGCCUUCCCUAAGGCCCAUGUACCUUAGUCGGUUAUGCAA";
+  const char  s1[]        = "(((...((((((((........))))))..))....))).";
+  const char  s2[]        = ".(((((....))))).((((.(((......)))))))...";
+  const char  *expected[] = {
+    "(((...((((((((........))))))..))....))).",
+    ".((...((((((((........))))))..))....))..",
+    ".((...((.(((((........)))))...))....))..",
+    ".(....((.(((((........)))))...)).....)..",
+    "......((.(((((........)))))...))........",
+    ".......(.(((((........)))))...).........",
+    ".........(((((........))))).............",
+    "..........((((........))))..............",
+    "...........(((........)))...............",
+    "............((........))................",
+    ".............(........).................",
+    "........................................",
+    "...(........)...........................",
+    "..((........))..........................",
+    ".(((........))).........................",
+    ".(((........)))........(......).........",
+    ".(((........))).......((......))........",
+    ".(((........)))......(((......))).......",
+    ".(((........))).(....(((......)))...)...",
+    ".(((........))).((...(((......)))..))...",
+    ".(((........))).(((..(((......))).)))...",
+    ".(((........))).((((.(((......)))))))...",
+    ".((((......)))).((((.(((......)))))))...",
+    ".(((((....))))).((((.(((......)))))))...",
+    NULL
+  };
+  double      energies[]  = {
+     -9.50,  -8.60,  -6.30,  -2.60,  -4.20,  -1.70,
+     -3.70,  -2.20,  -1.20,   0.10,   3.40,   0.00,
+      3.00,   0.10,  -3.00,  -0.50,  -3.40,  -4.50,
+     -2.40,  -3.60,  -5.40,  -6.90,  -8.30,  -8.80
+  };
+  int         i, saddle;
+  vrna_md_t   md;
+  vrna_path_t           *path;
+  vrna_fold_compound_t  *vc;
+
+  vrna_md_set_default(&md);
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+
+  saddle = vrna_path_findpath_saddle(vc, s1, s2, 10);
+  ck_assert_int_eq(saddle, 340);
+
+  path = vrna_path_findpath(vc, s1, s2, 10);
+
+  for (i = 0; expected[i]; i++) {
+    ck_assert(path[i].s != NULL);
+    ck_assert_str_eq(path[i].s, expected[i]);
+    ck_assert(fabs(path[i].en - energies[i]) < 1e-4);
+  }
+  ck_assert(path[i].s == NULL);
+
+  free_path_list(path);
+  vrna_fold_compound_free(vc);
+
+#test test_findpath_models
+  /*
+    saddle energies and paths for longer refolding paths with different
+    search widths and energy models, pinned against the implementation
+    that evaluated every move by a full energy evaluation
+  */
+  const char  *sequences[] = {
+    "AGGAUUCCCAGCCGAAUUUAGAAGGAUGGCAGUUGUGUAUAGCCACCAACAGCACUAAGGCGCCCUAAUAUUGAAGGGGGUGCAGGUUGCCAAGCCGCCC",
+    "GCUUAAAUCUGUGGUUCAAGCCCGCACGUCUCGUCUUCGAACAGUUCAAGGCUAUCAAUACGCACGUCUCCAGCGGCAGCGCGCCGGCGCCAAUACCUGCAACUCUCGUUUCAGUCACUGUAGUUGACCUGGUUCAGGUGCGUGAGUAAG"
+  };
+  const char  *s1[] = {
+    ".((((((......))))))....((.((((.((((.((......)))))).(((((...(((((((..........))))))).))).))...)))))).",
+    "((((.((((...)))).))))...(((((...(((((.(((...)))))))).........((.(((.....))))).((((....))))....(((((.((((.(((.(((((...))).)).)))...))))))))))))))......"
+  };
+  const char  *s2[] = {
+    ".((....)).(((....((((..((.((((...........)))))).......))))))).((((........))))((.((.((((....))))))))",
+    "(((((...((((.(((..((.....((((..(((.((.((..((((...)))).)))).))).))))))..))).))))((((((...((((.((.((((((((........)))...))))).))...))))...)))))))))))..."
+  };
+  int           seq[]       = { 0, 0, 0, 0, 1, 1, 1 };
+  int           dangles[]   = { 2, 2, 0, 2, 2, 0, 2 };
+  int           noLP[]      = { 0, 0, 0, 1, 0, 1, 1 };
+  int           maxkeep[]   = { 1, 10, 10, 10, 8, 64, 64 };
+  int           saddle[]    = { 160, -560, -250, -560, -1135, -1230, -1280 };
+  int           length[]    = { 58, 58, 58, 58, 97, 97, 97 };
+  unsigned int  checksum[]  = { 3048339369U, 2207149348U, 3038382004U, 2207149348U, 4148980506U, 1123538343U, 2782347583U };
+  int           i, n;
+  vrna_md_t     md;
+  vrna_path_t           *path;
+  vrna_fold_compound_t  *vc;
+
+  for (i = 0; i < 7; i++) {
+    vrna_md_set_default(&md);
+    md.dangles  = dangles[i];
+    md.noLP     = noLP[i];
+
+    vc = vrna_fold_compound(sequences[seq[i]], &md, VRNA_OPTION_EVAL_ONLY);
+
+    ck_assert_int_eq(vrna_path_findpath_saddle(vc, s1[seq[i]], s2[seq[i]], maxkeep[i]), saddle[i]);
+
+    path = vrna_path_findpath(vc, s1[seq[i]], s2[seq[i]], maxkeep[i]);
+    for (n = 0; path[n].s; n++);
+
+    ck_assert_int_eq(n, length[i]);
+    ck_assert(checksum_path(path) == checksum[i]);
+
+    free_path_list(path);
+    vrna_fold_compound_free(vc);
+  }
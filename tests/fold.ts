@@ -1,5 +1,9 @@
 #include <stdio.h>      /* printf, scanf, NULL */
 #include <stdlib.h>     /* malloc, free, rand */
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #include <ViennaRNA/fold_vars.h>
 #include <ViennaRNA/data_structures.h>
@@ -7,7 +11,122 @@
 #include <ViennaRNA/structure_utils.h>
 #include <ViennaRNA/constraints.h>
 #include <ViennaRNA/fold.h>
+#include <ViennaRNA/eval.h>
 #include <ViennaRNA/part_func.h>
+#include <ViennaRNA/part_func_co.h>
+#include <ViennaRNA/equilibrium_probs.h>
+#include <ViennaRNA/mfe.h>
+#include <ViennaRNA/params.h>
+#include <ViennaRNA/batch.h>
+#include <ViennaRNA/LPfold.h>
+#include <ViennaRNA/boltzmann_sampling.h>
+
+static char
+hc_allow_all(int i, int j, int k, int l, char d, void *data)
+{
+  return (char)1;
+}
+
+static FLT_OR_DBL
+sc_exp_penalty(int i, int j, int k, int l, char d, void *data)
+{
+  /* a mild penalty for pairs closing hairpins */
+  return (d == VRNA_DECOMP_PAIR_HP) ? (FLT_OR_DBL)0.5 : (FLT_OR_DBL)1.;
+}
+
+typedef struct {
+  int         n;
+  FLT_OR_DBL  **bpp;
+  FLT_OR_DBL  **up;
+} local_data;
+
+static void
+store_local_data(FLT_OR_DBL *pr, int pr_size, int i, int max, unsigned int type, void *data)
+{
+  int         j;
+  local_data  *d = (local_data *)data;
+
+  if (type & VRNA_PROBS_WINDOW_BPP) {
+    for (j = i + 1; j <= pr_size; j++)
+      d->bpp[i][j] = pr[j];
+  } else if (type & VRNA_PROBS_WINDOW_UP) {
+    for (j = 1; j <= pr_size; j++)
+      d->up[i][j] = pr[j];
+  }
+}
+
+static void
+store_band_data(FLT_OR_DBL *pr, int pr_size, int i, int max, unsigned int type, void *data)
+{
+  int         j;
+  local_data  *d = (local_data *)data;
+
+  if (type & VRNA_PROBS_WINDOW_BPP) {
+    for (j = i + 1; j <= MIN2(pr_size, i + max); j++)
+      d->bpp[i][j - i] = pr[j];
+  } else if (type & VRNA_PROBS_WINDOW_UP) {
+    for (j = 1; j <= pr_size; j++)
+      d->up[i][j] = pr[j];
+  }
+}
+
+typedef struct {
+  char          **hits;
+  unsigned int  num_hits;
+} hit_list;
+
+static void
+store_hit(int start, int end, const char *structure, float en, void *data)
+{
+  hit_list  *l = (hit_list *)data;
+
+  l->hits                 = (char **)vrna_realloc(l->hits, sizeof(char *) * (l->num_hits + 1));
+  l->hits[l->num_hits++]  = vrna_strdup_printf("%d %d %6.2f %s", start, end, en, structure);
+}
+
+typedef struct {
+  unsigned int  num_samples;
+  unsigned int  num_invalid;
+  int           n;
+  unsigned int  **pair_counts;
+  char          **structures;
+} sample_data;
+
+static void
+store_sample(const char *structure, void *data)
+{
+  int         i;
+  short       *pt;
+  sample_data *d = (sample_data *)data;
+
+  if ((int)strlen(structure) != d->n) {
+    d->num_invalid++;
+    return;
+  }
+
+  pt = vrna_ptable(structure);
+  for (i = 1; i <= d->n; i++)
+    if ((pt[i] > i) && (d->pair_counts))
+      d->pair_counts[i][pt[i]]++;
+
+  if (d->structures)
+    d->structures[d->num_samples] = strdup(structure);
+
+  d->num_samples++;
+  free(pt);
+}
+
+static char *
+random_sequence(int n)
+{
+  int   i;
+  char  *s = (char *)vrna_alloc(sizeof(char) * (n + 1));
+
+  for (i = 0; i < n; i++)
+    s[i] = "ACGU"[rand() % 4];
+
+  return s;
+}
 
 #suite  MFE_Prediction
 
@@ -22,8 +141,500 @@
   ck_assert(strcmp(str1, structure) == 0);
   free(structure);
 
+#tcase  Constraint_Free_Fast_Path
+
+#test test_fast_path_equivalence
+  /*
+   *  a hard constraint callback that allows everything forces the
+   *  generic recursions, so both paths must yield identical results
+   */
+  const char sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  char        *s1, *s2;
+  int         noGU;
+  double      mfe1, mfe2, g1, g2;
+  vrna_md_t   md;
+  vrna_fold_compound_t *vc1, *vc2;
+
+  for (noGU = 0; noGU <= 1; noGU++) {
+    vrna_md_set_default(&md);
+    md.noGUclosure  = noGU;
+    md.compute_bpp  = 0;
+
+    vc1 = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+    vc2 = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+    vrna_hc_add_f(vc2, &hc_allow_all);
+
+    s1    = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+    s2    = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+    mfe1  = (double)vrna_mfe(vc1, s1);
+    mfe2  = (double)vrna_mfe(vc2, s2);
+
+    ck_assert(mfe1 == mfe2);
+    ck_assert_str_eq(s1, s2);
+
+    vrna_exp_params_rescale(vc1, &mfe1);
+    vrna_exp_params_rescale(vc2, &mfe2);
+    g1  = (double)vrna_pf(vc1, NULL);
+    g2  = (double)vrna_pf(vc2, NULL);
+
+    ck_assert(g1 == g2);
+
+    free(s1);
+    free(s2);
+    vrna_fold_compound_free(vc1);
+    vrna_fold_compound_free(vc2);
+  }
+
+#tcase  Wavefront
+#test test_wavefront_mfe
+  /*
+   *  filling the matrices diagonal by diagonal must not change
+   *  a single bit of the result
+   */
+  const char  *sequences[] = {
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "GGGGAAGGGGAAGGGGAAGGGGCCAUUAGCUAGCUGGGUUUGGGUUUGGGUUUGGGAUCGAUGCCCCAAAAUUUUGGGGAAACCCC",
+    NULL
+  };
+  char        *s1, *s2;
+  int         k, circ, gquad, noLP, dangles;
+  float       mfe1, mfe2;
+  vrna_md_t   md;
+  vrna_fold_compound_t *vc1, *vc2;
+
+  for (k = 0; sequences[k]; k++)
+    for (circ = 0; circ <= 1; circ++)
+      for (gquad = 0; gquad <= 1; gquad++)
+      for (noLP = 0; noLP <= 1; noLP++)
+      for (dangles = 0; dangles <= 3; dangles++) {
+        if (circ && gquad) /* not supported by the recursions */
+          continue;
+
+        vrna_md_set_default(&md);
+        md.circ       = circ;
+        md.gquad      = gquad;
+        md.noLP       = noLP;
+        md.dangles    = dangles;
+        md.wavefront  = 0;
+        vc1           = vrna_fold_compound(sequences[k], &md, VRNA_OPTION_MFE);
+        md.wavefront  = 1;
+        vc2           = vrna_fold_compound(sequences[k], &md, VRNA_OPTION_MFE);
+
+        s1    = (char *)vrna_alloc(sizeof(char) * (strlen(sequences[k]) + 1));
+        s2    = (char *)vrna_alloc(sizeof(char) * (strlen(sequences[k]) + 1));
+        mfe1  = vrna_mfe(vc1, s1);
+        mfe2  = vrna_mfe(vc2, s2);
+
+        ck_assert(mfe1 == mfe2);
+        ck_assert_str_eq(s1, s2);
+
+        free(s1);
+        free(s2);
+        vrna_fold_compound_free(vc1);
+        vrna_fold_compound_free(vc2);
+      }
+
+#tcase  Compact_Matrices
+
+#test test_compact_matrices
+  const char sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const char  *alignment[] = { sequence, sequence, NULL };
+  char        *s1, *s2;
+  int         dangles, noLP, circ, gquad, with_sc;
+  float       mfe1, mfe2;
+  vrna_md_t   md;
+  vrna_fold_compound_t *vc1, *vc2;
+
+  /* the compact matrices are handled by the same recursions as the default ones */
+  for (dangles = 0; dangles <= 3; dangles++) {
+    for (noLP = 0; noLP <= 1; noLP++) {
+      for (circ = 0; circ <= 1; circ++) {
+        for (gquad = 0; gquad <= 1; gquad++) {
+          for (with_sc = 0; with_sc <= 1; with_sc++) {
+            /* circular folding supports neither gquads nor unpaired soft constraints */
+            if (circ && (gquad || with_sc))
+              continue;
+
+            vrna_md_set_default(&md);
+            md.dangles  = dangles;
+            md.noLP     = noLP;
+            md.circ     = circ;
+            md.gquad    = gquad;
+
+            vc1 = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+            vc2 = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+            vrna_mx_mfe_add(vc2, VRNA_MX_COMPACT, VRNA_OPTION_MFE);
+
+            if (with_sc) {
+              vrna_sc_add_up(vc1, 42, -1.5, VRNA_OPTION_DEFAULT);
+              vrna_sc_add_up(vc2, 42, -1.5, VRNA_OPTION_DEFAULT);
+            }
+
+            s1    = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+            s2    = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+            mfe1  = vrna_mfe(vc1, s1);
+            mfe2  = vrna_mfe(vc2, s2);
+
+            ck_assert(vc2->matrices->type == VRNA_MX_COMPACT);
+            ck_assert(mfe1 == mfe2);
+            ck_assert_str_eq(s1, s2);
+
+            free(s1);
+            free(s2);
+            vrna_fold_compound_free(vc1);
+            vrna_fold_compound_free(vc2);
+          }
+        }
+      }
+    }
+  }
+
+  /* recursions without matrix accessors transparently fall back to the default matrices */
+  vrna_md_set_default(&md);
+  vc1 = vrna_fold_compound_comparative(alignment, &md, VRNA_OPTION_MFE);
+  vrna_mx_mfe_add(vc1, VRNA_MX_COMPACT, VRNA_OPTION_MFE);
+  s1 = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+  vrna_mfe(vc1, s1);
+  ck_assert(vc1->matrices->type == VRNA_MX_DEFAULT);
+  free(s1);
+  vrna_fold_compound_free(vc1);
+
+#tcase  Reset_Sequence
+
+#test test_reset_sequence
+  /* re-targeting a fold compound must yield the same results as a fresh one */
+  const char  *sequences[] = {
+    "CGCAGGGAUACCCGCG",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "GGGGAAAACCCCAUCGAUAGCUAGCUAGGCAUCGAUUAGC",
+    NULL
+  };
+  char        *s1, *s2;
+  int         k;
+  double      mfe1, mfe2, g1, g2;
+  vrna_md_t   md;
+  vrna_fold_compound_t *vc1, *vc2;
+
+  vrna_md_set_default(&md);
+  md.compute_bpp = 0;
+
+  vc1 = vrna_fold_compound("GGGAAAUCC", &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+  for (k = 0; sequences[k]; k++) {
+    ck_assert_int_eq(vrna_fold_compound_reset_sequence(vc1, sequences[k]), 1);
+    ck_assert_int_eq(vc1->length, strlen(sequences[k]));
+
+    vc2 = vrna_fold_compound(sequences[k], &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+    /* the scaling factor of the previous sequence must not survive */
+    ck_assert(vc1->exp_params->pf_scale == vc2->exp_params->pf_scale);
+
+    s1    = (char *)vrna_alloc(sizeof(char) * (strlen(sequences[k]) + 1));
+    s2    = (char *)vrna_alloc(sizeof(char) * (strlen(sequences[k]) + 1));
+    mfe1  = (double)vrna_mfe(vc1, s1);
+    mfe2  = (double)vrna_mfe(vc2, s2);
+
+    ck_assert(mfe1 == mfe2);
+    ck_assert_str_eq(s1, s2);
+
+    vrna_exp_params_rescale(vc1, &mfe1);
+    vrna_exp_params_rescale(vc2, &mfe2);
+    g1  = (double)vrna_pf(vc1, NULL);
+    g2  = (double)vrna_pf(vc2, NULL);
+
+    ck_assert(g1 == g2);
+
+    free(s1);
+    free(s2);
+    vrna_fold_compound_free(vc2);
+  }
+
+  /* concatenated sequences are rejected */
+  ck_assert_int_eq(vrna_fold_compound_reset_sequence(vc1, "GGGAAA&UUUCCC"), 0);
+
+  vrna_fold_compound_free(vc1);
+
+#tcase  Shared_Parameters
+
+#test test_shared_parameters
+  const char  sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  char        *s1, *s2;
+  float       mfe1, mfe2;
+  vrna_md_t   md;
+  vrna_param_t          *P, *P2;
+  vrna_fold_compound_t  *vc1, *vc2;
+
+  vrna_md_set_default(&md);
+
+  vc1 = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+  vc2 = vrna_fold_compound("GGGAAAUCC", &md, VRNA_OPTION_MFE);
+
+  /* equal model details result in the same energy parameters */
+  ck_assert(vc1->params == vc2->params);
+
+  /* the window size is not part of the key, but any other setting is */
+  md.window_size = 42;
+  P = vrna_params_shared(&md);
+  ck_assert(P == vc1->params);
+  vrna_params_release(P);
+
+  md.window_size  = VRNA_MODEL_DEFAULT_WINDOW_SIZE;
+  md.pf_float     = !VRNA_MODEL_DEFAULT_PF_FLOAT;
+  P               = vrna_params_shared(&md);
+  ck_assert(P != vc1->params);
+  vrna_params_release(P);
+  md.pf_float = VRNA_MODEL_DEFAULT_PF_FLOAT;
+
+  /* but a modified copy must not affect other fold compounds */
+  P = vc2->params;
+  vrna_params_detach(vc2);
+  ck_assert(vc2->params != P);
+  ck_assert(vc1->params == P);
+  vrna_fold_compound_free(vc2);
+
+  /* results are the same as for private energy parameters */
+  vc2 = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+  vrna_params_subst(vc2, vc1->params);
+  ck_assert(vc1->params != vc2->params);
+
+  s1    = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+  s2    = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+  mfe1  = vrna_mfe(vc1, s1);
+  mfe2  = vrna_mfe(vc2, s2);
+
+  ck_assert(mfe1 == mfe2);
+  ck_assert_str_eq(s1, s2);
+
+  /* the deprecated eval wrappers must not modify the parameters they are handed */
+  md.window_size  = 42;
+  P               = vrna_params(&md);
+  md.window_size  = 7;
+  P2              = vrna_params(&md);
+  ck_assert(energy_of_struct_par(sequence, s1, P, 0) == mfe1);
+  ck_assert(energy_of_struct_par(sequence, s1, P2, 0) == mfe1);
+  ck_assert(P2->model_details.window_size == 7);
+  vrna_params_release(P);
+  vrna_params_release(P2);
+  md.window_size = VRNA_MODEL_DEFAULT_WINDOW_SIZE;
+
+  free(s1);
+  free(s2);
+  vrna_fold_compound_free(vc1);
+  vrna_fold_compound_free(vc2);
+
+  vrna_params_cache_clear();
+
+#tcase  Batch_Processing
+
+#test test_mfe_batch
+  const char  *sequences[] = {
+    "GGGAAAUCC",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "GGGGAAAACCCC&GGGGAAAACCCC",
+    "CGCAGGGAUACCCGCG",
+    NULL
+  };
+  char        *structures[4], *s;
+  float       *mfe, e;
+  int         i;
+  vrna_fold_compound_t  *vc;
+
+  mfe = vrna_mfe_batch(sequences, NULL, structures);
+
+  ck_assert(mfe != NULL);
+
+  /* results are returned in input order and match the serial predictions */
+  for (i = 0; sequences[i]; i++) {
+    vc  = vrna_fold_compound(sequences[i], NULL, VRNA_OPTION_MFE | VRNA_OPTION_HYBRID);
+    s   = (char *)vrna_alloc(sizeof(char) * (vc->length + 1));
+    e   = vrna_mfe_dimer(vc, s);
+
+    ck_assert(mfe[i] == e);
+    ck_assert_str_eq(structures[i], s);
+
+    free(s);
+    free(structures[i]);
+    vrna_fold_compound_free(vc);
+  }
+
+  free(mfe);
+
+#test test_pf_batch
+  const char  *sequences[] = {
+    "GGGAAAUCC",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "GGGGAAAACCCC&GGGGAAAACCCC",
+    "CGCAGGGAUACCCGCG",
+    NULL
+  };
+  float       *mfe, *G1, *G2;
+  double      e, g;
+  int         i;
+  vrna_fold_compound_t  *vc;
+
+  mfe = vrna_mfe_batch(sequences, NULL, NULL);
+  G1  = vrna_pf_batch(sequences, NULL, mfe, NULL);
+  G2  = vrna_pf_batch(sequences, NULL, NULL, NULL);
+
+  ck_assert((G1 != NULL) && (G2 != NULL));
+
+  /* the ensemble free energy does not depend on the scaling factor */
+  for (i = 0; sequences[i]; i++) {
+    vc  = vrna_fold_compound(sequences[i], NULL, VRNA_OPTION_MFE | VRNA_OPTION_PF | VRNA_OPTION_HYBRID);
+    e   = (double)vrna_mfe_dimer(vc, NULL);
+    vrna_exp_params_rescale(vc, &e);
+    g   = vrna_pf_dimer(vc, NULL).FAB;
+
+    ck_assert(fabs(G1[i] - g) < 1e-4);
+    ck_assert(fabs(G2[i] - g) < 1e-4);
+
+    vrna_fold_compound_free(vc);
+  }
+
+  free(mfe);
+  free(G1);
+  free(G2);
+
+#tcase  Local_Chunks
+
+#test test_mfe_window_parallel
+  char          *sequence;
+  unsigned int  i;
+  float         e1, e2;
+  hit_list      serial, chunked;
+  vrna_md_t     md;
+  vrna_fold_compound_t  *vc;
+
+  srand(42);
+  sequence = random_sequence(12000);
+
+  vrna_md_set_default(&md);
+  md.window_size  = 30;
+  md.max_bp_span  = 30;
+
+  serial.hits     = chunked.hits = NULL;
+  serial.num_hits = chunked.num_hits = 0;
+
+  vc  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_WINDOW);
+  e1  = vrna_mfe_window_cb(vc, &store_hit, &serial);
+  vrna_fold_compound_free(vc);
+
+  vc  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_WINDOW);
+  e2  = vrna_mfe_window_parallel_cb(vc, &store_hit, &chunked);
+  vrna_fold_compound_free(vc);
+
+  /* chunked processing must report the very same structures in the very same order */
+  ck_assert(e1 == e2);
+  ck_assert_int_eq(chunked.num_hits, serial.num_hits);
+  for (i = 0; i < serial.num_hits; i++) {
+    ck_assert_str_eq(chunked.hits[i], serial.hits[i]);
+    free(serial.hits[i]);
+    free(chunked.hits[i]);
+  }
+
+  free(serial.hits);
+  free(chunked.hits);
+  free(sequence);
+
 #suite  Partition_Function
 
+#tcase  Wavefront
+#test test_wavefront_pf
+  const char  *sequences[] = {
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "GGGGAAGGGGAAGGGGAAGGGGCCAUUAGCUAGCUGGGUUUGGGUUUGGGUUUGGGAUCGAUGCCCCAAAAUUUUGGGGAAACCCC",
+    NULL
+  };
+  int         k, n, circ, gquad, uniq_ML;
+  double      mfe, g1, g2;
+  vrna_md_t   md;
+  vrna_fold_compound_t *vc1, *vc2;
+
+  for (k = 0; sequences[k]; k++)
+    for (circ = 0; circ <= 1; circ++)
+      for (gquad = 0; gquad <= 1; gquad++)
+      for (uniq_ML = 0; uniq_ML <= 1; uniq_ML++) {
+        if (circ && gquad)
+          continue;
+
+        vrna_md_set_default(&md);
+        md.circ         = circ;
+        md.gquad        = gquad;
+        md.uniq_ML      = uniq_ML;
+        md.compute_bpp  = 0;
+        md.wavefront    = 0;
+        vc1             = vrna_fold_compound(sequences[k], &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+        md.wavefront    = 1;
+        vc2             = vrna_fold_compound(sequences[k], &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+        mfe = (double)vrna_mfe(vc1, NULL);
+        vrna_exp_params_rescale(vc1, &mfe);
+        vrna_exp_params_rescale(vc2, &mfe);
+        g1  = (double)vrna_pf(vc1, NULL);
+        g2  = (double)vrna_pf(vc2, NULL);
+
+        ck_assert(g1 == g2);
+
+        /* the wavefront fill uses qm1 as helper array whenever it is present */
+        if (circ || uniq_ML) {
+          n = (int)strlen(sequences[k]);
+          ck_assert(vc2->exp_matrices->qm1 != NULL);
+          ck_assert(memcmp(vc1->exp_matrices->qm1,
+                           vc2->exp_matrices->qm1,
+                           sizeof(FLT_OR_DBL) * (vc1->jindx[n] + n + 1)) == 0);
+        }
+
+        vrna_fold_compound_free(vc1);
+        vrna_fold_compound_free(vc2);
+      }
+
+#test test_wavefront_bpp
+  const char  sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  int         i, j, n, with_sc, identical, *iindx;
+  double      mfe;
+  FLT_OR_DBL  *p1, *p2;
+  vrna_md_t   md;
+  vrna_fold_compound_t *vc1, *vc2;
+
+  n = (int)strlen(sequence);
+
+  /* the soft constraint callback forces the serial outside recursion */
+  for (with_sc = 0; with_sc <= 1; with_sc++) {
+    vrna_md_set_default(&md);
+    md.wavefront  = 0;
+    vc1           = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+    md.wavefront  = 1;
+    vc2           = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+    if (with_sc) {
+      vrna_sc_add_exp_f(vc1, &sc_exp_penalty);
+      vrna_sc_add_exp_f(vc2, &sc_exp_penalty);
+      ck_assert(vrna_fold_compound_has_callbacks(vc2) == 1);
+    } else {
+      ck_assert(vrna_fold_compound_has_callbacks(vc2) == 0);
+    }
+
+    mfe = (double)vrna_mfe(vc1, NULL);
+    vrna_exp_params_rescale(vc1, &mfe);
+    vrna_exp_params_rescale(vc2, &mfe);
+    vrna_pf(vc1, NULL);
+    vrna_pf(vc2, NULL);
+
+    p1        = vc1->exp_matrices->probs;
+    p2        = vc2->exp_matrices->probs;
+    iindx     = vc1->iindx;
+    identical = 1;
+    for (i = 1; i < n; i++)
+      for (j = i + 1; j <= n; j++)
+        if (memcmp(p1 + iindx[i] - j, p2 + iindx[i] - j, sizeof(FLT_OR_DBL)) != 0)
+          identical = 0;
+
+    ck_assert(identical == 1);
+
+    vrna_fold_compound_free(vc1);
+    vrna_fold_compound_free(vc2);
+  }
+
 #tcase Stochastic_Backtracking
 
 #test test_sample_structure
@@ -50,6 +661,429 @@
 
   vrna_fold_compound_free(vc);
 
+#test test_sample_structure_batch
+  vrna_md_t md;
+  vrna_fold_compound_t *vc;
+  const char sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const char  hairpin[] = "GGGGAAAACCCC";
+  int         i, j, n;
+  unsigned int count, num_samples = 10000;
+  FLT_OR_DBL  *probs;
+  sample_data data;
+
+  n = (int)sizeof(sequence) - 1;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+  vrna_pf(vc, NULL);
+
+  data.n            = n;
+  data.num_samples  = 0;
+  data.num_invalid  = 0;
+  data.structures   = NULL;
+  data.pair_counts  = (unsigned int **)vrna_alloc(sizeof(unsigned int *) * (n + 1));
+  for (i = 1; i <= n; i++)
+    data.pair_counts[i] = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (n + 1));
+
+  count = vrna_pbacktrack_cb(vc, num_samples, &store_sample, (void *)&data, VRNA_PBACKTRACK_DEFAULT);
+  ck_assert_int_eq(count, num_samples);
+  ck_assert_int_eq(data.num_samples, num_samples);
+  ck_assert_int_eq(data.num_invalid, 0);
+
+  /* pair frequencies must agree with the base pair probabilities */
+  probs = vc->exp_matrices->probs;
+  for (i = 1; i < n; i++)
+    for (j = i + 1; j <= n; j++)
+      ck_assert(fabs((double)data.pair_counts[i][j] / num_samples - probs[vc->iindx[i] - j]) < 0.03);
+
+  for (i = 1; i <= n; i++)
+    free(data.pair_counts[i]);
+  free(data.pair_counts);
+  vrna_fold_compound_free(vc);
+
+  /* sampling distinct structures of a small ensemble reports each structure once */
+  vc = vrna_fold_compound(hairpin, &md, VRNA_OPTION_PF);
+  vrna_pf(vc, NULL);
+
+  data.n            = (int)sizeof(hairpin) - 1;
+  data.num_samples  = 0;
+  data.pair_counts  = NULL;
+  data.structures   = (char **)vrna_alloc(sizeof(char *) * 1000);
+
+  count = vrna_pbacktrack_cb(vc, 1000, &store_sample, (void *)&data, VRNA_PBACKTRACK_DISTINCT);
+  ck_assert(count > 1);
+  ck_assert(count < 1000);
+  ck_assert_int_eq(count, data.num_samples);
+  ck_assert_int_eq(data.num_invalid, 0);
+
+  for (i = 0; i < (int)count; i++)
+    for (j = i + 1; j < (int)count; j++)
+      ck_assert(strcmp(data.structures[i], data.structures[j]) != 0);
+
+  for (i = 0; i < (int)count; i++)
+    free(data.structures[i]);
+  free(data.structures);
+  vrna_fold_compound_free(vc);
+
+#tcase  Local_Probabilities
+
+#test test_probs_window
+  const char  sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  int         i, j, n, ulength;
+  double      **pU;
+  plist       *pl, *ptr;
+  local_data  data;
+  vrna_md_t   md;
+  vrna_fold_compound_t  *vc;
+
+  n       = (int)sizeof(sequence) - 1;
+  ulength = 10;
+
+  vrna_md_set_default(&md);
+  md.window_size  = 60;
+  md.max_bp_span  = 40;
+
+  data.n    = n;
+  data.bpp  = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  data.up   = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  for (i = 1; i <= n; i++) {
+    data.bpp[i] = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 1));
+    data.up[i]  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (ulength + 1));
+  }
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+  ck_assert_int_eq(vrna_probs_window(vc, ulength, VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP, &store_local_data, &data), 1);
+  vrna_fold_compound_free(vc);
+
+  /* the backward compatibility wrapper must yield the very same probabilities */
+  pU        = (double **)vrna_alloc(sizeof(double *) * (n + 2));
+  pU[0]     = (double *)vrna_alloc(sizeof(double) * 2);
+  pU[0][0]  = (double)ulength;
+
+  pl = pfl_fold((char *)sequence, md.window_size, md.max_bp_span, 1e-4, pU, NULL, NULL, NULL);
+
+  ck_assert(pl != NULL);
+  for (ptr = pl; ptr->i; ptr++) {
+    ck_assert(ptr->j - ptr->i <= md.max_bp_span);
+    ck_assert(ptr->p == (float)data.bpp[ptr->i][ptr->j]);
+  }
+
+  for (i = 1; i <= n; i++) {
+    for (j = 1; j <= MIN2(i, ulength); j++)
+      ck_assert(pU[i][j] == data.up[i][j]);
+    free(pU[i]);
+    free(data.bpp[i]);
+    free(data.up[i]);
+  }
+
+  free(pU[0]);
+  free(pU);
+  free(pl);
+  free(data.bpp);
+  free(data.up);
+
+#test test_probs_window_parallel
+  char        *sequence;
+  int         i, j, n, ulength;
+  local_data  serial, chunked;
+  vrna_md_t   md;
+  vrna_fold_compound_t  *vc;
+
+  srand(23);
+  n         = 5000;
+  ulength   = 10;
+  sequence  = random_sequence(n);
+
+  vrna_md_set_default(&md);
+  md.window_size  = 40;
+  md.max_bp_span  = 30;
+
+  serial.n    = chunked.n = n;
+  serial.bpp  = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  serial.up   = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  chunked.bpp = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  chunked.up  = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  for (i = 1; i <= n; i++) {
+    serial.bpp[i]   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (md.window_size + 1));
+    serial.up[i]    = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (ulength + 1));
+    chunked.bpp[i]  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (md.window_size + 1));
+    chunked.up[i]   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (ulength + 1));
+  }
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+  ck_assert_int_eq(vrna_probs_window(vc, ulength, VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP, &store_band_data, &serial), 1);
+  vrna_fold_compound_free(vc);
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+  ck_assert_int_eq(vrna_probs_window_parallel(vc, ulength, VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP, &store_band_data, &chunked), 1);
+  vrna_fold_compound_free(vc);
+
+  /* probabilities of each position only depend on the windows that contain it */
+  for (i = 1; i <= n; i++) {
+    for (j = 1; j <= md.window_size; j++)
+      ck_assert(chunked.bpp[i][j] == serial.bpp[i][j]);
+    for (j = 1; j <= MIN2(i, ulength); j++)
+      ck_assert(chunked.up[i][j] == serial.up[i][j]);
+    free(serial.bpp[i]);
+    free(serial.up[i]);
+    free(chunked.bpp[i]);
+    free(chunked.up[i]);
+  }
+
+  free(serial.bpp);
+  free(serial.up);
+  free(chunked.bpp);
+  free(chunked.up);
+  free(sequence);
+
+#test test_probs_window_float
+  char        *sequence;
+  int         i, j, n, ulength;
+  local_data  dbl, flt;
+  vrna_md_t   md;
+  vrna_fold_compound_t  *vc;
+
+  srand(42);
+  n         = 1000;
+  ulength   = 20;
+  sequence  = random_sequence(n);
+
+  vrna_md_set_default(&md);
+  md.window_size  = 150;
+  md.max_bp_span  = 100;
+
+  dbl.n   = flt.n = n;
+  dbl.bpp = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  dbl.up  = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  flt.bpp = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  flt.up  = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+  for (i = 1; i <= n; i++) {
+    dbl.bpp[i]  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (md.window_size + 1));
+    dbl.up[i]   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (ulength + 1));
+    flt.bpp[i]  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (md.window_size + 1));
+    flt.up[i]   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (ulength + 1));
+  }
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+  ck_assert_int_eq(vrna_probs_window(vc, ulength, VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP, &store_band_data, &dbl), 1);
+  vrna_fold_compound_free(vc);
+
+  md.pf_float = 1;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF | VRNA_OPTION_WINDOW);
+  ck_assert_int_eq(vrna_probs_window(vc, ulength, VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP, &store_band_data, &flt), 1);
+  vrna_fold_compound_free(vc);
+
+  /* single precision matrices only introduce small rounding errors */
+  for (i = 1; i <= n; i++) {
+    for (j = 1; j <= md.window_size; j++)
+      ck_assert(fabs(flt.bpp[i][j] - dbl.bpp[i][j]) < 1e-5);
+    for (j = 1; j <= MIN2(i, ulength); j++)
+      ck_assert(fabs(flt.up[i][j] - dbl.up[i][j]) < 1e-5);
+    free(dbl.bpp[i]);
+    free(dbl.up[i]);
+    free(flt.bpp[i]);
+    free(flt.up[i]);
+  }
+
+  free(dbl.bpp);
+  free(dbl.up);
+  free(flt.bpp);
+  free(flt.up);
+  free(sequence);
+
+#tcase  Scaling
+
+#test test_pf_rescale
+  const char  motif[] = "GGGCGCAUCCGCGGAUGCGCCCAUGC";
+  int         i, j, n = 600;
+  double      mfe, G_ref, G_small, G_large, kT;
+  char        *sequence;
+  vrna_md_t   md;
+  vrna_fold_compound_t  *ref, *small, *large;
+
+  sequence = (char *)vrna_alloc(sizeof(char) * (n + 1));
+  for (i = 0; i < n; i++)
+    sequence[i] = motif[(i * 7 + i / 26) % 26];
+
+  vrna_md_set_default(&md);
+  md.temperature = 0.;
+
+  ref = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+  mfe = (double)vrna_mfe(ref, NULL);
+  vrna_exp_params_rescale(ref, &mfe);
+  G_ref = (double)vrna_pf(ref, NULL);
+
+  /* no scaling at all overflows, a too large scaling factor underflows */
+  small = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+  small->exp_params->pf_scale = 1.;
+  vrna_exp_params_rescale(small, NULL);
+  G_small = (double)vrna_pf(small, NULL);
+
+  large = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+  kT    = large->exp_params->kT / 1000.;
+  large->exp_params->pf_scale = exp(-3. * mfe / kT / n);
+  vrna_exp_params_rescale(large, NULL);
+  G_large = (double)vrna_pf(large, NULL);
+
+  ck_assert(fabs(G_small - G_ref) < 1e-3);
+  ck_assert(fabs(G_large - G_ref) < 1e-3);
+
+  for (i = 1; i < n; i++)
+    for (j = i + 1; j <= n; j++) {
+      ck_assert(fabs(small->exp_matrices->probs[ref->iindx[i] - j] - ref->exp_matrices->probs[ref->iindx[i] - j]) < 1e-6);
+      ck_assert(fabs(large->exp_matrices->probs[ref->iindx[i] - j] - ref->exp_matrices->probs[ref->iindx[i] - j]) < 1e-6);
+    }
+
+  vrna_fold_compound_free(ref);
+  vrna_fold_compound_free(small);
+  vrna_fold_compound_free(large);
+  free(sequence);
+
+#test test_pf_rescale_range
+  /*
+   *  AU-rich stretches followed by GC-rich ones at low temperatures span a
+   *  range of Boltzmann weights that a single scaling factor barely covers.
+   *  Prefixes that silently underflowed used to result in NaN probabilities
+   *  or a free energy above the MFE. If no scaling factor fits at all, e.g.
+   *  1600 AU followed by 700 GC at 0 degrees, vrna_pf() must fail instead
+   */
+  int         au[]          = { 400, 300, 250 };
+  int         gc[]          = { 100, 60, 50 };
+  double      temperature[] = { -150., -200., -250. };
+  int         representable[] = { 1, 1, 0 };
+  int         i, j, k, n;
+  unsigned int  x;
+  double      mfe, G, p;
+  char        *sequence;
+  vrna_md_t   md;
+  vrna_fold_compound_t  *vc;
+
+  for (k = 0; k < 3; k++) {
+    n         = au[k] + gc[k];
+    sequence  = (char *)vrna_alloc(sizeof(char) * (n + 1));
+    for (x = 1, i = 0; i < n; i++) {
+      x           = x * 1103515245U + 12345U;
+      sequence[i] = ((i < au[k]) ? "AU" : "GC")[(x >> 16) & 1];
+    }
+
+    vrna_md_set_default(&md);
+    md.temperature = temperature[k];
+
+    vc  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+    mfe = (double)vrna_mfe(vc, NULL);
+    vrna_exp_params_rescale(vc, &mfe);
+    G   = (double)vrna_pf(vc, NULL);
+
+    if (representable[k]) {
+      ck_assert(G <= mfe);
+      ck_assert(G > mfe - 10.);
+      for (i = 1; i < n; i++)
+        for (j = i + 1; j <= n; j++) {
+          p = vc->exp_matrices->probs[vc->iindx[i] - j];
+          ck_assert((p >= 0.) && (p <= 1. + 1e-6));
+        }
+    } else {
+      ck_assert(G == (double)(float)(INF / 100.));
+    }
+
+    vrna_fold_compound_free(vc);
+    free(sequence);
+  }
+
+#tcase  Sparse_Probabilities
+
+#test test_pairing_probs_sparse
+  const char  motif[] = "GGGCGCAUCCGCGGAUGCGCCCAUGC";
+  int         i, n = 300;
+  char        *sequence;
+  vrna_md_t   md;
+  vrna_plist_t          *ref_pl, *pl;
+  vrna_fold_compound_t  *ref, *vc;
+
+  sequence = (char *)vrna_alloc(sizeof(char) * (n + 1));
+  for (i = 0; i < n; i++)
+    sequence[i] = motif[(i * 7 + i / 26) % 26];
+
+  vrna_md_set_default(&md);
+  ref = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+  vrna_pf(ref, NULL);
+  ref_pl = vrna_plist_from_probs(ref, 1e-4);
+
+  /* no dense probability matrix is attached to the fold compound */
+  md.compute_bpp = 0;
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+  vrna_pf(vc, NULL);
+  pl = vrna_pairing_probs_sparse(vc, 1e-4);
+
+  ck_assert(pl != NULL);
+  ck_assert(vc->exp_matrices->probs == NULL);
+
+  for (i = 0; ref_pl[i].i; i++) {
+    ck_assert_int_eq(pl[i].i, ref_pl[i].i);
+    ck_assert_int_eq(pl[i].j, ref_pl[i].j);
+    ck_assert(fabs(pl[i].p - ref_pl[i].p) < 1e-6);
+  }
+  ck_assert(i > 0);
+  ck_assert_int_eq(pl[i].i, 0);
+
+  free(pl);
+  free(ref_pl);
+  vrna_fold_compound_free(ref);
+  vrna_fold_compound_free(vc);
+  free(sequence);
+
+#test test_pairing_probs_sparse_memory
+  /* the outside pass must fit into the memory left after the forward recursion */
+  int           i, n = 3000;
+  long          pages;
+  size_t        dense, used;
+  char          *sequence;
+  FILE          *fp;
+  struct rlimit limit, old_limit;
+  vrna_md_t     md;
+  vrna_plist_t  *pl;
+  vrna_fold_compound_t  *vc;
+
+  srand(42);
+  sequence = random_sequence(n);
+
+  vrna_md_set_default(&md);
+  md.compute_bpp = 0;
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+  vrna_pf(vc, NULL);
+
+  /* the address space currently in use, only available on Linux */
+  fp = fopen("/proc/self/statm", "r");
+  if (fp) {
+    ck_assert_int_eq(fscanf(fp, "%ld", &pages), 1);
+    fclose(fp);
+
+    /* leave room for anything but another dense matrix of doubles */
+    dense = sizeof(FLT_OR_DBL) * (((size_t)n + 1) * (n + 2)) / 2;
+    used  = (size_t)pages * (size_t)sysconf(_SC_PAGESIZE);
+
+    getrlimit(RLIMIT_AS, &old_limit);
+    limit.rlim_cur  = used + dense / 2;
+    limit.rlim_max  = old_limit.rlim_max;
+    ck_assert_int_eq(setrlimit(RLIMIT_AS, &limit), 0);
+
+    pl = vrna_pairing_probs_sparse(vc, 1e-3);
+
+    setrlimit(RLIMIT_AS, &old_limit);
+
+    ck_assert(pl != NULL);
+    for (i = 0; pl[i].i; i++);
+    ck_assert(i > 0);
+
+    free(pl);
+  }
+
+  vrna_fold_compound_free(vc);
+  free(sequence);
+
 #suite  Constraints_Implementation
 
 #tcase  Soft_Constraints
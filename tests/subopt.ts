@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/data_structures.h>
+#include <ViennaRNA/utils.h>
+#include <ViennaRNA/subopt.h>
+
+typedef struct {
+  unsigned int  num;
+  unsigned int  max;
+  unsigned int  num_end;
+  SOLUTION      *sol;
+} subopt_list;
+
+static void
+store_subopt(const char *structure, float energy, void *data)
+{
+  subopt_list *l = (subopt_list *)data;
+
+  if (!structure) {
+    l->num_end++;
+    return;
+  }
+
+  if (l->num == l->max) {
+    l->max  = (l->max) ? 2 * l->max : 128;
+    l->sol  = (SOLUTION *)vrna_realloc(l->sol, sizeof(SOLUTION) * l->max);
+  }
+
+  l->sol[l->num].energy       = energy;
+  l->sol[l->num++].structure  = strdup(structure);
+}
+
+static int
+compare_subopt(const void *a, const void *b)
+{
+  if (((SOLUTION *)a)->energy > ((SOLUTION *)b)->energy)
+    return 1;
+  if (((SOLUTION *)a)->energy < ((SOLUTION *)b)->energy)
+    return -1;
+  return strcmp(((SOLUTION *)a)->structure, ((SOLUTION *)b)->structure);
+}
+
+static void
+free_subopt_list(subopt_list *l)
+{
+  unsigned int i;
+
+  for (i = 0; i < l->num; i++)
+    free(l->sol[i].structure);
+  free(l->sol);
+}
+
+/* checksum over structures and energies in the order they were reported */
+static unsigned int
+checksum_subopt(subopt_list *l)
+{
+  unsigned int  i, h = 2166136261U;
+  char          energy[16], *c;
+
+  for (i = 0; i < l->num; i++) {
+    for (c = l->sol[i].structure; *c; c++)
+      h = (h ^ (unsigned char)*c) * 16777619U;
+    sprintf(energy, " %6.2f\n", l->sol[i].energy);
+    for (c = energy; *c; c++)
+      h = (h ^ (unsigned char)*c) * 16777619U;
+  }
+
+  return h;
+}
+
+#suite Suboptimals
+
+#tcase Order
+
+#test test_subopt_cb_order
+  /*
+    vrna_subopt_cb() reports the structures in the order of its search.
+    Pin that order against the output of the implementation that
+    allocated every state and interval list separately
+  */
+  const char  *sequences[] = {
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGG",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGG",
+    "GCGCUUCGCCGCGCAUAGUCAGCUUCGAAGC&GCUUCGAAGCUGACUAGCGCGGCGAAGCGCA",
+    "GGGCUAUUAGCUCAGUUGGUUAGAGCGCACCCCUGAUAAGGGUGAGGUCGCUGAUUCGAAUUCAGCAUAGCCCA",
+    "AUGGGAGGGAAGGGAGGGUUUUCCCUCCCAAUGGGAGGGAAGGGAGGGUACGCAUCGAUGCGU",
+    NULL
+  };
+  int           dangles[]   = { 2, 0, 2, 2, 2 };
+  int           noLP[]      = { 0, 1, 0, 0, 0 };
+  int           uniq_ML[]   = { 1, 0, 1, 1, 1 };
+  int           circ[]      = { 0, 0, 0, 1, 0 };
+  int           gquad[]     = { 0, 0, 0, 0, 1 };
+  int           delta[]     = { 400, 500, 1000, 400, 700 };
+  unsigned int  num[]       = { 1812, 644, 252, 737, 232 };
+  unsigned int  checksum[]  = { 3396274127U, 3072229421U, 467823716U, 3310717371U, 506070480U };
+  int           i;
+  subopt_list   l;
+  vrna_md_t     md;
+  vrna_fold_compound_t  *vc;
+
+  for (i = 0; sequences[i]; i++) {
+    vrna_md_set_default(&md);
+    md.dangles  = dangles[i];
+    md.noLP     = noLP[i];
+    md.uniq_ML  = uniq_ML[i];
+    md.circ     = circ[i];
+    md.gquad    = gquad[i];
+
+    vc = vrna_fold_compound(sequences[i], &md, VRNA_OPTION_DEFAULT);
+
+    memset(&l, 0, sizeof(subopt_list));
+    vrna_subopt_cb(vc, delta[i], &store_subopt, (void *)&l);
+
+    ck_assert_int_eq(l.num_end, 1);
+    ck_assert_int_eq(l.num, num[i]);
+    ck_assert(checksum_subopt(&l) == checksum[i]);
+
+    free_subopt_list(&l);
+    vrna_fold_compound_free(vc);
+  }
+
+
+#tcase Parallel
+
+#test test_subopt_cb_parallel
+  const char  sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGG";
+  int         i, delta = 400;
+  subopt_list serial, parallel, sorted;
+  vrna_md_t   md;
+  vrna_fold_compound_t  *vc;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+
+  memset(&serial, 0, sizeof(subopt_list));
+  memset(&parallel, 0, sizeof(subopt_list));
+  memset(&sorted, 0, sizeof(subopt_list));
+
+  vrna_subopt_cb(vc, delta, &store_subopt, (void *)&serial);
+  vrna_subopt_cb_parallel(vc, delta, 0, &store_subopt, (void *)&parallel);
+  vrna_subopt_cb_parallel(vc, delta, 1, &store_subopt, (void *)&sorted);
+
+  ck_assert(serial.num > 1000);
+  ck_assert_int_eq(parallel.num, serial.num);
+  ck_assert_int_eq(sorted.num, serial.num);
+  ck_assert_int_eq(parallel.num_end, 1);
+  ck_assert_int_eq(sorted.num_end, 1);
+
+  /* same structures in any order, sorted output is ordered like vrna_subopt() */
+  qsort(serial.sol, serial.num, sizeof(SOLUTION), compare_subopt);
+  qsort(parallel.sol, parallel.num, sizeof(SOLUTION), compare_subopt);
+
+  for (i = 0; i < (int)serial.num; i++) {
+    ck_assert_str_eq(parallel.sol[i].structure, serial.sol[i].structure);
+    ck_assert(parallel.sol[i].energy == serial.sol[i].energy);
+    ck_assert_str_eq(sorted.sol[i].structure, serial.sol[i].structure);
+    ck_assert(sorted.sol[i].energy == serial.sol[i].energy);
+  }
+
+  free_subopt_list(&serial);
+  free_subopt_list(&parallel);
+  free_subopt_list(&sorted);
+  vrna_fold_compound_free(vc);
+
+#tcase Sorted
+
+#test test_subopt_cb_sorted
+  const char  sequence[] = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGG";
+  int         i, delta = 400;
+  subopt_list sorted;
+  vrna_md_t   md;
+  vrna_fold_compound_t    *vc;
+  vrna_subopt_solution_t  *sol;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+
+  memset(&sorted, 0, sizeof(subopt_list));
+
+  /* a tiny memory budget forces the structures to be sorted in temporary files */
+  vrna_subopt_cb_sorted(vc, delta, 1024, &store_subopt, (void *)&sorted);
+  sol = vrna_subopt(vc, delta, 1, NULL);
+
+  ck_assert_int_eq(sorted.num_end, 1);
+
+  for (i = 0; sol[i].structure; i++) {
+    ck_assert(i < (int)sorted.num);
+    ck_assert_str_eq(sorted.sol[i].structure, sol[i].structure);
+    ck_assert(sorted.sol[i].energy == sol[i].energy);
+    free(sol[i].structure);
+  }
+  ck_assert_int_eq(i, sorted.num);
+
+  free(sol);
+  free_subopt_list(&sorted);
+  vrna_fold_compound_free(vc);
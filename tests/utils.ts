@@ -1,7 +1,12 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include <ViennaRNA/model.h>
 #include <ViennaRNA/utils.h>
+#include <ViennaRNA/energy_const.h>
+#include <ViennaRNA/higher_order_functions.h>
+#include <ViennaRNA/file_formats_pU.h>
 
 #suite Utilities
 
@@ -184,3 +189,157 @@
   //@TODO: extend alphabeth
   //@TODO: details.noLP = 1
   //@TODO: idx_type = 1
+
+#tcase Higher_Order_Functions
+
+#test test_vrna_fun_zip_add_min
+  int count, i, en, expected, *e1, *e2;
+
+  e1 = (int *)vrna_alloc(sizeof(int) * 100);
+  e2 = (int *)vrna_alloc(sizeof(int) * 100);
+
+  srand(4711);
+  for (i = 0; i < 100; i++) {
+    e1[i] = (rand() % 7 == 0) ? INF : (rand() % 2000) - 1000;
+    e2[i] = (rand() % 5 == 0) ? INF : (rand() % 2000) - 1000;
+  }
+
+  /* cover all remainders of vectorized implementations */
+  for (count = 0; count <= 100; count++) {
+    for (expected = INF, i = 0; i < count; i++) {
+      if ((e1[i] != INF) && (e2[i] != INF)) {
+        en        = e1[i] + e2[i];
+        expected  = MIN2(expected, en);
+      }
+    }
+    ck_assert_int_eq(vrna_fun_zip_add_min(e1, e2, count), expected);
+  }
+
+  /* no valid pair at all */
+  for (i = 0; i < 100; i++)
+    e1[i] = INF;
+
+  ck_assert_int_eq(vrna_fun_zip_add_min(e1, e2, 100), INF);
+
+  free(e1);
+  free(e2);
+
+#test test_vrna_fun_zip_rmul_sum
+  int         count, i;
+  FLT_OR_DBL  expected, result, *e1, *e2;
+
+  e1  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * 100);
+  e2  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * 100);
+
+  srand(4711);
+  for (i = 0; i < 100; i++) {
+    e1[i] = (FLT_OR_DBL)rand() / RAND_MAX;
+    e2[i] = (FLT_OR_DBL)rand() / RAND_MAX;
+  }
+
+  for (count = 0; count <= 100; count++) {
+    for (expected = 0., i = 0; i < count; i++)
+      expected += e1[i] * e2[count - 1 - i];
+
+    result = vrna_fun_zip_rmul_sum(e1, e2, count);
+    ck_assert(result >= expected - 1e-5 * expected);
+    ck_assert(result <= expected + 1e-5 * expected);
+  }
+
+  free(e1);
+  free(e2);
+
+#tcase File_Formats
+
+#test test_pU_container
+  const char        *ids[] = { "target1", "target2", "t3" };
+  const int         lengths[] = { 50, 7, 120 };
+  const int         ulength = 10;
+  const char        *filename = "test_pU_container.bin";
+  unsigned int      precision;
+  int               s, i, u, n;
+  double            **pU[3], p, q, kT;
+  vrna_pU_writer_t  *writer;
+  vrna_pU_file_t    *pU_file;
+
+  kT = (37. + K0) * GASCONST / 1000.;
+
+  srand(4711);
+  for (s = 0; s < 3; s++) {
+    n     = lengths[s];
+    pU[s] = (double **)vrna_alloc(sizeof(double *) * (n + 1));
+    for (i = 1; i <= n; i++) {
+      pU[s][i] = (double *)vrna_alloc(sizeof(double) * (ulength + 2));
+      for (p = 1., u = 1; u <= MIN2(i, ulength); u++) {
+        p           *= (double)rand() / RAND_MAX;
+        pU[s][i][u] = (rand() % 10 == 0) ? 0. : p;
+      }
+    }
+  }
+
+  for (precision = VRNA_PU_FLOAT; precision <= VRNA_PU_UINT16; precision++) {
+    writer = vrna_file_pU_writer_open(filename, precision, kT);
+    ck_assert(writer != NULL);
+    for (s = 0; s < 3; s++)
+      ck_assert_int_eq(vrna_file_pU_write(writer, ids[s], pU[s], lengths[s], ulength), 1);
+    ck_assert_int_eq(vrna_file_pU_writer_close(writer), 1);
+
+    pU_file = vrna_file_pU_open(filename);
+    ck_assert(pU_file != NULL);
+    ck_assert_int_eq(vrna_file_pU_size(pU_file), 3);
+    ck_assert(vrna_file_pU_kT(pU_file) == kT);
+    ck_assert_int_eq(vrna_file_pU_find(pU_file, "unknown"), -1);
+
+    for (s = 0; s < 3; s++) {
+      ck_assert_int_eq(vrna_file_pU_find(pU_file, ids[s]), s);
+      ck_assert_str_eq(vrna_file_pU_id(pU_file, s), ids[s]);
+      ck_assert_int_eq(vrna_file_pU_length(pU_file, s), lengths[s]);
+      ck_assert_int_eq(vrna_file_pU_ulength(pU_file, s), ulength);
+
+      for (i = 1; i <= lengths[s]; i++)
+        for (u = 1; u <= ulength; u++) {
+          p = (u <= i) ? pU[s][i][u] : 0.;
+          q = vrna_file_pU_prob(pU_file, s, i, u);
+          if (precision == VRNA_PU_FLOAT) {
+            ck_assert(q == (double)(float)p);
+          } else if (p < 1e-25) {
+            ck_assert(q <= 1e-25);
+          } else {
+            ck_assert(fabs(q - p) <= 5e-4 * p);
+            ck_assert(fabs(vrna_file_pU_energy(pU_file, s, i, u) + kT * log(p)) < 1e-3);
+          }
+        }
+
+      /* out of range queries */
+      ck_assert(vrna_file_pU_prob(pU_file, s, 0, 1) == 0.);
+      ck_assert(vrna_file_pU_prob(pU_file, s, lengths[s] + 1, 1) == 0.);
+      ck_assert(vrna_file_pU_prob(pU_file, s, lengths[s], ulength + 1) == 0.);
+    }
+
+    vrna_file_pU_close(pU_file);
+  }
+
+  /* an existing container is only replaced once the new one is complete */
+  writer = vrna_file_pU_writer_open(filename, VRNA_PU_FLOAT, kT);
+  ck_assert(writer != NULL);
+  ck_assert_int_eq(vrna_file_pU_write(writer, ids[0], pU[0], lengths[0], ulength), 1);
+  pU_file = vrna_file_pU_open(filename);
+  ck_assert(pU_file != NULL);
+  ck_assert_int_eq(vrna_file_pU_size(pU_file), 3);
+  vrna_file_pU_close(pU_file);
+  ck_assert_int_eq(vrna_file_pU_writer_close(writer), 1);
+  pU_file = vrna_file_pU_open(filename);
+  ck_assert(pU_file != NULL);
+  ck_assert_int_eq(vrna_file_pU_size(pU_file), 1);
+  vrna_file_pU_close(pU_file);
+
+  /* anything else is rejected */
+  ck_assert(vrna_file_pU_open("test_pU_container.missing") == NULL);
+
+  remove(filename);
+
+  for (s = 0; s < 3; s++) {
+    for (i = 1; i <= lengths[s]; i++)
+      free(pU[s][i]);
+    free(pU[s]);
+  }